@@ -0,0 +1,97 @@
+#ifndef BOOK_H
+#define BOOK_H
+
+/**
+ * book.h - Polyglot Opening Books
+ *
+ * Purpose:
+ *   Lets the AI play opening moves straight from a book instead of
+ *   searching, and compiles weighted books from PGN collections and FEN
+ *   logs (including the FEN_FILES opening demonstrations).
+ *
+ * File format (Polyglot .bin, all integers big-endian):
+ *   16-byte entries sorted by key: uint64 key, uint16 move, uint16 weight,
+ *   uint32 learn. Moves pack to file (bits 0-2), to rank (3-5), from file
+ *   (6-8), from rank (9-11) and promotion (12-14: 1=N 2=B 3=R 4=Q);
+ *   castling is written as the king capturing its own rook (e1h1).
+ *
+ * Architecture:
+ *   - Keys are standard Polyglot keys (piece-square, castling, en passant
+ *     and side-to-move slots of the 781-entry Random64 table), so books
+ *     from other tools probe here and books written by
+ *     book_builder_write() work elsewhere. book_load_keys() replaces the
+ *     table for books made with a non-standard one
+ *   - Probing binary-searches the book file with pread(); the book is
+ *     never loaded into memory
+ *   - Every book move is checked against generate_legal_moves() before it
+ *     is played, so a corrupt or mismatched book cannot make illegal moves
+ *
+ * Dependencies:
+ *   - chess.h for ChessGame, Move and generate_legal_moves()
+ *   - game_record.h and pgn_utils.h for the builder's input games
+ */
+
+#include "chess.h"
+#include "game_record.h"
+
+#define BOOK_ENTRY_SIZE 16           // Bytes per book entry
+#define BOOK_KEY_COUNT 781           // Random keys in the Polyglot layout
+#define BOOK_MAX_MOVES 64            // Book moves returned for one position
+#define BOOK_DEFAULT_PLIES 20        // Plies per game added by the builder
+#define BOOK_DEFAULT_FILE "book.bin" // Default opening book file name
+
+/**
+ * Book - Open opening book file
+ */
+typedef struct {
+    int fd;                          // Book file descriptor (-1 when closed)
+    uint64_t entry_count;            // Number of 16-byte entries
+    uint64_t random_state;           // Generator for weighted move choice
+} Book;
+
+/**
+ * BookMove - One book move for a position
+ */
+typedef struct {
+    Move move;                       // Legal move (castling as king move)
+    uint16_t weight;                 // Relative weight from the book
+} BookMove;
+
+/**
+ * BookBuildEntry - One (position, move) occurrence collected by the builder
+ */
+typedef struct {
+    uint64_t key;                    // Polyglot key of the position
+    uint16_t move;                   // Polyglot-encoded move
+    uint32_t weight;                 // 2 per win, 1 per draw or unknown result
+} BookBuildEntry;
+
+/**
+ * BookBuilder - Accumulates weighted moves from games
+ */
+typedef struct {
+    BookBuildEntry *entries;
+    size_t count;
+    size_t capacity;
+    int max_plies;                   // Plies of each game added to the book
+    int games;                       // Games added so far
+} BookBuilder;
+
+// Keys
+bool book_load_keys(const char *path);  // Replace the built-in Polyglot keys (781 hex keys, one per line)
+uint64_t book_hash(const ChessGame *game);  // Polyglot key of a position
+
+// Reading
+bool book_open(Book *book, const char *path);  // Open a .bin book
+void book_close(Book *book);  // Close the book file
+int book_probe(const Book *book, ChessGame *game, BookMove moves[], int max_moves);  // Legal book moves, best first
+bool book_pick_move(Book *book, ChessGame *game, char *move_str);  // Weighted random book move as UCI text
+
+// Building
+void book_builder_init(BookBuilder *builder, int max_plies);  // Empty builder
+bool book_builder_add_record(BookBuilder *builder, const GameRecord *record, const char *result);  // Add one game
+int book_builder_add_file(BookBuilder *builder, const char *path);  // Add a .pgn, .fen or .cgr file; games added or -1
+int64_t book_builder_write(BookBuilder *builder, const char *path);  // Merge, sort and write; entries written or -1
+void book_builder_free(BookBuilder *builder);  // Release builder memory
+
+#endif // BOOK_H
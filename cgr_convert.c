@@ -0,0 +1,114 @@
+/**
+ * CGR_CONVERT.C - Binary Game Record Conversion Utility
+ *
+ * Converts between compact binary game records (.cgr), FEN logs and PGN.
+ * The direction is chosen from the file extensions.
+ *
+ * Usage: ./cgr_convert game.fen game.cgr        (FEN log to binary record)
+ *        ./cgr_convert game.cgr game.fen        (binary record to FEN log)
+ *        ./cgr_convert game.cgr game.pgn        (binary record to PGN)
+ *        ./cgr_convert game.cgr --ply N         (print FEN at ply N)
+ *
+ * PGN input is handled by pgn_to_fen: ./pgn_to_fen --cgr game.cgr game.pgn
+ *
+ * Features:
+ * - Records written with a keyframe index for fast seeking
+ * - Every recorded move is validated by the chess engine on replay
+ * - Seeking reads only the nearest keyframe and the moves after it
+ */
+
+#include "chess.h"
+#include "game_record.h"
+#include "pgn_utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Check whether a filename ends with the given extension (including dot)
+ */
+static bool has_extension(const char* filename, const char* extension) {
+    size_t name_len = strlen(filename);
+    size_t ext_len = strlen(extension);
+    return name_len > ext_len && strcmp(filename + name_len - ext_len, extension) == 0;
+}
+
+/**
+ * Write a record as PGN through the shared record-to-PGN generator
+ */
+static bool write_record_as_pgn(const GameRecord* record, const char* pgn_filename) {
+    char* pgn_content = convert_record_to_pgn_string(record, "*");
+    if (!pgn_content) return false;
+
+    FILE* pgn_file = fopen(pgn_filename, "w");
+    bool ok = pgn_file && fputs(pgn_content, pgn_file) >= 0;
+    if (pgn_file && fclose(pgn_file) != 0) ok = false;
+    free(pgn_content);
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 3 && argc != 4) {
+        fprintf(stderr, "Usage: %s input.fen output.cgr\n", argv[0]);
+        fprintf(stderr, "       %s input.cgr output.fen|output.pgn\n", argv[0]);
+        fprintf(stderr, "       %s input.cgr --ply N\n", argv[0]);
+        return 1;
+    }
+
+    const char* input = argv[1];
+
+    // Seek directly to one ply without loading the whole record
+    if (argc == 4 && strcmp(argv[2], "--ply") == 0) {
+        ChessGame game;
+        char fen[FEN_BUFFER_SIZE];
+        memset(&game, 0, sizeof(game));
+        if (!game_record_seek_file(input, atoi(argv[3]), &game)) {
+            fprintf(stderr, "Error: Cannot read ply %s from %s\n", argv[3], input);
+            return 1;
+        }
+        fen_write(&game, fen, sizeof(fen));
+        printf("%s\n", fen);
+        return 0;
+    }
+
+    const char* output = argv[2];
+    GameRecord record;
+
+    if (has_extension(output, ".cgr")) {
+        if (!game_record_from_fen_log(&record, input)) {
+            fprintf(stderr, "Error: %s is not a readable FEN log of consecutive positions\n", input);
+            return 1;
+        }
+        bool saved = game_record_save(&record, output, true);
+        printf("Converted %d plies to %s\n", record.ply_count, output);
+        game_record_free(&record);
+        if (!saved) {
+            fprintf(stderr, "Error: Cannot write %s\n", output);
+            return 1;
+        }
+        return 0;
+    }
+
+    if (!game_record_load(&record, input)) {
+        fprintf(stderr, "Error: %s is not a valid game record\n", input);
+        return 1;
+    }
+
+    bool ok;
+    if (has_extension(output, ".pgn")) {
+        ok = write_record_as_pgn(&record, output);
+    } else {
+        FILE* fen_file = fopen(output, "w");
+        ok = fen_file && game_record_write_fen_log(&record, fen_file);
+        if (fen_file && fclose(fen_file) != 0) ok = false;
+    }
+
+    if (ok) {
+        printf("Converted %d plies to %s\n", record.ply_count, output);
+    } else {
+        fprintf(stderr, "Error: Cannot convert %s to %s\n", input, output);
+    }
+
+    game_record_free(&record);
+    return ok ? 0 : 1;
+}
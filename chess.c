@@ -27,8 +27,11 @@
  * 1. BOARD MANAGEMENT & INITIALIZATION
  *    - init_board() - Initialize new chess game with standard starting positions
  *    - piece_to_char() - Convert piece to character representation
+ *    - get_board_highlights() - Last move, check and overlay masks
+ *    - get_move_highlights() - Destination masks for one piece
  *    - print_board() - Display board with color highlighting and move indicators
  *    - print_captured_pieces() - Display captured pieces with time controls
+ *    - set_hanging_overlay() - Toggle underlining of hanging pieces
  *
  * 2. POSITION & UTILITY FUNCTIONS
  *    - is_valid_position() - Check if row/col coordinates are within board
@@ -52,9 +55,12 @@
  *
  * 4. MOVE VALIDATION & GAME RULES
  *    - is_square_attacked() - Check if square is under attack by color
+ *    - static_exchange_eval() - Material balance of a capture sequence
+ *    - is_piece_hanging() - Check if a piece can be won by the opponent
  *    - is_in_check() - Check if king is in check
  *    - would_be_in_check_after_move() - Simulate move to check for check
  *    - is_valid_move() - Validate move legality and check prevention
+ *    - generate_legal_moves() - Full legal move list for the side to move
  *    - is_fifty_move_rule_draw() - Check 50-move rule draw condition
  *
  * 5. PAWN PROMOTION SYSTEM
@@ -68,23 +74,41 @@
  *    - execute_move() - Execute move from Move structure (AI/human)
  *
  * 7. FEN SYSTEM & BOARD SETUP
+ *    - fen_decode() - Single-pass FEN decoder with structured error reporting
+ *    - fen_error_string() - Human-readable description of a FEN error code
  *    - validate_fen_string() - Validate FEN format and structure
  *    - calculate_captured_pieces() - Calculate missing pieces vs starting position
- *    - parse_fen_board_position() - Parse piece placement field of FEN
- *    - parse_fen_metadata() - Parse active color, castling, en passant, counters
  *    - setup_board_from_fen() - Complete FEN parsing and game state setup
+ *    - fen_write() - Serialize game state to FEN in a single pass
  *
  * 8. TIME CONTROL SYSTEM
- *    - parse_time_control() - Parse time control string (xx/yy or xx/yy/zz/ww)
+ *    - parse_time_control() - Parse time control string (xx/yy, xx/yy/zz/ww or extended)
+ *    - describe_time_control() - Summarize a player's time control
  *    - init_game_timer() - Initialize timer with time control settings
  *    - start_move_timer() - Start timing current player's move
- *    - stop_move_timer() - Stop timer and apply increment
+ *    - stop_move_timer() - Stop timer, apply delay/increment, advance periods
  *    - get_remaining_time_string() - Format time as MM:SS string
+ *    - game_clock_ms() - Monotonic millisecond clock
+ *    - get_remaining_time_ms() - Time until flag-fall, including the running move
+ *    - format_player_clock() - Clock text as displayed (byoyomi included)
+ *    - get_clock_budget() - Remaining time, bonus and moves to go for engines
  *    - check_time_forfeit() - Check for time forfeit condition
  *    - is_time_control_enabled() - Check if time controls are active
+ *
+ * 9. POSITION HASHING
+ *    - position_hash() - 64-bit Zobrist hash of the position fields
  */
 
+#define _GNU_SOURCE        // Required for Linux (clock_gettime)
+
 #include "chess.h"
+#include "profile.h"
+#include "screen.h"
+#include <pthread.h>
+
+#include <strings.h>
+
+static bool show_hanging_pieces = false;   // get_board_highlights() hanging pieces overlay
 
 /******************************************************************************
  *                       BOARD MANAGEMENT & INITIALIZATION
@@ -134,6 +158,10 @@ void init_board(ChessGame *game) {
     game->en_passant_target.row = -1;
     game->en_passant_target.col = -1;
 
+    // No move has been made yet
+    memset(&game->last_move, 0, sizeof(game->last_move));
+    game->last_move.from.row = -1;
+
     // Define starting piece arrangements for back ranks
     // Standard chess setup: Rook, Knight, Bishop, Queen, King, Bishop, Knight, Rook
     Piece white_pieces[] = {
@@ -176,84 +204,154 @@ char piece_to_char(Piece piece) {
 }
 
 /**
- * Display the chess board with colored pieces and possible moves
- * Shows board coordinates, piece positions with color highlighting,
- * possible moves with '*' markers, and capturable pieces in inverted colors.
+ * Enable or disable the hanging pieces overlay
+ * When enabled, get_board_highlights() marks every piece either side would
+ * lose to a capture (see is_piece_hanging()) and print_board() underlines it.
+ *
+ * @param enabled true to show the overlay
+ */
+void set_hanging_overlay(bool enabled) {
+    show_hanging_pieces = enabled;
+}
+
+/**
+ * Check whether the hanging pieces overlay is enabled
+ *
+ * @return true if board highlights include hanging pieces
+ */
+bool is_hanging_overlay_enabled(void) {
+    return show_hanging_pieces;
+}
+
+/**
+ * Highlights every board display shows: the last move, a king in check
+ * and, when enabled, the hanging pieces overlay
+ *
+ * @param game Current game state
+ * @param highlights Output: masks for the position (moves and captures empty)
+ */
+void get_board_highlights(const ChessGame *game, BoardHighlights *highlights) {
+    memset(highlights, 0, sizeof(*highlights));
+
+    const Move *last = &game->last_move;
+    if (is_valid_position(last->from.row, last->from.col) && is_valid_position(last->to.row, last->to.col)) {
+        highlights->last_move = SQUARE_BIT(last->from.row, last->from.col) | SQUARE_BIT(last->to.row, last->to.col);
+    }
+
+    for (int color = WHITE; color <= BLACK; color++) {
+        Position king = color == WHITE ? game->white_king_pos : game->black_king_pos;
+        if (game->in_check[color] && is_valid_position(king.row, king.col)) {
+            highlights->check |= SQUARE_BIT(king.row, king.col);
+        }
+    }
+
+    if (show_hanging_pieces) {
+        for (int row = 0; row < BOARD_SIZE; row++) {
+            for (int col = 0; col < BOARD_SIZE; col++) {
+                if (is_piece_hanging(game, (Position){row, col})) highlights->hanging |= SQUARE_BIT(row, col);
+            }
+        }
+    }
+}
+
+/**
+ * Add the legal destinations of one piece to a set of highlights
+ * Empty destinations go to moves, occupied ones to captures, and the pawn
+ * an en passant capture would remove to en_passant.
+ *
+ * @param game Current game state
+ * @param from Square of the piece
+ * @param highlights Masks to add to
+ * @return Number of legal destinations
+ */
+int get_move_highlights(ChessGame *game, Position from, BoardHighlights *highlights) {
+    Position targets[MAX_POSSIBLE_MOVES];
+    int count = get_possible_moves(game, from, targets);
+    Piece piece = game->board[from.row][from.col];
+    int legal = 0;
+
+    for (int i = 0; i < count; i++) {
+        Position to = targets[i];
+        if (would_be_in_check_after_move(game, from, to)) continue;
+        legal++;
+
+        if (game->board[to.row][to.col].type != EMPTY) {
+            highlights->captures |= SQUARE_BIT(to.row, to.col);
+            continue;
+        }
+        highlights->moves |= SQUARE_BIT(to.row, to.col);
+
+        if (piece.type == PAWN && game->en_passant_available &&
+            to.row == game->en_passant_target.row && to.col == game->en_passant_target.col) {
+            highlights->en_passant |= SQUARE_BIT(from.row, to.col);
+        }
+    }
+    return legal;
+}
+
+/**
+ * Display the chess board with colored pieces and highlights
+ * Shows board coordinates and piece positions with color highlighting.
+ * Each square is drawn from a bit test on the highlight masks: possible
+ * moves as '*', capturable pieces in inverted colors, a king in check on
+ * red, the last move's squares shaded and hanging pieces underlined.
  * Also displays check status if applicable.
  *
  * @param game Current game state with board position
- * @param possible_moves Array of positions showing legal moves (NULL to hide moves)
- * @param move_count Number of positions in possible_moves array
+ * @param highlights Squares to mark (NULL for a plain board)
  */
-void print_board(ChessGame *game, Position possible_moves[], int move_count) {
-    printf("\n    a b c d e f g h\n");
-    printf("  +----------------+\n");
+void print_board(ChessGame *game, const BoardHighlights *highlights) {
+    static const BoardHighlights no_highlights = {0, 0, 0, 0, 0, 0};
+    if (!highlights) highlights = &no_highlights;
+    uint64_t inverted = highlights->captures | highlights->en_passant;
+
+    screen_printf("\n    a b c d e f g h\n");
+    screen_printf("  +----------------+\n");
 
     for (int row = 0; row < BOARD_SIZE; row++) {
-        printf("%d | ", 8 - row);
+        screen_printf("%d | ", 8 - row);
 
         for (int col = 0; col < BOARD_SIZE; col++) {
-            bool is_possible_move = false;
-            bool is_en_passant_capture = false;
-
-            if (possible_moves != NULL) {
-                for (int i = 0; i < move_count; i++) {
-                    if (possible_moves[i].row == row && possible_moves[i].col == col) {
-                        is_possible_move = true;
-                        break;
-                    }
-                }
-
-                // Check for en passant captured pawn highlighting
-                if (game->en_passant_available && !is_possible_move) {
-                    // Check if this position contains the pawn that would be captured by en passant
-                    Position en_passant_target = game->en_passant_target;
-                    int captured_pawn_row = (game->current_player == WHITE) ? en_passant_target.row + 1 : en_passant_target.row - 1;
-
-                    if (row == captured_pawn_row && col == en_passant_target.col) {
-                        // Check if any of the possible moves is the en passant target square
-                        for (int j = 0; j < move_count; j++) {
-                            if (possible_moves[j].row == en_passant_target.row &&
-                                possible_moves[j].col == en_passant_target.col) {
-                                is_en_passant_capture = true;
-                                break;
-                            }
-                        }
-                    }
-                }
-            }
-
+            uint64_t bit = SQUARE_BIT(row, col);
             char piece_char = piece_to_char(game->board[row][col]);
-            if (is_possible_move && piece_char == '.') {
-                printf("* ");
-            } else if (is_possible_move || is_en_passant_capture) {
-                // Capturable piece - use reverse/inverted colors for highlighting
-                if (piece_char >= 'A' && piece_char <= 'Z') {
-                    printf("%s%c%s ", COLOR_WHITE_PIECE_INVERTED, piece_char, SCREEN_RESET); // Inverted bold cyan for white pieces
+            bool white = piece_char >= 'A' && piece_char <= 'Z';
+
+            if (piece_char == '.') {
+                if (highlights->moves & bit) {
+                    screen_printf("* ");
+                } else if (highlights->last_move & bit) {
+                    screen_printf("%s.%s ", COLOR_LAST_MOVE, SCREEN_RESET);
                 } else {
-                    printf("%s%c%s ", COLOR_BLACK_PIECE_INVERTED, piece_char, SCREEN_RESET); // Inverted bold magenta for black pieces
+                    screen_printf(". ");
                 }
+            } else if (inverted & bit) {
+                // Capturable piece - use reverse/inverted colors for highlighting
+                screen_printf("%s%c%s ", white ? COLOR_WHITE_PIECE_INVERTED : COLOR_BLACK_PIECE_INVERTED, piece_char, SCREEN_RESET);
+            } else if (highlights->check & bit) {
+                screen_printf("%s%c%s ", COLOR_KING_IN_CHECK, piece_char, SCREEN_RESET);
+            } else if (highlights->hanging & bit) {
+                // Hanging piece - underline in the owner's color
+                screen_printf("%s%c%s ", white ? COLOR_WHITE_PIECE_HANGING : COLOR_BLACK_PIECE_HANGING, piece_char, SCREEN_RESET);
+            } else if (highlights->last_move & bit) {
+                screen_printf("%s%s%c%s ", white ? COLOR_WHITE_PIECE : COLOR_BLACK_PIECE, COLOR_LAST_MOVE, piece_char, SCREEN_RESET);
             } else {
-                if (piece_char != '.') {
-                    if (piece_char >= 'A' && piece_char <= 'Z') {
-                        printf("%s%c%s ", COLOR_WHITE_PIECE, piece_char, SCREEN_RESET); // White pieces in bold cyan
-                    } else {
-                        printf("%s%c%s ", COLOR_BLACK_PIECE, piece_char, SCREEN_RESET); // Black pieces in bold magenta
-                    }
-                } else {
-                    printf("%c ", piece_char);
-                }
+                // White pieces in bold cyan, Black pieces in bold magenta
+                screen_printf("%s%c%s ", white ? COLOR_WHITE_PIECE : COLOR_BLACK_PIECE, piece_char, SCREEN_RESET);
             }
         }
 
-        printf("| %d\n", 8 - row);
+        screen_printf("| %d\n", 8 - row);
     }
 
-    printf("  +----------------+\n");
-    printf("    a b c d e f g h\n");
+    screen_printf("  +----------------+\n");
+    screen_printf("    a b c d e f g h\n");
+
+    if (highlights->hanging) {
+        screen_printf("\n(underlined pieces are hanging: capturing them wins material)\n");
+    }
 
     if (game->in_check[game->current_player]) {
-        printf("\n*** %s KING IS IN CHECK! ***\n",
+        screen_printf("\n*** %s KING IS IN CHECK! ***\n",
                game->current_player == WHITE ? "WHITE" : "BLACK");
     }
 }
@@ -275,41 +373,28 @@ void print_captured_pieces(CapturedPieces *captured, const char* color_code, con
 
     // Display time if time controls are enabled
     if (is_time_control_enabled(game)) {
-        int current_time;
-        if (is_white) {
-            current_time = game->timer.white_time_seconds;
-            // If White is currently moving and timer is active, subtract elapsed time
-            if (game->current_player == WHITE && game->timer.timing_active) {
-                time_t now = time(NULL);
-                int elapsed = (int)(now - game->timer.move_start_time);
-                current_time -= elapsed;
-                if (current_time < 0) current_time = 0;
-            }
-        } else {
-            current_time = game->timer.black_time_seconds;
-            // If Black is currently moving and timer is active, subtract elapsed time
-            if (game->current_player == BLACK && game->timer.timing_active) {
-                time_t now = time(NULL);
-                int elapsed = (int)(now - game->timer.move_start_time);
-                current_time -= elapsed;
-                if (current_time < 0) current_time = 0;
-            }
-        }
-
-        printf("%s%s: %s%s | Captured: ", color_code, player_name,
-               get_remaining_time_string(current_time), SCREEN_RESET);
+        // Remaining time includes the running move; the clock text is a
+        // screen field so the clock ticker can update it in place
+        char clock_text[CLOCK_STRING_SIZE];
+        format_player_clock(game, is_white ? WHITE : BLACK, clock_text, sizeof(clock_text));
+
+        screen_printf("%s%s: ", color_code, player_name);
+        screen_field_begin(is_white ? CLOCK_FIELD_WHITE : CLOCK_FIELD_BLACK);
+        screen_printf("%s", clock_text);
+        screen_field_end(is_white ? CLOCK_FIELD_WHITE : CLOCK_FIELD_BLACK);
+        screen_printf("%s | Captured: ", SCREEN_RESET);
     } else {
-        printf("%s%s Captured:%s ", color_code, player_name, SCREEN_RESET);
+        screen_printf("%s%s Captured:%s ", color_code, player_name, SCREEN_RESET);
     }
 
     if (captured->count == 0) {
-        printf("%sNone%s", color_code, SCREEN_RESET);
+        screen_printf("%sNone%s", color_code, SCREEN_RESET);
     } else {
         for (int i = 0; i < captured->count; i++) {
-            printf("%c ", piece_to_char(captured->captured_pieces[i]));  // All captured pieces in normal black text
+            screen_printf("%c ", piece_to_char(captured->captured_pieces[i]));  // All captured pieces in normal black text
         }
     }
-    printf("\n");
+    screen_printf("\n");
 }
 
 
@@ -768,8 +853,10 @@ int get_possible_moves(ChessGame *game, Position from, Position moves[]) {
 
 /**
  * Check if a square is under attack by pieces of a given color
- * Tests whether any piece of the specified color can move to the target square.
- * Used for check detection, castling validation, and move legality.
+ * Looks outward from the target square: pawn and knight squares, the
+ * adjacent king squares, and the first piece along each rook and bishop
+ * line. Works for empty squares too (castling path checks), where only
+ * diagonal pawn attacks count.
  *
  * @param game Current game state
  * @param pos Position of square to check
@@ -777,37 +864,239 @@ int get_possible_moves(ChessGame *game, Position from, Position moves[]) {
  * @return true if square is attacked by specified color, false otherwise
  */
 bool is_square_attacked(ChessGame *game, Position pos, Color by_color) {
-    for (int row = 0; row < BOARD_SIZE; row++) {
-        for (int col = 0; col < BOARD_SIZE; col++) {
-            if (is_piece_at(game, row, col)) {
-                Piece piece = get_piece_at(game, row, col);
-                if (piece.color == by_color) {
-                    Position moves[64];
-                    Color original_player = game->current_player;
-                    game->current_player = by_color;
-
-                    int move_count;
-                    // Use special king function to avoid infinite recursion
-                    if (piece.type == KING) {
-                        move_count = get_king_moves_no_castling(game, (Position){row, col}, moves);
-                    } else {
-                        move_count = get_possible_moves(game, (Position){row, col}, moves);
-                    }
+    static const int knight_steps[8][2] = {{-2, -1}, {-2, 1}, {-1, -2}, {-1, 2}, {1, -2}, {1, 2}, {2, -1}, {2, 1}};
+    static const int king_steps[8][2] = {{-1, -1}, {-1, 0}, {-1, 1}, {0, -1}, {0, 1}, {1, -1}, {1, 0}, {1, 1}};
+
+    // Pawns attack diagonally forward, so an attacker stands one row behind
+    int pawn_row = pos.row + (by_color == WHITE ? 1 : -1);
+    for (int side = -1; side <= 1; side += 2) {
+        int col = pos.col + side;
+        if (is_valid_position(pawn_row, col)) {
+            Piece piece = game->board[pawn_row][col];
+            if (piece.type == PAWN && piece.color == by_color) return true;
+        }
+    }
 
-                    game->current_player = original_player;
+    for (int i = 0; i < 8; i++) {
+        int row = pos.row + knight_steps[i][0], col = pos.col + knight_steps[i][1];
+        if (is_valid_position(row, col)) {
+            Piece piece = game->board[row][col];
+            if (piece.type == KNIGHT && piece.color == by_color) return true;
+        }
 
-                    for (int i = 0; i < move_count; i++) {
-                        if (moves[i].row == pos.row && moves[i].col == pos.col) {
-                            return true;
-                        }
-                    }
+        row = pos.row + king_steps[i][0];
+        col = pos.col + king_steps[i][1];
+        if (is_valid_position(row, col)) {
+            Piece piece = game->board[row][col];
+            if (piece.type == KING && piece.color == by_color) return true;
+        }
+    }
+
+    // Sliders: the first piece on each line (king_steps doubles as the 8 directions)
+    for (int i = 0; i < 8; i++) {
+        bool diagonal = king_steps[i][0] != 0 && king_steps[i][1] != 0;
+        int row = pos.row + king_steps[i][0], col = pos.col + king_steps[i][1];
+
+        while (is_valid_position(row, col)) {
+            Piece piece = game->board[row][col];
+            if (piece.type != EMPTY) {
+                if (piece.color == by_color &&
+                    (piece.type == QUEEN || piece.type == (diagonal ? BISHOP : ROOK))) {
+                    return true;
+                }
+                break;
+            }
+            row += king_steps[i][0];
+            col += king_steps[i][1];
+        }
+    }
+    return false;
+}
+
+/**
+ * Piece values used by static_exchange_eval() (centipawns, indexed by PieceType)
+ * The king is worth more than everything else combined, so capturing it
+ * always ends an exchange.
+ */
+static const int SEE_PIECE_VALUE[7] = {0, 100, 500, 320, 330, 900, 20000};
+
+/**
+ * Find the least valuable piece of a color attacking a square
+ * Works on a scratch board, so pieces removed by earlier captures in an
+ * exchange uncover the sliders behind them (x-rays).
+ *
+ * @param board Scratch board
+ * @param target Square being fought over
+ * @param by_color Color of the attackers
+ * @param from Output: square of the least valuable attacker
+ * @return true if any piece of by_color attacks target
+ */
+static bool see_least_attacker(Piece board[BOARD_SIZE][BOARD_SIZE], Position target, Color by_color, Position *from) {
+    static const int knight_steps[8][2] = {{-2, -1}, {-2, 1}, {-1, -2}, {-1, 2}, {1, -2}, {1, 2}, {2, -1}, {2, 1}};
+    static const int king_steps[8][2] = {{-1, -1}, {-1, 0}, {-1, 1}, {0, -1}, {0, 1}, {1, -1}, {1, 0}, {1, 1}};
+    int best_value = 0;
+
+    int pawn_row = target.row + (by_color == WHITE ? 1 : -1);
+    for (int side = -1; side <= 1; side += 2) {
+        int col = target.col + side;
+        if (is_valid_position(pawn_row, col) &&
+            board[pawn_row][col].type == PAWN && board[pawn_row][col].color == by_color) {
+            from->row = pawn_row;
+            from->col = col;
+            return true;   // Nothing is cheaper than a pawn
+        }
+    }
+
+    for (int i = 0; i < 8; i++) {
+        int row = target.row + knight_steps[i][0], col = target.col + knight_steps[i][1];
+        if (is_valid_position(row, col) &&
+            board[row][col].type == KNIGHT && board[row][col].color == by_color) {
+            from->row = row;
+            from->col = col;
+            best_value = SEE_PIECE_VALUE[KNIGHT];
+            break;
+        }
+    }
+
+    // Sliders: the first piece on each line
+    for (int i = 0; i < 8; i++) {
+        bool diagonal = king_steps[i][0] != 0 && king_steps[i][1] != 0;
+        int row = target.row + king_steps[i][0], col = target.col + king_steps[i][1];
+
+        while (is_valid_position(row, col)) {
+            Piece piece = board[row][col];
+            if (piece.type != EMPTY) {
+                if (piece.color == by_color &&
+                    (piece.type == QUEEN || piece.type == (diagonal ? BISHOP : ROOK)) &&
+                    (best_value == 0 || SEE_PIECE_VALUE[piece.type] < best_value)) {
+                    from->row = row;
+                    from->col = col;
+                    best_value = SEE_PIECE_VALUE[piece.type];
                 }
+                break;
             }
+            row += king_steps[i][0];
+            col += king_steps[i][1];
+        }
+    }
+    if (best_value != 0) return true;
+
+    for (int i = 0; i < 8; i++) {
+        int row = target.row + king_steps[i][0], col = target.col + king_steps[i][1];
+        if (is_valid_position(row, col) &&
+            board[row][col].type == KING && board[row][col].color == by_color) {
+            from->row = row;
+            from->col = col;
+            return true;
         }
     }
     return false;
 }
 
+/**
+ * Static exchange evaluation of a capture
+ * Plays out the sequence of recaptures on the destination square, each side
+ * always recapturing with its least valuable attacker, on a scratch copy of
+ * the board and without legality checks. Either side may stop capturing
+ * when continuing would lose material (swap-list minimax).
+ *
+ * @param game Current game state (not modified)
+ * @param move Capture to evaluate; from must hold a piece of the side making it
+ * @return Material won by the side making the capture (centipawns); negative
+ *         for a losing capture, 0 for a non-capture or an even trade
+ */
+int static_exchange_eval(const ChessGame *game, Move move) {
+    Piece board[BOARD_SIZE][BOARD_SIZE];
+    memcpy(board, game->board, sizeof(board));
+
+    Piece mover = board[move.from.row][move.from.col];
+    Piece victim = board[move.to.row][move.to.col];
+    if (mover.type == EMPTY) return 0;
+
+    int gain[32];
+    int depth = 0;
+    gain[0] = SEE_PIECE_VALUE[victim.type];
+
+    // En passant: the captured pawn is beside the destination, not on it
+    if (mover.type == PAWN && victim.type == EMPTY && move.from.col != move.to.col) {
+        board[move.from.row][move.to.col].type = EMPTY;
+        gain[0] = SEE_PIECE_VALUE[PAWN];
+    }
+    if (gain[0] == 0) return 0;
+
+    // Value now standing on the square, which the next capture wins
+    int on_square = SEE_PIECE_VALUE[mover.type];
+    if (move.is_promotion) {
+        PieceType promoted = move.promotion_piece != EMPTY ? move.promotion_piece : QUEEN;
+        gain[0] += SEE_PIECE_VALUE[promoted] - SEE_PIECE_VALUE[PAWN];
+        on_square = SEE_PIECE_VALUE[promoted];
+    }
+
+    board[move.to.row][move.to.col] = mover;
+    board[move.from.row][move.from.col].type = EMPTY;
+    Color side = mover.color == WHITE ? BLACK : WHITE;
+    Position from;
+
+    while (depth < 31 && see_least_attacker(board, move.to, side, &from)) {
+        // Capturing the king ends the exchange; a king may not recapture into attack
+        if (on_square == SEE_PIECE_VALUE[KING]) break;
+        Piece attacker = board[from.row][from.col];
+        if (attacker.type == KING) {
+            Position defender;
+            Color other = side == WHITE ? BLACK : WHITE;
+            board[from.row][from.col].type = EMPTY;
+            bool defended = see_least_attacker(board, move.to, other, &defender);
+            board[from.row][from.col] = attacker;
+            if (defended) break;
+        }
+
+        depth++;
+        gain[depth] = on_square - gain[depth - 1];
+        on_square = SEE_PIECE_VALUE[attacker.type];
+        board[move.to.row][move.to.col] = attacker;
+        board[from.row][from.col].type = EMPTY;
+        side = side == WHITE ? BLACK : WHITE;
+    }
+
+    // Each side picks the better of capturing and standing pat
+    while (depth > 0) {
+        if (-gain[depth] < gain[depth - 1]) gain[depth - 1] = -gain[depth];
+        depth--;
+    }
+    return gain[0];
+}
+
+/**
+ * Check whether a piece can be won outright by the opponent
+ * A piece hangs if the opponent's cheapest capture of it wins material
+ * once every recapture is played out (undefended or under-defended pieces).
+ * Kings never hang; attacks on them are checks.
+ *
+ * @param game Current game state
+ * @param pos Square of the piece
+ * @return true if capturing the piece gains the opponent material
+ */
+bool is_piece_hanging(const ChessGame *game, Position pos) {
+    Piece piece = game->board[pos.row][pos.col];
+    if (piece.type == EMPTY || piece.type == KING) return false;
+
+    Piece board[BOARD_SIZE][BOARD_SIZE];
+    memcpy(board, game->board, sizeof(board));
+
+    Move capture = {0};
+    capture.to = pos;
+    capture.is_capture = true;
+    capture.captured = piece;
+    if (!see_least_attacker(board, pos, piece.color == WHITE ? BLACK : WHITE, &capture.from)) return false;
+
+    Piece attacker = board[capture.from.row][capture.from.col];
+    if (attacker.type == PAWN && (pos.row == 0 || pos.row == BOARD_SIZE - 1)) {
+        capture.is_promotion = true;
+        capture.promotion_piece = QUEEN;
+    }
+    return static_exchange_eval(game, capture) > 0;
+}
+
 /**
  * Check if a king is currently in check
  * Determines if the king of the specified color is under attack by opponent pieces
@@ -862,6 +1151,67 @@ bool would_be_in_check_after_move(ChessGame *game, Position from, Position to) {
     return in_check;
 }
 
+/**
+ * Check if a player has any legal moves available
+ * Iterates through all pieces of the specified color and tests if any
+ * piece has at least one legal move. Used for stalemate and checkmate detection.
+ *
+ * @param game Current game state
+ * @param color Color of player to check for legal moves
+ * @return true if player has at least one legal move, false if no moves available
+ */
+bool has_legal_moves(ChessGame *game, Color color) {
+    for (int row = 0; row < BOARD_SIZE; row++) {
+        for (int col = 0; col < BOARD_SIZE; col++) {
+            if (is_piece_at(game, row, col)) {
+                Piece piece = get_piece_at(game, row, col);
+                if (piece.color == color) {
+                    Position moves[64];
+                    Color original_player = game->current_player;
+                    game->current_player = color;
+                    
+                    int move_count = get_possible_moves(game, (Position){row, col}, moves);
+                    
+                    for (int i = 0; i < move_count; i++) {
+                        if (!would_be_in_check_after_move(game, (Position){row, col}, moves[i])) {
+                            game->current_player = original_player;
+                            return true;
+                        }
+                    }
+                    
+                    game->current_player = original_player;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * Check if a player is in checkmate
+ * Checkmate occurs when the king is in check and has no legal moves to escape check
+ *
+ * @param game Current game state
+ * @param color Color of player to check for checkmate
+ * @return true if player is in checkmate, false otherwise
+ */
+bool is_checkmate(ChessGame *game, Color color) {
+    return is_in_check(game, color) && !has_legal_moves(game, color);
+}
+
+/**
+ * Check if a player is in stalemate
+ * Stalemate occurs when the player is NOT in check but has no legal moves.
+ * Results in a draw.
+ *
+ * @param game Current game state
+ * @param color Color of player to check for stalemate
+ * @return true if player is in stalemate, false otherwise
+ */
+bool is_stalemate(ChessGame *game, Color color) {
+    return !is_in_check(game, color) && !has_legal_moves(game, color);
+}
+
 /**
  * Validate if a move is legal according to chess rules
  * Checks if destination is in the piece's possible moves list and verifies
@@ -874,16 +1224,79 @@ bool would_be_in_check_after_move(ChessGame *game, Position from, Position to) {
  * @return true if move is legal, false otherwise
  */
 bool is_valid_move(ChessGame *game, Position from, Position to) {
+    uint64_t profile_start = profile_begin();
     Position possible_moves[64];
     int move_count = get_possible_moves(game, from, possible_moves);
+    bool valid = false;
 
     for (int i = 0; i < move_count; i++) {
         if (possible_moves[i].row == to.row && possible_moves[i].col == to.col) {
-            return !would_be_in_check_after_move(game, from, to);
+            valid = !would_be_in_check_after_move(game, from, to);
+            break;
         }
     }
 
-    return false;
+    profile_end(PROFILE_LEGALITY_CHECK, profile_start);
+    return valid;
+}
+
+/**
+ * Generate every legal move for the side to move
+ * Builds the full legal move list in one pass over the board. Pawn moves
+ * to the last rank are expanded into one entry per promotion piece
+ * (queen, rook, bishop, knight) with is_promotion and promotion_piece set.
+ * Capture information is filled in; check flags are left false.
+ *
+ * @param game Current game state
+ * @param moves Output array with room for MAX_LEGAL_MOVES entries
+ * @return Number of legal moves written
+ */
+int generate_legal_moves(ChessGame *game, Move moves[]) {
+    static const PieceType promotion_pieces[] = {QUEEN, ROOK, BISHOP, KNIGHT};
+    uint64_t profile_start = profile_begin();
+    int count = 0;
+
+    for (int row = 0; row < BOARD_SIZE; row++) {
+        for (int col = 0; col < BOARD_SIZE; col++) {
+            Piece piece = game->board[row][col];
+            if (piece.type == EMPTY || piece.color != game->current_player) continue;
+
+            Position from = {row, col};
+            Position targets[64];
+            int target_count = get_possible_moves(game, from, targets);
+
+            for (int i = 0; i < target_count; i++) {
+                Position to = targets[i];
+                if (would_be_in_check_after_move(game, from, to)) continue;
+
+                Move move;
+                memset(&move, 0, sizeof(move));
+                move.from = from;
+                move.to = to;
+                move.captured = game->board[to.row][to.col];
+                move.is_capture = move.captured.type != EMPTY;
+
+                // En passant: diagonal pawn move onto the empty target square
+                if (piece.type == PAWN && !move.is_capture && to.col != from.col) {
+                    move.is_capture = true;
+                    move.captured = game->board[from.row][to.col];
+                }
+
+                if (piece.type == PAWN && (to.row == 0 || to.row == 7)) {
+                    move.is_promotion = true;
+                    for (int p = 0; p < 4 && count < MAX_LEGAL_MOVES; p++) {
+                        move.promotion_piece = promotion_pieces[p];
+                        moves[count++] = move;
+                    }
+                } else if (count < MAX_LEGAL_MOVES) {
+                    moves[count++] = move;
+                }
+            }
+        }
+    }
+
+    profile_end(PROFILE_MOVE_GENERATION, profile_start);
+    return count;
 }
 
 /**
@@ -993,6 +1406,27 @@ PieceType get_promotion_choice() {
     }
 }
 
+/**
+ * Remember the move just made in game->last_move (after the player switch)
+ *
+ * @param game Game the move was made in
+ * @param from Starting position of the move
+ * @param to Destination position of the move
+ * @param captured Piece captured (EMPTY if none)
+ * @param promotion Piece promoted to (EMPTY if not a promotion)
+ */
+static void record_last_move(ChessGame *game, Position from, Position to, Piece captured, PieceType promotion) {
+    Move *move = &game->last_move;
+    move->from = from;
+    move->to = to;
+    move->captured = captured;
+    move->is_capture = captured.type != EMPTY;
+    move->is_check = game->in_check[game->current_player];
+    move->is_checkmate = false;
+    move->is_promotion = promotion != EMPTY;
+    move->promotion_piece = promotion;
+}
+
 /**
  * Execute a pawn promotion move
  * Performs the move and promotes the pawn to the specified piece type
@@ -1055,6 +1489,7 @@ bool make_promotion_move(ChessGame *game, Position from, Position to, PieceType
     game->in_check[WHITE] = is_in_check(game, WHITE);
     game->in_check[BLACK] = is_in_check(game, BLACK);
 
+    record_last_move(game, from, to, captured_piece, promotion_type);
     return true;
 }
 
@@ -1201,6 +1636,7 @@ bool make_move(ChessGame *game, Position from, Position to) {
     game->in_check[WHITE] = is_in_check(game, WHITE);
     game->in_check[BLACK] = is_in_check(game, BLACK);
 
+    record_last_move(game, from, to, captured_piece, EMPTY);
     return true;
 }
 
@@ -1229,79 +1665,297 @@ bool execute_move(ChessGame *game, Move move) {
 
 
 /**
- * Validate FEN string format
- * Performs basic validation of FEN string structure and content
- *
- * @param fen FEN string to validate
- * @return true if FEN appears valid, false otherwise
+ * FEN field separator test
+ * Fields are separated by spaces; tabs and line endings are tolerated so
+ * lines read straight from a file can be decoded without trimming first.
  */
-bool validate_fen_string(const char* fen) {
-    if (!fen || strlen(fen) == 0) return false;
-
-    // Count slashes (should be 7 for 8 ranks)
-    int slash_count = 0;
-    int board_chars = 0;
-    const char* ptr = fen;
-
-    // Parse board section (until first space)
-    while (*ptr && *ptr != ' ') {
-        if (*ptr == '/') {
-            slash_count++;
-        } else if (isdigit(*ptr)) {
-            int empty_squares = *ptr - '0';
-            if (empty_squares < 1 || empty_squares > 8) return false;
-            board_chars += empty_squares;
-        } else if (strchr("rnbqkpRNBQKP", *ptr)) {
-            board_chars++;
-        } else {
-            return false; // Invalid character
-        }
-        ptr++;
-    }
+static bool fen_is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
 
-    // Should have exactly 7 slashes and 64 board positions
-    if (slash_count != 7 || board_chars != 64) return false;
+/**
+ * Build a FenResult for the current decoder position
+ */
+static FenResult fen_result(FenError code, const char *fen, const char *ptr) {
+    FenResult result = {code, (int)(ptr - fen)};
+    return result;
+}
 
-    // Should have at least one space (separating board from other FEN components)
-    if (*ptr != ' ') return false;
+/**
+ * Decode a non-negative FEN move counter
+ * Advances *ptr past the digits on success
+ *
+ * @param ptr In/out cursor into the FEN string
+ * @param value Output counter value
+ * @return true if at least one digit was read and the value fits
+ */
+static bool fen_read_counter(const char **ptr, int *value) {
+    const char *p = *ptr;
+    int result = 0;
+    int digits = 0;
+
+    while (*p >= '0' && *p <= '9') {
+        if (++digits > 6) return false;  // Far beyond any real game length
+        result = result * 10 + (*p - '0');
+        p++;
+    }
+    if (digits == 0) return false;
 
+    *value = result;
+    *ptr = p;
     return true;
 }
 
 /**
- * Calculate captured pieces by comparing current board to starting position
- * Determines which pieces are missing from their starting positions
- * and populates the captured pieces arrays accordingly
+ * Decode FEN string into game state in a single pass
+ * Walks the string exactly once, filling the board, king positions, active
+ * color, castling rights, en passant target and move counters as it goes.
+ * The piece placement and active color fields are required; the remaining
+ * fields are optional and default to "- - 0 1" when absent. Only the
+ * position is decoded: captured pieces, check status and timers are left
+ * to the caller (see setup_board_from_fen()). On failure the game state is
+ * partially written and must not be used.
  *
- * @param game Game state with current board position
+ * @param game Game state to fill
+ * @param fen FEN string to decode
+ * @return FEN_OK with offset at end of input, or the error code and byte
+ *         offset of the offending character
  */
-void calculate_captured_pieces(ChessGame *game) {
-    // Standard starting pieces count for each type and color
-    int starting_counts[2][7] = {
-        // WHITE: EMPTY, PAWN, ROOK, KNIGHT, BISHOP, QUEEN, KING
-        {0, 8, 2, 2, 2, 1, 1},
-        // BLACK: EMPTY, PAWN, ROOK, KNIGHT, BISHOP, QUEEN, KING
-        {0, 8, 2, 2, 2, 1, 1}
-    };
+static FenResult fen_decode_fields(ChessGame *game, const char *fen) {
+    if (!fen || *fen == '\0') {
+        FenResult result = {FEN_ERR_EMPTY, 0};
+        return result;
+    }
 
-    // Count current pieces on board
-    int current_counts[2][7] = {{0}};
+    const char *ptr = fen;
 
-    for (int row = 0; row < BOARD_SIZE; row++) {
-        for (int col = 0; col < BOARD_SIZE; col++) {
-            Piece piece = game->board[row][col];
-            if (piece.type != EMPTY) {
-                current_counts[piece.color][piece.type]++;
+    game->white_king_pos.row = -1;
+    game->white_king_pos.col = -1;
+    game->black_king_pos.row = -1;
+    game->black_king_pos.col = -1;
+
+    // Field 1: piece placement, filled rank by rank from rank 8 down
+    int row = 0;
+    int col = 0;
+    while (!fen_is_space(*ptr)) {
+        char c = *ptr;
+
+        if (c == '\0') {
+            return fen_result(row == BOARD_SIZE - 1 && col == BOARD_SIZE ?
+                              FEN_ERR_MISSING_FIELD : FEN_ERR_RANK_COUNT, fen, ptr);
+        }
+
+        if (c == '/') {
+            if (col != BOARD_SIZE) return fen_result(FEN_ERR_RANK_LENGTH, fen, ptr);
+            if (++row >= BOARD_SIZE) return fen_result(FEN_ERR_RANK_COUNT, fen, ptr);
+            col = 0;
+        } else if (c >= '1' && c <= '8') {
+            int run = c - '0';
+            if (col + run > BOARD_SIZE) return fen_result(FEN_ERR_RANK_LENGTH, fen, ptr);
+            for (int i = 0; i < run; i++) {
+                game->board[row][col].type = EMPTY;
+                game->board[row][col].color = WHITE;
+                col++;
+            }
+        } else {
+            PieceType type = char_to_piece_type(c);
+            if (type == EMPTY) return fen_result(FEN_ERR_BAD_PIECE, fen, ptr);
+            if (col >= BOARD_SIZE) return fen_result(FEN_ERR_RANK_LENGTH, fen, ptr);
+
+            Color color = isupper((unsigned char)c) ? WHITE : BLACK;
+            game->board[row][col].type = type;
+            game->board[row][col].color = color;
+
+            if (type == KING) {
+                Position *king = (color == WHITE) ? &game->white_king_pos : &game->black_king_pos;
+                king->row = row;
+                king->col = col;
             }
+            col++;
         }
+        ptr++;
     }
+    if (row != BOARD_SIZE - 1) return fen_result(FEN_ERR_RANK_COUNT, fen, ptr);
+    if (col != BOARD_SIZE) return fen_result(FEN_ERR_RANK_LENGTH, fen, ptr);
 
-    // Clear captured pieces arrays
-    game->white_captured.count = 0;
-    game->black_captured.count = 0;
-
-    // Calculate captured pieces for each color
-    for (int color = 0; color < 2; color++) {
+    // Field 2: active color (required)
+    while (fen_is_space(*ptr)) ptr++;
+    if (*ptr == 'w' || *ptr == 'W') {
+        game->current_player = WHITE;
+    } else if (*ptr == 'b' || *ptr == 'B') {
+        game->current_player = BLACK;
+    } else if (*ptr == '\0') {
+        return fen_result(FEN_ERR_MISSING_FIELD, fen, ptr);
+    } else {
+        return fen_result(FEN_ERR_BAD_ACTIVE_COLOR, fen, ptr);
+    }
+    ptr++;
+    if (*ptr && !fen_is_space(*ptr)) return fen_result(FEN_ERR_BAD_ACTIVE_COLOR, fen, ptr);
+
+    // Defaults for the optional trailing fields
+    game->white_king_moved = true;
+    game->black_king_moved = true;
+    game->white_rook_a_moved = true;
+    game->white_rook_h_moved = true;
+    game->black_rook_a_moved = true;
+    game->black_rook_h_moved = true;
+    game->en_passant_available = false;
+    game->en_passant_target.row = -1;
+    game->en_passant_target.col = -1;
+    game->halfmove_clock = 0;
+    game->fullmove_number = 1;
+
+    // Field 3: castling rights
+    while (fen_is_space(*ptr)) ptr++;
+    if (*ptr == '\0') return fen_result(FEN_OK, fen, ptr);
+    if (*ptr == '-') {
+        ptr++;
+    } else {
+        const char *start = ptr;
+        while (*ptr && !fen_is_space(*ptr)) {
+            switch (*ptr) {
+                case 'K':
+                    game->white_king_moved = false;
+                    game->white_rook_h_moved = false;
+                    break;
+                case 'Q':
+                    game->white_king_moved = false;
+                    game->white_rook_a_moved = false;
+                    break;
+                case 'k':
+                    game->black_king_moved = false;
+                    game->black_rook_h_moved = false;
+                    break;
+                case 'q':
+                    game->black_king_moved = false;
+                    game->black_rook_a_moved = false;
+                    break;
+                default:
+                    return fen_result(FEN_ERR_BAD_CASTLING, fen, ptr);
+            }
+            if (ptr - start >= 4) return fen_result(FEN_ERR_BAD_CASTLING, fen, ptr);
+            ptr++;
+        }
+    }
+    if (*ptr && !fen_is_space(*ptr)) return fen_result(FEN_ERR_BAD_CASTLING, fen, ptr);
+
+    // Field 4: en passant target square (rank 3 or 6 only)
+    while (fen_is_space(*ptr)) ptr++;
+    if (*ptr == '\0') return fen_result(FEN_OK, fen, ptr);
+    if (*ptr == '-') {
+        ptr++;
+    } else {
+        if (*ptr < 'a' || *ptr > 'h') return fen_result(FEN_ERR_BAD_EN_PASSANT, fen, ptr);
+        if (ptr[1] != '3' && ptr[1] != '6') return fen_result(FEN_ERR_BAD_EN_PASSANT, fen, ptr + 1);
+        game->en_passant_target.col = ptr[0] - 'a';
+        game->en_passant_target.row = '8' - ptr[1];
+        game->en_passant_available = true;
+        ptr += 2;
+    }
+    if (*ptr && !fen_is_space(*ptr)) return fen_result(FEN_ERR_BAD_EN_PASSANT, fen, ptr);
+
+    // Fields 5 and 6: halfmove clock and fullmove number
+    while (fen_is_space(*ptr)) ptr++;
+    if (*ptr == '\0') return fen_result(FEN_OK, fen, ptr);
+    if (!fen_read_counter(&ptr, &game->halfmove_clock)) return fen_result(FEN_ERR_BAD_COUNTER, fen, ptr);
+    if (*ptr && !fen_is_space(*ptr)) return fen_result(FEN_ERR_BAD_COUNTER, fen, ptr);
+
+    while (fen_is_space(*ptr)) ptr++;
+    if (*ptr == '\0') return fen_result(FEN_OK, fen, ptr);
+    if (!fen_read_counter(&ptr, &game->fullmove_number)) return fen_result(FEN_ERR_BAD_COUNTER, fen, ptr);
+
+    while (fen_is_space(*ptr)) ptr++;
+    if (*ptr != '\0') return fen_result(FEN_ERR_TRAILING_DATA, fen, ptr);
+
+    return fen_result(FEN_OK, fen, ptr);
+}
+
+/**
+ * Decode FEN string into game state (see fen_decode_fields())
+ * Timed as PROFILE_FEN_DECODE when profiling is on.
+ *
+ * @param game Game state to fill
+ * @param fen FEN string to decode
+ * @return FEN_OK with offset at end of input, or the error code and byte
+ *         offset of the offending character
+ */
+FenResult fen_decode(ChessGame *game, const char *fen) {
+    uint64_t profile_start = profile_begin();
+    FenResult result = fen_decode_fields(game, fen);
+    profile_end(PROFILE_FEN_DECODE, profile_start);
+    return result;
+}
+
+/**
+ * Get human-readable description of a FEN decoder error
+ *
+ * @param error Error code returned in FenResult.code
+ * @return Static description string
+ */
+const char* fen_error_string(FenError error) {
+    switch (error) {
+        case FEN_OK:                   return "no error";
+        case FEN_ERR_EMPTY:            return "empty FEN string";
+        case FEN_ERR_BAD_PIECE:        return "invalid piece character";
+        case FEN_ERR_RANK_LENGTH:      return "rank does not contain exactly 8 squares";
+        case FEN_ERR_RANK_COUNT:       return "board does not contain exactly 8 ranks";
+        case FEN_ERR_MISSING_FIELD:    return "missing active color field";
+        case FEN_ERR_BAD_ACTIVE_COLOR: return "active color must be 'w' or 'b'";
+        case FEN_ERR_BAD_CASTLING:     return "invalid castling rights";
+        case FEN_ERR_BAD_EN_PASSANT:   return "invalid en passant square";
+        case FEN_ERR_BAD_COUNTER:      return "invalid move counter";
+        case FEN_ERR_TRAILING_DATA:    return "unexpected data after fullmove number";
+    }
+    return "unknown FEN error";
+}
+
+/**
+ * Validate FEN string format
+ * Runs the FEN decoder against a scratch game so validation and setup can
+ * never disagree about what is accepted
+ *
+ * @param fen FEN string to validate
+ * @return true if FEN appears valid, false otherwise
+ */
+bool validate_fen_string(const char* fen) {
+    ChessGame scratch;
+    return fen_decode(&scratch, fen).code == FEN_OK;
+}
+
+/**
+ * Calculate captured pieces by comparing current board to starting position
+ * Determines which pieces are missing from their starting positions
+ * and populates the captured pieces arrays accordingly
+ *
+ * @param game Game state with current board position
+ */
+void calculate_captured_pieces(ChessGame *game) {
+    // Standard starting pieces count for each type and color
+    int starting_counts[2][7] = {
+        // WHITE: EMPTY, PAWN, ROOK, KNIGHT, BISHOP, QUEEN, KING
+        {0, 8, 2, 2, 2, 1, 1},
+        // BLACK: EMPTY, PAWN, ROOK, KNIGHT, BISHOP, QUEEN, KING
+        {0, 8, 2, 2, 2, 1, 1}
+    };
+
+    // Count current pieces on board
+    int current_counts[2][7] = {{0}};
+
+    for (int row = 0; row < BOARD_SIZE; row++) {
+        for (int col = 0; col < BOARD_SIZE; col++) {
+            Piece piece = game->board[row][col];
+            if (piece.type != EMPTY) {
+                current_counts[piece.color][piece.type]++;
+            }
+        }
+    }
+
+    // Clear captured pieces arrays
+    game->white_captured.count = 0;
+    game->black_captured.count = 0;
+
+    // Calculate captured pieces for each color
+    for (int color = 0; color < 2; color++) {
         for (int piece_type = PAWN; piece_type <= KING; piece_type++) {
             int captured = starting_counts[color][piece_type] - current_counts[color][piece_type];
 
@@ -1322,202 +1976,302 @@ void calculate_captured_pieces(ChessGame *game) {
 }
 
 /**
- * Parse FEN board position (piece placement field)
- * Parses the first field of FEN notation and updates board state with piece positions
+ * Setup board from FEN string
+ * Decodes the FEN in a single pass and configures game state accordingly
+ * Updates board position, current player, king positions, and castling rights
  *
- * @param game Game state to update with parsed pieces
- * @param fen_ptr Pointer to start of FEN string
- * @return Pointer to the character after board position field (typically a space)
+ * @param game Game state to modify
+ * @param fen Valid FEN string
+ * @return true if successful, false if parsing failed
  */
-static const char* parse_fen_board_position(ChessGame *game, const char* fen_ptr) {
-    int row = 0, col = 0;
-    const char* ptr = fen_ptr;
+bool setup_board_from_fen(ChessGame *game, const char* fen) {
+    // Decode into a copy so a malformed FEN never leaves the game half-written
+    ChessGame decoded = *game;
+    if (fen_decode(&decoded, fen).code != FEN_OK) {
+        return false;
+    }
 
-    while (*ptr && *ptr != ' ' && row < BOARD_SIZE) {
-        if (*ptr == '/') {
-            row++;
-            col = 0;
-        } else if (isdigit(*ptr)) {
-            col += (*ptr - '0');
-        } else {
-            PieceType piece_type = char_to_piece_type(tolower(*ptr));
-            Color piece_color = isupper(*ptr) ? WHITE : BLACK;
-
-            if (row < BOARD_SIZE && col < BOARD_SIZE) {
-                game->board[row][col].type = piece_type;
-                game->board[row][col].color = piece_color;
-
-                if (piece_type == KING) {
-                    if (piece_color == WHITE) {
-                        game->white_king_pos.row = row;
-                        game->white_king_pos.col = col;
-                    } else {
-                        game->black_king_pos.row = row;
-                        game->black_king_pos.col = col;
-                    }
-                }
-            }
-            col++;
-        }
-        ptr++;
+    // Verify both kings were found during parsing
+    if (decoded.white_king_pos.row == -1 || decoded.black_king_pos.row == -1) {
+        return false;
     }
 
-    return ptr;
+    // Calculate captured pieces based on current board position
+    calculate_captured_pieces(&decoded);
+
+    // Update check status
+    decoded.in_check[WHITE] = is_in_check(&decoded, WHITE);
+    decoded.in_check[BLACK] = is_in_check(&decoded, BLACK);
+
+    // A position set up from FEN has no last move to show
+    memset(&decoded.last_move, 0, sizeof(decoded.last_move));
+    decoded.last_move.from.row = -1;
+
+    *game = decoded;
+    return true;
 }
 
 /**
- * Parse FEN metadata fields (active color, castling, en passant, counters)
- * Parses all fields after board position and updates game state
- *
- * @param game Game state to update with parsed metadata
- * @param fen_ptr Pointer to start of metadata fields (after board position)
+ * FEN piece characters indexed by [color][piece type]
+ * EMPTY maps to '1' but is never emitted directly (empty runs are counted)
  */
-static void parse_fen_metadata(ChessGame *game, const char* fen_ptr) {
-    const char* ptr = fen_ptr;
+static const char FEN_PIECE_CHARS[2][7] = {
+    {'1', 'P', 'R', 'N', 'B', 'Q', 'K'},  // WHITE
+    {'1', 'p', 'r', 'n', 'b', 'q', 'k'}   // BLACK
+};
 
-    // Parse active color
-    if (*ptr == ' ') ptr++;
-    if (*ptr == 'w' || *ptr == 'W') {
-        game->current_player = WHITE;
-    } else if (*ptr == 'b' || *ptr == 'B') {
-        game->current_player = BLACK;
-    } else {
-        game->current_player = WHITE;
+/**
+ * Append a non-negative decimal integer without going through printf
+ *
+ * @param p Write position
+ * @param value Value to write (negative values are written as 0)
+ * @return Write position after the last digit
+ */
+static char* fen_put_uint(char *p, int value) {
+    char digits[12];
+    int n = 0;
+    unsigned int v = value > 0 ? (unsigned int)value : 0;
+
+    do {
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v > 0);
+
+    while (n > 0) {
+        *p++ = digits[--n];
     }
+    return p;
+}
 
-    // Skip to castling rights
-    while (*ptr && *ptr != ' ') ptr++;
-    if (*ptr == ' ') ptr++;
+/**
+ * Serialize game state to FEN (Forsyth-Edwards Notation)
+ * Emits each rank in a single pass using a precomputed piece-character table.
+ * Unlike board_to_fen() this writes into a caller-supplied buffer, so it is
+ * safe to call from multiple threads on different games.
+ *
+ * @param game Game state to serialize
+ * @param out Destination buffer (FEN_BUFFER_SIZE bytes always suffice)
+ * @param cap Capacity of destination buffer in bytes
+ * @return Length of the FEN string written (excluding NUL), or 0 if it did not fit
+ */
+size_t fen_write(const ChessGame *game, char *out, size_t cap) {
+    uint64_t profile_start = profile_begin();
+    char scratch[FEN_BUFFER_SIZE];
+    char *start = (cap >= FEN_BUFFER_SIZE) ? out : scratch;
+    char *p = start;
 
-    // Parse castling rights
-    game->white_king_moved = true;
-    game->black_king_moved = true;
-    game->white_rook_a_moved = true;
-    game->white_rook_h_moved = true;
-    game->black_rook_a_moved = true;
-    game->black_rook_h_moved = true;
+    // Piece placement, rank 8 down to rank 1
+    for (int row = 0; row < BOARD_SIZE; row++) {
+        const Piece *rank = game->board[row];
+        int empty_count = 0;
 
-    while (*ptr && *ptr != ' ') {
-        switch (*ptr) {
-            case 'K':
-                game->white_king_moved = false;
-                game->white_rook_h_moved = false;
-                break;
-            case 'Q':
-                game->white_king_moved = false;
-                game->white_rook_a_moved = false;
-                break;
-            case 'k':
-                game->black_king_moved = false;
-                game->black_rook_h_moved = false;
-                break;
-            case 'q':
-                game->black_king_moved = false;
-                game->black_rook_a_moved = false;
-                break;
+        for (int col = 0; col < BOARD_SIZE; col++) {
+            if (rank[col].type == EMPTY) {
+                empty_count++;
+                continue;
+            }
+            if (empty_count > 0) {
+                *p++ = (char)('0' + empty_count);
+                empty_count = 0;
+            }
+            *p++ = FEN_PIECE_CHARS[rank[col].color][rank[col].type];
         }
-        ptr++;
-    }
 
-    // Parse en passant target square
-    while (*ptr && *ptr == ' ') ptr++;
-    game->en_passant_available = false;
-    game->en_passant_target.row = -1;
-    game->en_passant_target.col = -1;
-
-    if (*ptr && *ptr != '-' && *ptr != ' ') {
-        if (*ptr >= 'a' && *ptr <= 'h') {
-            char file = *ptr;
-            ptr++;
-            if (*ptr >= '1' && *ptr <= '8') {
-                char rank = *ptr;
-                game->en_passant_target.col = file - 'a';
-                game->en_passant_target.row = '8' - rank;
-                game->en_passant_available = true;
-                ptr++;
-            }
+        if (empty_count > 0) {
+            *p++ = (char)('0' + empty_count);
+        }
+        if (row < BOARD_SIZE - 1) {
+            *p++ = '/';
         }
     }
-    while (*ptr && *ptr != ' ') ptr++;
 
-    // Parse halfmove clock
-    while (*ptr && *ptr == ' ') ptr++;
-    if (*ptr && isdigit(*ptr)) {
-        game->halfmove_clock = atoi(ptr);
-        while (*ptr && isdigit(*ptr)) ptr++;
+    // Active color
+    *p++ = ' ';
+    *p++ = (game->current_player == WHITE) ? 'w' : 'b';
+
+    // Castling availability
+    *p++ = ' ';
+    char *castling_start = p;
+    if (!game->white_king_moved) {
+        if (!game->white_rook_h_moved) *p++ = 'K';
+        if (!game->white_rook_a_moved) *p++ = 'Q';
+    }
+    if (!game->black_king_moved) {
+        if (!game->black_rook_h_moved) *p++ = 'k';
+        if (!game->black_rook_a_moved) *p++ = 'q';
+    }
+    if (p == castling_start) *p++ = '-';
+
+    // En passant target square
+    *p++ = ' ';
+    if (game->en_passant_available &&
+        is_valid_position(game->en_passant_target.row, game->en_passant_target.col)) {
+        *p++ = (char)('a' + game->en_passant_target.col);
+        *p++ = (char)('8' - game->en_passant_target.row);
     } else {
-        game->halfmove_clock = 0;
+        *p++ = '-';
     }
 
-    // Parse fullmove number
-    while (*ptr && *ptr == ' ') ptr++;
-    if (*ptr && isdigit(*ptr)) {
-        game->fullmove_number = atoi(ptr);
-        while (*ptr && isdigit(*ptr)) ptr++;
-    } else {
-        game->fullmove_number = 1;
+    // Halfmove clock and fullmove number
+    *p++ = ' ';
+    p = fen_put_uint(p, game->halfmove_clock);
+    *p++ = ' ';
+    p = fen_put_uint(p, game->fullmove_number);
+    *p = '\0';
+
+    size_t length = (size_t)(p - start);
+    if (start == scratch) {
+        if (length >= cap) {
+            if (cap > 0) out[0] = '\0';
+            length = 0;
+        } else {
+            memcpy(out, scratch, length + 1);
+        }
     }
+    profile_end(PROFILE_FEN_ENCODE, profile_start);
+    return length;
 }
 
+
+/******************************************************************************
+ *                            TIME CONTROL SYSTEM
+ ******************************************************************************/
+
+
 /**
- * Setup board from FEN string
- * Parses FEN string and configures game state accordingly
- * Updates board position, current player, king positions, and castling rights
+ * Read a number of at most three digits from a time control string
  *
- * @param game Game state to modify
- * @param fen Valid FEN string
- * @return true if successful, false if parsing failed
+ * @param cursor Position in the string, advanced past the digits
+ * @param value Output number
+ * @return false if no digits or more than three
  */
-bool setup_board_from_fen(ChessGame *game, const char* fen) {
-    if (!validate_fen_string(fen)) {
+static bool parse_time_number(const char **cursor, int *value) {
+    const char *p = *cursor;
+    if (!isdigit((unsigned char)*p)) {
         return false;
     }
 
-    // Initialize king positions to invalid values
-    game->white_king_pos.row = -1;
-    game->white_king_pos.col = -1;
-    game->black_king_pos.row = -1;
-    game->black_king_pos.col = -1;
+    int number = 0, digits = 0;
+    while (isdigit((unsigned char)*p)) {
+        if (++digits > 3) return false;
+        number = number * 10 + (*p++ - '0');
+    }
+    *value = number;
+    *cursor = p;
+    return true;
+}
 
-    // Clear the board
-    for (int row = 0; row < BOARD_SIZE; row++) {
-        for (int col = 0; col < BOARD_SIZE; col++) {
-            game->board[row][col].type = EMPTY;
-            game->board[row][col].color = WHITE;
+/**
+ * Parse one player's extended time control
+ * Comma-separated periods, each "[moves/]minutes[bonus]" or "G/minutes"
+ * (also "SD/minutes") for the rest of the game, where bonus is "+s"
+ * (increment), "ds" (simple delay) or "bs" (Bronstein delay); optionally
+ * ending in "byoNxS" (N overtime periods of S seconds; "byoS" = one).
+ * Example: "40/90+30,G/30+30" or "60,byo5x30".
+ *
+ * @param spec Time control text for one player
+ * @param control Output control
+ * @return true if the text is valid
+ */
+static bool parse_player_time_control(const char *spec, PlayerTimeControl *control) {
+    memset(control, 0, sizeof(*control));
+    const char *p = spec;
+
+    while (*p) {
+        if (strncasecmp(p, "byo", 3) == 0) {
+            // Overtime comes last
+            p += 3;
+            int first, second;
+            if (!parse_time_number(&p, &first)) return false;
+            if (*p == 'x' || *p == 'X') {
+                p++;
+                if (!parse_time_number(&p, &second)) return false;
+                control->byoyomi_periods = first;
+                control->byoyomi_seconds = second;
+            } else {
+                control->byoyomi_periods = 1;
+                control->byoyomi_seconds = first;
+            }
+            if (*p != '\0' || control->byoyomi_periods == 0 || control->byoyomi_seconds == 0) return false;
+            break;
         }
-    }
 
-    // Parse board position (piece placement)
-    const char* ptr = parse_fen_board_position(game, fen);
+        // Nothing can follow a period that lasts the rest of the game
+        if (control->period_count == TIME_MAX_PERIODS) return false;
+        if (control->period_count > 0 && control->periods[control->period_count - 1].moves == 0) return false;
+        TimePeriod *period = &control->periods[control->period_count++];
+
+        bool sudden_death = false;
+        if (toupper((unsigned char)p[0]) == 'G' && p[1] == '/') {
+            p += 2;
+            sudden_death = true;
+        } else if (strncasecmp(p, "SD/", 3) == 0) {
+            p += 3;
+            sudden_death = true;
+        }
 
-    // Parse metadata fields (active color, castling, en passant, counters)
-    parse_fen_metadata(game, ptr);
+        int number;
+        if (!parse_time_number(&p, &number)) return false;
+        if (!sudden_death && *p == '/') {
+            p++;
+            if (number == 0) return false;
+            period->moves = number;
+            if (!parse_time_number(&p, &number)) return false;
+        }
+        period->minutes = number;
 
-    // Calculate captured pieces based on current board position
-    calculate_captured_pieces(game);
+        char kind = (char)tolower((unsigned char)*p);
+        if (kind == '+' || kind == 'd' || kind == 'b') {
+            p++;
+            period->bonus = kind == 'd' ? TIME_BONUS_DELAY : kind == 'b' ? TIME_BONUS_BRONSTEIN : TIME_BONUS_INCREMENT;
+            if (!parse_time_number(&p, &period->bonus_seconds)) return false;
+        }
 
-    // Verify both kings were found during parsing
-    if (game->white_king_pos.row == -1 || game->black_king_pos.row == -1) {
-        return false;
+        if (*p == ',') {
+            p++;
+        } else if (*p != '\0') {
+            return false;
+        }
     }
 
-    // Update check status
-    game->in_check[WHITE] = is_in_check(game, WHITE);
-    game->in_check[BLACK] = is_in_check(game, BLACK);
-
+    // Overtime only: main time starts at zero
+    if (control->period_count == 0) {
+        if (control->byoyomi_seconds == 0) return false;
+        control->period_count = 1;
+    }
     return true;
 }
 
+/**
+ * Set a single sudden-death period with a Fischer increment
+ */
+static void set_simple_time_control(PlayerTimeControl *control, int minutes, int increment) {
+    memset(control, 0, sizeof(*control));
+    control->period_count = 1;
+    control->periods[0].minutes = minutes;
+    control->periods[0].bonus_seconds = increment;
+    control->periods[0].bonus = TIME_BONUS_INCREMENT;
+}
 
-/******************************************************************************
- *                            TIME CONTROL SYSTEM
- ******************************************************************************/
-
+/**
+ * Whether a player's control gives them any time at all
+ */
+static bool player_time_control_enabled(const PlayerTimeControl *control) {
+    if (control->byoyomi_seconds > 0) return true;
+    for (int i = 0; i < control->period_count; i++) {
+        if (control->periods[i].minutes > 0 || control->periods[i].bonus_seconds > 0) return true;
+    }
+    return false;
+}
 
 /**
- * Parse time control string format (xx/yy or xx/yy/zz/ww)
+ * Parse time control string format
+ * Classic forms are xx/yy (minutes/increment for both) and xx/yy/zz/ww
+ * (White then Black). Anything else is the extended form (see
+ * parse_player_time_control()), one control for both players or White's
+ * and Black's separated by a space: "40/90+30,G/30+30" or "60,byo5x30 15+10".
  *
- * @param time_str String in format "minutes/increment" or "white_min/white_inc/black_min/black_inc"
+ * @param time_str Time control text
  * @param tc TimeControl structure to populate
  * @return true if parsing was successful, false if invalid format
  */
@@ -1526,16 +2280,31 @@ bool parse_time_control(const char* time_str, TimeControl* tc) {
         return false;
     }
 
+    while (isspace((unsigned char)*time_str)) time_str++;
+    char text[TIME_CONTROL_STRING_SIZE];
+    size_t length = strlen(time_str);
+    if (length >= sizeof(text)) {
+        return false;
+    }
+    memcpy(text, time_str, length + 1);
+    while (length > 0 && isspace((unsigned char)text[length - 1])) text[--length] = '\0';
+
+    TimeControl parsed;
+    memset(&parsed, 0, sizeof(parsed));
+
     // Count slashes to determine format
     int slash_count = 0;
-    for (const char* p = time_str; *p; p++) {
+    for (const char* p = text; *p; p++) {
         if (*p == '/') slash_count++;
     }
+    // Only digits and slashes is the classic minutes/increment form, so a
+    // single moves/minutes period must carry a bonus ("40/120+0")
+    bool classic = slash_count > 0 && text[strspn(text, "0123456789/")] == '\0';
 
-    if (slash_count == 1) {
+    if (classic && slash_count == 1) {
         // Format: xx/yy (same time controls for both players)
-        const char* slash = strchr(time_str, '/');
-        int minutes = atoi(time_str);
+        const char* slash = strchr(text, '/');
+        int minutes = atoi(text);
         int increment = atoi(slash + 1);
 
         // Validate ranges
@@ -1544,19 +2313,12 @@ bool parse_time_control(const char* time_str, TimeControl* tc) {
         }
 
         // Set same time controls for both players
-        tc->white_minutes = minutes;
-        tc->white_increment = increment;
-        tc->black_minutes = minutes;
-        tc->black_increment = increment;
-        tc->enabled = (minutes > 0 || increment > 0);
+        set_simple_time_control(&parsed.white, minutes, increment);
+        set_simple_time_control(&parsed.black, minutes, increment);
 
-    } else if (slash_count == 3) {
+    } else if (classic && slash_count == 3) {
         // Format: xx/yy/zz/ww (different time controls for each player)
-        char temp_str[64];
-        strncpy(temp_str, time_str, sizeof(temp_str) - 1);
-        temp_str[sizeof(temp_str) - 1] = '\0';
-
-        char* token = strtok(temp_str, "/");
+        char* token = strtok(text, "/");
         if (!token) return false;
         int white_minutes = atoi(token);
 
@@ -1579,20 +2341,103 @@ bool parse_time_control(const char* time_str, TimeControl* tc) {
         }
 
         // Set different time controls for each player
-        tc->white_minutes = white_minutes;
-        tc->white_increment = white_increment;
-        tc->black_minutes = black_minutes;
-        tc->black_increment = black_increment;
-        tc->enabled = (white_minutes > 0 || white_increment > 0 || black_minutes > 0 || black_increment > 0);
+        set_simple_time_control(&parsed.white, white_minutes, white_increment);
+        set_simple_time_control(&parsed.black, black_minutes, black_increment);
 
-    } else {
+    } else if (classic) {
         // Invalid format
         return false;
+
+    } else {
+        // Extended format: one control for both, or White's and Black's
+        char *black_text = strpbrk(text, " \t");
+        if (black_text) {
+            *black_text++ = '\0';
+            while (isspace((unsigned char)*black_text)) black_text++;
+        }
+        if (!parse_player_time_control(text, &parsed.white)) {
+            return false;
+        }
+        if (black_text && *black_text) {
+            if (!parse_player_time_control(black_text, &parsed.black)) return false;
+        } else {
+            parsed.black = parsed.white;
+        }
     }
 
+    parsed.enabled = player_time_control_enabled(&parsed.white) || player_time_control_enabled(&parsed.black);
+    *tc = parsed;
     return true;
 }
 
+/**
+ * Describe a player's time control for messages
+ * A single period with an increment reads "15 minutes + 5 second
+ * increment"; anything else is given in the extended TIME notation.
+ *
+ * @param control Control to describe
+ * @param out Output buffer (TIME_CONTROL_STRING_SIZE is enough)
+ * @param cap Size of out
+ */
+void describe_time_control(const PlayerTimeControl* control, char *out, size_t cap) {
+    const TimePeriod *first = &control->periods[0];
+    if (control->period_count == 1 && first->moves == 0 && first->bonus == TIME_BONUS_INCREMENT &&
+        control->byoyomi_seconds == 0) {
+        snprintf(out, cap, "%d minutes + %d second increment", first->minutes, first->bonus_seconds);
+        return;
+    }
+
+    static const char bonus_symbol[] = {'+', 'd', 'b'};
+    size_t used = 0;
+    out[0] = '\0';
+    for (int i = 0; i < control->period_count && used < cap; i++) {
+        const TimePeriod *period = &control->periods[i];
+        int written = period->moves > 0 ?
+            snprintf(out + used, cap - used, "%s%d/%d", i ? "," : "", period->moves, period->minutes) :
+            snprintf(out + used, cap - used, "%sG/%d", i ? "," : "", period->minutes);
+        if (written > 0) used += (size_t)written;
+        if (period->bonus_seconds > 0 && used < cap) {
+            written = snprintf(out + used, cap - used, "%c%d", bonus_symbol[period->bonus], period->bonus_seconds);
+            if (written > 0) used += (size_t)written;
+        }
+    }
+    if (control->byoyomi_seconds > 0 && used < cap) {
+        snprintf(out + used, cap - used, ",byo%dx%d", control->byoyomi_periods, control->byoyomi_seconds);
+    }
+}
+
+static const PlayerTimeControl *player_time_control(const ChessGame *game, Color color) {
+    return color == WHITE ? &game->time_control.white : &game->time_control.black;
+}
+
+static const TimePeriod *current_time_period(const ChessGame *game, Color color) {
+    return &player_time_control(game, color)->periods[game->timer.period[color]];
+}
+
+/**
+ * Clock time charged for a move that has taken elapsed milliseconds
+ * (a simple delay is free; Bronstein is given back after the move)
+ */
+static int64_t charged_move_time(const TimePeriod *period, int64_t elapsed) {
+    if (period->bonus == TIME_BONUS_DELAY) {
+        elapsed -= (int64_t)period->bonus_seconds * 1000;
+        if (elapsed < 0) elapsed = 0;
+    }
+    return elapsed;
+}
+
+/**
+ * Main time a player has left, counting the move in progress (negative
+ * once they are into overtime)
+ */
+static int64_t main_time_left(const ChessGame *game, Color color) {
+    int64_t remaining = color == WHITE ? game->timer.white_time_ms : game->timer.black_time_ms;
+    if (game->timer.timing_active && game->timer.timer_player == color) {
+        remaining -= charged_move_time(current_time_period(game, color), game_clock_ms() - game->timer.move_start_ms);
+    }
+    return remaining;
+}
+
 /**
  * Initialize game timer with given time control settings
  *
@@ -1605,21 +2450,15 @@ void init_game_timer(ChessGame* game, TimeControl* time_control) {
     }
 
     game->time_control = *time_control;
+    memset(&game->timer, 0, sizeof(game->timer));
+    game->timer.timer_player = WHITE; // Initialize to WHITE (will be set properly on first start)
 
     if (time_control->enabled) {
-        // Convert minutes to seconds for both players (can be different now)
-        game->timer.white_time_seconds = time_control->white_minutes * 60;
-        game->timer.black_time_seconds = time_control->black_minutes * 60;
-        game->timer.timing_active = false;
-        game->timer.move_start_time = 0;
-        game->timer.timer_player = WHITE; // Initialize to WHITE (will be set properly on first start)
-    } else {
-        // Disabled time controls
-        game->timer.white_time_seconds = 0;
-        game->timer.black_time_seconds = 0;
-        game->timer.timing_active = false;
-        game->timer.move_start_time = 0;
-        game->timer.timer_player = WHITE;
+        // Both players start in their first period (can be different)
+        game->timer.white_time_ms = (int64_t)time_control->white.periods[0].minutes * 60000;
+        game->timer.black_time_ms = (int64_t)time_control->black.periods[0].minutes * 60000;
+        game->timer.byoyomi_left[WHITE] = time_control->white.byoyomi_periods;
+        game->timer.byoyomi_left[BLACK] = time_control->black.byoyomi_periods;
     }
 }
 
@@ -1637,12 +2476,14 @@ void start_move_timer(ChessGame* game) {
     if (!game->timer.timing_active || game->timer.timer_player != game->current_player) {
         game->timer.timing_active = true;
         game->timer.timer_player = game->current_player;
-        game->timer.move_start_time = time(NULL);
+        game->timer.move_start_ms = game_clock_ms();
     }
 }
 
 /**
- * Stop timing and apply increment to current player
+ * Stop timing: charge the move (less any delay), credit the increment or
+ * Bronstein delay, use up overtime periods, and start the next period
+ * once its move count is reached
  *
  * @param game Game state
  */
@@ -1651,50 +2492,158 @@ void stop_move_timer(ChessGame* game) {
         return;
     }
 
-    time_t now = time(NULL);
-    int elapsed = (int)(now - game->timer.move_start_time);
+    // Charge the player who was being timed (timer_player)
+    Color color = game->timer.timer_player;
+    const PlayerTimeControl *control = player_time_control(game, color);
+    const TimePeriod *period = current_time_period(game, color);
+    int64_t *main_time = color == WHITE ? &game->timer.white_time_ms : &game->timer.black_time_ms;
+    int64_t elapsed = game_clock_ms() - game->timer.move_start_ms;
+    int64_t charged = charged_move_time(period, elapsed);
+    int64_t bonus_ms = (int64_t)period->bonus_seconds * 1000;
+    int64_t byoyomi_ms = (int64_t)control->byoyomi_seconds * 1000;
+
+    game->timer.timing_active = false;
+    game->timer.move_start_ms = 0;
+
+    if (charged >= *main_time + byoyomi_ms * game->timer.byoyomi_left[color]) {
+        // Flag fell: no bonus or new period can save it
+        *main_time = 0;
+        game->timer.byoyomi_left[color] = 0;
+        return;
+    }
 
-    // Subtract elapsed time from the player who was being timed (timer_player)
-    if (game->timer.timer_player == WHITE) {
-        game->timer.white_time_seconds -= elapsed;
-        // Add White's increment
-        game->timer.white_time_seconds += game->time_control.white_increment;
-        // Ensure time doesn't go below 0
-        if (game->timer.white_time_seconds < 0) {
-            game->timer.white_time_seconds = 0;
+    if (charged <= *main_time) {
+        *main_time -= charged;
+        if (period->bonus == TIME_BONUS_INCREMENT) {
+            *main_time += bonus_ms;
+        } else if (period->bonus == TIME_BONUS_BRONSTEIN) {
+            *main_time += elapsed < bonus_ms ? elapsed : bonus_ms;
         }
     } else {
-        game->timer.black_time_seconds -= elapsed;
-        // Add Black's increment
-        game->timer.black_time_seconds += game->time_control.black_increment;
-        // Ensure time doesn't go below 0
-        if (game->timer.black_time_seconds < 0) {
-            game->timer.black_time_seconds = 0;
+        // Overtime: each overtime period overrun is lost
+        game->timer.byoyomi_left[color] -= (int)((charged - *main_time) / byoyomi_ms);
+        *main_time = 0;
+    }
+
+    if (period->moves > 0 && ++game->timer.period_moves[color] >= period->moves) {
+        // Time control reached: next period (the last one repeats)
+        game->timer.period_moves[color] = 0;
+        if (game->timer.period[color] + 1 < control->period_count) {
+            game->timer.period[color]++;
         }
+        *main_time += (int64_t)current_time_period(game, color)->minutes * 60000;
     }
+}
 
-    game->timer.timing_active = false;
-    game->timer.move_start_time = 0;
+/**
+ * Format a clock reading as M:SS, or M:SS.t below CLOCK_TENTHS_BELOW_MS
+ * Time is rounded down, so a clock only shows 0:00.0 once it has run out.
+ *
+ * @param milliseconds Time in milliseconds (negative shows as 0)
+ * @param out Output buffer (CLOCK_STRING_SIZE fits any value)
+ * @param cap Size of out
+ */
+void format_clock(int64_t milliseconds, char *out, size_t cap) {
+    if (milliseconds < 0) {
+        milliseconds = 0;
+    }
+
+    long long seconds = milliseconds / 1000;
+    if (milliseconds < CLOCK_TENTHS_BELOW_MS) {
+        snprintf(out, cap, "%lld:%02lld.%lld", seconds / 60, seconds % 60, (long long)(milliseconds % 1000) / 100);
+    } else {
+        snprintf(out, cap, "%lld:%02lld", seconds / 60, seconds % 60);
+    }
 }
 
 /**
  * Format remaining time as MM:SS string
  *
- * @param seconds Time in seconds
- * @return Static string with formatted time (do not free)
+ * @param milliseconds Time in milliseconds
+ * @return Static string with formatted time (do not free; see format_clock()
+ *         for a reentrant version)
  */
-char* get_remaining_time_string(int seconds) {
-    static char time_str[16];
+char* get_remaining_time_string(int64_t milliseconds) {
+    static char time_str[CLOCK_STRING_SIZE];
+    format_clock(milliseconds, time_str, sizeof(time_str));
+    return time_str;
+}
 
-    if (seconds < 0) {
-        seconds = 0;
+/**
+ * Read the monotonic clock
+ * Unaffected by wall-clock changes, so it is safe for measuring moves.
+ *
+ * @return Milliseconds since an arbitrary fixed point
+ */
+int64_t game_clock_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/**
+ * Time until a player's flag falls, counting the move in progress
+ * (main time plus any overtime periods left)
+ *
+ * @param game Game state
+ * @param color Player to read
+ * @return Milliseconds remaining (0 once the flag has fallen)
+ */
+int64_t get_remaining_time_ms(const ChessGame* game, Color color) {
+    int64_t remaining = main_time_left(game, color) +
+                        (int64_t)player_time_control(game, color)->byoyomi_seconds * 1000 * game->timer.byoyomi_left[color];
+    return remaining > 0 ? remaining : 0;
+}
+
+/**
+ * Format a player's clock as displayed: main time, or in overtime the
+ * periods left and the time left in the current one ("BY3 0:25")
+ *
+ * @param game Game state
+ * @param color Player to show
+ * @param out Output buffer (CLOCK_STRING_SIZE fits any value)
+ * @param cap Size of out
+ */
+void format_player_clock(const ChessGame* game, Color color, char *out, size_t cap) {
+    int64_t main_time = main_time_left(game, color);
+    int64_t byoyomi_ms = (int64_t)player_time_control(game, color)->byoyomi_seconds * 1000;
+    if (main_time > 0 || byoyomi_ms == 0) {
+        format_clock(main_time, out, cap);
+        return;
     }
 
-    int minutes = seconds / 60;
-    int secs = seconds % 60;
-    snprintf(time_str, sizeof(time_str), "%d:%02d", minutes, secs);
+    int64_t overtime = -main_time;
+    int periods_left = game->timer.byoyomi_left[color] - (int)(overtime / byoyomi_ms);
+    if (periods_left <= 0) {
+        format_clock(0, out, cap);
+        return;
+    }
+    char period_clock[CLOCK_STRING_SIZE];
+    format_clock(byoyomi_ms - overtime % byoyomi_ms, period_clock, sizeof(period_clock));
+    snprintf(out, cap, "BY%d %s", periods_left, period_clock);
+}
 
-    return time_str;
+/**
+ * Summarize a player's clock for engine time allocation
+ *
+ * @param game Game state
+ * @param color Player to summarize
+ * @param budget Output (all zero when time controls are off)
+ */
+void get_clock_budget(const ChessGame* game, Color color, ClockBudget* budget) {
+    memset(budget, 0, sizeof(*budget));
+    if (!game->time_control.enabled) {
+        return;
+    }
+
+    const TimePeriod *period = current_time_period(game, color);
+    int64_t main_time = main_time_left(game, color);
+    budget->time_ms = main_time > 0 ? main_time : 0;
+    budget->increment_ms = (int64_t)period->bonus_seconds * 1000;
+    if (game->timer.byoyomi_left[color] > 0) {
+        budget->byoyomi_ms = (int64_t)player_time_control(game, color)->byoyomi_seconds * 1000;
+    }
+    budget->moves_to_go = period->moves > 0 ? period->moves - game->timer.period_moves[color] : 0;
 }
 
 /**
@@ -1710,18 +2659,11 @@ bool check_time_forfeit(ChessGame* game) {
 
     // Update active timer player's time if timer is active
     if (game->timer.timing_active) {
-        time_t now = time(NULL);
-        int elapsed = (int)(now - game->timer.move_start_time);
-
-        if (game->timer.timer_player == WHITE) {
-            return (game->timer.white_time_seconds - elapsed) <= 0;
-        } else {
-            return (game->timer.black_time_seconds - elapsed) <= 0;
-        }
+        return get_remaining_time_ms(game, game->timer.timer_player) <= 0;
     }
 
     // Check stored times
-    return (game->timer.white_time_seconds <= 0 || game->timer.black_time_seconds <= 0);
+    return (get_remaining_time_ms(game, WHITE) <= 0 || get_remaining_time_ms(game, BLACK) <= 0);
 }
 
 /**
@@ -1732,4 +2674,95 @@ bool check_time_forfeit(ChessGame* game) {
  */
 bool is_time_control_enabled(ChessGame* game) {
     return (game && game->time_control.enabled);
-}
\ No newline at end of file
+}
+
+
+/******************************************************************************
+ *                             POSITION HASHING
+ ******************************************************************************/
+
+
+/**
+ * Zobrist keys indexed by piece/castling/en passant/side
+ * Generated once from a fixed seed so hashes are stable across runs;
+ * pthread_once() makes the first position_hash() safe from any thread
+ */
+static uint64_t zobrist_pieces[2][7][64];
+static uint64_t zobrist_castling[4];
+static uint64_t zobrist_en_passant[8];
+static uint64_t zobrist_black_to_move;
+static pthread_once_t zobrist_once = PTHREAD_ONCE_INIT;
+
+/**
+ * SplitMix64 step used to fill the Zobrist tables
+ */
+static uint64_t zobrist_next(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * Fill the Zobrist tables (run once through zobrist_once)
+ */
+static void zobrist_init(void) {
+    uint64_t state = 0x436C617564654368ULL;
+    for (int color = 0; color < 2; color++) {
+        for (int type = 0; type < 7; type++) {
+            for (int square = 0; square < 64; square++) {
+                zobrist_pieces[color][type][square] = zobrist_next(&state);
+            }
+        }
+    }
+    for (int i = 0; i < 4; i++) zobrist_castling[i] = zobrist_next(&state);
+    for (int i = 0; i < 8; i++) zobrist_en_passant[i] = zobrist_next(&state);
+    zobrist_black_to_move = zobrist_next(&state);
+}
+
+/**
+ * Compute 64-bit Zobrist hash of a position
+ * Covers board, side to move, castling rights and en passant file (the
+ * same fields FEN records, minus the move counters), so equal positions
+ * always hash equally regardless of how they were reached. The en passant
+ * file only counts when a pawn of the side to move stands ready to capture;
+ * otherwise 1.e4 e5 and 1.Nf3 ... e5 transpositions would hash differently.
+ *
+ * @param game Game state to hash
+ * @return Position hash
+ */
+uint64_t position_hash(const ChessGame *game) {
+    pthread_once(&zobrist_once, zobrist_init);
+
+    uint64_t hash = 0;
+    for (int row = 0; row < BOARD_SIZE; row++) {
+        for (int col = 0; col < BOARD_SIZE; col++) {
+            Piece piece = game->board[row][col];
+            if (piece.type != EMPTY) {
+                hash ^= zobrist_pieces[piece.color][piece.type][row * 8 + col];
+            }
+        }
+    }
+
+    if (!game->white_king_moved && !game->white_rook_h_moved) hash ^= zobrist_castling[0];
+    if (!game->white_king_moved && !game->white_rook_a_moved) hash ^= zobrist_castling[1];
+    if (!game->black_king_moved && !game->black_rook_h_moved) hash ^= zobrist_castling[2];
+    if (!game->black_king_moved && !game->black_rook_a_moved) hash ^= zobrist_castling[3];
+
+    if (game->en_passant_available && is_valid_position(game->en_passant_target.row, game->en_passant_target.col)) {
+        int row = game->en_passant_target.row + (game->current_player == WHITE ? 1 : -1);
+        int col = game->en_passant_target.col;
+        for (int side = -1; side <= 1; side += 2) {
+            if (!is_valid_position(row, col + side)) continue;
+            Piece pawn = game->board[row][col + side];
+            if (pawn.type == PAWN && pawn.color == game->current_player) {
+                hash ^= zobrist_en_passant[col];
+                break;
+            }
+        }
+    }
+
+    if (game->current_player == BLACK) hash ^= zobrist_black_to_move;
+
+    return hash;
+}
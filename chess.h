@@ -22,6 +22,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <ctype.h>
 #include <time.h>
 
@@ -29,17 +30,30 @@
 
 // Game constants
 #define MAX_POSSIBLE_MOVES 64           // Maximum moves a piece can make
+#define MAX_LEGAL_MOVES 256             // Upper bound on legal moves in any position (218 known max)
 #define FIFTY_MOVE_HALFMOVES 100        // Halfmove count for 50-move rule draw (50 full moves)
 #define MAX_SKILL_LEVEL 20              // Maximum Stockfish skill level
 #define MIN_SKILL_LEVEL 0               // Minimum Stockfish skill level
 #define MAX_PGN_DISPLAY_MOVES 1000      // Maximum moves to display in PGN
 #define PAGINATION_LINES 20             // Lines per page for help/load commands
+#define FEN_BUFFER_SIZE 128             // Buffer size that always fits a complete FEN string
+
+// Clock display
+#define CLOCK_TENTHS_BELOW_MS 20000     // Show tenths of a second below this much time
+#define CLOCK_STRING_SIZE 16            // Buffer size for a formatted clock
+#define CLOCK_FIELD_WHITE 0             // Screen field holding White's clock (screen.h)
+#define CLOCK_FIELD_BLACK 1             // Screen field holding Black's clock
 
 // Engine timing constants (milliseconds)
 #define DEFAULT_SEARCH_DEPTH 10         // Default depth when time controls disabled
 #define MOVE_TIME_DIVISOR 20            // Divide remaining time by this for move time
 #define MIN_MOVE_TIME_MS 500            // Minimum time per move
 #define MAX_MOVE_TIME_MS 10000          // Maximum time per move (10 seconds)
+#define MOVE_OVERHEAD_MS 100            // Clock time kept back for engine and display latency
+
+// Time control limits
+#define TIME_MAX_PERIODS 4              // Stages in a multi-period control (40/90+30, G/30)
+#define TIME_CONTROL_STRING_SIZE 64     // Longest TIME setting or description
 
 // Position evaluation thresholds (centipawns)
 #define EVAL_WINNING_THRESHOLD 900      // Decisive advantage
@@ -59,6 +73,14 @@
 #define COLOR_WHITE_PIECE_INVERTED "\033[7;1;96m"  // Inverted bold cyan for captured White pieces
 #define COLOR_BLACK_PIECE_INVERTED "\033[7;1;95m"  // Inverted bold magenta for captured Black pieces
 
+// Square highlights
+#define COLOR_LAST_MOVE "\033[48;5;238m"     // Dark gray background on the last move's squares
+#define COLOR_KING_IN_CHECK "\033[1;97;41m"  // Bold white on red for a king in check
+
+// Chess piece colors (hanging pieces overlay)
+#define COLOR_WHITE_PIECE_HANGING "\033[4;1;96m"  // Underlined bold cyan for hanging White pieces
+#define COLOR_BLACK_PIECE_HANGING "\033[4;1;95m"  // Underlined bold magenta for hanging Black pieces
+
 // Player status colors for captured pieces display
 #define COLOR_WHITE_PLAYER "\033[1;96m"  // Bold cyan for White player status
 #define COLOR_BLACK_PLAYER "\033[1;95m"  // Bold magenta for Black player status
@@ -129,28 +151,75 @@ typedef struct {
     int count;                  // Number of pieces currently captured
 } CapturedPieces;
 
+/**
+ * TimeBonus - How a period's per-move seconds are applied
+ */
+typedef enum {
+    TIME_BONUS_INCREMENT = 0,   // Fischer: added after every move
+    TIME_BONUS_DELAY,           // Simple delay: the clock only runs after the delay
+    TIME_BONUS_BRONSTEIN        // Bronstein: time used is given back, up to the delay
+} TimeBonus;
+
+/**
+ * TimePeriod - One stage of a time control, e.g. 40 moves in 90 minutes
+ * with 30 seconds increment
+ */
+typedef struct {
+    int moves;                  // Moves to complete in the period (0 = rest of the game)
+    int minutes;                // Minutes added when the period begins
+    int bonus_seconds;          // Per-move increment or delay
+    TimeBonus bonus;            // How bonus_seconds applies
+} TimePeriod;
+
+/**
+ * PlayerTimeControl - Complete time control for one player
+ * Periods run in order; if the last one has a move count it repeats.
+ * Byoyomi starts once main time is used up: each move must be made within
+ * byoyomi_seconds, and every overrun costs one of byoyomi_periods.
+ */
+typedef struct {
+    TimePeriod periods[TIME_MAX_PERIODS];
+    int period_count;           // Periods used (1 to TIME_MAX_PERIODS)
+    int byoyomi_seconds;        // Overtime per move (0 = none)
+    int byoyomi_periods;        // Overruns allowed in overtime
+} PlayerTimeControl;
+
 /**
  * TimeControl - Time control settings for the game
  * Configures timing rules for both players (can be different)
  */
 typedef struct {
-    int white_minutes;          // Minutes allocated to White player
-    int white_increment;        // Seconds added after each White move
-    int black_minutes;          // Minutes allocated to Black player
-    int black_increment;        // Seconds added after each Black move
+    PlayerTimeControl white;    // White's time control
+    PlayerTimeControl black;    // Black's time control
     bool enabled;              // Whether time controls are active
 } TimeControl;
 
+/**
+ * ClockBudget - What a player's clock allows, for engine time allocation
+ * (the same quantities UCI passes as wtime/winc/movestogo)
+ */
+typedef struct {
+    int64_t time_ms;            // Main time left, running move included
+    int64_t increment_ms;       // Time credited per move (increment or delay)
+    int64_t byoyomi_ms;         // Overtime per move once main time is gone (0 = none)
+    int moves_to_go;            // Moves until the next period adds time (0 = sudden death)
+} ClockBudget;
+
 /**
  * GameTimer - Tracks time remaining for both players
- * Manages actual timing during gameplay
+ * Manages actual timing during gameplay. Times are milliseconds on the
+ * monotonic clock (game_clock_ms()), so wall-clock changes cannot affect
+ * them and no move is charged for rounding.
  */
 typedef struct {
-    int white_time_seconds;     // Seconds remaining for White player
-    int black_time_seconds;     // Seconds remaining for Black player
-    time_t move_start_time;     // When current player's move started
+    int64_t white_time_ms;      // Milliseconds remaining for White player
+    int64_t black_time_ms;      // Milliseconds remaining for Black player
+    int64_t move_start_ms;      // game_clock_ms() when current player's move started
     bool timing_active;         // Whether timer is currently running
     Color timer_player;         // Which player the active timer belongs to
+    int period[2];              // Current time control period, indexed by Color
+    int period_moves[2];        // Moves made in the current period, indexed by Color
+    int byoyomi_left[2];        // Overtime periods remaining, indexed by Color
 } GameTimer;
 
 
@@ -179,7 +248,7 @@ typedef struct {
     // Efficient game state tracking
     Position white_king_pos;   // White king position (for fast check detection)
     Position black_king_pos;   // Black king position (for fast check detection)
-    Move last_move;           // Most recent move made (for move validation)
+    Move last_move;           // Most recent move made (from.row -1 if none, e.g. after FEN setup)
     bool in_check[2];         // Check status [WHITE, BLACK]
     
     // FEN move counters
@@ -196,6 +265,49 @@ typedef struct {
 
 } ChessGame;
 
+/**
+ * BoardHighlights - Squares print_board() marks, one bit per square
+ * Bit index is row * 8 + col (SQUARE_BIT), so a8 is bit 0 and h1 bit 63
+ */
+typedef struct {
+    uint64_t moves;           // Empty squares the selected piece can move to ('*')
+    uint64_t captures;        // Pieces the selected piece can capture (inverted colors)
+    uint64_t en_passant;      // Pawn an en passant capture would remove (inverted colors)
+    uint64_t last_move;       // From and to squares of the last move (shaded)
+    uint64_t check;           // King in check (red)
+    uint64_t hanging;         // Pieces that can be won by a capture (underlined)
+} BoardHighlights;
+
+#define SQUARE_BIT(row, col) (1ULL << ((row) * BOARD_SIZE + (col)))  // Mask bit of a square
+
+/**
+ * FenError - Result codes from the FEN decoder
+ * Every failure identifies which FEN field was malformed
+ */
+typedef enum {
+    FEN_OK = 0,                 // Position decoded successfully
+    FEN_ERR_EMPTY,              // NULL or empty string
+    FEN_ERR_BAD_PIECE,          // Unknown character in piece placement
+    FEN_ERR_RANK_LENGTH,        // A rank does not describe exactly 8 squares
+    FEN_ERR_RANK_COUNT,         // Piece placement does not have exactly 8 ranks
+    FEN_ERR_MISSING_FIELD,      // Active color field is missing
+    FEN_ERR_BAD_ACTIVE_COLOR,   // Active color is not 'w' or 'b'
+    FEN_ERR_BAD_CASTLING,       // Castling field is not '-' or a subset of KQkq
+    FEN_ERR_BAD_EN_PASSANT,     // En passant field is not '-' or a rank 3/6 square
+    FEN_ERR_BAD_COUNTER,        // Halfmove clock or fullmove number is not a number
+    FEN_ERR_TRAILING_DATA       // Extra characters after the fullmove number
+} FenError;
+
+/**
+ * FenResult - Outcome of fen_decode()
+ * offset is the byte index of the offending character on error, or the
+ * length of the consumed input on success
+ */
+typedef struct {
+    FenError code;
+    int offset;
+} FenResult;
+
 /* ========================================================================
  * FUNCTION DECLARATIONS
  * Core chess game functions for board management, move validation,
@@ -204,7 +316,11 @@ typedef struct {
 
 // Board initialization and display
 void init_board(ChessGame *game);  // Initialize new game with starting positions
-void print_board(ChessGame *game, Position possible_moves[], int move_count);  // Display board with optional move highlighting
+void print_board(ChessGame *game, const BoardHighlights *highlights);  // Display board with highlight masks (NULL for none)
+void get_board_highlights(const ChessGame *game, BoardHighlights *highlights);  // Last move, check and hanging overlay masks
+int get_move_highlights(ChessGame *game, Position from, BoardHighlights *highlights);  // Add a piece's legal destinations (returns count)
+void set_hanging_overlay(bool enabled);  // Include hanging pieces in board highlights
+bool is_hanging_overlay_enabled(void);  // Whether the hanging pieces overlay is on
 
 // Board state queries  
 bool is_valid_position(int row, int col);  // Check if coordinates are within board bounds
@@ -217,6 +333,7 @@ void clear_position(ChessGame *game, int row, int col);  // Remove piece from po
 int get_possible_moves(ChessGame *game, Position from, Position moves[]);  // Get all possible moves for piece at position
 int get_pawn_moves(ChessGame *game, Position from, Position moves[]);  // Get all possible pawn moves including en passant
 bool is_valid_move(ChessGame *game, Position from, Position to);  // Check if move is legal
+int generate_legal_moves(ChessGame *game, Move moves[]);  // Fill moves[] (MAX_LEGAL_MOVES) with all legal moves
 bool make_move(ChessGame *game, Position from, Position to);  // Execute move and update game state
 bool make_promotion_move(ChessGame *game, Position from, Position to, PieceType promotion_type);  // Execute pawn promotion move
 bool execute_move(ChessGame *game, Move move);  // Execute move from Move structure (handles AI promotion)
@@ -229,9 +346,16 @@ bool is_valid_promotion_piece(PieceType piece_type);  // Validate promotion piec
 // Check and game state analysis
 bool is_in_check(ChessGame *game, Color color);  // Determine if player is in check
 bool would_be_in_check_after_move(ChessGame *game, Position from, Position to);  // Test if move would leave king in check
+bool has_legal_moves(ChessGame *game, Color color);  // Check if a player has at least one legal move
+bool is_checkmate(ChessGame *game, Color color);  // In check with no legal move
+bool is_stalemate(ChessGame *game, Color color);  // Not in check with no legal move (draw)
 bool is_square_attacked(ChessGame *game, Position pos, Color by_color);  // Check if square is attacked by given color
 int get_king_moves_no_castling(ChessGame *game, Position from, Position moves[]);  // Get king moves without castling (for attack checking)
 
+// Static exchange evaluation
+int static_exchange_eval(const ChessGame *game, Move move);  // Material won by a capture after all recaptures (centipawns)
+bool is_piece_hanging(const ChessGame *game, Position pos);  // Check if the opponent wins material by capturing the piece
+
 // Display and formatting utilities
 void print_captured_pieces(CapturedPieces *captured, const char* color_code, const char* player_name, ChessGame* game);  // Display captured pieces for UI
 char piece_to_char(Piece piece);  // Convert piece to display character
@@ -243,20 +367,32 @@ char *position_to_string(Position pos);  // Convert Position to algebraic notati
 void calculate_captured_pieces(ChessGame *game);  // Calculate captured pieces from current board position
 
 // FEN parsing and board setup functions
+FenResult fen_decode(ChessGame *game, const char *fen);  // Single-pass FEN decoder (position fields only)
+const char* fen_error_string(FenError error);  // Describe a FEN decoder error code
 bool validate_fen_string(const char* fen);  // Validate FEN string format
 bool setup_board_from_fen(ChessGame *game, const char* fen);  // Parse FEN and set board position
+size_t fen_write(const ChessGame *game, char *out, size_t cap);  // Serialize position to FEN (reentrant, returns length)
 PieceType char_to_piece_type(char c);  // Convert character to piece type (helper function)
 
 // Draw conditions
 bool is_fifty_move_rule_draw(ChessGame *game);  // Check if 50-move rule draw condition is met
 
 // Time control functions
-bool parse_time_control(const char* time_str, TimeControl* tc);  // Parse TIME xx/yy command format
+bool parse_time_control(const char* time_str, TimeControl* tc);  // Parse TIME xx/yy or extended (40/90+30,G/30d5,byo5x30) format
+void describe_time_control(const PlayerTimeControl* control, char *out, size_t cap);  // Human-readable summary
 void init_game_timer(ChessGame* game, TimeControl* time_control);  // Initialize timer system
 void start_move_timer(ChessGame* game);  // Begin timing current player's move
-void stop_move_timer(ChessGame* game);  // End timing and apply increment
-char* get_remaining_time_string(int seconds);  // Format time as MM:SS string
+void stop_move_timer(ChessGame* game);  // End timing, apply delay/increment, advance periods
+char* get_remaining_time_string(int64_t milliseconds);  // Format time as M:SS (M:SS.t when low)
+void format_clock(int64_t milliseconds, char *out, size_t cap);  // Reentrant get_remaining_time_string()
+int64_t game_clock_ms(void);  // Monotonic clock in milliseconds
+int64_t get_remaining_time_ms(const ChessGame* game, Color color);  // Time until flag-fall, byoyomi included
+void format_player_clock(const ChessGame* game, Color color, char *out, size_t cap);  // Clock text as displayed
+void get_clock_budget(const ChessGame* game, Color color, ClockBudget* budget);  // Inputs for engine time allocation
 bool check_time_forfeit(ChessGame* game);  // Check for time expiration
 bool is_time_control_enabled(ChessGame* game);  // Check if time controls are active
 
+// Position hashing
+uint64_t position_hash(const ChessGame *game);  // 64-bit Zobrist hash of board, side, castling, en passant
+
 #endif
\ No newline at end of file
@@ -0,0 +1,90 @@
+/**
+ * CHESS_SERVER.C - Multi-Game Server
+ *
+ * Hosts many games in one process behind a local Unix socket, sharing a
+ * small engine pool between all of them (see server.h for the commands).
+ *
+ * Usage: ./chess_server [--socket PATH] [--journals DIR] [--engines N]
+ *
+ * Example session with a line client such as socat:
+ *        socat - UNIX-CONNECT:chess_server.sock
+ *        create white skill 5 time 10/5       -> created 1
+ *        move 1 e4                            -> moved 1 e2e4 e4, ok, moved 1 ... (engine)
+ *        query 1                              -> state 1 playing * white ...
+ *
+ * Features:
+ * - Each game keeps its own clock, move history and FEN journal
+ *   (DIR/session_<id>.fen)
+ * - Engines are Stockfish processes, or the built-in search when
+ *   Stockfish is not installed
+ * - SIGINT or SIGTERM shuts the server down cleanly
+ */
+
+#define _GNU_SOURCE        // Required for Linux (sigaction)
+
+#include "server.h"
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SERVER_DEFAULT_SOCKET "chess_server.sock"
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void handle_stop_signal(int signal_number) {
+    (void)signal_number;
+    stop_requested = 1;
+}
+
+int main(int argc, char* argv[]) {
+    static GameServer server;
+    const char *socket_path = SERVER_DEFAULT_SOCKET;
+    const char *journal_dir = ".";
+    int engines = SERVER_DEFAULT_ENGINES;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else if (strcmp(argv[i], "--journals") == 0 && i + 1 < argc) {
+            journal_dir = argv[++i];
+        } else if (strcmp(argv[i], "--engines") == 0 && i + 1 < argc) {
+            engines = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--socket PATH] [--journals DIR] [--engines N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (engines < 1 || engines > SERVER_MAX_ENGINES) {
+        fprintf(stderr, "Error: --engines must be 1 to %d\n", SERVER_MAX_ENGINES);
+        return 1;
+    }
+
+    // No SA_RESTART: a signal ends epoll_wait() so the loop sees it at once
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_stop_signal;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    if (!server_init(&server, socket_path, journal_dir, engines)) {
+        fprintf(stderr, "Error: Cannot listen on %s\n", socket_path);
+        server_close(&server);
+        return 1;
+    }
+    printf("Listening on %s with %d engine%s (%s), journals in %s\n", socket_path, server.engine_count,
+           server.engine_count == 1 ? "" : "s", server.engines[0].builtin ? "built-in" : "Stockfish", journal_dir);
+    fflush(stdout);
+
+    while (!stop_requested) {
+        if (server_run_once(&server, SERVER_TICK_MS) < 0) {
+            perror("epoll_wait");
+            break;
+        }
+    }
+
+    server_close(&server);
+    printf("Server stopped\n");
+    return 0;
+}
@@ -0,0 +1,227 @@
+/**
+ * clock_ticker.c - Live Game Clock
+ *
+ * Purpose:
+ *   Background thread that redraws the running clock and signals
+ *   flag-fall (see clock_ticker.h).
+ *
+ * Architecture:
+ *   - All state is guarded by one mutex; the thread holds it while it
+ *     reads the timer and draws, which is what makes
+ *     clock_ticker_disarm() a barrier
+ *   - Waits use a CLOCK_MONOTONIC condition variable, matching
+ *     game_clock_ms(), so the wake-up for a flag-fall is exact
+ *   - Flag-fall wakes the reader through a non-blocking self-pipe; the
+ *     byte stays in the pipe until the reader drains it, so a flag that
+ *     falls before the reader reaches poll() is never missed
+ *
+ * Dependencies:
+ *   - chess.h, screen.h, POSIX threads, pipe2() and poll()
+ */
+
+#define _GNU_SOURCE        // Required for Linux (pthread_condattr_setclock, pipe2)
+
+#include "clock_ticker.h"
+#include "screen.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <unistd.h>
+
+static pthread_mutex_t ticker_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ticker_wake;
+static pthread_t ticker_thread;
+static int flag_pipe[2] = {-1, -1};     // Written on flag-fall, polled by clock_ticker_read_line()
+static ChessGame *ticker_game = NULL;
+static bool running = false;
+static bool armed = false;
+static bool interrupt_on_flag = false;
+static bool flag_fell = false;
+
+/**
+ * Empty the flag-fall pipe
+ */
+static void drain_flag_pipe(void) {
+    char bytes[16];
+    while (read(flag_pipe[0], bytes, sizeof(bytes)) > 0) {
+        // Discard
+    }
+}
+
+/**
+ * Draw both clocks into their screen fields
+ */
+static void draw_clocks(void) {
+    char text[CLOCK_STRING_SIZE];
+    format_player_clock(ticker_game, WHITE, text, sizeof(text));
+    screen_update_field(CLOCK_FIELD_WHITE, text);
+    format_player_clock(ticker_game, BLACK, text, sizeof(text));
+    screen_update_field(CLOCK_FIELD_BLACK, text);
+}
+
+/**
+ * Thread body: tick while armed, sleep otherwise
+ */
+static void *ticker_main(void *unused) {
+    (void)unused;
+    pthread_mutex_lock(&ticker_lock);
+    while (running) {
+        if (!armed || !ticker_game->timer.timing_active) {
+            pthread_cond_wait(&ticker_wake, &ticker_lock);
+            continue;
+        }
+
+        draw_clocks();
+        int64_t remaining = get_remaining_time_ms(ticker_game, ticker_game->timer.timer_player);
+        if (remaining <= 0) {
+            flag_fell = true;
+            armed = false;
+            if (interrupt_on_flag && write(flag_pipe[1], "F", 1) < 0) {
+                // Pipe full: a wake-up is already pending
+            }
+            continue;
+        }
+
+        // Wake for the next tick, or exactly when the flag falls
+        int64_t wait_ms = remaining < CLOCK_TICK_MS ? remaining : CLOCK_TICK_MS;
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += wait_ms / 1000;
+        deadline.tv_nsec += (long)(wait_ms % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+        pthread_cond_timedwait(&ticker_wake, &ticker_lock, &deadline);
+    }
+    pthread_mutex_unlock(&ticker_lock);
+    return NULL;
+}
+
+/**
+ * Start the ticker thread and create the flag-fall pipe
+ *
+ * @param game Game whose timer is shown (must outlive the ticker)
+ * @return true if the thread is running
+ */
+bool clock_ticker_start(ChessGame *game) {
+    if (running) return true;
+    if (pipe2(flag_pipe, O_NONBLOCK | O_CLOEXEC) != 0) return false;
+
+    pthread_condattr_t attributes;
+    pthread_condattr_init(&attributes);
+    pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+    pthread_cond_init(&ticker_wake, &attributes);
+    pthread_condattr_destroy(&attributes);
+
+    ticker_game = game;
+    running = true;
+    if (pthread_create(&ticker_thread, NULL, ticker_main, NULL) != 0) {
+        running = false;
+        pthread_cond_destroy(&ticker_wake);
+        close(flag_pipe[0]);
+        close(flag_pipe[1]);
+        flag_pipe[0] = flag_pipe[1] = -1;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Stop and join the ticker thread
+ */
+void clock_ticker_stop(void) {
+    pthread_mutex_lock(&ticker_lock);
+    if (!running) {
+        pthread_mutex_unlock(&ticker_lock);
+        return;
+    }
+    running = false;
+    armed = false;
+    pthread_cond_signal(&ticker_wake);
+    pthread_mutex_unlock(&ticker_lock);
+
+    pthread_join(ticker_thread, NULL);
+    pthread_cond_destroy(&ticker_wake);
+    close(flag_pipe[0]);
+    close(flag_pipe[1]);
+    flag_pipe[0] = flag_pipe[1] = -1;
+}
+
+/**
+ * Start showing the running clock (call after start_move_timer())
+ *
+ * @param interrupt Make clock_ticker_read_line() return NULL on flag-fall
+ */
+void clock_ticker_arm(bool interrupt) {
+    pthread_mutex_lock(&ticker_lock);
+    if (running) {
+        drain_flag_pipe();   // A wake-up left from an earlier period
+        armed = true;
+        interrupt_on_flag = interrupt;
+        flag_fell = false;
+        pthread_cond_signal(&ticker_wake);
+    }
+    pthread_mutex_unlock(&ticker_lock);
+}
+
+/**
+ * Stop updating the clock; no tick is in progress once this returns
+ */
+void clock_ticker_disarm(void) {
+    pthread_mutex_lock(&ticker_lock);
+    armed = false;
+    pthread_mutex_unlock(&ticker_lock);
+}
+
+/**
+ * Whether the last armed period ended because the running clock hit zero
+ *
+ * @return true after a flag-fall
+ */
+bool clock_ticker_flag_fell(void) {
+    pthread_mutex_lock(&ticker_lock);
+    bool fell = flag_fell;
+    pthread_mutex_unlock(&ticker_lock);
+    return fell;
+}
+
+/**
+ * Read a line from stdin like fgets(), giving up when the flag falls
+ * Waits on stdin and the flag-fall pipe with poll() and reads one byte at
+ * a time, so stdin must be unbuffered. Without a running ticker this is a
+ * plain blocking read.
+ *
+ * @param buffer Output: the line, newline included when it fits
+ * @param size Buffer size in bytes
+ * @return buffer, or NULL at end of input or when the flag fell (see
+ *         clock_ticker_flag_fell())
+ */
+char *clock_ticker_read_line(char *buffer, int size) {
+    int length = 0;
+    while (length < size - 1) {
+        struct pollfd fds[2] = {{STDIN_FILENO, POLLIN, 0}, {flag_pipe[0], POLLIN, 0}};
+        int count = flag_pipe[0] >= 0 ? 2 : 1;
+        if (poll(fds, count, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (count == 2 && (fds[1].revents & POLLIN)) {
+            pthread_mutex_lock(&ticker_lock);
+            drain_flag_pipe();
+            pthread_mutex_unlock(&ticker_lock);
+            return NULL;
+        }
+
+        int c = getc(stdin);
+        if (c == EOF) break;
+        buffer[length++] = (char)c;
+        if (c == '\n') break;
+    }
+    if (length == 0) return NULL;
+    buffer[length] = '\0';
+    return buffer;
+}
@@ -0,0 +1,50 @@
+#ifndef CLOCK_TICKER_H
+#define CLOCK_TICKER_H
+
+/**
+ * clock_ticker.h - Live Game Clock
+ *
+ * Purpose:
+ *   Keeps the clocks on the game screen counting down while a player
+ *   thinks, and ends the human's turn the moment their flag falls instead
+ *   of on their next keypress.
+ *
+ * Architecture:
+ *   - One background thread, idle (waiting on a condition variable)
+ *     except while armed
+ *   - While armed it wakes every CLOCK_TICK_MS, or at the instant the
+ *     running clock reaches zero if that is sooner, and rewrites the
+ *     clock fields (CLOCK_FIELD_WHITE/BLACK) of the frame on screen with
+ *     screen_update_field()
+ *   - Armed with interrupt_on_flag, a flag-fall writes a byte to a
+ *     self-pipe. clock_ticker_read_line() polls stdin and that pipe
+ *     together, so the prompt returns NULL at flag-fall even if the flag
+ *     fell before the read started, and the game loop's
+ *     check_time_forfeit() ends the game
+ *   - clock_ticker_read_line() polls the file descriptor, so stdin must be
+ *     unbuffered (setvbuf() before the first read); otherwise a line held
+ *     in the stdio buffer would never wake the poll
+ *   - The game timer is only read while armed, and disarming waits for
+ *     any tick in progress, so the caller may stop_move_timer() right
+ *     after clock_ticker_disarm()
+ *
+ * Dependencies:
+ *   - chess.h for the game timer, screen.h for field updates, pthreads,
+ *     poll()
+ */
+
+#include "chess.h"
+
+#define CLOCK_TICK_MS 100               // Display refresh while a clock runs
+
+// Lifetime
+bool clock_ticker_start(ChessGame *game);  // Start the thread (idle until armed)
+void clock_ticker_stop(void);  // Stop and join the thread
+
+// Turns
+void clock_ticker_arm(bool interrupt);  // Show the running clock; optionally end clock_ticker_read_line() on flag-fall
+void clock_ticker_disarm(void);  // Stop updating; returns once no tick is in progress
+bool clock_ticker_flag_fell(void);  // Whether the last armed period ended in a flag-fall
+char *clock_ticker_read_line(char *buffer, int size);  // fgets() on stdin that returns NULL at flag-fall
+
+#endif // CLOCK_TICKER_H
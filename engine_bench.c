@@ -0,0 +1,528 @@
+/**
+ * ENGINE_BENCH.C - End-to-End Latency Benchmark for Engine Round Trips
+ *
+ * Replays a corpus of positions against a UCI engine at a fixed node count
+ * and splits each round trip into phases, so the time the AI takes can be
+ * divided into search and our own overhead (building the commands, the
+ * pipe, reading and parsing the answer).
+ *
+ * Usage: ./engine_bench [--engine stub|stockfish|PATH] [--positions PATH]
+ *                       [--nodes N] [--limit N] [--rounds N]
+ *                       [--transport stdio|fd|both]
+ *        ./engine_bench --stub          (act as the stub engine on stdin/stdout)
+ *
+ * Example:
+ *        ./engine_bench                              (stub engine: our overhead only)
+ *        ./engine_bench --engine stockfish --nodes 20000 --positions FEN_FILES
+ *
+ * Phases (per position):
+ * - serialize   FEN and "position"/"go nodes" command text built
+ * - send        commands written to the engine's stdin
+ * - first_info  end of send to the first "info" line
+ * - bestmove    end of send to the "bestmove" line
+ * - parse       bestmove line turned into a legal Move
+ * - total       all of the above
+ *
+ * Transports:
+ * - stdio  what get_best_move() does: send_command() (fprintf + fflush)
+ *          once per command, read_response() (fgets) per line
+ * - fd     both commands in one write(), lines split from read() calls
+ *          that wait with poll()
+ *   Each transport talks to its own engine process.
+ *
+ * The stub engine answers every "go" at once with one info line and the
+ * first legal move, so with it every phase measures our side and the pipe.
+ * Positions come from .fen files (every line; a directory is read in name
+ * order); positions without a legal move are skipped.
+ */
+
+#define _GNU_SOURCE        // Required for Linux (fdopen, strdup)
+
+#include "chess.h"
+#include "profile.h"
+#include "stockfish.h"
+#include <dirent.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define ENGINE_BENCH_MAX_POSITIONS 4096     // Corpus size limit
+#define ENGINE_BENCH_DEFAULT_NODES 10000    // go nodes
+#define ENGINE_BENCH_TIMEOUT_MS 30000       // Longest wait for one engine line (fd transport)
+#define ENGINE_BENCH_LINE_SIZE 4096         // Longest engine line kept
+#define ENGINE_BENCH_COMMAND_SIZE (FEN_BUFFER_SIZE + 64)
+
+/**
+ * Phase - Parts of one round trip
+ */
+typedef enum {
+    PHASE_SERIALIZE,
+    PHASE_SEND,
+    PHASE_FIRST_INFO,
+    PHASE_BESTMOVE,
+    PHASE_PARSE,
+    PHASE_TOTAL,
+    PHASE_COUNT
+} Phase;
+
+static const char *phase_names[PHASE_COUNT] = {
+    "serialize", "send", "first_info", "bestmove", "parse", "total"
+};
+
+/**
+ * Transport - How commands and answers cross the pipes
+ */
+typedef enum {
+    TRANSPORT_STDIO,
+    TRANSPORT_FD,
+    TRANSPORT_COUNT
+} Transport;
+
+static const char *transport_names[TRANSPORT_COUNT] = {"stdio", "fd"};
+
+/**
+ * FdReader - Line splitter over a raw descriptor
+ */
+typedef struct {
+    int fd;
+    char data[ENGINE_BENCH_LINE_SIZE];
+    size_t start, end;            // Unread bytes are data[start..end)
+} FdReader;
+
+/**
+ * Timings - Per-phase samples of one transport, in nanoseconds
+ */
+typedef struct {
+    uint64_t *samples[PHASE_COUNT];
+    int count;
+    int no_info;                  // Round trips without an info line
+} Timings;
+
+/******************************************************************************
+ *                                STUB ENGINE
+ ******************************************************************************/
+
+/**
+ * Minimal UCI engine: answers "go" at once with the first legal move
+ *
+ * @return Exit status
+ */
+static int run_stub_engine(void) {
+    ChessGame game;
+    Move moves[MAX_LEGAL_MOVES];
+    char line[ENGINE_BENCH_LINE_SIZE];
+
+    init_board(&game);
+    setvbuf(stdout, NULL, _IOFBF, 0);
+    while (fgets(line, sizeof(line), stdin)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (strcmp(line, "uci") == 0) {
+            printf("id name engine_bench stub\nid author Claude Chess\nuciok\n");
+        } else if (strcmp(line, "isready") == 0) {
+            printf("readyok\n");
+        } else if (strncmp(line, "position fen ", 13) == 0) {
+            if (!setup_board_from_fen(&game, line + 13)) init_board(&game);
+        } else if (strncmp(line, "position startpos", 17) == 0) {
+            init_board(&game);
+        } else if (strncmp(line, "go", 2) == 0) {
+            char uci[8] = "(none)";
+            if (generate_legal_moves(&game, moves) > 0) {
+                Move *move = &moves[0];
+                snprintf(uci, sizeof(uci), "%c%c%c%c", 'a' + move->from.col, '8' - move->from.row,
+                         'a' + move->to.col, '8' - move->to.row);
+                if (move->is_promotion) {
+                    uci[4] = "  rnbq"[move->promotion_piece];
+                    uci[5] = '\0';
+                }
+            }
+            printf("info depth 1 nodes 1 score cp 0 pv %s\nbestmove %s\n", uci, uci);
+        } else if (strcmp(line, "quit") == 0) {
+            break;
+        }
+        fflush(stdout);
+    }
+    return 0;
+}
+
+/******************************************************************************
+ *                                  CORPUS
+ ******************************************************************************/
+
+static int compare_names(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/**
+ * Add every playable position of one .fen file to the corpus
+ */
+static void load_fen_file(const char *path, ChessGame *positions, int *count, int limit) {
+    FILE *file = fopen(path, "r");
+    if (!file) return;
+    char line[256];
+    Move moves[MAX_LEGAL_MOVES];
+    while (*count < limit && fgets(line, sizeof(line), file)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        ChessGame *game = &positions[*count];
+        if (line[0] == '\0' || !setup_board_from_fen(game, line)) continue;
+        if (generate_legal_moves(game, moves) > 0) (*count)++;
+    }
+    fclose(file);
+}
+
+/**
+ * Load the corpus from a .fen file or a directory of them
+ *
+ * @return Positions loaded, or -1 if the path cannot be read
+ */
+static int load_corpus(const char *path, ChessGame *positions, int limit) {
+    struct stat info;
+    if (stat(path, &info) != 0) return -1;
+
+    int count = 0;
+    if (!S_ISDIR(info.st_mode)) {
+        load_fen_file(path, positions, &count, limit);
+        return count;
+    }
+
+    DIR *dir = opendir(path);
+    if (!dir) return -1;
+    char *names[ENGINE_BENCH_MAX_POSITIONS];
+    int name_count = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) && name_count < ENGINE_BENCH_MAX_POSITIONS) {
+        const char *dot = strrchr(entry->d_name, '.');
+        if (dot && strcmp(dot, ".fen") == 0) names[name_count++] = strdup(entry->d_name);
+    }
+    closedir(dir);
+    qsort(names, name_count, sizeof(char *), compare_names);
+
+    for (int i = 0; i < name_count; i++) {
+        char file_path[1024];
+        snprintf(file_path, sizeof(file_path), "%s/%s", path, names[i]);
+        load_fen_file(file_path, positions, &count, limit);
+        free(names[i]);
+    }
+    return count;
+}
+
+/******************************************************************************
+ *                                TRANSPORTS
+ ******************************************************************************/
+
+/**
+ * Read one line from a raw descriptor, waiting with poll()
+ *
+ * @return false on end of file, error or timeout
+ */
+static bool fd_read_line(FdReader *reader, char *line, size_t size) {
+    for (;;) {
+        char *newline = memchr(reader->data + reader->start, '\n', reader->end - reader->start);
+        if (newline) {
+            size_t length = (size_t)(newline - (reader->data + reader->start));
+            size_t copied = length < size - 1 ? length : size - 1;
+            memcpy(line, reader->data + reader->start, copied);
+            line[copied] = '\0';
+            reader->start += length + 1;
+            return true;
+        }
+
+        if (reader->start > 0) {
+            memmove(reader->data, reader->data + reader->start, reader->end - reader->start);
+            reader->end -= reader->start;
+            reader->start = 0;
+        }
+        if (reader->end == sizeof(reader->data)) reader->end = 0;    // Overlong line: drop it
+
+        struct pollfd wait = {reader->fd, POLLIN, 0};
+        int ready = poll(&wait, 1, ENGINE_BENCH_TIMEOUT_MS);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready <= 0) return false;
+        ssize_t got = read(reader->fd, reader->data + reader->end, sizeof(reader->data) - reader->end);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        reader->end += (size_t)got;
+    }
+}
+
+/**
+ * Write a whole buffer to a raw descriptor
+ */
+static bool fd_write_all(int fd, const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        data += written;
+        length -= (size_t)written;
+    }
+    return true;
+}
+
+/**
+ * Turn a "bestmove" line into a legal move the way get_best_move() does
+ */
+static bool parse_bestmove(ChessGame *game, char *line, Move *move) {
+    char *move_start = line + 9;
+    char *space_pos = strchr(move_start, ' ');
+    if (space_pos) *space_pos = '\0';
+    return find_legal_uci_move(game, move_start, move);
+}
+
+/**
+ * One round trip: position, go, wait for bestmove, parse
+ *
+ * @param engine Engine (its FILE streams for stdio, their descriptors for fd)
+ * @param reader Line splitter for the fd transport
+ * @param transport Transport to use
+ * @param game Position to send
+ * @param nodes go nodes limit
+ * @param phases Output: nanoseconds per phase (first_info is 0 without an info line)
+ * @return false if the engine stopped answering or gave an illegal move
+ */
+static bool round_trip(StockfishEngine *engine, FdReader *reader, Transport transport, ChessGame *game,
+                       int nodes, uint64_t phases[PHASE_COUNT]) {
+    char position_command[ENGINE_BENCH_COMMAND_SIZE];
+    char go_command[32];
+    char line[ENGINE_BENCH_LINE_SIZE];
+    memset(phases, 0, sizeof(uint64_t) * PHASE_COUNT);
+
+    uint64_t start = profile_now_ns();
+    static const char prefix[] = "position fen ";
+    memcpy(position_command, prefix, sizeof(prefix) - 1);
+    fen_write(game, position_command + sizeof(prefix) - 1, FEN_BUFFER_SIZE);
+    snprintf(go_command, sizeof(go_command), "go nodes %d", nodes);
+    uint64_t serialized = profile_now_ns();
+
+    bool sent;
+    if (transport == TRANSPORT_STDIO) {
+        sent = send_command(engine, position_command) && send_command(engine, go_command);
+    } else {
+        char batch[ENGINE_BENCH_COMMAND_SIZE + 32];
+        int length = snprintf(batch, sizeof(batch), "%s\n%s\n", position_command, go_command);
+        sent = fd_write_all(fileno(engine->to_engine), batch, (size_t)length);
+    }
+    uint64_t sent_at = profile_now_ns();
+    if (!sent) return false;
+
+    uint64_t first_info = 0;
+    for (;;) {
+        bool got = transport == TRANSPORT_STDIO ? read_response(engine, line, sizeof(line))
+                                                : fd_read_line(reader, line, sizeof(line));
+        if (!got) return false;
+        if (first_info == 0 && strncmp(line, "info", 4) == 0) first_info = profile_now_ns();
+        if (strncmp(line, "bestmove", 8) == 0) break;
+    }
+    uint64_t answered = profile_now_ns();
+
+    Move move;
+    bool legal = parse_bestmove(game, line, &move);
+    uint64_t parsed = profile_now_ns();
+
+    phases[PHASE_SERIALIZE] = serialized - start;
+    phases[PHASE_SEND] = sent_at - serialized;
+    phases[PHASE_FIRST_INFO] = first_info ? first_info - sent_at : 0;
+    phases[PHASE_BESTMOVE] = answered - sent_at;
+    phases[PHASE_PARSE] = parsed - answered;
+    phases[PHASE_TOTAL] = parsed - start;
+    return legal;
+}
+
+/******************************************************************************
+ *                                 REPORTING
+ ******************************************************************************/
+
+static int compare_samples(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Median, p99 (nearest rank) and mean of samples; sorts them
+ */
+static void summarize(uint64_t *samples, int count, uint64_t *median, uint64_t *p99, uint64_t *mean) {
+    *median = *p99 = *mean = 0;
+    if (count == 0) return;
+    qsort(samples, count, sizeof(uint64_t), compare_samples);
+    uint64_t total = 0;
+    for (int i = 0; i < count; i++) total += samples[i];
+    int rank = (int)(0.99 * count + 0.999999);
+    *median = samples[count / 2];
+    *p99 = samples[(rank < 1 ? 1 : rank) - 1];
+    *mean = total / (uint64_t)count;
+}
+
+/**
+ * Print the phase table of one transport; fills medians for the comparison
+ */
+static void print_timings(Transport transport, Timings *timings, uint64_t medians[PHASE_COUNT]) {
+    char median_text[16], p99_text[16], mean_text[16];
+    printf("\nTransport %s: %d round trips\n", transport_names[transport], timings->count);
+    printf("%-12s %10s %10s %10s\n", "Phase", "Median", "p99", "Mean");
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        int count = timings->count;
+        uint64_t *samples = timings->samples[phase];
+        if (phase == PHASE_FIRST_INFO) {
+            // Only round trips that had an info line
+            int kept = 0;
+            for (int i = 0; i < count; i++) {
+                if (samples[i] > 0) samples[kept++] = samples[i];
+            }
+            count = kept;
+        }
+        uint64_t median, p99, mean;
+        summarize(samples, count, &median, &p99, &mean);
+        medians[phase] = median;
+        profile_format_ns(median, median_text, sizeof(median_text));
+        profile_format_ns(p99, p99_text, sizeof(p99_text));
+        profile_format_ns(mean, mean_text, sizeof(mean_text));
+        printf("%-12s %10s %10s %10s\n", phase_names[phase], median_text, p99_text, mean_text);
+    }
+    if (timings->no_info > 0) {
+        printf("(%d round trips had no info line)\n", timings->no_info);
+    }
+}
+
+/**
+ * Run the corpus over one transport with its own engine process
+ *
+ * @return false if the engine cannot be started or stops answering
+ */
+static bool run_transport(char *const command[], Transport transport, ChessGame *positions, int count,
+                          int rounds, int nodes, Timings *timings) {
+    StockfishEngine engine = {0};
+    if (!init_uci_engine(&engine, command)) {
+        fprintf(stderr, "Error: Cannot start engine %s\n", command[0]);
+        return false;
+    }
+    send_command(&engine, "ucinewgame");
+    send_command(&engine, "isready");
+    char line[ENGINE_BENCH_LINE_SIZE];
+    while (read_response(&engine, line, sizeof(line)) && !strstr(line, "readyok")) {
+    }
+
+    FdReader reader = {fileno(engine.from_engine), {0}, 0, 0};
+    bool ok = true;
+    for (int round = 0; round < rounds && ok; round++) {
+        for (int i = 0; i < count; i++) {
+            uint64_t phases[PHASE_COUNT];
+            if (!round_trip(&engine, &reader, transport, &positions[i], nodes, phases)) {
+                fprintf(stderr, "Error: No legal answer from the engine for position %d\n", i + 1);
+                ok = false;
+                break;
+            }
+            for (int phase = 0; phase < PHASE_COUNT; phase++) {
+                timings->samples[phase][timings->count] = phases[phase];
+            }
+            if (phases[PHASE_FIRST_INFO] == 0) timings->no_info++;
+            timings->count++;
+        }
+    }
+
+    close_stockfish(&engine);
+    return ok;
+}
+
+static void print_usage(const char *program) {
+    fprintf(stderr, "Usage: %s [--engine stub|stockfish|PATH] [--positions PATH] [--nodes N]\n", program);
+    fprintf(stderr, "       %*s [--limit N] [--rounds N] [--transport stdio|fd|both]\n", (int)strlen(program), "");
+    fprintf(stderr, "       %s --stub\n", program);
+}
+
+int main(int argc, char* argv[]) {
+    const char *engine_name = "stub";
+    const char *corpus_path = "FEN_FILES";
+    int nodes = ENGINE_BENCH_DEFAULT_NODES;
+    int limit = ENGINE_BENCH_MAX_POSITIONS;
+    int rounds = 1;
+    bool use_transport[TRANSPORT_COUNT] = {true, true};
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--stub") == 0) {
+            return run_stub_engine();
+        } else if (strcmp(argv[i], "--engine") == 0 && i + 1 < argc) {
+            engine_name = argv[++i];
+        } else if (strcmp(argv[i], "--positions") == 0 && i + 1 < argc) {
+            corpus_path = argv[++i];
+        } else if (strcmp(argv[i], "--nodes") == 0 && i + 1 < argc) {
+            nodes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--limit") == 0 && i + 1 < argc) {
+            limit = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+            rounds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--transport") == 0 && i + 1 < argc) {
+            const char *name = argv[++i];
+            use_transport[TRANSPORT_STDIO] = strcmp(name, "stdio") == 0 || strcmp(name, "both") == 0;
+            use_transport[TRANSPORT_FD] = strcmp(name, "fd") == 0 || strcmp(name, "both") == 0;
+            if (!use_transport[TRANSPORT_STDIO] && !use_transport[TRANSPORT_FD]) {
+                print_usage(argv[0]);
+                return 1;
+            }
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (nodes < 1 || limit < 1 || limit > ENGINE_BENCH_MAX_POSITIONS || rounds < 1) {
+        fprintf(stderr, "Error: --nodes and --rounds must be positive, --limit 1 to %d\n", ENGINE_BENCH_MAX_POSITIONS);
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);   // An engine that exits makes writes fail instead
+
+    // The stub is this program started again with --stub
+    char *stub_command[] = {argv[0], "--stub", NULL};
+    char *named_command[] = {(char *)engine_name, NULL};
+    char *const *command = strcmp(engine_name, "stub") == 0 ? stub_command : named_command;
+
+    ChessGame *positions = malloc(sizeof(ChessGame) * limit);
+    if (!positions) return 1;
+    int count = load_corpus(corpus_path, positions, limit);
+    if (count <= 0) {
+        fprintf(stderr, "Error: No playable positions in %s\n", corpus_path);
+        free(positions);
+        return 1;
+    }
+    printf("Engine %s, %d positions from %s, go nodes %d, %d round%s\n", engine_name, count, corpus_path,
+           nodes, rounds, rounds == 1 ? "" : "s");
+    fflush(stdout);
+
+    uint64_t medians[TRANSPORT_COUNT][PHASE_COUNT];
+    bool finished[TRANSPORT_COUNT] = {false, false};
+    int status = 0;
+    for (int transport = 0; transport < TRANSPORT_COUNT && status == 0; transport++) {
+        if (!use_transport[transport]) continue;
+        Timings timings = {{NULL}, 0, 0};
+        bool allocated = true;
+        for (int phase = 0; phase < PHASE_COUNT; phase++) {
+            timings.samples[phase] = malloc(sizeof(uint64_t) * count * rounds);
+            allocated = allocated && timings.samples[phase];
+        }
+        if (allocated && run_transport(command, transport, positions, count, rounds, nodes, &timings)) {
+            print_timings(transport, &timings, medians[transport]);
+            finished[transport] = true;
+        } else {
+            status = 1;
+        }
+        for (int phase = 0; phase < PHASE_COUNT; phase++) free(timings.samples[phase]);
+    }
+
+    if (finished[TRANSPORT_STDIO] && finished[TRANSPORT_FD]) {
+        char stdio_text[16], fd_text[16];
+        printf("\nMedian per phase, stdio vs fd:\n");
+        for (int phase = 0; phase < PHASE_COUNT; phase++) {
+            uint64_t a = medians[TRANSPORT_STDIO][phase], b = medians[TRANSPORT_FD][phase];
+            profile_format_ns(a, stdio_text, sizeof(stdio_text));
+            profile_format_ns(b, fd_text, sizeof(fd_text));
+            printf("%-12s %10s %10s", phase_names[phase], stdio_text, fd_text);
+            if (a > 0) printf(" %+7.1f%%", ((double)b - (double)a) / (double)a * 100.0);
+            printf("\n");
+        }
+    }
+
+    free(positions);
+    return status;
+}
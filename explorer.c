@@ -0,0 +1,460 @@
+/**
+ * explorer.c - Opening Explorer Statistics over PGN Collections
+ *
+ * Purpose:
+ *   Builds and queries the per-position move statistics described in
+ *   explorer.h.
+ *
+ * Architecture:
+ *   - explorer_builder_add_game() turns each ply into one observation
+ *     (a record with games = 1) in the in-memory buffer
+ *   - A full buffer is sorted by (hash, move), aggregated in place and
+ *     written as a run file next to the output ("<output>.run<N>")
+ *   - explorer_builder_finish() merges the runs, EXPLORER_MERGE_FANIN at a
+ *     time, summing equal keys, until one pass writes the final file
+ *     (through a temporary file and rename)
+ *
+ * Dependencies:
+ *   - chess.h: position_hash(), execute_move()
+ *   - game_record.h: cgr_unpack_position(), cgr_pack_move()
+ *   - pgn_utils.h: PgnReader and eval annotations
+ */
+
+#define _GNU_SOURCE        // Required for Linux (pread)
+
+#include "explorer.h"
+#include "pgn_utils.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/******************************************************************************
+ *                         RECORD SERIALIZATION
+ ******************************************************************************/
+
+static void explorer_put(uint8_t *out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) out[i] = (uint8_t)(value >> (8 * i));
+}
+
+static uint64_t explorer_get(const uint8_t *in, int bytes) {
+    uint64_t value = 0;
+    for (int i = bytes - 1; i >= 0; i--) value = (value << 8) | in[i];
+    return value;
+}
+
+static void explorer_pack(uint8_t *out, const ExplorerRecord *record) {
+    explorer_put(out, record->hash, 8);
+    explorer_put(out + 8, record->move, 2);
+    explorer_put(out + 10, record->games, 4);
+    explorer_put(out + 14, record->white_wins, 4);
+    explorer_put(out + 18, record->draws, 4);
+    explorer_put(out + 22, record->black_wins, 4);
+    explorer_put(out + 26, (uint64_t)record->eval_sum, 8);
+    explorer_put(out + 34, record->eval_count, 4);
+}
+
+static void explorer_unpack(const uint8_t *in, ExplorerRecord *record) {
+    record->hash = explorer_get(in, 8);
+    record->move = (uint16_t)explorer_get(in + 8, 2);
+    record->games = (uint32_t)explorer_get(in + 10, 4);
+    record->white_wins = (uint32_t)explorer_get(in + 14, 4);
+    record->draws = (uint32_t)explorer_get(in + 18, 4);
+    record->black_wins = (uint32_t)explorer_get(in + 22, 4);
+    record->eval_sum = (int64_t)explorer_get(in + 26, 8);
+    record->eval_count = (uint32_t)explorer_get(in + 34, 4);
+}
+
+/**
+ * Record order: hash, then move
+ */
+static int explorer_compare(const ExplorerRecord *left, const ExplorerRecord *right) {
+    if (left->hash != right->hash) return left->hash < right->hash ? -1 : 1;
+    if (left->move != right->move) return left->move < right->move ? -1 : 1;
+    return 0;
+}
+
+static int explorer_compare_records(const void *a, const void *b) {
+    return explorer_compare(a, b);
+}
+
+/**
+ * Add the counts of one record to another with the same key
+ */
+static void explorer_accumulate(ExplorerRecord *total, const ExplorerRecord *record) {
+    total->games += record->games;
+    total->white_wins += record->white_wins;
+    total->draws += record->draws;
+    total->black_wins += record->black_wins;
+    total->eval_sum += record->eval_sum;
+    total->eval_count += record->eval_count;
+}
+
+static void explorer_run_path(const ExplorerBuilder *builder, int run, char *path, size_t size) {
+    snprintf(path, size, "%s.run%d", builder->output_path, run);
+}
+
+/******************************************************************************
+ *                                BUILDING
+ ******************************************************************************/
+
+/**
+ * Initialize a statistics builder
+ *
+ * @param builder Builder to initialize
+ * @param output_path Final statistics file (run files are created next to it)
+ * @param memory_bytes Observation buffer size (EXPLORER_DEFAULT_MEMORY_MB if 0)
+ * @param max_plies Plies of each game to add (EXPLORER_DEFAULT_PLIES if <= 0)
+ * @return false if the buffer cannot be allocated
+ */
+bool explorer_builder_init(ExplorerBuilder *builder, const char *output_path, size_t memory_bytes, int max_plies) {
+    memset(builder, 0, sizeof(*builder));
+    snprintf(builder->output_path, sizeof(builder->output_path), "%s", output_path);
+    builder->max_plies = max_plies > 0 ? max_plies : EXPLORER_DEFAULT_PLIES;
+
+    if (memory_bytes == 0) memory_bytes = (size_t)EXPLORER_DEFAULT_MEMORY_MB * 1024 * 1024;
+    builder->capacity = memory_bytes / sizeof(ExplorerRecord);
+    if (builder->capacity < 1024) builder->capacity = 1024;
+
+    builder->buffer = malloc(builder->capacity * sizeof(ExplorerRecord));
+    return builder->buffer != NULL;
+}
+
+/**
+ * Sort and aggregate the buffer and write it as the next run file
+ */
+static bool explorer_spill(ExplorerBuilder *builder) {
+    if (builder->count == 0) return true;
+
+    qsort(builder->buffer, builder->count, sizeof(ExplorerRecord), explorer_compare_records);
+
+    char path[600];
+    explorer_run_path(builder, builder->next_run, path, sizeof(path));
+    FILE *file = fopen(path, "wb");
+    if (!file) return false;
+
+    bool ok = true;
+    size_t i = 0;
+    while (ok && i < builder->count) {
+        ExplorerRecord total = builder->buffer[i++];
+        while (i < builder->count && explorer_compare(&total, &builder->buffer[i]) == 0) {
+            explorer_accumulate(&total, &builder->buffer[i++]);
+        }
+
+        uint8_t packed[EXPLORER_RECORD_SIZE];
+        explorer_pack(packed, &total);
+        ok = fwrite(packed, 1, sizeof(packed), file) == sizeof(packed);
+    }
+
+    if (fclose(file) != 0) ok = false;
+    if (!ok) {
+        unlink(path);
+        return false;
+    }
+
+    builder->next_run++;
+    builder->count = 0;
+    return true;
+}
+
+/**
+ * Add the opening of one game
+ *
+ * @param builder Builder to add to
+ * @param record Game to add
+ * @param result PGN result ("1-0", "0-1", "1/2-1/2"; anything else counts only as a game)
+ * @param evals Per-ply eval annotations (PGN_NO_EVAL where missing), or NULL
+ * @return false if a run file cannot be written or the record holds an illegal move
+ */
+bool explorer_builder_add_game(ExplorerBuilder *builder, const GameRecord *record, const char *result,
+                               const int32_t *evals) {
+    ChessGame position;
+    memset(&position, 0, sizeof(position));
+    if (!cgr_unpack_position(record->root, &position)) return false;
+
+    bool white_won = result && strcmp(result, "1-0") == 0;
+    bool black_won = result && strcmp(result, "0-1") == 0;
+    bool drawn = result && strcmp(result, "1/2-1/2") == 0;
+
+    int plies = record->ply_count < builder->max_plies ? record->ply_count : builder->max_plies;
+    for (int ply = 0; ply < plies; ply++) {
+        if (builder->count == builder->capacity && !explorer_spill(builder)) return false;
+
+        ExplorerRecord *observation = &builder->buffer[builder->count++];
+        memset(observation, 0, sizeof(*observation));
+        observation->hash = position_hash(&position);
+        observation->move = record->moves[ply];
+        observation->games = 1;
+        observation->white_wins = white_won;
+        observation->draws = drawn;
+        observation->black_wins = black_won;
+        if (evals && evals[ply] != PGN_NO_EVAL) {
+            observation->eval_sum = evals[ply];
+            observation->eval_count = 1;
+        }
+
+        if (!cgr_play_move(&position, record->moves[ply])) return false;
+    }
+
+    builder->games++;
+    return true;
+}
+
+/**
+ * Stream every game of a PGN file into the builder
+ *
+ * @param builder Builder to add to
+ * @param path PGN file
+ * @return Number of games added, or -1 if the file cannot be read or a run cannot be written
+ */
+int explorer_builder_add_pgn(ExplorerBuilder *builder, const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) return -1;
+
+    PgnReader reader;
+    PgnGame game;
+    int added = 0;
+    bool ok = true;
+    pgn_reader_init(&reader, file);
+    while (ok && pgn_reader_next(&reader, &game)) {
+        ok = explorer_builder_add_game(builder, &game.record, game.result, game.evals);
+        if (ok) added++;
+        game_record_free(&game.record);
+    }
+    pgn_reader_free(&reader);
+    fclose(file);
+    return ok ? added : -1;
+}
+
+/**
+ * Buffered reader over one sorted run file
+ */
+typedef struct {
+    FILE *file;
+    ExplorerRecord current;
+    bool has_current;
+} ExplorerRun;
+
+static void explorer_run_advance(ExplorerRun *run) {
+    uint8_t packed[EXPLORER_RECORD_SIZE];
+    run->has_current = fread(packed, 1, sizeof(packed), run->file) == sizeof(packed);
+    if (run->has_current) explorer_unpack(packed, &run->current);
+}
+
+/**
+ * Merge run files [first, first + count) into one sorted, aggregated stream
+ *
+ * @param output Destination stream, positioned where records start
+ * @param written Output: records written
+ * @return false on I/O error
+ */
+static bool explorer_merge_runs(const ExplorerBuilder *builder, int first, int count, FILE *output, uint64_t *written) {
+    ExplorerRun runs[EXPLORER_MERGE_FANIN];
+    bool ok = true;
+    *written = 0;
+
+    for (int i = 0; i < count; i++) {
+        char path[600];
+        explorer_run_path(builder, first + i, path, sizeof(path));
+        runs[i].file = fopen(path, "rb");
+        runs[i].has_current = false;
+        if (!runs[i].file) {
+            ok = false;
+            continue;
+        }
+        explorer_run_advance(&runs[i]);
+    }
+
+    while (ok) {
+        // Smallest key across the runs; few runs, so a linear scan is enough
+        int smallest = -1;
+        for (int i = 0; i < count; i++) {
+            if (!runs[i].has_current) continue;
+            if (smallest < 0 || explorer_compare(&runs[i].current, &runs[smallest].current) < 0) smallest = i;
+        }
+        if (smallest < 0) break;
+
+        ExplorerRecord total = runs[smallest].current;
+        explorer_run_advance(&runs[smallest]);
+        for (int i = 0; i < count; i++) {
+            while (runs[i].has_current && explorer_compare(&runs[i].current, &total) == 0) {
+                explorer_accumulate(&total, &runs[i].current);
+                explorer_run_advance(&runs[i]);
+            }
+        }
+
+        uint8_t packed[EXPLORER_RECORD_SIZE];
+        explorer_pack(packed, &total);
+        ok = fwrite(packed, 1, sizeof(packed), output) == sizeof(packed);
+        (*written)++;
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (runs[i].file) fclose(runs[i].file);
+    }
+    return ok;
+}
+
+/**
+ * Delete run files [first, first + count)
+ */
+static void explorer_remove_runs(const ExplorerBuilder *builder, int first, int count) {
+    for (int i = 0; i < count; i++) {
+        char path[600];
+        explorer_run_path(builder, first + i, path, sizeof(path));
+        unlink(path);
+    }
+}
+
+/**
+ * Write the statistics file from everything added so far
+ * Intermediate merge passes run while more than EXPLORER_MERGE_FANIN runs
+ * remain; the last pass writes the header and records.
+ *
+ * @param builder Builder (its run files are consumed)
+ * @return Number of records written, or -1 on I/O error
+ */
+int64_t explorer_builder_finish(ExplorerBuilder *builder) {
+    if (!explorer_spill(builder)) return -1;
+
+    while (builder->next_run - builder->first_run > EXPLORER_MERGE_FANIN) {
+        char path[600];
+        explorer_run_path(builder, builder->next_run, path, sizeof(path));
+        FILE *file = fopen(path, "wb");
+        if (!file) return -1;
+
+        uint64_t written;
+        bool ok = explorer_merge_runs(builder, builder->first_run, EXPLORER_MERGE_FANIN, file, &written);
+        if (fclose(file) != 0) ok = false;
+        if (!ok) {
+            unlink(path);
+            return -1;
+        }
+        explorer_remove_runs(builder, builder->first_run, EXPLORER_MERGE_FANIN);
+        builder->first_run += EXPLORER_MERGE_FANIN;
+        builder->next_run++;
+    }
+
+    char temp_path[600];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", builder->output_path);
+    FILE *file = fopen(temp_path, "wb");
+    if (!file) return -1;
+
+    uint8_t header[EXPLORER_HEADER_SIZE] = {0};
+    bool ok = fwrite(header, 1, sizeof(header), file) == sizeof(header);
+
+    uint64_t written = 0;
+    int live_runs = builder->next_run - builder->first_run;
+    if (ok) ok = explorer_merge_runs(builder, builder->first_run, live_runs, file, &written);
+
+    // Header last, once the record count is known
+    memcpy(header, EXPLORER_MAGIC, 4);
+    explorer_put(header + 4, EXPLORER_VERSION, 4);
+    explorer_put(header + 8, written, 8);
+    explorer_put(header + 16, builder->games, 8);
+    if (ok) ok = fseek(file, 0, SEEK_SET) == 0 && fwrite(header, 1, sizeof(header), file) == sizeof(header);
+
+    if (fclose(file) != 0) ok = false;
+    if (ok) ok = rename(temp_path, builder->output_path) == 0;
+    if (!ok) {
+        unlink(temp_path);
+        return -1;
+    }
+
+    explorer_remove_runs(builder, builder->first_run, live_runs);
+    builder->first_run = builder->next_run;
+    return (int64_t)written;
+}
+
+/**
+ * Release the buffer and remove any run files left by an unfinished build
+ *
+ * @param builder Builder to free
+ */
+void explorer_builder_free(ExplorerBuilder *builder) {
+    explorer_remove_runs(builder, builder->first_run, builder->next_run - builder->first_run);
+    builder->first_run = builder->next_run;
+    free(builder->buffer);
+    builder->buffer = NULL;
+    builder->count = builder->capacity = 0;
+}
+
+/******************************************************************************
+ *                                 LOOKUP
+ ******************************************************************************/
+
+/**
+ * Read one record of the on-disk record table
+ */
+static bool explorer_read_record(int fd, uint64_t index, ExplorerRecord *record) {
+    uint8_t packed[EXPLORER_RECORD_SIZE];
+    off_t offset = EXPLORER_HEADER_SIZE + (off_t)(index * EXPLORER_RECORD_SIZE);
+    if (pread(fd, packed, sizeof(packed), offset) != (ssize_t)sizeof(packed)) return false;
+    explorer_unpack(packed, record);
+    return true;
+}
+
+/**
+ * Most played first
+ */
+static int explorer_compare_popularity(const void *a, const void *b) {
+    const ExplorerRecord *left = a;
+    const ExplorerRecord *right = b;
+    if (left->games != right->games) return left->games > right->games ? -1 : 1;
+    return left->move < right->move ? -1 : (left->move > right->move);
+}
+
+/**
+ * Look up the statistics of every move played from a position
+ *
+ * @param path Statistics file
+ * @param hash position_hash() of the position
+ * @param records Output records, most played first
+ * @param max_records Capacity of records
+ * @return Number of records written (0 if the position never occurs), or -1 if the file cannot be read
+ */
+int explorer_lookup(const char *path, uint64_t hash, ExplorerRecord records[], int max_records) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    uint8_t header[EXPLORER_HEADER_SIZE];
+    if (pread(fd, header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+        memcmp(header, EXPLORER_MAGIC, 4) != 0 || explorer_get(header + 4, 4) != EXPLORER_VERSION) {
+        close(fd);
+        return -1;
+    }
+    uint64_t record_count = explorer_get(header + 8, 8);
+
+    uint64_t low = 0, high = record_count;
+    ExplorerRecord record;
+    while (low < high) {
+        uint64_t middle = low + (high - low) / 2;
+        if (!explorer_read_record(fd, middle, &record)) {
+            close(fd);
+            return -1;
+        }
+        if (record.hash < hash) low = middle + 1;
+        else high = middle;
+    }
+
+    // Records of one position are sorted by move, not popularity: keep the
+    // max_records most played by insertion into the sorted output
+    int count = 0;
+    for (uint64_t i = low; i < record_count && max_records > 0; i++) {
+        if (!explorer_read_record(fd, i, &record) || record.hash != hash) break;
+        if (count == max_records) {
+            if (explorer_compare_popularity(&record, &records[count - 1]) >= 0) continue;
+            count--;
+        }
+        int slot = count++;
+        while (slot > 0 && explorer_compare_popularity(&record, &records[slot - 1]) < 0) {
+            records[slot] = records[slot - 1];
+            slot--;
+        }
+        records[slot] = record;
+    }
+    close(fd);
+    return count;
+}
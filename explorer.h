@@ -0,0 +1,87 @@
+#ifndef EXPLORER_H
+#define EXPLORER_H
+
+/**
+ * explorer.h - Opening Explorer Statistics over PGN Collections
+ *
+ * Purpose:
+ *   Aggregates large PGN collections into per-position move statistics:
+ *   for every position hash and every continuation played from it, the
+ *   number of games, White wins, draws, Black wins and the average engine
+ *   evaluation after the move (from "[%eval]" comments when present).
+ *
+ * File layout (all integers little-endian):
+ *   header   magic "CXP1", uint32 version, uint64 record count,
+ *            uint64 games, uint64 reserved
+ *   records  38 bytes each, sorted by hash then move: uint64 hash,
+ *            uint16 move (game_record.h packing), uint32 games,
+ *            uint32 white wins, uint32 draws, uint32 black wins,
+ *            int64 eval sum (centipawns), uint32 eval count
+ *
+ * Architecture:
+ *   - Building is an external sort: observations are collected in a
+ *     fixed-size buffer, which is sorted, aggregated and spilled to a run
+ *     file whenever it fills; runs are then merged (several passes when
+ *     there are more than EXPLORER_MERGE_FANIN of them), summing records
+ *     with the same hash and move. Memory use is bounded by the buffer
+ *     size regardless of the number of games
+ *   - Lookups binary-search the record table on disk with pread()
+ *
+ * Dependencies:
+ *   - chess.h for position_hash()
+ *   - game_record.h for move packing
+ *   - pgn_utils.h for the streaming PGN reader
+ */
+
+#include "chess.h"
+#include "game_record.h"
+
+#define EXPLORER_MAGIC "CXP1"
+#define EXPLORER_VERSION 1
+#define EXPLORER_HEADER_SIZE 32          // Bytes before the first record
+#define EXPLORER_RECORD_SIZE 38          // Bytes per record on disk
+#define EXPLORER_MERGE_FANIN 32          // Runs merged at once
+#define EXPLORER_DEFAULT_MEMORY_MB 64    // Default observation buffer size
+#define EXPLORER_DEFAULT_PLIES 30        // Plies per game added by default
+#define EXPLORER_DEFAULT_FILE "explorer.cxp"   // Default statistics file name
+
+/**
+ * ExplorerRecord - Statistics for one move from one position
+ */
+typedef struct {
+    uint64_t hash;           // position_hash() of the position before the move
+    int64_t eval_sum;        // Sum of annotated evals after the move (centipawns, White's view)
+    uint32_t games;          // Games that played the move here
+    uint32_t white_wins;     // ... won by White
+    uint32_t draws;          // ... drawn
+    uint32_t black_wins;     // ... won by Black
+    uint32_t eval_count;     // Games with an eval annotation on the move
+    uint16_t move;           // Packed move (cgr_pack_move)
+} ExplorerRecord;
+
+/**
+ * ExplorerBuilder - Bounded-memory statistics builder
+ */
+typedef struct {
+    ExplorerRecord *buffer;  // Observations not yet spilled
+    size_t count;            // Observations in buffer
+    size_t capacity;         // Buffer size in records
+    char output_path[512];   // Final statistics file
+    int first_run;           // Oldest run file not merged yet
+    int next_run;            // Number for the next run file name
+    int max_plies;           // Plies of each game added
+    uint64_t games;          // Games added
+} ExplorerBuilder;
+
+// Building
+bool explorer_builder_init(ExplorerBuilder *builder, const char *output_path, size_t memory_bytes, int max_plies);  // Allocate buffer
+bool explorer_builder_add_game(ExplorerBuilder *builder, const GameRecord *record, const char *result,
+                               const int32_t *evals);  // Add one game's opening
+int explorer_builder_add_pgn(ExplorerBuilder *builder, const char *path);  // Stream a PGN file; games added or -1
+int64_t explorer_builder_finish(ExplorerBuilder *builder);  // Spill, merge and write; records or -1
+void explorer_builder_free(ExplorerBuilder *builder);  // Release memory and remove run files
+
+// Querying
+int explorer_lookup(const char *path, uint64_t hash, ExplorerRecord records[], int max_records);  // Moves from a position, most played first (-1 if no file)
+
+#endif // EXPLORER_H
@@ -0,0 +1,112 @@
+/**
+ * FIND_POSITION.C - Position Index Builder and Search Utility
+ *
+ * Builds the on-disk position index over a library of FEN logs, PGN files
+ * and .cgr records, and lists the games that reach a given position.
+ *
+ * Usage: ./find_position update positions.cpx DIR... [-r DIR...]
+ *        ./find_position find positions.cpx "FEN"
+ *
+ * Directories after -r are scanned recursively.
+ *
+ * Features:
+ * - Incremental updates: unchanged files are not parsed again
+ * - Lookups binary-search the index file instead of loading it
+ * - Transpositions match: positions are compared by Zobrist hash
+ */
+
+#define _GNU_SOURCE        // Required for Linux (clock_gettime)
+
+#include "chess.h"
+#include "position_index.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define FIND_MAX_LISTED 50   // Matches printed per query
+
+/**
+ * Milliseconds elapsed since a start time
+ */
+static double elapsed_ms(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000.0 + (now.tv_nsec - start->tv_nsec) / 1000000.0;
+}
+
+static void print_usage(const char *program) {
+    fprintf(stderr, "Usage: %s update INDEX DIR... [-r DIR...]\n", program);
+    fprintf(stderr, "       %s find INDEX \"FEN\"\n", program);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 4) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    const char *index_path = argv[2];
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if (strcmp(argv[1], "update") == 0) {
+        IndexRoot roots[POSITION_INDEX_MAX_ROOTS];
+        int root_count = 0;
+        bool recursive = false;
+
+        for (int i = 3; i < argc; i++) {
+            if (strcmp(argv[i], "-r") == 0) {
+                recursive = true;
+                continue;
+            }
+            if (root_count == POSITION_INDEX_MAX_ROOTS) {
+                fprintf(stderr, "Error: At most %d directories per update\n", POSITION_INDEX_MAX_ROOTS);
+                return 1;
+            }
+            roots[root_count].path = argv[i];
+            roots[root_count].recursive = recursive;
+            root_count++;
+        }
+
+        IndexUpdateStats stats;
+        if (!position_index_update(index_path, roots, root_count, NULL, &stats)) {
+            fprintf(stderr, "Error: Cannot write %s\n", index_path);
+            return 1;
+        }
+        printf("Indexed %d files, reused %d, removed %d\n",
+               stats.files_indexed, stats.files_reused, stats.files_removed);
+        printf("%u games, %llu positions (%.1f ms)\n",
+               stats.games, (unsigned long long)stats.positions, elapsed_ms(&start));
+        return 0;
+    }
+
+    if (strcmp(argv[1], "find") == 0 && argc == 4) {
+        ChessGame game;
+        memset(&game, 0, sizeof(game));
+        FenResult result = fen_decode(&game, argv[3]);
+        if (result.code != FEN_OK) {
+            fprintf(stderr, "Error: Invalid FEN at column %d: %s\n", result.offset + 1, fen_error_string(result.code));
+            return 1;
+        }
+
+        IndexMatch matches[FIND_MAX_LISTED];
+        int total = 0;
+        int found = position_index_find(index_path, position_hash(&game), matches, FIND_MAX_LISTED, &total);
+        if (found < 0) {
+            fprintf(stderr, "Error: Cannot read index %s (run '%s update' first)\n", index_path, argv[0]);
+            return 1;
+        }
+
+        for (int i = 0; i < found; i++) {
+            printf("%s game %u: ply %u of %u\n", matches[i].path, matches[i].game_number,
+                   matches[i].ply, matches[i].ply_count);
+        }
+        if (total > found) printf("... and %d more\n", total - found);
+        printf("%d game%s (%.2f ms)\n", total, total == 1 ? "" : "s", elapsed_ms(&start));
+        return 0;
+    }
+
+    print_usage(argv[0]);
+    return 1;
+}
@@ -0,0 +1,599 @@
+/**
+ * game_record.c - Compact Binary Game Record (.cgr) Format
+ *
+ * Purpose:
+ *   Packs games into a root position plus 16-bit moves so they can be
+ *   stored ~30x smaller than FEN logs, loaded without text parsing and
+ *   seeked to any ply using the optional keyframe index.
+ *
+ * Architecture:
+ *   - Pack/unpack helpers for moves and positions (see game_record.h)
+ *   - GameRecord holds the packed root and a growable move array
+ *   - Positions are reconstructed by replaying moves with execute_move(),
+ *     so every stored move is re-validated by the rules engine
+ *   - FEN log conversion detects each ply by matching a legal move
+ *     against the next logged position
+ *
+ * Dependencies:
+ *   - chess.h: ChessGame, Move, execute_move(), fen_decode(), fen_write()
+ */
+
+#include "game_record.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Promotion codes used in bits 12-14 of a packed move
+static const PieceType CGR_PROMOTION_PIECES[5] = {EMPTY, KNIGHT, BISHOP, ROOK, QUEEN};
+
+/******************************************************************************
+ *                         MOVE AND POSITION PACKING
+ ******************************************************************************/
+
+/**
+ * Pack a move into 16 bits
+ *
+ * @param move Move to pack (promotion_piece used when is_promotion is set)
+ * @return Packed move word
+ */
+uint16_t cgr_pack_move(Move move) {
+    uint16_t from = (uint16_t)(move.from.row * 8 + move.from.col);
+    uint16_t to = (uint16_t)(move.to.row * 8 + move.to.col);
+    uint16_t promotion = 0;
+
+    if (move.is_promotion) {
+        for (uint16_t code = 1; code < 5; code++) {
+            if (CGR_PROMOTION_PIECES[code] == move.promotion_piece) {
+                promotion = code;
+                break;
+            }
+        }
+    }
+
+    return (uint16_t)(to | (from << 6) | (promotion << 12));
+}
+
+/**
+ * Unpack a 16-bit move
+ * Only from/to and promotion fields are restored; capture and check flags
+ * are not stored and are left false.
+ *
+ * @param packed Packed move word
+ * @return Move structure suitable for execute_move()
+ */
+Move cgr_unpack_move(uint16_t packed) {
+    Move move;
+    memset(&move, 0, sizeof(move));
+
+    int to = packed & 0x3F;
+    int from = (packed >> 6) & 0x3F;
+    int promotion = (packed >> 12) & 0x7;
+
+    move.from.row = from / 8;
+    move.from.col = from % 8;
+    move.to.row = to / 8;
+    move.to.col = to % 8;
+
+    if (promotion > 0 && promotion < 5) {
+        move.is_promotion = true;
+        move.promotion_piece = CGR_PROMOTION_PIECES[promotion];
+    }
+
+    return move;
+}
+
+/**
+ * Play a packed move on a game
+ * A pawn reaching the last rank without a valid promotion code (0 or 5-7)
+ * is rejected: execute_move() would otherwise ask for the promotion piece
+ * on stdin.
+ *
+ * @param game Game to update
+ * @param packed Packed move word
+ * @return true if the move was legal and played
+ */
+bool cgr_play_move(ChessGame *game, uint16_t packed) {
+    Move move = cgr_unpack_move(packed);
+    if (!move.is_promotion && is_promotion_move(game, move.from, move.to)) return false;
+    return execute_move(game, move);
+}
+
+/**
+ * Pack the position fields of a game into CGR_POSITION_SIZE bytes
+ *
+ * @param game Game state to pack
+ * @param out Output buffer
+ */
+void cgr_pack_position(const ChessGame *game, uint8_t out[CGR_POSITION_SIZE]) {
+    memset(out, 0, CGR_POSITION_SIZE);
+
+    for (int square = 0; square < 64; square++) {
+        Piece piece = game->board[square / 8][square % 8];
+        uint8_t nibble = (piece.type == EMPTY) ? 0 : (uint8_t)(piece.type | (piece.color << 3));
+        out[square / 2] |= (square % 2 == 0) ? (uint8_t)(nibble << 4) : nibble;
+    }
+
+    out[32] = (uint8_t)game->current_player;
+
+    uint8_t castling = 0;
+    if (!game->white_king_moved && !game->white_rook_h_moved) castling |= 1;
+    if (!game->white_king_moved && !game->white_rook_a_moved) castling |= 2;
+    if (!game->black_king_moved && !game->black_rook_h_moved) castling |= 4;
+    if (!game->black_king_moved && !game->black_rook_a_moved) castling |= 8;
+    out[33] = castling;
+
+    out[34] = 0xFF;
+    if (game->en_passant_available &&
+        is_valid_position(game->en_passant_target.row, game->en_passant_target.col)) {
+        out[34] = (uint8_t)(game->en_passant_target.row * 8 + game->en_passant_target.col);
+    }
+
+    out[35] = (uint8_t)(game->halfmove_clock & 0xFF);
+    out[36] = (uint8_t)((game->halfmove_clock >> 8) & 0xFF);
+    out[37] = (uint8_t)(game->fullmove_number & 0xFF);
+    out[38] = (uint8_t)((game->fullmove_number >> 8) & 0xFF);
+}
+
+/**
+ * Restore position fields of a game from packed bytes
+ * Board, side to move, castling, en passant, counters, king positions,
+ * captured pieces and check status are set; time control and timer
+ * fields are left untouched.
+ *
+ * @param in Packed position
+ * @param game Game state to fill
+ * @return true if the packed data describes a position with both kings
+ */
+bool cgr_unpack_position(const uint8_t in[CGR_POSITION_SIZE], ChessGame *game) {
+    game->white_king_pos.row = -1;
+    game->white_king_pos.col = -1;
+    game->black_king_pos.row = -1;
+    game->black_king_pos.col = -1;
+
+    for (int square = 0; square < 64; square++) {
+        int row = square / 8;
+        int col = square % 8;
+        uint8_t nibble = (square % 2 == 0) ? (uint8_t)(in[square / 2] >> 4) : (uint8_t)(in[square / 2] & 0x0F);
+        PieceType type = (PieceType)(nibble & 0x7);
+        Color color = (nibble & 0x8) ? BLACK : WHITE;
+
+        if (type > KING) return false;
+
+        game->board[row][col].type = type;
+        game->board[row][col].color = (type == EMPTY) ? WHITE : color;
+
+        if (type == KING) {
+            Position *king = (color == WHITE) ? &game->white_king_pos : &game->black_king_pos;
+            king->row = row;
+            king->col = col;
+        }
+    }
+
+    if (game->white_king_pos.row == -1 || game->black_king_pos.row == -1) return false;
+    if (in[32] > BLACK) return false;
+    game->current_player = (Color)in[32];
+
+    uint8_t castling = in[33];
+    game->white_king_moved = !(castling & 3);
+    game->white_rook_h_moved = !(castling & 1);
+    game->white_rook_a_moved = !(castling & 2);
+    game->black_king_moved = !(castling & 12);
+    game->black_rook_h_moved = !(castling & 4);
+    game->black_rook_a_moved = !(castling & 8);
+
+    if (in[34] < 64) {
+        game->en_passant_available = true;
+        game->en_passant_target.row = in[34] / 8;
+        game->en_passant_target.col = in[34] % 8;
+    } else {
+        game->en_passant_available = false;
+        game->en_passant_target.row = -1;
+        game->en_passant_target.col = -1;
+    }
+
+    game->halfmove_clock = in[35] | (in[36] << 8);
+    game->fullmove_number = in[37] | (in[38] << 8);
+
+    calculate_captured_pieces(game);
+    game->in_check[WHITE] = is_in_check(game, WHITE);
+    game->in_check[BLACK] = is_in_check(game, BLACK);
+
+    return true;
+}
+
+/******************************************************************************
+ *                            IN-MEMORY RECORDS
+ ******************************************************************************/
+
+/**
+ * Start an empty record from a root position
+ *
+ * @param record Record to initialize
+ * @param root Starting position of the game
+ */
+void game_record_init(GameRecord *record, const ChessGame *root) {
+    cgr_pack_position(root, record->root);
+    record->moves = NULL;
+    record->ply_count = 0;
+    record->capacity = 0;
+}
+
+/**
+ * Release move storage held by a record
+ *
+ * @param record Record to free (may be reused after game_record_init)
+ */
+void game_record_free(GameRecord *record) {
+    free(record->moves);
+    record->moves = NULL;
+    record->ply_count = 0;
+    record->capacity = 0;
+}
+
+/**
+ * Reserve space for at least the given number of plies
+ */
+static bool game_record_reserve(GameRecord *record, int plies) {
+    if (plies <= record->capacity) return true;
+
+    int capacity = record->capacity ? record->capacity : 128;
+    while (capacity < plies) capacity *= 2;
+
+    uint16_t *moves = realloc(record->moves, (size_t)capacity * sizeof(uint16_t));
+    if (!moves) return false;
+
+    record->moves = moves;
+    record->capacity = capacity;
+    return true;
+}
+
+/**
+ * Append one ply to a record
+ *
+ * @param record Record to extend
+ * @param move Move played (from, to and promotion are stored)
+ * @return true on success, false if memory allocation failed
+ */
+bool game_record_append(GameRecord *record, Move move) {
+    if (!game_record_reserve(record, record->ply_count + 1)) return false;
+    record->moves[record->ply_count++] = cgr_pack_move(move);
+    return true;
+}
+
+/**
+ * Replay a range of packed moves onto a game
+ */
+static bool cgr_replay(ChessGame *game, const uint16_t *moves, int count) {
+    for (int i = 0; i < count; i++) {
+        if (!cgr_play_move(game, moves[i])) return false;
+    }
+    return true;
+}
+
+/**
+ * Reconstruct the position after a given number of plies
+ *
+ * @param record Record to replay
+ * @param ply Number of plies to play from the root (0 = root position)
+ * @param game Output game state (position fields are overwritten)
+ * @return true on success, false if ply is out of range or a move is illegal
+ */
+bool game_record_position_at(const GameRecord *record, int ply, ChessGame *game) {
+    if (ply < 0 || ply > record->ply_count) return false;
+    if (!cgr_unpack_position(record->root, game)) return false;
+    return cgr_replay(game, record->moves, ply);
+}
+
+/******************************************************************************
+ *                                FILE I/O
+ ******************************************************************************/
+
+static void cgr_put_u16(uint8_t *p, uint16_t value) {
+    p[0] = (uint8_t)(value & 0xFF);
+    p[1] = (uint8_t)(value >> 8);
+}
+
+static void cgr_put_u32(uint8_t *p, uint32_t value) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)((value >> (8 * i)) & 0xFF);
+}
+
+static uint16_t cgr_get_u16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t cgr_get_u32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * Parsed .cgr file header
+ */
+typedef struct {
+    uint16_t flags;
+    uint32_t ply_count;
+    uint16_t interval;
+} CgrHeader;
+
+/**
+ * Read and validate the header and root position of an open .cgr file
+ */
+static bool cgr_read_header(FILE *file, CgrHeader *header, uint8_t root[CGR_POSITION_SIZE]) {
+    uint8_t bytes[CGR_HEADER_SIZE];
+
+    if (fread(bytes, 1, sizeof(bytes), file) != sizeof(bytes)) return false;
+    if (memcmp(bytes, CGR_MAGIC, 4) != 0) return false;
+    if (cgr_get_u16(bytes + 4) != CGR_VERSION) return false;
+
+    header->flags = cgr_get_u16(bytes + 6);
+    header->ply_count = cgr_get_u32(bytes + 8);
+    header->interval = cgr_get_u16(bytes + 12);
+
+    if ((header->flags & CGR_FLAG_INDEX) && header->interval == 0) return false;
+    if (header->ply_count > CGR_MAX_PLIES) return false;
+
+    return fread(root, 1, CGR_POSITION_SIZE, file) == CGR_POSITION_SIZE;
+}
+
+/**
+ * Write a record to a .cgr file
+ *
+ * @param record Record to write
+ * @param filename Output path (overwritten)
+ * @param with_index Whether to append a keyframe index for fast seeking
+ * @return true on success, false on I/O error or illegal recorded move
+ */
+bool game_record_save(const GameRecord *record, const char *filename, bool with_index) {
+    FILE *file = fopen(filename, "wb");
+    if (!file) return false;
+
+    uint8_t header[CGR_HEADER_SIZE] = {0};
+    memcpy(header, CGR_MAGIC, 4);
+    cgr_put_u16(header + 4, CGR_VERSION);
+    cgr_put_u16(header + 6, with_index ? CGR_FLAG_INDEX : 0);
+    cgr_put_u32(header + 8, (uint32_t)record->ply_count);
+    cgr_put_u16(header + 12, with_index ? CGR_INDEX_INTERVAL : 0);
+
+    bool ok = fwrite(header, 1, sizeof(header), file) == sizeof(header) &&
+              fwrite(record->root, 1, CGR_POSITION_SIZE, file) == CGR_POSITION_SIZE;
+
+    for (int i = 0; ok && i < record->ply_count; i++) {
+        uint8_t word[2];
+        cgr_put_u16(word, record->moves[i]);
+        ok = fwrite(word, 1, 2, file) == 2;
+    }
+
+    if (ok && with_index) {
+        // Keyframes are produced by a single forward replay of the game
+        ChessGame game;
+        memset(&game, 0, sizeof(game));
+        ok = cgr_unpack_position(record->root, &game);
+        for (int ply = CGR_INDEX_INTERVAL; ok && ply <= record->ply_count; ply += CGR_INDEX_INTERVAL) {
+            uint8_t keyframe[CGR_POSITION_SIZE];
+            ok = cgr_replay(&game, record->moves + ply - CGR_INDEX_INTERVAL, CGR_INDEX_INTERVAL);
+            if (ok) {
+                cgr_pack_position(&game, keyframe);
+                ok = fwrite(keyframe, 1, sizeof(keyframe), file) == sizeof(keyframe);
+            }
+        }
+    }
+
+    if (fclose(file) != 0) ok = false;
+    return ok;
+}
+
+/**
+ * Load a .cgr file into memory
+ * The keyframe index, if present, is not needed in memory and is skipped.
+ *
+ * @param record Output record (caller frees with game_record_free)
+ * @param filename Path to .cgr file
+ * @return true on success, false if the file is missing or malformed
+ */
+bool game_record_load(GameRecord *record, const char *filename) {
+    FILE *file = fopen(filename, "rb");
+    if (!file) return false;
+
+    CgrHeader header;
+    record->moves = NULL;
+    record->ply_count = 0;
+    record->capacity = 0;
+
+    bool ok = cgr_read_header(file, &header, record->root) &&
+              game_record_reserve(record, (int)header.ply_count);
+
+    uint8_t word[2];
+    for (uint32_t i = 0; ok && i < header.ply_count; i++) {
+        ok = fread(word, 1, 2, file) == 2;
+        if (ok) record->moves[record->ply_count++] = cgr_get_u16(word);
+    }
+
+    fclose(file);
+    if (!ok) game_record_free(record);
+    return ok;
+}
+
+/**
+ * Reconstruct the position at a ply directly from a .cgr file
+ * Uses the keyframe index when present so only the moves after the
+ * nearest keyframe are read and replayed.
+ *
+ * @param filename Path to .cgr file
+ * @param ply Ply to seek to (0 = root position)
+ * @param game Output game state (position fields are overwritten)
+ * @return true on success, false if ply is out of range or file is malformed
+ */
+bool game_record_seek_file(const char *filename, int ply, ChessGame *game) {
+    FILE *file = fopen(filename, "rb");
+    if (!file) return false;
+
+    CgrHeader header;
+    uint8_t position[CGR_POSITION_SIZE];
+    bool ok = cgr_read_header(file, &header, position) &&
+              ply >= 0 && (uint32_t)ply <= header.ply_count;
+
+    int start = 0;
+    if (ok && (header.flags & CGR_FLAG_INDEX) && ply >= header.interval) {
+        int keyframe = ply / header.interval;
+        long offset = CGR_HEADER_SIZE + CGR_POSITION_SIZE + 2L * header.ply_count +
+                      (long)(keyframe - 1) * CGR_POSITION_SIZE;
+        ok = fseek(file, offset, SEEK_SET) == 0 &&
+             fread(position, 1, CGR_POSITION_SIZE, file) == CGR_POSITION_SIZE;
+        start = keyframe * header.interval;
+    }
+
+    ok = ok && cgr_unpack_position(position, game);
+
+    if (ok && ply > start) {
+        uint16_t moves[CGR_INDEX_INTERVAL];
+        long offset = CGR_HEADER_SIZE + CGR_POSITION_SIZE + 2L * start;
+        ok = fseek(file, offset, SEEK_SET) == 0;
+
+        // Without an index the whole prefix is replayed in fixed-size chunks
+        int remaining = ply - start;
+        while (ok && remaining > 0) {
+            int chunk = remaining < CGR_INDEX_INTERVAL ? remaining : CGR_INDEX_INTERVAL;
+            uint8_t bytes[2 * CGR_INDEX_INTERVAL];
+            ok = fread(bytes, 2, (size_t)chunk, file) == (size_t)chunk;
+            for (int i = 0; ok && i < chunk; i++) moves[i] = cgr_get_u16(bytes + 2 * i);
+            ok = ok && cgr_replay(game, moves, chunk);
+            remaining -= chunk;
+        }
+    }
+
+    fclose(file);
+    return ok;
+}
+
+/******************************************************************************
+ *                               CONVERSION
+ ******************************************************************************/
+
+/**
+ * Find the legal move that turns one position into the next
+ * Only pieces of the side to move that left their square are tried, so
+ * normally one or two candidates are examined.
+ *
+ * @param prev Position before the move
+ * @param next Position after the move
+ * @param move Output move
+ * @return true if a matching legal move was found
+ */
+bool game_record_find_move(ChessGame *prev, const ChessGame *next, Move *move) {
+    Color side = prev->current_player;
+
+    for (int row = 0; row < BOARD_SIZE; row++) {
+        for (int col = 0; col < BOARD_SIZE; col++) {
+            Piece piece = prev->board[row][col];
+            if (piece.type == EMPTY || piece.color != side) continue;
+
+            Piece after = next->board[row][col];
+            if (after.type == piece.type && after.color == piece.color) continue;
+
+            Position from = {row, col};
+            Position targets[64];
+            int count = get_possible_moves(prev, from, targets);
+
+            for (int i = 0; i < count; i++) {
+                Move candidate;
+                memset(&candidate, 0, sizeof(candidate));
+                candidate.from = from;
+                candidate.to = targets[i];
+
+                Piece landed = next->board[targets[i].row][targets[i].col];
+                if (is_promotion_move(prev, from, targets[i])) {
+                    if (!is_valid_promotion_piece(landed.type)) continue;
+                    candidate.is_promotion = true;
+                    candidate.promotion_piece = landed.type;
+                } else if (landed.type != piece.type || landed.color != side) {
+                    continue;
+                }
+
+                ChessGame trial = *prev;
+                if (execute_move(&trial, candidate) &&
+                    memcmp(trial.board, next->board, sizeof(trial.board)) == 0) {
+                    *move = candidate;
+                    return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Build a record from a FEN log (one FEN per line)
+ * The first line becomes the root; each following line must be reachable
+ * from the previous one by a single legal move.
+ *
+ * @param record Output record (caller frees with game_record_free)
+ * @param fen_filename Path to FEN log
+ * @return true on success, false if the file is missing or positions are not consecutive
+ */
+bool game_record_from_fen_log(GameRecord *record, const char *fen_filename) {
+    FILE *file = fopen(fen_filename, "r");
+    if (!file) return false;
+
+    ChessGame prev, next;
+    char line[256];
+    bool have_root = false;
+    bool ok = true;
+
+    memset(&prev, 0, sizeof(prev));
+    memset(&next, 0, sizeof(next));
+    record->moves = NULL;
+    record->ply_count = 0;
+    record->capacity = 0;
+
+    while (ok && fgets(line, sizeof(line), file)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0') continue;
+
+        ChessGame *target = have_root ? &next : &prev;
+        if (!setup_board_from_fen(target, line)) {
+            ok = false;
+            break;
+        }
+
+        if (!have_root) {
+            game_record_init(record, &prev);
+            have_root = true;
+            continue;
+        }
+
+        Move move;
+        ok = game_record_find_move(&prev, &next, &move) && game_record_append(record, move);
+        prev = next;
+    }
+
+    fclose(file);
+    if (!ok) game_record_free(record);
+    return ok && have_root;
+}
+
+/**
+ * Write one FEN line per ply (root included) to a stream
+ *
+ * @param record Record to replay
+ * @param out Output stream
+ * @return true on success, false if a recorded move is illegal
+ */
+bool game_record_write_fen_log(const GameRecord *record, FILE *out) {
+    ChessGame game;
+    char fen[FEN_BUFFER_SIZE];
+
+    memset(&game, 0, sizeof(game));
+    if (!cgr_unpack_position(record->root, &game)) return false;
+
+    fen_write(&game, fen, sizeof(fen));
+    fprintf(out, "%s\n", fen);
+
+    for (int i = 0; i < record->ply_count; i++) {
+        if (!cgr_replay(&game, record->moves + i, 1)) return false;
+        fen_write(&game, fen, sizeof(fen));
+        fprintf(out, "%s\n", fen);
+    }
+
+    return true;
+}
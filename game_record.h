@@ -0,0 +1,84 @@
+#ifndef GAME_RECORD_H
+#define GAME_RECORD_H
+
+/**
+ * game_record.h - Compact Binary Game Record (.cgr) Format
+ *
+ * Purpose:
+ *   Stores a complete game as a packed root position followed by one
+ *   16-bit word per ply, instead of a ~60-byte FEN line per ply. Records
+ *   can optionally carry an index of position keyframes so any ply can be
+ *   reached by replaying at most CGR_INDEX_INTERVAL - 1 moves.
+ *
+ * File layout (all multi-byte integers little-endian):
+ *   offset  0  magic "CGR1"
+ *   offset  4  uint16 format version (CGR_VERSION)
+ *   offset  6  uint16 flags (CGR_FLAG_INDEX)
+ *   offset  8  uint32 ply count
+ *   offset 12  uint16 keyframe interval (0 when there is no index)
+ *   offset 14  uint16 reserved (0)
+ *   offset 16  root position (CGR_POSITION_SIZE bytes)
+ *   offset 56  ply_count packed moves (2 bytes each)
+ *   then       one packed position per keyframe, for plies interval,
+ *              2*interval, ... <= ply_count (only when CGR_FLAG_INDEX set)
+ *
+ * Packed move: bits 0-5 destination square, bits 6-11 source square,
+ *   bits 12-14 promotion piece (0 none, 1 knight, 2 bishop, 3 rook,
+ *   4 queen). Squares are row * 8 + col using the board's own layout
+ *   (row 0 = rank 8, col 0 = file a).
+ *
+ * Packed position: 32 bytes of 4-bit squares (piece type | color << 3,
+ *   high nibble first), side to move, castling bits (K=1 Q=2 k=4 q=8),
+ *   en passant square (0xFF if none), halfmove clock and fullmove number
+ *   (uint16 each) and one reserved byte.
+ *
+ * Dependencies:
+ *   - chess.h for ChessGame, Move and move execution
+ */
+
+#include "chess.h"
+#include <stdint.h>
+
+#define CGR_MAGIC "CGR1"
+#define CGR_VERSION 1
+#define CGR_FLAG_INDEX 0x0001           // File carries a keyframe index
+#define CGR_HEADER_SIZE 16              // Bytes before the root position
+#define CGR_POSITION_SIZE 40            // Bytes per packed position
+#define CGR_INDEX_INTERVAL 32           // Plies between index keyframes
+#define CGR_MAX_PLIES 65536             // Sanity limit on ply count read from files
+
+/**
+ * GameRecord - In-memory game record
+ * Root position plus the packed move list; grows as moves are appended
+ */
+typedef struct {
+    uint8_t root[CGR_POSITION_SIZE];   // Packed starting position
+    uint16_t *moves;                   // Packed moves, one per ply
+    int ply_count;                     // Number of plies recorded
+    int capacity;                      // Allocated entries in moves[]
+} GameRecord;
+
+// Move and position packing
+uint16_t cgr_pack_move(Move move);  // Pack move into 16 bits
+Move cgr_unpack_move(uint16_t packed);  // Unpack 16-bit move (promotion flags set)
+bool cgr_play_move(ChessGame *game, uint16_t packed);  // Unpack and play; false if illegal or a promotion without a piece
+void cgr_pack_position(const ChessGame *game, uint8_t out[CGR_POSITION_SIZE]);  // Pack position fields
+bool cgr_unpack_position(const uint8_t in[CGR_POSITION_SIZE], ChessGame *game);  // Restore position fields
+
+// Record lifecycle
+void game_record_init(GameRecord *record, const ChessGame *root);  // Start empty record from root position
+void game_record_free(GameRecord *record);  // Release move storage
+bool game_record_append(GameRecord *record, Move move);  // Append one ply
+bool game_record_position_at(const GameRecord *record, int ply, ChessGame *game);  // Replay to ply
+
+// File I/O
+bool game_record_save(const GameRecord *record, const char *filename, bool with_index);  // Write .cgr file
+bool game_record_load(GameRecord *record, const char *filename);  // Read .cgr file into memory
+bool game_record_seek_file(const char *filename, int ply, ChessGame *game);  // Position at ply without full load
+
+// Conversion
+bool game_record_from_fen_log(GameRecord *record, const char *fen_filename);  // Build record from FEN log
+bool game_record_write_fen_log(const GameRecord *record, FILE *out);  // Emit one FEN per ply
+bool game_record_find_move(ChessGame *prev, const ChessGame *next, Move *move);  // Legal move linking two positions
+
+#endif // GAME_RECORD_H
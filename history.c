@@ -0,0 +1,473 @@
+/**
+ * history.c - In-Memory Game Tree with Append-Only FEN Journal
+ *
+ * Purpose:
+ *   Serves undo, redo and variation switching from memory and keeps the
+ *   session FEN log as an append-only journal of the current line.
+ *
+ * Architecture:
+ *   - Positions are stored packed (CGR_POSITION_SIZE bytes each) together
+ *     with their hash, so navigation restores a position with one unpack
+ *     instead of replaying moves
+ *   - The journal file descriptor stays open for the whole session
+ *   - Every navigation goes through history_goto(): truncate the journal
+ *     to the common ancestor, then append the FEN lines of the new path
+ *
+ * Dependencies:
+ *   - chess.h: fen_write(), setup_board_from_fen(), position_hash()
+ *   - game_record.h: cgr_pack_move(), cgr_pack_position(), cgr_unpack_position(),
+ *     game_record_find_move()
+ */
+
+#define _GNU_SOURCE        // Required for Linux (ftruncate)
+
+#include "history.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * Initialize an empty history with no journal
+ *
+ * @param history History to initialize
+ */
+void history_init(GameHistory *history) {
+    history->nodes = NULL;
+    history->node_count = 0;
+    history->capacity = 0;
+    history->current = HISTORY_NO_NODE;
+    history->journal_fd = -1;
+}
+
+/**
+ * Close the journal and release all nodes
+ *
+ * @param history History to close (may be reused after history_reset)
+ */
+void history_close(GameHistory *history) {
+    if (history->journal_fd >= 0) {
+        close(history->journal_fd);
+    }
+    free(history->nodes);
+    history_init(history);
+}
+
+/**
+ * Make room for one more node
+ */
+static bool history_reserve(GameHistory *history) {
+    if (history->node_count < history->capacity) return true;
+
+    int capacity = history->capacity ? history->capacity * 2 : 256;
+    HistoryNode *nodes = realloc(history->nodes, (size_t)capacity * sizeof(HistoryNode));
+    if (!nodes) return false;
+
+    history->nodes = nodes;
+    history->capacity = capacity;
+    return true;
+}
+
+/**
+ * Append a FEN line for a position to the journal
+ * Returns the new journal length; on failure (or with no journal) the
+ * length is returned unchanged so offsets stay consistent with the file.
+ */
+static long history_journal_append(GameHistory *history, const ChessGame *game, long journal_end) {
+    if (history->journal_fd < 0) return journal_end;
+
+    char fen[FEN_BUFFER_SIZE + 1];
+    size_t length = fen_write(game, fen, FEN_BUFFER_SIZE);
+    fen[length++] = '\n';
+
+    if (write(history->journal_fd, fen, length) != (ssize_t)length) return journal_end;
+    return journal_end + (long)length;
+}
+
+/**
+ * Create a node for a position as a child of parent (or as root)
+ * Returns the new node index, or HISTORY_NO_NODE on allocation failure
+ */
+static int history_add_node(GameHistory *history, const ChessGame *game, uint16_t move, int parent) {
+    if (!history_reserve(history)) return HISTORY_NO_NODE;
+
+    int index = history->node_count++;
+    HistoryNode *node = &history->nodes[index];
+
+    node->move = move;
+    cgr_pack_position(game, node->position);
+    node->hash = position_hash(game);
+    node->eval = 0;
+    node->has_eval = false;
+    node->depth = (parent == HISTORY_NO_NODE) ? 0 : history->nodes[parent].depth + 1;
+    node->parent = parent;
+    node->first_child = HISTORY_NO_NODE;
+    node->next_sibling = HISTORY_NO_NODE;
+    node->redo_child = HISTORY_NO_NODE;
+    node->journal_end = 0;
+
+    // New variations go last so existing variation numbers stay stable
+    if (parent != HISTORY_NO_NODE) {
+        int *link = &history->nodes[parent].first_child;
+        while (*link != HISTORY_NO_NODE) link = &history->nodes[*link].next_sibling;
+        *link = index;
+    }
+
+    return index;
+}
+
+/**
+ * Start a new game history and journal
+ * Any previous journal is closed; the new journal file is created (or
+ * truncated) and the root position is written as its first line.
+ *
+ * @param history History to reset
+ * @param root Starting position
+ * @param journal_filename FEN log path for this game (NULL = no journal)
+ * @return true on success, false if the journal could not be created
+ */
+bool history_reset(GameHistory *history, const ChessGame *root, const char *journal_filename) {
+    history_close(history);
+
+    if (journal_filename) {
+        history->journal_fd = open(journal_filename, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+        if (history->journal_fd < 0) return false;
+    }
+
+    int node = history_add_node(history, root, 0, HISTORY_NO_NODE);
+    if (node == HISTORY_NO_NODE) return false;
+
+    history->nodes[node].journal_end = history_journal_append(history, root, 0);
+    history->current = node;
+    return true;
+}
+
+/**
+ * Adopt an existing FEN log as the game history
+ * Reads the file once, building a single line of nodes that records each
+ * line's end offset, then keeps it open as the journal for further moves.
+ * The move between consecutive positions is recovered from the legal move
+ * list; it is stored as 0 where the log skips positions.
+ *
+ * @param history History to replace
+ * @param journal_filename Existing FEN log
+ * @return true if every line was a valid position, false otherwise (the
+ *         history is left empty)
+ */
+bool history_load_journal(GameHistory *history, const char *journal_filename) {
+    history_close(history);
+
+    FILE *file = fopen(journal_filename, "r");
+    if (!file) return false;
+
+    ChessGame game, prev;
+    char line[256];
+    bool ok = true;
+    bool terminated = true;
+
+    memset(&game, 0, sizeof(game));
+    memset(&prev, 0, sizeof(prev));
+    while (ok && fgets(line, sizeof(line), file)) {
+        if (line[0] == '\n' || line[0] == '\0') continue;
+        terminated = line[strlen(line) - 1] == '\n';
+
+        ok = setup_board_from_fen(&game, line);
+        if (!ok) break;
+
+        int parent = history->current;
+        Move move;
+        uint16_t packed = 0;
+        if (parent != HISTORY_NO_NODE && game_record_find_move(&prev, &game, &move)) {
+            packed = cgr_pack_move(move);
+        }
+        prev = game;
+
+        int node = history_add_node(history, &game, packed, parent);
+        ok = node != HISTORY_NO_NODE;
+        if (ok) {
+            if (parent != HISTORY_NO_NODE) history->nodes[parent].redo_child = node;
+            history->nodes[node].journal_end = ftell(file);
+            history->current = node;
+        }
+    }
+    fclose(file);
+
+    if (!ok || history->node_count == 0) {
+        history_close(history);
+        return false;
+    }
+
+    history->journal_fd = open(journal_filename, O_WRONLY | O_APPEND);
+    if (history->journal_fd < 0) {
+        history_close(history);
+        return false;
+    }
+
+    // Terminate a final line written without a newline so appends start cleanly
+    if (!terminated) {
+        if (write(history->journal_fd, "\n", 1) != 1) {
+            history_close(history);
+            return false;
+        }
+        history->nodes[history->current].journal_end++;
+    }
+    return true;
+}
+
+/**
+ * Record the position reached by a move from the current position
+ * If the move was already explored from here the existing node is reused
+ * (keeping its cached data); otherwise a new variation is created. The
+ * position is appended to the journal either way.
+ *
+ * @param history Game history
+ * @param game Position after the move
+ * @param move Move that was played
+ * @return true on success, false on allocation failure
+ */
+bool history_push(GameHistory *history, const ChessGame *game, Move move) {
+    int parent = history->current;
+    uint16_t packed = cgr_pack_move(move);
+    int node = HISTORY_NO_NODE;
+
+    if (parent != HISTORY_NO_NODE) {
+        for (int child = history->nodes[parent].first_child; child != HISTORY_NO_NODE;
+             child = history->nodes[child].next_sibling) {
+            if (history->nodes[child].move == packed) {
+                node = child;
+                break;
+            }
+        }
+    }
+
+    if (node == HISTORY_NO_NODE) {
+        node = history_add_node(history, game, packed, parent);
+        if (node == HISTORY_NO_NODE) return false;
+    }
+
+    long parent_end = (parent != HISTORY_NO_NODE) ? history->nodes[parent].journal_end : 0;
+    history->nodes[node].journal_end = history_journal_append(history, game, parent_end);
+
+    if (parent != HISTORY_NO_NODE) history->nodes[parent].redo_child = node;
+    history->current = node;
+    return true;
+}
+
+/**
+ * Number of plies that can be undone
+ *
+ * @param history Game history
+ * @return Plies from the starting position to the current position
+ */
+int history_ply_count(const GameHistory *history) {
+    return (history->current != HISTORY_NO_NODE) ? history->nodes[history->current].depth : 0;
+}
+
+/**
+ * Number of plies that can be redone along the remembered line
+ *
+ * @param history Game history
+ * @return Length of the redo chain from the current position
+ */
+int history_redo_count(const GameHistory *history) {
+    int count = 0;
+    int node = history->current;
+
+    while (node != HISTORY_NO_NODE && history->nodes[node].redo_child != HISTORY_NO_NODE) {
+        node = history->nodes[node].redo_child;
+        count++;
+    }
+    return count;
+}
+
+/**
+ * Jump to any node in the tree
+ * Truncates the journal to the deepest node shared by the old and new
+ * lines, appends the FEN lines of the new line below it, and restores the
+ * stored position. Parents along the new line remember it for redo.
+ * Time control and other non-position fields of game are kept.
+ *
+ * @param history Game history
+ * @param node Target node index
+ * @param game Game state to restore into
+ * @return true on success, false if node is invalid or the journal cannot be truncated
+ */
+bool history_goto(GameHistory *history, int node, ChessGame *game) {
+    if (node < 0 || node >= history->node_count || history->current == HISTORY_NO_NODE) return false;
+
+    // Find the common ancestor by walking the deeper side up first
+    int a = history->current;
+    int b = node;
+    while (history->nodes[a].depth > history->nodes[b].depth) a = history->nodes[a].parent;
+    while (history->nodes[b].depth > history->nodes[a].depth) b = history->nodes[b].parent;
+    while (a != b) {
+        a = history->nodes[a].parent;
+        b = history->nodes[b].parent;
+    }
+    int ancestor = a;
+
+    if (history->journal_fd >= 0 && ancestor != history->current) {
+        if (ftruncate(history->journal_fd, (off_t)history->nodes[ancestor].journal_end) != 0) return false;
+    }
+
+    // Collect the new path below the ancestor (target first), then replay it top-down
+    int depth = history->nodes[node].depth - history->nodes[ancestor].depth;
+    int *path = NULL;
+    if (depth > 0) {
+        path = malloc((size_t)depth * sizeof(int));
+        if (!path) return false;
+        int walk = node;
+        for (int i = depth - 1; i >= 0; i--) {
+            path[i] = walk;
+            walk = history->nodes[walk].parent;
+        }
+    }
+
+    ChessGame scratch = *game;
+    long journal_end = history->nodes[ancestor].journal_end;
+    for (int i = 0; i < depth; i++) {
+        HistoryNode *step = &history->nodes[path[i]];
+        history->nodes[step->parent].redo_child = path[i];
+        if (history->journal_fd >= 0 && cgr_unpack_position(step->position, &scratch)) {
+            journal_end = history_journal_append(history, &scratch, journal_end);
+        }
+        step->journal_end = journal_end;
+    }
+    free(path);
+
+    history->current = node;
+    return cgr_unpack_position(history->nodes[node].position, game);
+}
+
+/**
+ * Undo plies and restore the resulting position
+ * The undone line is remembered so history_redo() can return to it.
+ *
+ * @param history Game history
+ * @param plies Number of plies to take back
+ * @param game Game state to restore into
+ * @return true on success, false if plies is out of range
+ */
+bool history_undo(GameHistory *history, int plies, ChessGame *game) {
+    if (plies < 1 || plies > history_ply_count(history)) return false;
+
+    int node = history->current;
+    for (int i = 0; i < plies; i++) node = history->nodes[node].parent;
+
+    return history_goto(history, node, game);
+}
+
+/**
+ * Redo plies along the remembered line and restore the resulting position
+ *
+ * @param history Game history
+ * @param plies Number of plies to replay
+ * @param game Game state to restore into
+ * @return true on success, false if plies is out of range
+ */
+bool history_redo(GameHistory *history, int plies, ChessGame *game) {
+    if (plies < 1 || plies > history_redo_count(history)) return false;
+
+    int node = history->current;
+    for (int i = 0; i < plies; i++) node = history->nodes[node].redo_child;
+
+    return history_goto(history, node, game);
+}
+
+/**
+ * Number of moves already explored from the current position
+ *
+ * @param history Game history
+ * @return Count of child nodes of the current node
+ */
+int history_variation_count(const GameHistory *history) {
+    if (history->current == HISTORY_NO_NODE) return 0;
+
+    int count = 0;
+    for (int child = history->nodes[history->current].first_child; child != HISTORY_NO_NODE;
+         child = history->nodes[child].next_sibling) {
+        count++;
+    }
+    return count;
+}
+
+/**
+ * Node of an explored move from the current position
+ *
+ * @param history Game history
+ * @param index 0-based variation index in the order moves were first played
+ * @return Node index, or HISTORY_NO_NODE if index is out of range
+ */
+int history_variation_node(const GameHistory *history, int index) {
+    if (history->current == HISTORY_NO_NODE || index < 0) return HISTORY_NO_NODE;
+
+    int child = history->nodes[history->current].first_child;
+    while (child != HISTORY_NO_NODE && index-- > 0) {
+        child = history->nodes[child].next_sibling;
+    }
+    return child;
+}
+
+/**
+ * Get the current node
+ *
+ * @param history Game history
+ * @return Current node, or NULL if the history is empty
+ */
+const HistoryNode* history_current(const GameHistory *history) {
+    return (history->current != HISTORY_NO_NODE) ? &history->nodes[history->current] : NULL;
+}
+
+/**
+ * Cache an evaluation for the current position
+ *
+ * @param history Game history
+ * @param eval Evaluation in centipawns from White's point of view
+ */
+void history_set_eval(GameHistory *history, int eval) {
+    if (history->current == HISTORY_NO_NODE) return;
+    history->nodes[history->current].eval = eval;
+    history->nodes[history->current].has_eval = true;
+}
+
+/**
+ * Export the line from the starting position to the current position
+ * Lets PGN and .cgr writers use the recorded moves directly instead of
+ * reconstructing them from the FEN journal.
+ *
+ * @param history Game history
+ * @param record Output record (caller frees with game_record_free)
+ * @return true on success, false if the history is empty, a move on the
+ *         line is unknown, or memory runs out
+ */
+bool history_to_record(const GameHistory *history, GameRecord *record) {
+    if (history->current == HISTORY_NO_NODE) return false;
+
+    int depth = history->nodes[history->current].depth;
+    ChessGame root;
+    memset(&root, 0, sizeof(root));
+    if (!cgr_unpack_position(history->nodes[0].position, &root)) return false;
+
+    game_record_init(record, &root);
+    if (depth == 0) return true;
+
+    uint16_t *moves = malloc((size_t)depth * sizeof(uint16_t));
+    if (!moves) return false;
+
+    int node = history->current;
+    for (int i = depth - 1; i >= 0; i--) {
+        moves[i] = history->nodes[node].move;
+        node = history->nodes[node].parent;
+    }
+
+    bool ok = true;
+    for (int i = 0; i < depth && ok; i++) {
+        ok = moves[i] != 0 && game_record_append(record, cgr_unpack_move(moves[i]));
+    }
+    free(moves);
+
+    if (!ok) game_record_free(record);
+    return ok;
+}
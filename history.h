@@ -0,0 +1,86 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+/**
+ * history.h - In-Memory Game Tree with Append-Only FEN Journal
+ *
+ * Purpose:
+ *   Keeps every position of the current game in memory as a move tree so
+ *   undo, redo and switching between variations never touch the disk or
+ *   replay moves, while the session FEN log is kept as an append-only
+ *   journal of the line currently being played.
+ *
+ * Architecture:
+ *   - Nodes live in one growable array and link to parent, first child and
+ *     next sibling by index; node 0 is the starting position
+ *   - Each node stores the packed move that reached it, the packed
+ *     position (see game_record.h), its Zobrist hash and, once known, a
+ *     cached evaluation
+ *   - Each node remembers the child it was last left through, which is
+ *     the line redo follows
+ *   - The journal always holds the path from the root to the current node:
+ *     moving back ftruncate()s it to the recorded length of the common
+ *     ancestor, moving forward appends the FEN lines of the new path
+ *
+ * Dependencies:
+ *   - chess.h for ChessGame, Move and position_hash()
+ *   - game_record.h for move and position packing
+ */
+
+#include "chess.h"
+#include "game_record.h"
+
+#define HISTORY_NO_NODE -1   // Null node index
+
+/**
+ * HistoryNode - One position in the game tree
+ */
+typedef struct {
+    uint16_t move;                        // Packed move that reached this position (0 for root/unknown)
+    uint8_t position[CGR_POSITION_SIZE];  // Packed position
+    uint64_t hash;                        // Zobrist hash of the position
+    int eval;                             // Cached evaluation in centipawns (White's view)
+    bool has_eval;                        // Whether eval holds a cached value
+    int depth;                            // Plies from the starting position
+    int parent;                           // Parent node (HISTORY_NO_NODE for root)
+    int first_child;                      // First variation from here
+    int next_sibling;                     // Next alternative to this move
+    int redo_child;                       // Child on the line last played from here
+    long journal_end;                     // Journal size after this node's line (valid on current path)
+} HistoryNode;
+
+/**
+ * GameHistory - Move tree of the current game plus its FEN journal
+ */
+typedef struct {
+    HistoryNode *nodes;      // Node storage; nodes[0] is the starting position
+    int node_count;          // Nodes in use
+    int capacity;            // Allocated nodes
+    int current;             // Node of the position on the board
+    int journal_fd;          // Append-only FEN journal (-1 if none is open)
+} GameHistory;
+
+// Lifecycle
+void history_init(GameHistory *history);  // Initialize empty history with no journal
+void history_close(GameHistory *history);  // Close journal and free nodes
+bool history_reset(GameHistory *history, const ChessGame *root, const char *journal_filename);  // Start new game and journal
+bool history_load_journal(GameHistory *history, const char *journal_filename);  // Adopt an existing FEN log as history
+
+// Recording and navigation
+bool history_push(GameHistory *history, const ChessGame *game, Move move);  // Record position after a move
+int history_ply_count(const GameHistory *history);  // Plies available to undo
+int history_redo_count(const GameHistory *history);  // Plies available to redo along the remembered line
+bool history_undo(GameHistory *history, int plies, ChessGame *game);  // Step back and restore position
+bool history_redo(GameHistory *history, int plies, ChessGame *game);  // Step forward along the remembered line
+int history_variation_count(const GameHistory *history);  // Moves already explored from the current position
+int history_variation_node(const GameHistory *history, int index);  // Node of the index-th explored move (0-based)
+bool history_goto(GameHistory *history, int node, ChessGame *game);  // Jump to any node in the tree
+
+// Cached data for the current position
+const HistoryNode* history_current(const GameHistory *history);  // Current node
+void history_set_eval(GameHistory *history, int eval);  // Cache evaluation for current node
+
+// Export
+bool history_to_record(const GameHistory *history, GameRecord *record);  // Moves from start to current position
+
+#endif // HISTORY_H
@@ -13,7 +13,7 @@
  * - Interactive command system with pause/continue prompts
  * - Human vs AI gameplay (White vs Stockfish)
  * - Move validation and possible move display
- * - Unlimited undo functionality using FEN log restoration
+ * - Unlimited undo functionality using in-memory game history
  * - AI difficulty control with skill level adjustment (0-20)
  * - Real-time position evaluation and visual scoring
  * - Custom board setup via FEN notation
@@ -27,9 +27,23 @@
 #include "chess.h"
 #include "stockfish.h"
 #include "pgn_utils.h"
+#include "game_record.h"
+#include "history.h"
+#include "position_index.h"
+#include "book.h"
+#include "explorer.h"
+#include "tablebase.h"
+#include "tt.h"
+#include "profile.h"
+#include "search.h"
+#include "san.h"
+#include "screen.h"
+#include "clock_ticker.h"
+#include "protocol.h"
 
 // System headers
 #include <dirent.h>      // For directory scanning
+#include <signal.h>      // For ignoring SIGPIPE from engine pipes
 #include <strings.h>     // For strcasecmp() case-insensitive string comparison
 #include <sys/stat.h>    // For file statistics
 #include <sys/types.h>   // For process ID types
@@ -49,7 +63,15 @@ typedef struct {
     int default_skill_level;           // Default AI skill level (0-20)
     bool auto_create_pgn;              // Create PGN files on exit (true=PGNON, false=PGNOFF)
     bool auto_delete_fen;              // Delete FEN files on exit (true=FENOFF, false=FENON)
-    char default_time_control[16];     // Default time control (e.g., "30/10")
+    char default_time_control[TIME_CONTROL_STRING_SIZE];  // Default time control (e.g., "30/10")
+    int hash_size_mb;                  // Built-in engine transposition table size
+    int search_threads;                // Built-in engine threads (0 = all processors)
+    char database_directory[512];      // Game database searched recursively by FIND (empty = none)
+    char position_index_file[512];     // Position index file used by FIND
+    char opening_book[512];            // Polyglot book the AI plays from (missing file = no book)
+    char book_keys[512];               // Optional key table replacing the standard Polyglot keys
+    char explorer_file[512];           // Opening explorer statistics shown by EXPLORE
+    char tablebase_directory[512];     // Endgame tables used by SCORE and the AI (empty = none)
     bool fen_directory_overridden;     // Flag for debug messages
     bool skill_level_overridden;       // Flag for debug messages
 } ChessConfig;
@@ -75,6 +97,8 @@ typedef struct {
     bool pgn_window_active;            // Whether live PGN window is open
     bool game_started;                 // Whether first move has been made
     int current_skill_level;           // Active AI skill level
+    GameHistory history;               // In-memory positions backing undo, journaled to FEN log
+    Book book;                         // Opening book (fd -1 when not available)
     ChessConfig config;                // Configuration settings
     RuntimeConfig runtime;             // Runtime flags
 } GameSession;
@@ -87,6 +111,8 @@ GameSession g_session = {0};
  */
 void init_game_session() {
     memset(&g_session, 0, sizeof(GameSession));
+    history_init(&g_session.history);
+    g_session.book.fd = -1;
     g_session.current_skill_level = MAX_SKILL_LEVEL;
     g_session.pgn_window_active = false;
     g_session.game_started = false;
@@ -95,6 +121,15 @@ void init_game_session() {
     g_session.runtime.delete_fen_on_exit = false;
 }
 
+/**
+ * Write the --trace file (registered with atexit())
+ */
+static void write_trace_file(void) {
+    if (!profile_trace_stop()) {
+        fprintf(stderr, "Warning: Cannot write trace file\n");
+    }
+}
+
 /**
  * Display command line help information
  * Shows all available command line options with descriptions
@@ -109,6 +144,11 @@ void show_command_line_help() {
     printf("             FEN log will still be created during gameplay\n\n");
     printf("  FENOFF     Delete FEN log file on game exit (after PGN creation)\n");
     printf("             Useful for temporary games or testing\n\n");
+    printf("  --protocol Headless mode: read engine commands from stdin, reply on stdout\n");
+    printf("             (position, moves, go, stop, eval, undo, fen, pgn; see README)\n\n");
+    printf("  --json     With --protocol, reply with one JSON object per line\n\n");
+    printf("  --trace F  Write a Chrome trace-event JSON timeline to file F on exit\n");
+    printf("             (open in chrome://tracing or ui.perfetto.dev)\n\n");
     printf("  /HELP      Display this help information and exit\n\n");
     printf("Examples:\n");
     printf("  chess                    # Start normal game\n");
@@ -117,6 +157,8 @@ void show_command_line_help() {
     printf("  chess FENOFF             # FEN file deleted on exit\n");
     printf("  chess PGNOFF FENOFF      # No files saved on exit\n");
     printf("  chess debug pgnoff       # Mixed case works fine\n");
+    printf("  chess --protocol --json  # Drive the engine from another program\n");
+    printf("  chess --trace trace.json # Record where the time goes\n");
     printf("  chess /help              # Show this help\n\n");
     printf("Note: Options can be combined in any order.\n");
     printf("      All options are case-insensitive.\n");
@@ -151,6 +193,29 @@ void generate_persistent_pgn_filename() {
              "/tmp/chess_pgn_live_%d.txt", getpid());
 }
 
+/**
+ * Generate PGN for the current game line
+ * Uses the moves held by the session history; falls back to reading the
+ * FEN log only if the history cannot supply them.
+ *
+ * @param game_result Result marker ("1-0", "0-1", "1/2-1/2" or "*")
+ * @return malloc'd PGN string, or NULL on error
+ */
+char* generate_current_pgn(const char* game_result) {
+    uint64_t profile_start = profile_begin();
+    char* pgn_content = NULL;
+    GameRecord record;
+    if (history_to_record(&g_session.history, &record)) {
+        pgn_content = convert_record_to_pgn_string(&record, game_result);
+        game_record_free(&record);
+    }
+    if (!pgn_content) {
+        pgn_content = convert_fen_to_pgn_string(g_session.fen_log_filename, game_result);
+    }
+    profile_end(PROFILE_PGN_REBUILD, profile_start);
+    return pgn_content;
+}
+
 /**
  * Update persistent PGN file with current game state
  * Called after each move to refresh the live PGN display
@@ -160,7 +225,7 @@ void update_persistent_pgn_file() {
         return;  // No PGN window is active, skip update
     }
 
-    char* pgn_content = convert_fen_to_pgn_string(g_session.fen_log_filename, "*");
+    char* pgn_content = generate_current_pgn("*");
     if (!pgn_content) {
         return;  // Could not generate PGN content
     }
@@ -188,19 +253,16 @@ void cleanup_persistent_pgn_file() {
 }
 
 /**
- * Save current board position to FEN log file
- * Appends current board state to the session's FEN log file.
- * Called after every half-move to create complete game history.
- * 
+ * Save current board position to game history and FEN log file
+ * Records the position in the in-memory history, which appends it to the
+ * session's FEN log journal. Called after every half-move to create
+ * complete game history.
+ *
  * @param game Current game state to save as FEN
+ * @param move Move that produced this position
  */
-void save_fen_log(ChessGame *game) {
-    char *fen = board_to_fen(game);
-    FILE *fen_file = fopen(g_session.fen_log_filename, "a");
-    if (fen_file) {
-        fprintf(fen_file, "%s\n", fen);
-        fclose(fen_file);
-    }
+void save_fen_log(ChessGame *game, Move move) {
+    history_push(&g_session.history, game, move);
     // Update live PGN display after saving FEN
     update_persistent_pgn_file();
     // Note: FEN logging is always enabled - no debug messages needed
@@ -253,6 +315,14 @@ void load_config() {
     g_session.config.auto_create_pgn = true;      // Default PGNON (create PGN files)
     g_session.config.auto_delete_fen = false;     // Default FENON (keep FEN files)
     strcpy(g_session.config.default_time_control, "30/10/5/0"); // Default: White 30/10, Black 5/0
+    g_session.config.hash_size_mb = TT_DEFAULT_MB;  // Default built-in engine hash
+    g_session.config.search_threads = 0;            // Default: one thread per processor
+    g_session.config.database_directory[0] = '\0';  // Default: no separate game database
+    strcpy(g_session.config.position_index_file, POSITION_INDEX_DEFAULT_FILE);
+    strcpy(g_session.config.opening_book, BOOK_DEFAULT_FILE);
+    g_session.config.book_keys[0] = '\0';        // Default: standard Polyglot keys
+    strcpy(g_session.config.explorer_file, EXPLORER_DEFAULT_FILE);
+    g_session.config.tablebase_directory[0] = '\0';  // Default: no endgame tables
 
     if (!config_file) {
         // Create default config file if it doesn't exist
@@ -320,6 +390,27 @@ void load_config() {
                         // Invalid directory - fallback to default
                         strcpy(g_session.config.pgn_directory, ".");
                     }
+                } else if (strcmp(key, "DatabaseDirectory") == 0) {
+                    char temp_path[512];
+                    expand_path(value, temp_path, sizeof(temp_path));
+
+                    // Invalid directory - leave the database unset
+                    if (is_valid_directory(temp_path)) {
+                        strcpy(g_session.config.database_directory, temp_path);
+                    }
+                } else if (strcmp(key, "PositionIndex") == 0 && value[0] != '\0') {
+                    expand_path(value, g_session.config.position_index_file,
+                                sizeof(g_session.config.position_index_file));
+                } else if (strcmp(key, "OpeningBook") == 0) {
+                    // Empty value disables the book
+                    expand_path(value, g_session.config.opening_book, sizeof(g_session.config.opening_book));
+                } else if (strcmp(key, "BookKeys") == 0) {
+                    expand_path(value, g_session.config.book_keys, sizeof(g_session.config.book_keys));
+                } else if (strcmp(key, "ExplorerFile") == 0 && value[0] != '\0') {
+                    expand_path(value, g_session.config.explorer_file, sizeof(g_session.config.explorer_file));
+                } else if (strcmp(key, "TablebaseDirectory") == 0) {
+                    expand_path(value, g_session.config.tablebase_directory,
+                                sizeof(g_session.config.tablebase_directory));
                 }
             } else if (strcmp(section, "Settings") == 0) {
                 if (strcmp(key, "DefaultSkillLevel") == 0) {
@@ -353,10 +444,23 @@ void load_config() {
                     }
                     // Invalid values are ignored, keeping default
                 } else if (strcasecmp(key, "DefaultTimeControl") == 0) {
-                    // Validate time control format (xx/yy or 0/0)
+                    // Validate time control format (xx/yy, extended, or 0/0)
                     TimeControl temp_tc;
                     if (parse_time_control(value, &temp_tc)) {
-                        strcpy(g_session.config.default_time_control, value);
+                        snprintf(g_session.config.default_time_control,
+                                 sizeof(g_session.config.default_time_control), "%s", value);
+                    }
+                    // Invalid values are ignored, keeping default
+                } else if (strcasecmp(key, "SearchThreads") == 0) {
+                    int threads = atoi(value);
+                    if (threads >= 0 && threads <= SEARCH_MAX_THREADS) {
+                        g_session.config.search_threads = threads;
+                    }
+                    // Invalid values are ignored, keeping default
+                } else if (strcasecmp(key, "HashSizeMB") == 0) {
+                    int megabytes = atoi(value);
+                    if (megabytes >= 1 && megabytes <= TT_MAX_MB) {
+                        g_session.config.hash_size_mb = megabytes;
                     }
                     // Invalid values are ignored, keeping default
                 }
@@ -398,6 +502,29 @@ void create_default_config() {
     fprintf(config_file, "#   PGNDirectory=C:\\Users\\User\\Chess\\Games\n");
     fprintf(config_file, "PGNDirectory=.\n");
     fprintf(config_file, "\n");
+    fprintf(config_file, "# Game database searched (with subdirectories) by the FIND command\n");
+    fprintf(config_file, "# FEN, PGN and CGR files in the FEN and PGN directories are always searched\n");
+    fprintf(config_file, "# Example: DatabaseDirectory=/home/user/chess/database\n");
+    fprintf(config_file, "DatabaseDirectory=\n");
+    fprintf(config_file, "\n");
+    fprintf(config_file, "# Position index file maintained by the FIND command\n");
+    fprintf(config_file, "PositionIndex=positions.cpx\n");
+    fprintf(config_file, "\n");
+    fprintf(config_file, "# Polyglot opening book the AI plays from before searching (build with make_book)\n");
+    fprintf(config_file, "# Leave empty to disable; a missing file simply means no book\n");
+    fprintf(config_file, "OpeningBook=book.bin\n");
+    fprintf(config_file, "\n");
+    fprintf(config_file, "# Key table (781 hex keys, one per line) replacing the standard Polyglot keys\n");
+    fprintf(config_file, "# Only needed for books made with non-standard keys\n");
+    fprintf(config_file, "BookKeys=\n");
+    fprintf(config_file, "\n");
+    fprintf(config_file, "# Opening explorer statistics for the EXPLORE command (build with make_explorer)\n");
+    fprintf(config_file, "ExplorerFile=explorer.cxp\n");
+    fprintf(config_file, "\n");
+    fprintf(config_file, "# Endgame tables for exact scores and AI moves (build with make_tablebase)\n");
+    fprintf(config_file, "# Example: TablebaseDirectory=/home/user/chess/tablebases\n");
+    fprintf(config_file, "TablebaseDirectory=\n");
+    fprintf(config_file, "\n");
     fprintf(config_file, "[Settings]\n");
     fprintf(config_file, "# Default AI skill level (0=easiest, 20=strongest)\n");
     fprintf(config_file, "# Can be overridden with 'skill N' command before first move\n");
@@ -414,13 +541,41 @@ void create_default_config() {
     fprintf(config_file, "# Default time control setting\n");
     fprintf(config_file, "# Format: white_min/white_inc/black_min/black_inc OR min/inc (same for both)\n");
     fprintf(config_file, "# Examples: 30/10 (both get 30min+10sec), 30/10/5/0 (White 30/10, Black 5/0)\n");
+    fprintf(config_file, "# Extended: 40/90+30,G/30+30 (multi-period), G/60d5 (delay), 60,byo5x30 (byoyomi)\n");
     fprintf(config_file, "# Use 0/0 to disable time controls\n");
     fprintf(config_file, "# Can be overridden with 'TIME' command during gameplay\n");
     fprintf(config_file, "DefaultTimeControl=30/10/5/0\n");
+    fprintf(config_file, "\n");
+    fprintf(config_file, "# Transposition table size in MB for the built-in engine (used without Stockfish)\n");
+    fprintf(config_file, "HashSizeMB=16\n");
+    fprintf(config_file, "# Search threads for the built-in engine (0 = one per processor)\n");
+    fprintf(config_file, "SearchThreads=0\n");
 
     fclose(config_file);
 }
 
+/**
+ * Print the configured default time control for the debug startup report
+ */
+static void print_default_time_control() {
+    printf("Configuration loaded: DefaultTimeControl='%s'", g_session.config.default_time_control);
+
+    TimeControl time_control;
+    if (!parse_time_control(g_session.config.default_time_control, &time_control) || !time_control.enabled) {
+        printf(" (time controls disabled)\n");
+        return;
+    }
+
+    char white_text[TIME_CONTROL_STRING_SIZE], black_text[TIME_CONTROL_STRING_SIZE];
+    describe_time_control(&time_control.white, white_text, sizeof(white_text));
+    describe_time_control(&time_control.black, black_text, sizeof(black_text));
+    if (strcmp(white_text, black_text) == 0) {
+        printf(" (both players: %s)\n", white_text);
+    } else {
+        printf(" (White: %s; Black: %s)\n", white_text, black_text);
+    }
+}
+
 /**
  * Expand path with tilde (~) and environment variables
  * Handles tilde expansion to home directory and provides better error reporting
@@ -464,94 +619,9 @@ void reset_fen_log_for_setup(ChessGame *game) {
     // Generate a new FEN log filename for the setup position
     generate_fen_filename();
 
-    // Log the new starting position
-    save_fen_log(game);
-}
-
-/**
- * Remove last two moves from FEN log file for undo functionality
- * When undo is executed, both White's move and AI's response are reverted,
- * so we need to remove the last 2 FEN entries to keep the file synchronized.
- */
-/**
- * Count available undo moves from FEN log file
- * Returns number of move pairs that can be undone (each pair = White + AI move)
- */
-int count_available_undos() {
-    FILE *file = fopen(g_session.fen_log_filename, "r");
-    if (!file) return 0;
-
-    int line_count = 0;
-    char buffer[256];
-
-    while (fgets(buffer, sizeof(buffer), file)) {
-        line_count++;
-    }
-    fclose(file);
-
-    // Each move pair requires 2 FEN entries, but we need at least 1 entry to remain (starting position)
-    return (line_count > 2) ? (line_count - 1) / 2 : 0;
-}
-
-/**
- * Truncate FEN log file by specified number of move pairs
- * Each move pair removes 2 FEN entries (White move + AI response)
- */
-void truncate_fen_log_by_moves(int move_pairs_to_undo) {
-    FILE *file = fopen(g_session.fen_log_filename, "r");
-    if (!file) return;
-
-    // Read all lines into memory
-    char lines[MAX_PGN_DISPLAY_MOVES][256];  // Support up to MAX_PGN_DISPLAY_MOVES moves
-    int line_count = 0;
-
-    while (fgets(lines[line_count], sizeof(lines[line_count]), file) && line_count < MAX_PGN_DISPLAY_MOVES) {
-        // Remove newline character for easier handling
-        lines[line_count][strcspn(lines[line_count], "\n")] = '\0';
-        line_count++;
-    }
-    fclose(file);
-
-    // Remove 2 lines per move pair to undo
-    int lines_to_remove = move_pairs_to_undo * 2;
-    if (line_count > lines_to_remove) {
-        line_count -= lines_to_remove;
-
-        // Rewrite the file with the truncated content
-        file = fopen(g_session.fen_log_filename, "w");
-        if (file) {
-            for (int i = 0; i < line_count; i++) {
-                fprintf(file, "%s\n", lines[i]);
-            }
-            fclose(file);
-        }
-    }
-}
-
-/**
- * Restore game state from last FEN entry in log file
- * Reads the FEN file and uses the last entry to restore game state
- */
-bool restore_from_fen_log(ChessGame *game) {
-    FILE *file = fopen(g_session.fen_log_filename, "r");
-    if (!file) return false;
-
-    char last_fen[256] = "";
-    char buffer[256];
-
-    // Read all lines to find the last one
-    while (fgets(buffer, sizeof(buffer), file)) {
-        strcpy(last_fen, buffer);
-    }
-    fclose(file);
-
-    // Remove newline character
-    last_fen[strcspn(last_fen, "\n")] = '\0';
-
-    if (strlen(last_fen) == 0) return false;
-
-    // Restore game state from FEN
-    return setup_board_from_fen(game, last_fen);
+    // Start a new history and journal with the new starting position
+    history_reset(&g_session.history, game, g_session.fen_log_filename);
+    update_persistent_pgn_file();
 }
 
 /**
@@ -628,8 +698,8 @@ void convert_fen_to_pgn(const char* game_result) {
     fclose(fen_file);
 
     // We can't pass game_result through the command-line utility easily,
-    // so we'll use the convert_fen_to_pgn_string() function and write it directly
-    char* pgn_content = convert_fen_to_pgn_string(g_session.fen_log_filename, game_result);
+    // so we'll generate the PGN in-process and write it directly
+    char* pgn_content = generate_current_pgn(game_result);
     if (pgn_content) {
         FILE* pgn_file = fopen(pgn_filename, "w");
         if (pgn_file) {
@@ -640,6 +710,47 @@ void convert_fen_to_pgn(const char* game_result) {
     }
 }
 
+/**
+ * Build the game record filename from the FEN log filename
+ * Replaces the .fen extension with .cgr
+ */
+static void get_game_record_filename(char* cgr_filename, size_t size) {
+    char* base_name = strdup(g_session.fen_log_filename);
+
+    // Remove .fen extension if present
+    char* dot = strrchr(base_name, '.');
+    if (dot) *dot = '\0';
+
+    snprintf(cgr_filename, size, "%s.cgr", base_name);
+    free(base_name);
+}
+
+/**
+ * Save a compact binary game record (.cgr) next to the FEN log
+ * Called on exit when the FEN log is kept. The record holds the same
+ * game as the FEN log in a fraction of the space and can be converted
+ * back with the cgr_convert utility.
+ */
+void save_game_record() {
+    // Nothing worth recording if the FEN log is missing or has no moves
+    if (access(g_session.fen_log_filename, F_OK) != 0 ||
+        is_starting_position_only_fen_file(g_session.fen_log_filename)) {
+        return;
+    }
+
+    // Prefer the moves already held by the session history
+    GameRecord record;
+    if (!history_to_record(&g_session.history, &record) &&
+        !game_record_from_fen_log(&record, g_session.fen_log_filename)) {
+        return;
+    }
+
+    char cgr_filename[256];
+    get_game_record_filename(cgr_filename, sizeof(cgr_filename));
+    game_record_save(&record, cgr_filename, true);
+    game_record_free(&record);
+}
+
 /**
  * Display the generated game files to inform the user
  * Shows both the FEN log file and the converted PGN file names
@@ -682,6 +793,12 @@ void show_game_files() {
     } else if (g_session.runtime.suppress_pgn_creation) {
         printf("  PGN file: %s (not created due to PGNOFF option)\n", pgn_filename);
     }
+
+    char cgr_filename[256];
+    get_game_record_filename(cgr_filename, sizeof(cgr_filename));
+    if (access(cgr_filename, F_OK) == 0) {
+        printf("  Game record: %s\n", cgr_filename);
+    }
 }
 
 /**
@@ -809,6 +926,7 @@ bool display_pgn_in_new_window(const char* pgn_content) {
 void clear_screen() {
     printf("%s", CLEAR_SCREEN);  // Clear screen and move cursor to top-left
     fflush(stdout);           // Ensure immediate display
+    screen_invalidate();      // Next frame is drawn in full
 }
 
 /**
@@ -1326,6 +1444,11 @@ void copy_game_history_to_new_log(FENNavigator *nav, int up_to_position) {
 
     fclose(file);
 
+    // Continue journaling into the new log from the copied history
+    if (!history_load_journal(&g_session.history, g_session.fen_log_filename)) {
+        printf("Warning: Could not rebuild undo history from game log.\n");
+    }
+
     printf("Copied %d position%s to new game log.\n",
            up_to_position + 1,
            up_to_position == 0 ? "" : "s");
@@ -1346,15 +1469,16 @@ int interactive_fen_browser(ChessGame *game, FENNavigator *nav) {
             break;
         }
 
-        clear_screen();
+        screen_begin_frame();
 
         // Display current board
-        Position empty_moves[1];  // No highlighting
-        print_board(&temp_game, empty_moves, 0);
+        BoardHighlights highlights;
+        get_board_highlights(&temp_game, &highlights);
+        print_board(&temp_game, &highlights);
 
         // Display navigation info
-        printf("\n=== GAME BROWSER ===\n");
-        printf("Position %d/%d", nav->current + 1, nav->count);
+        screen_printf("\n=== GAME BROWSER ===\n");
+        screen_printf("Position %d/%d", nav->current + 1, nav->count);
 
         // Show move number based on FEN fullmove counter
         if (nav->current < nav->count) {
@@ -1370,18 +1494,18 @@ int interactive_fen_browser(ChessGame *game, FENNavigator *nav) {
             if (token) {
                 int move_num = atoi(token);
                 if (move_num > 0) {
-                    printf(" - Move %d", move_num);
+                    screen_printf(" - Move %d", move_num);
                 }
             }
         }
 
-        printf("\n\n");
-        printf("← → Navigate positions\n");
-        printf("ENTER to resume game from the currently loaded position\n");
-        printf("ESC ESC (twice) to cancel loading\n");
-        printf("Current FEN: %.60s...\n", nav->positions[nav->current]);
+        screen_printf("\n\n");
+        screen_printf("← → Navigate positions\n");
+        screen_printf("ENTER to resume game from the currently loaded position\n");
+        screen_printf("ESC ESC (twice) to cancel loading\n");
+        screen_printf("Current FEN: %.60s...\n", nav->positions[nav->current]);
 
-        fflush(stdout);
+        screen_end_frame();
 
         int key = get_key();
 
@@ -1891,6 +2015,119 @@ void handle_load_pgn_command(ChessGame *game) {
     getchar();
 }
 
+/**
+ * Handle FIND command - list saved games that reach the current position
+ * Brings the position index up to date first (only new or changed files are
+ * parsed), then looks the current position up by its Zobrist hash, so
+ * transpositions are found too. The FEN log of the game in progress is left
+ * out of the index.
+ *
+ * @param game Current game state
+ */
+void handle_find_command(ChessGame *game) {
+    IndexRoot roots[POSITION_INDEX_MAX_ROOTS];
+    int root_count = 0;
+    const char *directories[] = {".", g_session.config.fen_directory, g_session.config.pgn_directory};
+
+    for (int i = 0; i < 3; i++) {
+        bool duplicate = false;
+        for (int j = 0; j < root_count; j++) {
+            if (strcmp(roots[j].path, directories[i]) == 0) duplicate = true;
+        }
+        if (!duplicate) {
+            roots[root_count].path = directories[i];
+            roots[root_count].recursive = false;
+            root_count++;
+        }
+    }
+    if (g_session.config.database_directory[0] != '\0') {
+        roots[root_count].path = g_session.config.database_directory;
+        roots[root_count].recursive = true;
+        root_count++;
+    }
+
+    struct timespec start, indexed, searched;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    IndexUpdateStats stats;
+    printf("\nUpdating position index %s...\n", g_session.config.position_index_file);
+    if (!position_index_update(g_session.config.position_index_file, roots, root_count,
+                               g_session.fen_log_filename, &stats)) {
+        printf("Error: Cannot write position index %s\n", g_session.config.position_index_file);
+        printf("Press Enter to continue...");
+        getchar();
+        return;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &indexed);
+
+    IndexMatch matches[20];
+    int total = 0;
+    int found = position_index_find(g_session.config.position_index_file, position_hash(game),
+                                    matches, 20, &total);
+    clock_gettime(CLOCK_MONOTONIC, &searched);
+
+    double index_ms = (indexed.tv_sec - start.tv_sec) * 1000.0 + (indexed.tv_nsec - start.tv_nsec) / 1000000.0;
+    double search_ms = (searched.tv_sec - indexed.tv_sec) * 1000.0 + (searched.tv_nsec - indexed.tv_nsec) / 1000000.0;
+
+    printf("%u games, %llu positions indexed (%d files parsed, %d unchanged) in %.1f ms\n",
+           stats.games, (unsigned long long)stats.positions, stats.files_indexed, stats.files_reused, index_ms);
+
+    if (found <= 0) {
+        printf("\nNo saved games reach this position (search took %.2f ms).\n", search_ms);
+    } else {
+        printf("\nGames reaching this position:\n");
+        for (int i = 0; i < found; i++) {
+            printf("  %s, game %u: move %u (of %u plies)\n", matches[i].path, matches[i].game_number,
+                   matches[i].ply / 2 + 1, matches[i].ply_count);
+        }
+        if (total > found) {
+            printf("  ... and %d more\n", total - found);
+        }
+        printf("%d game%s found in %.2f ms\n", total, total == 1 ? "" : "s", search_ms);
+    }
+
+    printf("Press Enter to continue...");
+    getchar();
+}
+
+/**
+ * Handle EXPLORE command - opening explorer statistics for the current position
+ * Lists every move played from this position in the games aggregated by
+ * make_explorer, most played first, with results and average eval.
+ *
+ * @param game Current game state
+ */
+void handle_explore_command(ChessGame *game) {
+    ExplorerRecord records[20];
+    int count = explorer_lookup(g_session.config.explorer_file, position_hash(game), records, 20);
+
+    if (count < 0) {
+        printf("\nNo explorer statistics found at %s.\n", g_session.config.explorer_file);
+        printf("Build them with: ./make_explorer %s games.pgn\n", g_session.config.explorer_file);
+    } else if (count == 0) {
+        printf("\nThis position does not occur in the explorer games.\n");
+    } else {
+        printf("\nMove      Games  White  Draw  Black   Eval\n");
+        for (int i = 0; i < count; i++) {
+            char san[SAN_BUFFER_SIZE];
+            if (san_format_move(game, cgr_unpack_move(records[i].move), san, sizeof(san)) == 0) continue;
+
+            double games = records[i].games;
+            printf("%-8s %6u %5.1f%% %4.1f%% %5.1f%%", san, records[i].games,
+                   100.0 * records[i].white_wins / games, 100.0 * records[i].draws / games,
+                   100.0 * records[i].black_wins / games);
+            if (records[i].eval_count > 0) {
+                printf(" %+6.2f\n", (double)records[i].eval_sum / records[i].eval_count / 100.0);
+            } else {
+                printf("      -\n");
+            }
+        }
+    }
+
+    printf("Press Enter to continue...");
+    getchar();
+}
+
 /**
  * Convert centipawn evaluation to -9 to +9 scale
  * Stockfish returns evaluations in centipawns (hundredths of a pawn)
@@ -1975,6 +2212,48 @@ void print_evaluation_line(int evaluation) {
     printf("\n");
 }
 
+/**
+ * Display an exact tablebase result with the evaluation line at its end
+ * (+9 or -9 for a forced mate, 0 for a draw)
+ *
+ * @param game Current game state (the result is for its side to move)
+ * @param result Tablebase probe result
+ */
+void print_tablebase_result(ChessGame *game, TbResult result) {
+    printf("\nCurrent Game Evaluation (endgame tablebase):\n");
+    if (result.wdl == TB_DRAW) {
+        printf("Draw with best play\n");
+        print_evaluation_line(0);
+        return;
+    }
+
+    Color winner = result.wdl == TB_WIN ? game->current_player : (game->current_player == WHITE ? BLACK : WHITE);
+    int moves = (result.distance + 1) / 2;
+    printf("%s wins: mate in %d move%s\n", winner == WHITE ? "White" : "Black", moves, moves == 1 ? "" : "s");
+    print_evaluation_line(winner == WHITE ? 9 : -9);
+}
+
+/**
+ * Pick the tablebase move for a covered endgame
+ *
+ * @param game Current game state
+ * @param move_str Output: move in engine notation ("e7e8q")
+ * @return true if the position is covered
+ */
+bool pick_tablebase_move(ChessGame *game, char *move_str) {
+    Move move;
+    TbResult result;
+    if (!tablebase_best_move(game, &move, &result)) return false;
+
+    snprintf(move_str, 6, "%c%c%c%c", 'a' + move.from.col, '8' - move.from.row, 'a' + move.to.col, '8' - move.to.row);
+    if (move.is_promotion) {
+        const char *letters = " prnbqk";
+        move_str[4] = letters[move.promotion_piece];
+        move_str[5] = '\0';
+    }
+    return true;
+}
+
 /**
  * Display current game information including player turn and captured pieces
  * Shows game status header and captured piece summary for both players
@@ -1982,12 +2261,12 @@ void print_evaluation_line(int evaluation) {
  * @param game Current game state to display
  */
 void print_game_info(ChessGame *game) {
-    printf("\n=== Claude Chess ===\n");
-    printf("Current player: %s\n", game->current_player == WHITE ? "WHITE" : "BLACK");
-    printf("Stockfish Skill Level: %d\n", g_session.current_skill_level);
+    screen_printf("\n=== Claude Chess ===\n");
+    screen_printf("Current player: %s\n", game->current_player == WHITE ? "WHITE" : "BLACK");
+    screen_printf("Stockfish Skill Level: %d\n", g_session.current_skill_level);
     
     // Display captured pieces for both players
-    printf("\n");
+    screen_printf("\n");
     print_captured_pieces(&game->black_captured, COLOR_BLACK_PLAYER, "Black", game);
     print_captured_pieces(&game->white_captured, COLOR_WHITE_PLAYER, "White", game);
 }
@@ -2047,17 +2326,26 @@ void print_help() {
         "Type 'hint'       to get Stockfish's best move suggestion for White",
         "Type 'score'      to display current game evaluation score",
         "Type 'scale'      to view the score conversion chart (centipawns to -9/+9 scale)",
+        "Type 'hanging'    to toggle underlining of pieces that can be won by a capture",
         "Type 'skill N'    to set AI difficulty level (0=easiest, 20=strongest, only before first move)",
         "Type 'time xx/yy' to set time controls (minutes/increment for both, or xx/yy/zz/ww for White/Black)",
+        "                  also multi-period, delay and byoyomi: 'time 40/90+30,G/30+30', 'time G/60d5', 'time 60,byo5x30'",
         "Type 'fen'        to display current board position in FEN notation",
         "Type 'pgn'        to display current game in PGN (Portable Game Notation) format",
         "Type 'title'      to re-display the game title and info screen",
         "Type 'credits'    to view program credits",
+        "Type 'stats'      to show timing counters and histograms ('stats reset' to zero them)",
         "Type 'setup'      to setup a custom board position from FEN string",
         "Type 'load'       to show help for LOAD FEN and LOAD PGN commands",
         "Type 'load fen'   to browse and load saved FEN games (with arrow key navigation)",
         "Type 'load pgn'   to browse and load saved PGN games (with arrow key navigation)",
+        "Type 'find'       to list saved games that reach the current position",
+        "Type 'book'       to list opening book moves for the current position",
+        "Type 'explore'    to show how often each move was played here and how it scored",
         "Type 'undo'       for unlimited undo (undo any number of move pairs)",
+        "Type 'redo'       to replay move pairs that were undone",
+        "Type 'variations' to list moves already tried from this position",
+        "Type 'variation N' to switch to one of the listed variations",
         "Type 'resign'     to resign the game (with confirmation)",
         "Type 'quit'       to exit the game",
         "",  // Blank line
@@ -2100,67 +2388,6 @@ void print_help() {
     printf("\n");  // Final blank line
 }
 
-/**
- * Check if a player has any legal moves available
- * Iterates through all pieces of the specified color and tests if any
- * piece has at least one legal move. Used for stalemate and checkmate detection.
- *
- * @param game Current game state
- * @param color Color of player to check for legal moves
- * @return true if player has at least one legal move, false if no moves available
- */
-bool has_legal_moves(ChessGame *game, Color color) {
-    for (int row = 0; row < BOARD_SIZE; row++) {
-        for (int col = 0; col < BOARD_SIZE; col++) {
-            if (is_piece_at(game, row, col)) {
-                Piece piece = get_piece_at(game, row, col);
-                if (piece.color == color) {
-                    Position moves[64];
-                    Color original_player = game->current_player;
-                    game->current_player = color;
-                    
-                    int move_count = get_possible_moves(game, (Position){row, col}, moves);
-                    
-                    for (int i = 0; i < move_count; i++) {
-                        if (!would_be_in_check_after_move(game, (Position){row, col}, moves[i])) {
-                            game->current_player = original_player;
-                            return true;
-                        }
-                    }
-                    
-                    game->current_player = original_player;
-                }
-            }
-        }
-    }
-    return false;
-}
-
-/**
- * Check if a player is in checkmate
- * Checkmate occurs when the king is in check and has no legal moves to escape check
- *
- * @param game Current game state
- * @param color Color of player to check for checkmate
- * @return true if player is in checkmate, false otherwise
- */
-bool is_checkmate(ChessGame *game, Color color) {
-    return is_in_check(game, color) && !has_legal_moves(game, color);
-}
-
-/**
- * Check if a player is in stalemate
- * Stalemate occurs when the player is NOT in check but has no legal moves.
- * Results in a draw.
- *
- * @param game Current game state
- * @param color Color of player to check for stalemate
- * @return true if player is in stalemate, false otherwise
- */
-bool is_stalemate(ChessGame *game, Color color) {
-    return !is_in_check(game, color) && !has_legal_moves(game, color);
-}
-
 /**
  * Handle game commands during White's turn
  * Processes all non-move commands (help, hint, fen, quit, etc.)
@@ -2181,6 +2408,8 @@ bool handle_game_commands(const char *input, ChessGame *game, StockfishEngine *e
 
         if (g_session.runtime.delete_fen_on_exit) {
             unlink(g_session.fen_log_filename);
+        } else {
+            save_game_record();
         }
 
         show_game_files();
@@ -2231,6 +2460,14 @@ bool handle_game_commands(const char *input, ChessGame *game, StockfishEngine *e
         return true;
     }
 
+    if (strcmp(input, "hanging") == 0 || strcmp(input, "HANGING") == 0) {
+        set_hanging_overlay(!is_hanging_overlay_enabled());
+        printf("\nHanging pieces overlay %s.\n", is_hanging_overlay_enabled() ? "ON" : "OFF");
+        printf("Press Enter to continue...");
+        getchar();
+        return true;
+    }
+
     if (strncmp(input, "skill ", 6) == 0 || strncmp(input, "SKILL ", 6) == 0) {
         if (g_session.game_started) {
             printf("\nSkill level cannot be changed after the game has started!\n");
@@ -2271,16 +2508,15 @@ bool handle_game_commands(const char *input, ChessGame *game, StockfishEngine *e
             game->time_control = new_time_control;
 
             if (new_time_control.enabled) {
-                if (new_time_control.white_minutes == new_time_control.black_minutes &&
-                    new_time_control.white_increment == new_time_control.black_increment) {
-                    printf("\nTime controls set: %d minutes + %d second increment (both players)\n",
-                           new_time_control.white_minutes, new_time_control.white_increment);
+                char white_text[TIME_CONTROL_STRING_SIZE], black_text[TIME_CONTROL_STRING_SIZE];
+                describe_time_control(&new_time_control.white, white_text, sizeof(white_text));
+                describe_time_control(&new_time_control.black, black_text, sizeof(black_text));
+                if (strcmp(white_text, black_text) == 0) {
+                    printf("\nTime controls set: %s (both players)\n", white_text);
                 } else {
                     printf("\nTime controls set:\n");
-                    printf("  White: %d minutes + %d second increment\n",
-                           new_time_control.white_minutes, new_time_control.white_increment);
-                    printf("  Black: %d minutes + %d second increment\n",
-                           new_time_control.black_minutes, new_time_control.black_increment);
+                    printf("  White: %s\n", white_text);
+                    printf("  Black: %s\n", black_text);
                 }
                 init_game_timer(game, &new_time_control);
             } else {
@@ -2290,9 +2526,14 @@ bool handle_game_commands(const char *input, ChessGame *game, StockfishEngine *e
             printf("\nInvalid time control format. Use:\n");
             printf("  TIME xx/yy (same for both players)\n");
             printf("  TIME xx/yy/zz/ww (White: xx/yy, Black: zz/ww)\n");
+            printf("  TIME periods[,byoNxS] [Black's periods] (extended, see below)\n");
             printf("Examples:\n");
             printf("  TIME 15/5 (both get 15 min + 5 sec increment)\n");
             printf("  TIME 30/10/5/0 (White: 30/10, Black: 5/0)\n");
+            printf("  TIME 40/90+30,G/30+30 (40 moves in 90 min, then 30 min; 30 sec increment)\n");
+            printf("  TIME G/60d5 (60 min, 5 sec simple delay; b5 = Bronstein delay)\n");
+            printf("  TIME 60,byo5x30 (60 min, then five 30 sec byoyomi periods)\n");
+            printf("  TIME 40/120+0 (40 moves in 120 min, repeating; bare 40/120 is 40 min + 120 sec)\n");
             printf("  TIME 0/0 (disable time controls)\n");
             }
         }
@@ -2302,7 +2543,8 @@ bool handle_game_commands(const char *input, ChessGame *game, StockfishEngine *e
     }
 
     if (strcmp(input, "fen") == 0 || strcmp(input, "FEN") == 0) {
-        char *fen = board_to_fen(game);
+        char fen[FEN_BUFFER_SIZE];
+        fen_write(game, fen, sizeof(fen));
         printf("\nCurrent FEN: %s\n", fen);
         printf("Press Enter to continue...");
         getchar();
@@ -2313,7 +2555,7 @@ bool handle_game_commands(const char *input, ChessGame *game, StockfishEngine *e
         printf("\nGenerating current game PGN notation...");
         fflush(stdout);
 
-        char* pgn_content = convert_fen_to_pgn_string(g_session.fen_log_filename, "*");
+        char* pgn_content = generate_current_pgn("*");
         if (pgn_content) {
             if (display_pgn_in_new_window(pgn_content)) {
                 printf("Close the PGN window when you're done viewing.\n");
@@ -2337,11 +2579,32 @@ bool handle_game_commands(const char *input, ChessGame *game, StockfishEngine *e
     }
 
     if (strcmp(input, "score") == 0 || strcmp(input, "SCORE") == 0) {
+        // Covered endgames have an exact result; no engine needed
+        TbResult tb_result;
+        if (tablebase_probe(game, &tb_result)) {
+            print_tablebase_result(game, tb_result);
+            printf("Press Enter to continue...");
+            getchar();
+            return true;
+        }
+
         printf("\nGetting evaluation from Stockfish...");
         fflush(stdout);
 
+        // Positions revisited through undo/redo/variations reuse their cached evaluation.
+        // The engine scores for the side to move; the cache and the scale use White's view
         int centipawn_score;
-        if (get_position_evaluation(engine, game, &centipawn_score)) {
+        const HistoryNode *node = history_current(&g_session.history);
+        bool evaluated = node && node->has_eval;
+        if (evaluated) {
+            centipawn_score = node->eval;
+        } else if (get_position_evaluation(engine, game, &centipawn_score)) {
+            if (game->current_player == BLACK) centipawn_score = -centipawn_score;
+            history_set_eval(&g_session.history, centipawn_score);
+            evaluated = true;
+        }
+
+        if (evaluated) {
             int scale_score = centipawns_to_scale(centipawn_score);
             printf("\nCurrent Game Evaluation (Stockfish depth 15):\n");
             if (g_session.runtime.debug_mode) {
@@ -2358,6 +2621,25 @@ bool handle_game_commands(const char *input, ChessGame *game, StockfishEngine *e
         return true;
     }
 
+    if (strcmp(input, "stats") == 0 || strcmp(input, "STATS") == 0) {
+        clear_screen();
+        printf("=== Timing Statistics ===\n\n");
+        profile_print(stdout);
+        printf("\nengine_move is the whole AI move; engine_send is the part spent writing to Stockfish.\n");
+        printf("Type 'stats reset' to start counting again.\n");
+        printf("\nPress Enter to continue...");
+        getchar();
+        return true;
+    }
+
+    if (strcmp(input, "stats reset") == 0 || strcmp(input, "STATS RESET") == 0) {
+        profile_reset();
+        printf("\nTiming statistics reset.\n");
+        printf("Press Enter to continue...");
+        getchar();
+        return true;
+    }
+
     if (strcmp(input, "title") == 0 || strcmp(input, "TITLE") == 0) {
         clear_screen();
 
@@ -2410,53 +2692,79 @@ bool handle_game_commands(const char *input, ChessGame *game, StockfishEngine *e
         return true;
     }
 
+    if (strcmp(input, "book") == 0 || strcmp(input, "BOOK") == 0) {
+        BookMove moves[BOOK_MAX_MOVES];
+        int count = book_probe(&g_session.book, game, moves, BOOK_MAX_MOVES);
+
+        if (g_session.book.fd < 0) {
+            printf("\nNo opening book loaded (OpeningBook in CHESS.ini, build one with make_book).\n");
+        } else if (count == 0) {
+            printf("\nThis position is not in the opening book.\n");
+        } else {
+            uint32_t total = 0;
+            for (int i = 0; i < count; i++) total += moves[i].weight;
+            printf("\nOpening book moves:\n");
+            for (int i = 0; i < count; i++) {
+                char san[SAN_BUFFER_SIZE];
+                san_format_move(game, moves[i].move, san, sizeof(san));
+                printf("  %-8s %5.1f%%\n", san, 100.0 * moves[i].weight / total);
+            }
+        }
+        printf("Press Enter to continue...");
+        getchar();
+        return true;
+    }
+
+    if (strcmp(input, "explore") == 0 || strcmp(input, "EXPLORE") == 0) {
+        handle_explore_command(game);
+        return true;
+    }
+
+    if (strcmp(input, "find") == 0 || strcmp(input, "FIND") == 0) {
+        handle_find_command(game);
+        return true;
+    }
+
     if (strcmp(input, "undo") == 0 || strcmp(input, "UNDO") == 0) {
-        int available_undos = count_available_undos();
+        // Each undo reverts a move pair (White's move + AI response)
+        int plies_played = history_ply_count(&g_session.history);
+        int available_undos = (plies_played >= 2) ? plies_played / 2 : 0;
 
         if (available_undos > 0) {
+            int undo_count = 1;
             if (available_undos > 1) {
                 printf("\nYou can undo up to %d move pairs. How many would you like to undo? (1-%d): ",
                        available_undos, available_undos);
                 fflush(stdout);
 
                 char undo_input[10];
-                if (fgets(undo_input, sizeof(undo_input), stdin)) {
-                    int undo_count = atoi(undo_input);
-                    if (undo_count >= 1 && undo_count <= available_undos) {
-                        truncate_fen_log_by_moves(undo_count);
-                        if (restore_from_fen_log(game)) {
-                            if (is_time_control_enabled(game)) {
-                                game->time_control.enabled = false;
-                                game->timer.timing_active = false;
-                                printf("\n%d move pair%s undone! Restored to previous position.\n",
-                                       undo_count, undo_count > 1 ? "s" : "");
-                                printf("Time controls have been disabled for the remainder of this game.\n");
-                            } else {
-                                printf("\n%d move pair%s undone! Restored to previous position.\n",
-                                       undo_count, undo_count > 1 ? "s" : "");
-                            }
-                        } else {
-                            printf("\nError restoring game state from FEN log.\n");
-                        }
-                    } else {
+                if (!fgets(undo_input, sizeof(undo_input), stdin)) {
+                    printf("\nFailed to read undo count.\n");
+                    undo_count = 0;
+                } else {
+                    undo_count = atoi(undo_input);
+                    if (undo_count < 1 || undo_count > available_undos) {
                         printf("\nInvalid undo count. Must be between 1 and %d.\n", available_undos);
+                        undo_count = 0;
                     }
-                } else {
-                    printf("\nFailed to read undo count.\n");
                 }
-            } else {
-                truncate_fen_log_by_moves(1);
-                if (restore_from_fen_log(game)) {
+            }
+
+            if (undo_count > 0) {
+                if (history_undo(&g_session.history, undo_count * 2, game)) {
+                    update_persistent_pgn_file();
+                    if (undo_count > 1) {
+                        printf("\n%d move pairs undone! Restored to previous position.\n", undo_count);
+                    } else {
+                        printf("\nMove pair undone! Restored to previous position.\n");
+                    }
                     if (is_time_control_enabled(game)) {
                         game->time_control.enabled = false;
                         game->timer.timing_active = false;
-                        printf("\nMove pair undone! Restored to previous position.\n");
                         printf("Time controls have been disabled for the remainder of this game.\n");
-                    } else {
-                        printf("\nMove pair undone! Restored to previous position.\n");
                     }
                 } else {
-                    printf("\nError restoring game state from FEN log.\n");
+                    printf("\nError restoring game state from game history.\n");
                 }
             }
         } else {
@@ -2467,6 +2775,98 @@ bool handle_game_commands(const char *input, ChessGame *game, StockfishEngine *e
         return true;
     }
 
+    if (strcmp(input, "redo") == 0 || strcmp(input, "REDO") == 0) {
+        // Redo replays the move pairs most recently undone (or chosen with 'variation')
+        int available_redos = history_redo_count(&g_session.history) / 2;
+
+        if (available_redos > 0) {
+            int redo_count = 1;
+            if (available_redos > 1) {
+                printf("\nYou can redo up to %d move pairs. How many would you like to redo? (1-%d): ",
+                       available_redos, available_redos);
+                fflush(stdout);
+
+                char redo_input[10];
+                if (!fgets(redo_input, sizeof(redo_input), stdin)) {
+                    printf("\nFailed to read redo count.\n");
+                    redo_count = 0;
+                } else {
+                    redo_count = atoi(redo_input);
+                    if (redo_count < 1 || redo_count > available_redos) {
+                        printf("\nInvalid redo count. Must be between 1 and %d.\n", available_redos);
+                        redo_count = 0;
+                    }
+                }
+            }
+
+            if (redo_count > 0) {
+                if (history_redo(&g_session.history, redo_count * 2, game)) {
+                    update_persistent_pgn_file();
+                    if (redo_count > 1) {
+                        printf("\n%d move pairs redone!\n", redo_count);
+                    } else {
+                        printf("\nMove pair redone!\n");
+                    }
+                } else {
+                    printf("\nError restoring game state from game history.\n");
+                }
+            }
+        } else {
+            printf("\nNo moves to redo!\n");
+        }
+        printf("Press Enter to continue...");
+        getchar();
+        return true;
+    }
+
+    if (strcmp(input, "variations") == 0 || strcmp(input, "VARIATIONS") == 0) {
+        int variation_count = history_variation_count(&g_session.history);
+        const HistoryNode *current = history_current(&g_session.history);
+
+        if (variation_count == 0 || !current) {
+            printf("\nNo variations have been played from this position.\n");
+        } else {
+            printf("\nMoves already played from this position:\n");
+            for (int i = 0; i < variation_count; i++) {
+                int node = history_variation_node(&g_session.history, i);
+                Move move = cgr_unpack_move(g_session.history.nodes[node].move);
+                printf("  %d. %s", i + 1, position_to_string(move.from));
+                printf("%s%s\n", position_to_string(move.to),
+                       node == current->redo_child ? "   (redo line)" : "");
+            }
+            printf("Type 'variation N' to switch to one of them.\n");
+        }
+        printf("Press Enter to continue...");
+        getchar();
+        return true;
+    }
+
+    if (strncmp(input, "variation ", 10) == 0 || strncmp(input, "VARIATION ", 10) == 0) {
+        int index = atoi(input + 10) - 1;
+        int node = history_variation_node(&g_session.history, index);
+
+        if (node == HISTORY_NO_NODE) {
+            printf("\nNo such variation. Type 'variations' to list them.\n");
+        } else {
+            // Follow the remembered reply too so it is the player's turn again
+            int reply = g_session.history.nodes[node].redo_child;
+            if (history_goto(&g_session.history, reply != HISTORY_NO_NODE ? reply : node, game)) {
+                update_persistent_pgn_file();
+                printf("\nSwitched to variation %d.\n", index + 1);
+                if (is_time_control_enabled(game)) {
+                    game->time_control.enabled = false;
+                    game->timer.timing_active = false;
+                    printf("Time controls have been disabled for the remainder of this game.\n");
+                }
+            } else {
+                printf("\nError restoring game state from game history.\n");
+            }
+        }
+        printf("Press Enter to continue...");
+        getchar();
+        return true;
+    }
+
     if (strcmp(input, "resign") == 0 || strcmp(input, "RESIGN") == 0) {
         printf("\nYou are indicating that you are resigning the game. Are you sure?\n");
         printf("Type 'YES' to resign or 'NO' to cancel: ");
@@ -2495,6 +2895,8 @@ bool handle_game_commands(const char *input, ChessGame *game, StockfishEngine *e
 
             if (g_session.runtime.delete_fen_on_exit) {
                 unlink(g_session.fen_log_filename);
+            } else {
+                save_game_record();
             }
 
             show_game_files();
@@ -2532,7 +2934,14 @@ bool handle_game_commands(const char *input, ChessGame *game, StockfishEngine *e
 
             printf("\nGame will continue from this custom position.\n");
         } else {
-            printf("\nInvalid FEN string! Board setup failed.\n");
+            ChessGame scratch = *game;
+            FenResult result = fen_decode(&scratch, fen_input);
+            if (result.code != FEN_OK) {
+                printf("\nInvalid FEN string: %s (column %d).\n",
+                       fen_error_string(result.code), result.offset + 1);
+            } else {
+                printf("\nInvalid FEN string! Both sides must have a king.\n");
+            }
             printf("Please check FEN format and try again.\n");
         }
 
@@ -2557,43 +2966,35 @@ bool handle_show_possible_moves(const char *input, ChessGame *game) {
     if (is_valid_position(from.row, from.col) && is_piece_at(game, from.row, from.col)) {
         Piece piece = get_piece_at(game, from.row, from.col);
         if (piece.color == WHITE) {
-            Position possible_moves[64];
-            int move_count = 0;
-
-            Position all_moves[64];
-            int all_count = get_possible_moves(game, from, all_moves);
+            BoardHighlights highlights;
+            get_board_highlights(game, &highlights);
+            int move_count = get_move_highlights(game, from, &highlights);
 
-            for (int i = 0; i < all_count; i++) {
-                if (!would_be_in_check_after_move(game, from, all_moves[i])) {
-                    possible_moves[move_count++] = all_moves[i];
-                }
-            }
-
-            clear_screen();
-            printf("\n=== Claude Chess ===\n");
-            printf("Current player: %s\n", game->current_player == WHITE ? "WHITE" : "BLACK");
-
-            printf("\n");
-            print_captured_pieces(&game->black_captured, COLOR_BLACK_PLAYER, "Black", game);
-            print_captured_pieces(&game->white_captured, COLOR_WHITE_PLAYER, "White", game);
+            // Same layout as the game screen, so only the highlights are redrawn
+            screen_begin_frame();
+            print_game_info(game);
 
             if (game->in_check[WHITE]) {
-                printf("\nYour king is in check! You can only make moves that get out of check.\n");
+                screen_printf("\nYour king is in check! You can only make moves that get out of check.\n");
             }
 
-            print_board(game, possible_moves, move_count);
+            print_board(game, &highlights);
 
             if (move_count > 0) {
-                printf("\nPossible moves from %s:\n", position_to_string(from));
-                for (int i = 0; i < move_count; i++) {
-                    printf("%s ", position_to_string(possible_moves[i]));
+                screen_printf("\nPossible moves from %s:\n", position_to_string(from));
+                uint64_t targets = highlights.moves | highlights.captures;
+                for (int square = 0; square < BOARD_SIZE * BOARD_SIZE; square++) {
+                    if (targets & (1ULL << square)) {
+                        screen_printf("%s ", position_to_string((Position){square / BOARD_SIZE, square % BOARD_SIZE}));
+                    }
                 }
-                printf("\n");
+                screen_printf("\n");
             } else {
-                printf("\nNo legal moves available from %s\n", position_to_string(from));
+                screen_printf("\nNo legal moves available from %s\n", position_to_string(from));
             }
 
-            printf("Press Enter to continue...");
+            screen_printf("Press Enter to continue...");
+            screen_end_frame();
             getchar();
             return true;
         }
@@ -2624,11 +3025,17 @@ void handle_move_execution(const char *input, ChessGame *game) {
         return;
     }
 
+    Move move = {0};
+    move.from = from;
+    move.to = to;
+    move.is_promotion = is_promotion_move(game, from, to);
+
     if (make_move(game, from, to)) {
         g_session.game_started = true;
         stop_move_timer(game);
         printf("Move made: %s to %s                             \n", from_str, to_str);
-        save_fen_log(game);
+        move.promotion_piece = game->board[to.row][to.col].type;
+        save_fen_log(game, move);
         printf("Press Enter to continue...");
         getchar();
         clear_screen();
@@ -2650,12 +3057,14 @@ void handle_move_execution(const char *input, ChessGame *game) {
 void handle_white_turn(ChessGame *game, StockfishEngine *engine) {
     char input[100];
     printf("\nWhite's turn. Enter move (e.g., 'e2 e4') or 'help': ");
-    if (is_time_control_enabled(game)) {
-        printf("\n(Press RETURN to update remaining time)");
-        printf("%s", CURSOR_LINEUP_TOEND);  // Move cursor up one line and forward to end of prompt
-    }
+    fflush(stdout);
 
-    if (!fgets(input, sizeof(input), stdin)) {
+    // The clock counts down on screen while White thinks; a flag-fall
+    // ends the read and the game loop declares the time forfeit
+    clock_ticker_arm(true);
+    char *line = clock_ticker_read_line(input, sizeof(input));
+    clock_ticker_disarm();
+    if (!line) {
         return;
     }
 
@@ -2666,8 +3075,10 @@ void handle_white_turn(ChessGame *game, StockfishEngine *engine) {
         return;
     }
 
-    // Handle all game commands (quit, help, hint, etc.)
+    // Handle all game commands (quit, help, hint, etc.); their output may
+    // scroll the screen, so the next frame is drawn in full
     if (handle_game_commands(input, game, engine)) {
+        screen_invalidate();
         return;
     }
 
@@ -2695,10 +3106,18 @@ void handle_black_turn(ChessGame *game, StockfishEngine *engine) {
     fflush(stdout);
 
 
+    // Tablebase and book moves are played instantly; the engine only searches otherwise
     char move_str[10];
-    if (get_best_move(engine, game, move_str, g_session.runtime.debug_mode)) {
+    bool tablebase_move = pick_tablebase_move(game, move_str);
+    bool book_move = !tablebase_move && book_pick_move(&g_session.book, game, move_str);
+    clock_ticker_arm(false);   // Show Black's clock running while the engine thinks
+    bool have_move = tablebase_move || book_move || get_best_move(engine, game, move_str, g_session.runtime.debug_mode);
+    clock_ticker_disarm();
+    if (have_move) {
+        const char *source_note = tablebase_move ? " (tablebase)" : book_move ? " (book)" : "";
         if (g_session.runtime.debug_mode) {
-            printf("\nDebug: Stockfish returned move: '%s'\n", move_str);
+            printf("\nDebug: %s returned move: '%s'\n",
+                   tablebase_move ? "Tablebase" : book_move ? "Opening book" : "Stockfish", move_str);
         }
         Move ai_move = parse_move_string(move_str);
         if (g_session.runtime.debug_mode) {
@@ -2721,11 +3140,12 @@ void handle_black_turn(ChessGame *game, StockfishEngine *engine) {
 
                 if (ai_move.is_promotion && ai_move.promotion_piece != EMPTY) {
                     char piece_names[][10] = {"", "Pawn", "Rook", "Knight", "Bishop", "Queen", "King"};
-                    printf("\nAI played: %s to %s (promoted to %s)\n", from_str, to_str, piece_names[ai_move.promotion_piece]);
+                    printf("\nAI played: %s to %s (promoted to %s)%s\n", from_str, to_str, piece_names[ai_move.promotion_piece],
+                           source_note);
                 } else {
-                    printf("\nAI played: %s to %s\n", from_str, to_str);
+                    printf("\nAI played: %s to %s%s\n", from_str, to_str, source_note);
                 }
-                save_fen_log(game);  // Save FEN after AI's move
+                save_fen_log(game, ai_move);  // Save FEN after AI's move
                 printf("Press Enter to continue...");
                 getchar();
                 clear_screen();
@@ -2759,6 +3179,9 @@ int main(int argc, char *argv[]) {
     ChessGame game;
     StockfishEngine engine = {0};
 
+    // A write to an engine that has exited must fail, not end the game
+    signal(SIGPIPE, SIG_IGN);
+
     // Initialize game session with default values
     init_game_session();
 
@@ -2772,6 +3195,9 @@ int main(int argc, char *argv[]) {
 
     // Parse command line arguments (case-insensitive)
     // Command line options override configuration settings
+    bool protocol_mode = false;
+    bool protocol_json = false;
+    const char *trace_file = NULL;
     for (int i = 1; i < argc; i++) {
         if (strcasecmp(argv[i], "DEBUG") == 0) {
             g_session.runtime.debug_mode = true;
@@ -2779,18 +3205,64 @@ int main(int argc, char *argv[]) {
             g_session.runtime.suppress_pgn_creation = true;
         } else if (strcasecmp(argv[i], "FENOFF") == 0) {
             g_session.runtime.delete_fen_on_exit = true;
+        } else if (strcasecmp(argv[i], "--PROTOCOL") == 0) {
+            protocol_mode = true;
+        } else if (strcasecmp(argv[i], "--JSON") == 0) {
+            protocol_json = true;
+        } else if (strcasecmp(argv[i], "--TRACE") == 0 && i + 1 < argc) {
+            trace_file = argv[++i];
         } else if (strcasecmp(argv[i], "/HELP") == 0) {
             show_command_line_help();
             exit(0);
         } else {
             printf("Error: Invalid command line option '%s'\n", argv[i]);
-            printf("Valid options: DEBUG, PGNOFF, FENOFF, /HELP (case-insensitive)\n");
-            printf("Usage: chess [DEBUG] [PGNOFF] [FENOFF] [/HELP]\n");
+            printf("Valid options: DEBUG, PGNOFF, FENOFF, --PROTOCOL, --JSON, --TRACE FILE, /HELP (case-insensitive)\n");
+            printf("Usage: chess [DEBUG] [PGNOFF] [FENOFF] [--protocol [--json]] [--trace FILE] [/HELP]\n");
             printf("Use 'chess /help' for detailed information.\n");
             exit(1);
         }
     }
 
+    // Timing counters are always kept in a game (see 'stats'); a trace is
+    // written at exit, including the exit() of quit and resign
+    profile_enable(!protocol_mode);
+    if (trace_file) {
+        if (profile_trace_start(trace_file)) {
+            atexit(write_trace_file);
+        } else {
+            printf("Warning: Cannot start trace for %s\n", trace_file);
+        }
+    }
+
+    // Open the opening book; without one the AI always searches
+    if (g_session.config.book_keys[0] != '\0' && !book_load_keys(g_session.config.book_keys)) {
+        printf("Warning: Cannot read Polyglot keys from %s\n", g_session.config.book_keys);
+    }
+    if (g_session.config.opening_book[0] != '\0') {
+        book_open(&g_session.book, g_session.config.opening_book);
+    }
+    if (g_session.config.tablebase_directory[0] != '\0') {
+        tablebase_init(g_session.config.tablebase_directory);
+    }
+
+    // Headless mode: no screen, prompts or game files; the engine plays at full strength
+    if (protocol_mode) {
+        if (!init_stockfish(&engine)) {
+            init_builtin_engine(&engine);
+            set_search_threads(&engine, g_session.config.search_threads);
+            set_hash_size(&engine, g_session.config.hash_size_mb);
+        }
+        int status = protocol_run(&engine, stdin, stdout, protocol_json ? PROTOCOL_JSON : PROTOCOL_TEXT);
+        close_stockfish(&engine);
+        book_close(&g_session.book);
+        tablebase_free();
+        return status;
+    }
+
+    // Interactive input is unbuffered so the move prompt can poll stdin
+    // together with the clock (clock_ticker_read_line())
+    setvbuf(stdin, NULL, _IONBF, 0);
+
     // Generate FEN log filename for this game session
     generate_fen_filename();
 
@@ -2807,11 +3279,15 @@ int main(int argc, char *argv[]) {
     }
     printf("Initializing Stockfish engine...\n");
     
+    // Without a Stockfish binary the built-in search plays instead
     if (!init_stockfish(&engine)) {
-        printf("Failed to initialize Stockfish engine!\n");
-        printf("Make sure Stockfish is installed and in your PATH.\n");
-        printf("You can install it with: brew install stockfish (macOS) or apt install stockfish (Ubuntu)\n");
-        return 1;
+        printf("Stockfish not found - using the built-in engine.\n");
+        printf("For full strength install it with: brew install stockfish (macOS) or apt install stockfish (Ubuntu)\n");
+        init_builtin_engine(&engine);
+        set_search_threads(&engine, g_session.config.search_threads);
+        if (!set_hash_size(&engine, g_session.config.hash_size_mb)) {
+            printf("Warning: Cannot allocate %d MB hash - using %d MB\n", g_session.config.hash_size_mb, TT_DEFAULT_MB);
+        }
     }
 
     // Apply default skill level from configuration
@@ -2829,24 +3305,18 @@ int main(int argc, char *argv[]) {
             printf("*** DEBUG MODE ENABLED ***\n");
             printf("Configuration loaded: FENDirectory='%s'\n", g_session.config.fen_directory);
             printf("Configuration loaded: PGNDirectory='%s'\n", g_session.config.pgn_directory);
+            printf("Configuration loaded: DatabaseDirectory='%s'\n", g_session.config.database_directory);
+            printf("Configuration loaded: PositionIndex='%s'\n", g_session.config.position_index_file);
+            printf("Configuration loaded: OpeningBook='%s' (%s)\n", g_session.config.opening_book,
+                   g_session.book.fd >= 0 ? "loaded" : "not available");
+            printf("Configuration loaded: TablebaseDirectory='%s' (%d-piece tables)\n",
+                   g_session.config.tablebase_directory, tablebase_max_pieces());
             printf("Configuration loaded: DefaultSkillLevel=%d\n", g_session.config.default_skill_level);
+            printf("Configuration loaded: HashSizeMB=%d\n", g_session.config.hash_size_mb);
+            printf("Configuration loaded: SearchThreads=%d\n", g_session.config.search_threads);
             printf("Configuration loaded: AutoCreatePGN=%s\n", g_session.config.auto_create_pgn ? "true" : "false");
             printf("Configuration loaded: AutoDeleteFEN=%s\n", g_session.config.auto_delete_fen ? "true" : "false");
-            printf("Configuration loaded: DefaultTimeControl='%s'", g_session.config.default_time_control);
-            if (strcmp(g_session.config.default_time_control, "0/0") == 0) {
-                printf(" (time controls disabled)\n");
-            } else {
-                // Check if it's 2-value (same for both) or 4-value (different for each)
-                int count = 0;
-                for (int i = 0; g_session.config.default_time_control[i]; i++) {
-                    if (g_session.config.default_time_control[i] == '/') count++;
-                }
-                if (count == 1) {
-                    printf(" (both players get same time allocation)\n");
-                } else {
-                    printf(" (White gets first pair, Black gets second pair)\n");
-                }
-            }
+            print_default_time_control();
             printf("Active flags: suppress_pgn_creation=%s, delete_fen_on_exit=%s\n",
                    g_session.runtime.suppress_pgn_creation ? "true" : "false", g_session.runtime.delete_fen_on_exit ? "true" : "false");
 
@@ -2858,30 +3328,24 @@ int main(int argc, char *argv[]) {
                 printf("WARNING: Invalid DefaultSkillLevel in CHESS.ini - using default 5\n");
             }
         }
-        printf("Stockfish initialized successfully!\n");
+        printf("%s initialized successfully!\n", engine.builtin ? "Built-in engine" : "Stockfish");
     } else {
         if (g_session.runtime.debug_mode) {
             printf("*** DEBUG MODE ENABLED ***\n");
             printf("Configuration loaded: FENDirectory='%s'\n", g_session.config.fen_directory);
             printf("Configuration loaded: PGNDirectory='%s'\n", g_session.config.pgn_directory);
+            printf("Configuration loaded: DatabaseDirectory='%s'\n", g_session.config.database_directory);
+            printf("Configuration loaded: PositionIndex='%s'\n", g_session.config.position_index_file);
+            printf("Configuration loaded: OpeningBook='%s' (%s)\n", g_session.config.opening_book,
+                   g_session.book.fd >= 0 ? "loaded" : "not available");
+            printf("Configuration loaded: TablebaseDirectory='%s' (%d-piece tables)\n",
+                   g_session.config.tablebase_directory, tablebase_max_pieces());
             printf("Configuration loaded: DefaultSkillLevel=%d\n", g_session.config.default_skill_level);
+            printf("Configuration loaded: HashSizeMB=%d\n", g_session.config.hash_size_mb);
+            printf("Configuration loaded: SearchThreads=%d\n", g_session.config.search_threads);
             printf("Configuration loaded: AutoCreatePGN=%s\n", g_session.config.auto_create_pgn ? "true" : "false");
             printf("Configuration loaded: AutoDeleteFEN=%s\n", g_session.config.auto_delete_fen ? "true" : "false");
-            printf("Configuration loaded: DefaultTimeControl='%s'", g_session.config.default_time_control);
-            if (strcmp(g_session.config.default_time_control, "0/0") == 0) {
-                printf(" (time controls disabled)\n");
-            } else {
-                // Check if it's 2-value (same for both) or 4-value (different for each)
-                int count = 0;
-                for (int i = 0; g_session.config.default_time_control[i]; i++) {
-                    if (g_session.config.default_time_control[i] == '/') count++;
-                }
-                if (count == 1) {
-                    printf(" (both players get same time allocation)\n");
-                } else {
-                    printf(" (White gets first pair, Black gets second pair)\n");
-                }
-            }
+            print_default_time_control();
             printf("Active flags: suppress_pgn_creation=%s, delete_fen_on_exit=%s\n",
                    g_session.runtime.suppress_pgn_creation ? "true" : "false", g_session.runtime.delete_fen_on_exit ? "true" : "false");
 
@@ -2893,7 +3357,7 @@ int main(int argc, char *argv[]) {
                 printf("WARNING: Invalid DefaultSkillLevel in CHESS.ini - using default 5\n");
             }
         }
-        printf("Stockfish initialized successfully!\n");
+        printf("%s initialized successfully!\n", engine.builtin ? "Built-in engine" : "Stockfish");
     }
     
     printf("\nPress Enter to continue...");
@@ -2910,16 +3374,25 @@ int main(int argc, char *argv[]) {
         init_game_timer(&game, &default_time_control);
     }
 
-    // Log initial board position to FEN file
-    save_fen_log(&game);
+    // Start game history and log initial board position to FEN file
+    history_reset(&g_session.history, &game, g_session.fen_log_filename);
+
+    // Live clock display and flag-fall detection (idle without time controls)
+    clock_ticker_start(&game);
     
     while (true) {
-        clear_screen();
+        // Debug output may scroll the screen, so repaint in full
+        if (g_session.runtime.debug_mode) screen_invalidate();
+        screen_begin_frame();
         print_game_info(&game);
+
+        BoardHighlights highlights;
+        get_board_highlights(&game, &highlights);
         
         // Check for time forfeit before other game ending conditions
         if (check_time_forfeit(&game)) {
-            print_board(&game, NULL, 0);
+            print_board(&game, &highlights);
+            screen_end_frame();
             Color winner = (game.current_player == WHITE) ? BLACK : WHITE;
             printf("\n*** TIME FORFEIT! %s WINS! ***\n", winner == WHITE ? "WHITE" : "BLACK");
             printf("%s ran out of time.\n", game.current_player == WHITE ? "White" : "Black");
@@ -2936,6 +3409,8 @@ int main(int argc, char *argv[]) {
             // Delete FEN file if requested by FENOFF (after PGN creation)
             if (g_session.runtime.delete_fen_on_exit) {
                 unlink(g_session.fen_log_filename);
+            } else {
+                save_game_record();
             }
 
             show_game_files();
@@ -2946,7 +3421,8 @@ int main(int argc, char *argv[]) {
 
         // Check for game ending conditions
         if (is_checkmate(&game, game.current_player)) {
-            print_board(&game, NULL, 0);
+            print_board(&game, &highlights);
+            screen_end_frame();
             Color winner = (game.current_player == WHITE) ? BLACK : WHITE;
             printf("\n*** CHECKMATE! %s WINS! ***\n", winner == WHITE ? "WHITE" : "BLACK");
 
@@ -2962,6 +3438,8 @@ int main(int argc, char *argv[]) {
             // Delete FEN file if requested by FENOFF (after PGN creation)
             if (g_session.runtime.delete_fen_on_exit) {
                 unlink(g_session.fen_log_filename);
+            } else {
+                save_game_record();
             }
 
             show_game_files();
@@ -2971,7 +3449,8 @@ int main(int argc, char *argv[]) {
         }
         
         if (is_stalemate(&game, game.current_player)) {
-            print_board(&game, NULL, 0);
+            print_board(&game, &highlights);
+            screen_end_frame();
             printf("\n*** STALEMATE! IT'S A DRAW! ***\n");
 
             // Clean up persistent PGN file and handle file creation/deletion based on flags
@@ -2986,6 +3465,8 @@ int main(int argc, char *argv[]) {
             // Delete FEN file if requested by FENOFF (after PGN creation)
             if (g_session.runtime.delete_fen_on_exit) {
                 unlink(g_session.fen_log_filename);
+            } else {
+                save_game_record();
             }
 
             show_game_files();
@@ -2995,7 +3476,8 @@ int main(int argc, char *argv[]) {
         }
         
         if (is_fifty_move_rule_draw(&game)) {
-            print_board(&game, NULL, 0);
+            print_board(&game, &highlights);
+            screen_end_frame();
             printf("\n*** 50-MOVE RULE DRAW! ***\n");
             printf("50 moves have passed without a pawn move or capture.\n");
 
@@ -3011,6 +3493,8 @@ int main(int argc, char *argv[]) {
             // Delete FEN file if requested by FENOFF (after PGN creation)
             if (g_session.runtime.delete_fen_on_exit) {
                 unlink(g_session.fen_log_filename);
+            } else {
+                save_game_record();
             }
 
             show_game_files();
@@ -3019,7 +3503,8 @@ int main(int argc, char *argv[]) {
             break;
         }
         
-        print_board(&game, NULL, 0);
+        print_board(&game, &highlights);
+        screen_end_frame();
 
         // Start timer for current player's turn (safe - won't restart if already active)
         start_move_timer(&game);
@@ -3031,7 +3516,10 @@ int main(int argc, char *argv[]) {
         }
     }
     
+    clock_ticker_stop();
     close_stockfish(&engine);
+    book_close(&g_session.book);
+    tablebase_free();
     printf("Thanks for playing!\n");
     
     return 0;
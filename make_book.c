@@ -0,0 +1,164 @@
+/**
+ * MAKE_BOOK.C - Opening Book Builder and Probe Utility
+ *
+ * Compiles Polyglot .bin opening books from PGN collections, FEN logs and
+ * .cgr records, and lists the book moves for a position.
+ *
+ * Usage: ./make_book book.bin INPUT... [--plies N] [--keys FILE]
+ *        ./make_book --probe book.bin "FEN" [--keys FILE]
+ *
+ * INPUT may be a .pgn, .fen or .cgr file or a directory of them, e.g.
+ *        ./make_book book.bin FEN_FILES games.pgn
+ *
+ * Features:
+ * - Moves weighted by results: 2 per win, 1 per draw or unknown result
+ * - Only the first N plies of each game are used (default 20)
+ * - --keys replaces the standard Polyglot key table (non-standard books only)
+ */
+
+#define _GNU_SOURCE        // Required for Linux (strdup)
+
+#include "chess.h"
+#include "book.h"
+#include "san.h"
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/**
+ * Check whether a filename ends with the given extension (including dot)
+ */
+static bool has_extension(const char* filename, const char* extension) {
+    size_t name_len = strlen(filename);
+    size_t ext_len = strlen(extension);
+    return name_len > ext_len && strcmp(filename + name_len - ext_len, extension) == 0;
+}
+
+/**
+ * Add one input file to the builder and report it
+ */
+static void add_input_file(BookBuilder* builder, const char* path) {
+    int games = book_builder_add_file(builder, path);
+    if (games < 0) {
+        fprintf(stderr, "Warning: Cannot read %s\n", path);
+    } else {
+        printf("  %s: %d game%s\n", path, games, games == 1 ? "" : "s");
+    }
+}
+
+/**
+ * Add an input path: a game file or every game file in a directory
+ */
+static void add_input(BookBuilder* builder, const char* path) {
+    struct stat path_stat;
+    if (stat(path, &path_stat) != 0) {
+        fprintf(stderr, "Warning: Cannot access %s\n", path);
+        return;
+    }
+    if (!S_ISDIR(path_stat.st_mode)) {
+        add_input_file(builder, path);
+        return;
+    }
+
+    DIR* dir = opendir(path);
+    if (!dir) return;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (!has_extension(entry->d_name, ".pgn") && !has_extension(entry->d_name, ".fen") &&
+            !has_extension(entry->d_name, ".cgr")) {
+            continue;
+        }
+        char file_path[1024];
+        snprintf(file_path, sizeof(file_path), "%s/%s", path, entry->d_name);
+        add_input_file(builder, file_path);
+    }
+    closedir(dir);
+}
+
+/**
+ * Print the book moves for a position as SAN with weights
+ */
+static int probe_book(const char* book_path, const char* fen) {
+    ChessGame game;
+    memset(&game, 0, sizeof(game));
+    FenResult result = fen_decode(&game, fen);
+    if (result.code != FEN_OK) {
+        fprintf(stderr, "Error: Invalid FEN at column %d: %s\n", result.offset + 1, fen_error_string(result.code));
+        return 1;
+    }
+
+    Book book;
+    if (!book_open(&book, book_path)) {
+        fprintf(stderr, "Error: Cannot open book %s\n", book_path);
+        return 1;
+    }
+
+    BookMove moves[BOOK_MAX_MOVES];
+    int count = book_probe(&book, &game, moves, BOOK_MAX_MOVES);
+    book_close(&book);
+
+    if (count == 0) {
+        printf("Position not in book\n");
+        return 0;
+    }
+
+    uint32_t total = 0;
+    for (int i = 0; i < count; i++) total += moves[i].weight;
+    for (int i = 0; i < count; i++) {
+        char san[SAN_BUFFER_SIZE];
+        san_format_move(&game, moves[i].move, san, sizeof(san));
+        printf("%-8s weight %5u (%5.1f%%)\n", san, moves[i].weight, 100.0 * moves[i].weight / total);
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    int plies = BOOK_DEFAULT_PLIES;
+    const char* inputs[256];
+    int input_count = 0;
+    bool probe = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--plies") == 0 && i + 1 < argc) {
+            plies = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--keys") == 0 && i + 1 < argc) {
+            if (!book_load_keys(argv[++i])) {
+                fprintf(stderr, "Error: %s does not hold %d Polyglot keys\n", argv[i], BOOK_KEY_COUNT);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--probe") == 0) {
+            probe = true;
+        } else if (input_count < 256) {
+            inputs[input_count++] = argv[i];
+        }
+    }
+
+    if (probe && input_count == 2) {
+        return probe_book(inputs[0], inputs[1]);
+    }
+    if (probe || input_count < 2) {
+        fprintf(stderr, "Usage: %s book.bin INPUT... [--plies N] [--keys FILE]\n", argv[0]);
+        fprintf(stderr, "       %s --probe book.bin \"FEN\" [--keys FILE]\n", argv[0]);
+        return 1;
+    }
+
+    BookBuilder builder;
+    book_builder_init(&builder, plies);
+    printf("Reading games (first %d plies of each):\n", builder.max_plies);
+    for (int i = 1; i < input_count; i++) {
+        add_input(&builder, inputs[i]);
+    }
+
+    int64_t written = book_builder_write(&builder, inputs[0]);
+    int games = builder.games;
+    book_builder_free(&builder);
+
+    if (written < 0) {
+        fprintf(stderr, "Error: Cannot write %s\n", inputs[0]);
+        return 1;
+    }
+    printf("Wrote %lld entries from %d games to %s\n", (long long)written, games, inputs[0]);
+    return 0;
+}
@@ -0,0 +1,121 @@
+/**
+ * MAKE_EXPLORER.C - Opening Explorer Statistics Builder
+ *
+ * Streams PGN collections into the opening explorer statistics file used
+ * by the in-game EXPLORE command, and prints the statistics for a position.
+ *
+ * Usage: ./make_explorer explorer.cxp games.pgn... [--plies N] [--memory MB]
+ *        ./make_explorer --show explorer.cxp "FEN"
+ *
+ * Features:
+ * - Per position: each continuation's games, White wins, draws, Black wins
+ * - Average eval after each move from "[%eval]" comments when present
+ * - Bounded memory: sorted runs are spilled to disk and merged
+ */
+
+#include "chess.h"
+#include "explorer.h"
+#include "san.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define EXPLORER_MAX_LISTED 40   // Moves printed by --show
+
+/**
+ * Print the statistics of a position
+ */
+static int show_position(const char* path, const char* fen) {
+    ChessGame game;
+    memset(&game, 0, sizeof(game));
+    FenResult result = fen_decode(&game, fen);
+    if (result.code != FEN_OK) {
+        fprintf(stderr, "Error: Invalid FEN at column %d: %s\n", result.offset + 1, fen_error_string(result.code));
+        return 1;
+    }
+
+    ExplorerRecord records[EXPLORER_MAX_LISTED];
+    int count = explorer_lookup(path, position_hash(&game), records, EXPLORER_MAX_LISTED);
+    if (count < 0) {
+        fprintf(stderr, "Error: Cannot read %s\n", path);
+        return 1;
+    }
+    if (count == 0) {
+        printf("Position not found\n");
+        return 0;
+    }
+
+    printf("Move      Games  White  Draw  Black   Eval\n");
+    for (int i = 0; i < count; i++) {
+        char san[SAN_BUFFER_SIZE];
+        if (san_format_move(&game, cgr_unpack_move(records[i].move), san, sizeof(san)) == 0) continue;
+
+        double games = records[i].games;
+        printf("%-8s %6u %5.1f%% %4.1f%% %5.1f%%", san, records[i].games, 100.0 * records[i].white_wins / games,
+               100.0 * records[i].draws / games, 100.0 * records[i].black_wins / games);
+        if (records[i].eval_count > 0) {
+            printf(" %+6.2f\n", (double)records[i].eval_sum / records[i].eval_count / 100.0);
+        } else {
+            printf("      -\n");
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    int plies = EXPLORER_DEFAULT_PLIES;
+    size_t memory_mb = EXPLORER_DEFAULT_MEMORY_MB;
+    const char* inputs[256];
+    int input_count = 0;
+    bool show = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--plies") == 0 && i + 1 < argc) {
+            plies = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--memory") == 0 && i + 1 < argc) {
+            memory_mb = (size_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--show") == 0) {
+            show = true;
+        } else if (input_count < 256) {
+            inputs[input_count++] = argv[i];
+        }
+    }
+
+    if (show && input_count == 2) {
+        return show_position(inputs[0], inputs[1]);
+    }
+    if (show || input_count < 2 || memory_mb == 0) {
+        fprintf(stderr, "Usage: %s explorer.cxp games.pgn... [--plies N] [--memory MB]\n", argv[0]);
+        fprintf(stderr, "       %s --show explorer.cxp \"FEN\"\n", argv[0]);
+        return 1;
+    }
+
+    ExplorerBuilder builder;
+    if (!explorer_builder_init(&builder, inputs[0], memory_mb * 1024 * 1024, plies)) {
+        fprintf(stderr, "Error: Cannot allocate %zu MB\n", memory_mb);
+        return 1;
+    }
+
+    for (int i = 1; i < input_count; i++) {
+        int games = explorer_builder_add_pgn(&builder, inputs[i]);
+        if (games < 0) {
+            fprintf(stderr, "Error: Cannot read %s or write run files\n", inputs[i]);
+            explorer_builder_free(&builder);
+            return 1;
+        }
+        printf("  %s: %d game%s\n", inputs[i], games, games == 1 ? "" : "s");
+    }
+
+    int runs = builder.next_run + (builder.count > 0);
+    uint64_t games = builder.games;
+    int64_t records = explorer_builder_finish(&builder);
+    explorer_builder_free(&builder);
+
+    if (records < 0) {
+        fprintf(stderr, "Error: Cannot write %s\n", inputs[0]);
+        return 1;
+    }
+    printf("Wrote %lld moves from %llu games (%d sorted run%s) to %s\n", (long long)records,
+           (unsigned long long)games, runs, runs == 1 ? "" : "s", inputs[0]);
+    return 0;
+}
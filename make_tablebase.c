@@ -0,0 +1,81 @@
+/**
+ * MAKE_TABLEBASE.C - Endgame Tablebase Generator
+ *
+ * Generates the three-piece endgame tables used for exact endgame scores
+ * and moves, and probes a position against them.
+ *
+ * Usage: ./make_tablebase DIRECTORY
+ *        ./make_tablebase --probe DIRECTORY "FEN"
+ *
+ * Features:
+ * - Builds KQvK, KRvK and KPvK by retrograde analysis (a few seconds)
+ * - Prints each table's longest mate
+ * - --probe shows the result, the distance to mate and the best move
+ */
+
+#include "chess.h"
+#include "san.h"
+#include "tablebase.h"
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Print the tablebase result and best move of a position
+ */
+static int probe_position(const char* directory, const char* fen) {
+    if (tablebase_init(directory) == 0) {
+        fprintf(stderr, "Error: No tables in %s\n", directory);
+        return 1;
+    }
+
+    ChessGame game;
+    memset(&game, 0, sizeof(game));
+    FenResult result = fen_decode(&game, fen);
+    if (result.code != FEN_OK) {
+        fprintf(stderr, "Error: Invalid FEN at column %d: %s\n", result.offset + 1, fen_error_string(result.code));
+        tablebase_free();
+        return 1;
+    }
+
+    Move move;
+    TbResult tb;
+    if (!tablebase_probe(&game, &tb)) {
+        printf("Position not covered\n");
+    } else if (tb.wdl == TB_DRAW) {
+        printf("Draw\n");
+    } else {
+        printf("%s in %d pl%s\n", tb.wdl == TB_WIN ? "Side to move mates" : "Side to move is mated", tb.distance,
+               tb.distance == 1 ? "y" : "ies");
+    }
+
+    char san[SAN_BUFFER_SIZE];
+    if (tablebase_best_move(&game, &move, &tb) && san_format_move(&game, move, san, sizeof(san)) > 0) {
+        printf("Best move: %s\n", san);
+    }
+    tablebase_free();
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc == 4 && strcmp(argv[1], "--probe") == 0) {
+        return probe_position(argv[2], argv[3]);
+    }
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s DIRECTORY\n", argv[0]);
+        fprintf(stderr, "       %s --probe DIRECTORY \"FEN\"\n", argv[0]);
+        return 1;
+    }
+
+    const PieceType pieces[] = {QUEEN, ROOK, PAWN};
+    const char* names[] = {"KQvK", "KRvK", "KPvK"};
+    for (int i = 0; i < 3; i++) {
+        if (!tablebase_generate(pieces[i], argv[1])) {
+            fprintf(stderr, "Error: Cannot generate %s in %s\n", names[i], argv[1]);
+            tablebase_free();
+            return 1;
+        }
+        printf("  %s.ctb written\n", names[i]);
+    }
+    tablebase_free();
+    return 0;
+}
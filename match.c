@@ -0,0 +1,383 @@
+/**
+ * MATCH.C - Engine-vs-Engine Match Runner
+ *
+ * Plays a series of games between two engine configurations and reports
+ * the score, an Elo estimate and optionally an SPRT decision. Used to tune
+ * the DefaultSkillLevel presets and to regression-test engine changes.
+ *
+ * Usage: ./match ENGINE1 ENGINE2 [--games N] [--openings PATH]
+ *                [--movetime MS] [--depth N] [--maxplies N]
+ *                [--concurrency N] [--pgn FILE]
+ *                [--sprt ELO0 ELO1 [ALPHA BETA]]
+ *
+ * ENGINE is builtin[:skill=N,threads=N] or
+ *           stockfish[:skill=N,threads=N,hash=MB,nnue=FILE], e.g.
+ *        ./match builtin:skill=20 builtin:skill=10 --games 100 --openings FEN_FILES
+ *
+ * Features:
+ * - Openings from .fen logs (the last position of each file, so the
+ *   FEN_FILES demonstrations work as-is); each opening is played twice
+ *   with colors reversed
+ * - Games run in parallel, one pair of engines per worker (default: one
+ *   worker per processor)
+ * - Adjudication by the rules code (selfplay.h); every game is written as
+ *   PGN with its termination
+ * - With --sprt the match stops as soon as the test accepts a hypothesis
+ */
+
+#define _GNU_SOURCE        // Required for Linux (sysconf)
+
+#include "chess.h"
+#include "pgn_utils.h"
+#include "selfplay.h"
+#include <dirent.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define MATCH_MAX_OPENINGS 1024   // Start positions read from --openings
+#define MATCH_MAX_WORKERS 64      // Games played at the same time
+
+/**
+ * Opening - One start position
+ */
+typedef struct {
+    char name[64];                // File name without extension
+    ChessGame game;
+} Opening;
+
+/**
+ * Match - Shared state of a running match
+ */
+typedef struct {
+    EngineSpec specs[2];
+    SelfPlayLimits limits;
+    Opening *openings;
+    int opening_count;
+    int games;                    // Games to play
+    bool use_sprt;
+    SprtParams sprt;
+
+    pthread_mutex_t lock;         // Guards everything below
+    int next_game;                // Next game index to hand out
+    int finished;                 // Games completed
+    bool stopped;                 // SPRT decided: hand out no more games
+    MatchScore score;             // First engine's results
+    FILE *pgn;                    // PGN output (NULL = none)
+} Match;
+
+/**
+ * Worker - One thread and its two engines
+ */
+typedef struct {
+    Match *match;
+    StockfishEngine engines[2];   // Same order as Match.specs
+    pthread_t thread;
+} Worker;
+
+/******************************************************************************
+ *                                 OPENINGS
+ ******************************************************************************/
+
+/**
+ * Check whether a filename ends with the given extension (including dot)
+ */
+static bool has_extension(const char* filename, const char* extension) {
+    size_t name_len = strlen(filename);
+    size_t ext_len = strlen(extension);
+    return name_len > ext_len && strcmp(filename + name_len - ext_len, extension) == 0;
+}
+
+/**
+ * Add the last position of a FEN log as an opening
+ */
+static bool add_opening_file(Match *match, const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) return false;
+
+    char line[256], last[256] = "";
+    while (fgets(line, sizeof(line), file)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] != '\0') snprintf(last, sizeof(last), "%s", line);
+    }
+    fclose(file);
+
+    if (match->opening_count == MATCH_MAX_OPENINGS) return false;
+    Opening *opening = &match->openings[match->opening_count];
+    memset(&opening->game, 0, sizeof(opening->game));
+    if (last[0] == '\0' || !setup_board_from_fen(&opening->game, last)) return false;
+
+    const char *base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+    snprintf(opening->name, sizeof(opening->name), "%.*s", (int)(strlen(base) - 4), base);
+    match->opening_count++;
+    return true;
+}
+
+/**
+ * Order openings by name so matches are reproducible
+ */
+static int compare_openings(const void *a, const void *b) {
+    return strcmp(((const Opening *)a)->name, ((const Opening *)b)->name);
+}
+
+/**
+ * Read openings from a .fen file or every .fen file in a directory
+ */
+static void add_openings(Match *match, const char *path) {
+    struct stat path_stat;
+    if (stat(path, &path_stat) != 0) {
+        fprintf(stderr, "Warning: Cannot access %s\n", path);
+        return;
+    }
+    if (!S_ISDIR(path_stat.st_mode)) {
+        if (!add_opening_file(match, path)) fprintf(stderr, "Warning: No position in %s\n", path);
+        return;
+    }
+
+    DIR* dir = opendir(path);
+    if (!dir) return;
+    struct dirent* entry;
+    int first = match->opening_count;
+    while ((entry = readdir(dir)) != NULL) {
+        if (!has_extension(entry->d_name, ".fen")) continue;
+        char file_path[1024];
+        snprintf(file_path, sizeof(file_path), "%s/%s", path, entry->d_name);
+        if (!add_opening_file(match, file_path)) fprintf(stderr, "Warning: No position in %s\n", file_path);
+    }
+    closedir(dir);
+    qsort(match->openings + first, (size_t)(match->opening_count - first), sizeof(Opening), compare_openings);
+}
+
+/******************************************************************************
+ *                                  GAMES
+ ******************************************************************************/
+
+/**
+ * Append one game to the PGN output
+ */
+static void write_pgn_game(Match *match, int index, const Opening *opening, bool first_white, const SelfPlayGame *game) {
+    char *movetext = pgn_format_movetext(&game->record, game->result);
+    if (!movetext) return;
+
+    char date[20];
+    time_t now = time(NULL);
+    strftime(date, sizeof(date), "%Y.%m.%d", localtime(&now));
+    char fen[FEN_BUFFER_SIZE];
+    fen_write(&opening->game, fen, sizeof(fen));
+
+    FILE *out = match->pgn;
+    fprintf(out, "[Event \"Engine match\"]\n[Site \"Claude Chess\"]\n[Date \"%s\"]\n[Round \"%d\"]\n", date, index + 1);
+    fprintf(out, "[White \"%s\"]\n[Black \"%s\"]\n[Result \"%s\"]\n", match->specs[first_white ? 0 : 1].name,
+            match->specs[first_white ? 1 : 0].name, game->result);
+    if (!pgn_is_standard_start(fen) || opening->game.current_player != WHITE) {
+        fprintf(out, "[SetUp \"1\"]\n[FEN \"%s\"]\n", fen);
+    }
+    fprintf(out, "[Opening \"%s\"]\n[Termination \"%s\"]\n\n", opening->name, game->termination);
+    size_t length = strlen(movetext);
+    fprintf(out, "%s%s\n", movetext, length > 0 && movetext[length - 1] == '\n' ? "" : "\n");
+    fflush(out);
+    free(movetext);
+}
+
+/**
+ * Record a finished game: score, progress line, PGN, SPRT check
+ */
+static void finish_game(Match *match, int index, const Opening *opening, bool first_white, const SelfPlayGame *game) {
+    pthread_mutex_lock(&match->lock);
+    match_score_add(&match->score, game->result, first_white);
+    match->finished++;
+
+    double margin;
+    double elo = match_elo(&match->score, &margin);
+    printf("Game %d/%d %s: %s vs %s %s (%s)  Score %d-%d-%d  Elo %+.1f +/- %.1f\n", index + 1, match->games,
+           opening->name, match->specs[first_white ? 0 : 1].name, match->specs[first_white ? 1 : 0].name,
+           game->result, game->termination, match->score.wins, match->score.losses, match->score.draws, elo, margin);
+    fflush(stdout);
+
+    if (match->pgn) write_pgn_game(match, index, opening, first_white, game);
+    if (match->use_sprt && match_sprt(&match->score, &match->sprt, NULL, NULL, NULL) != SPRT_CONTINUE) {
+        match->stopped = true;
+    }
+    pthread_mutex_unlock(&match->lock);
+}
+
+/**
+ * Worker thread: play games until none are left
+ * Each opening is played twice, the first engine taking White first.
+ */
+static void *worker_main(void *argument) {
+    Worker *worker = argument;
+    Match *match = worker->match;
+
+    for (;;) {
+        pthread_mutex_lock(&match->lock);
+        int index = match->stopped || match->next_game >= match->games ? -1 : match->next_game++;
+        pthread_mutex_unlock(&match->lock);
+        if (index < 0) break;
+
+        const Opening *opening = &match->openings[(index / 2) % match->opening_count];
+        bool first_white = index % 2 == 0;
+        StockfishEngine *white = &worker->engines[first_white ? 0 : 1];
+        StockfishEngine *black = &worker->engines[first_white ? 1 : 0];
+
+        SelfPlayGame game;
+        if (!selfplay_play_game(white, black, &opening->game, &match->limits, &game)) {
+            fprintf(stderr, "Error: Out of memory in game %d\n", index + 1);
+            continue;
+        }
+        finish_game(match, index, opening, first_white, &game);
+        game_record_free(&game.record);
+    }
+    return NULL;
+}
+
+/******************************************************************************
+ *                                   MAIN
+ ******************************************************************************/
+
+/**
+ * Print the final score, Elo and SPRT state
+ */
+static void print_summary(const Match *match) {
+    const MatchScore *score = &match->score;
+    double margin;
+    double elo = match_elo(score, &margin);
+
+    printf("\n%s vs %s: %d games\n", match->specs[0].name, match->specs[1].name, match->finished);
+    printf("Score: %d wins, %d losses, %d draws (%.1f%%)\n", score->wins, score->losses, score->draws,
+           match->finished > 0 ? 100.0 * (score->wins + 0.5 * score->draws) / match->finished : 0.0);
+    printf("Elo difference: %+.1f +/- %.1f (95%%), LOS %.1f%%\n", elo, margin, 100.0 * match_los(score));
+
+    if (match->use_sprt) {
+        double llr, lower, upper;
+        SprtStatus status = match_sprt(score, &match->sprt, &llr, &lower, &upper);
+        printf("SPRT [%.1f, %.1f] alpha %.2f beta %.2f: LLR %.2f (%.2f, %.2f) - %s\n", match->sprt.elo0,
+               match->sprt.elo1, match->sprt.alpha, match->sprt.beta, llr, lower, upper,
+               status == SPRT_ACCEPT_H1 ? "H1 accepted" : status == SPRT_ACCEPT_H0 ? "H0 accepted" : "inconclusive");
+    }
+}
+
+static int usage(const char *program) {
+    fprintf(stderr, "Usage: %s ENGINE1 ENGINE2 [--games N] [--openings PATH] [--movetime MS] [--depth N]\n", program);
+    fprintf(stderr, "       [--maxplies N] [--concurrency N] [--pgn FILE] [--sprt ELO0 ELO1 [ALPHA BETA]]\n");
+    fprintf(stderr, "ENGINE: builtin[:skill=N,threads=N] or stockfish[:skill=N,threads=N,hash=MB,nnue=FILE]\n");
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    static Match match;
+    static Opening openings[MATCH_MAX_OPENINGS];
+    static Worker workers[MATCH_MAX_WORKERS];
+    const char *engine_args[2] = {NULL, NULL};
+    const char *pgn_path = NULL;
+    int concurrency = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    signal(SIGPIPE, SIG_IGN);   // A crashed engine loses its game; the match goes on
+    match.openings = openings;
+    match.games = 2;
+    match.limits.movetime_ms = SELFPLAY_DEFAULT_MOVETIME_MS;
+    match.limits.max_plies = SELFPLAY_DEFAULT_MAX_PLIES;
+    match.sprt.alpha = match.sprt.beta = 0.05;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--games") == 0 && i + 1 < argc) {
+            match.games = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--openings") == 0 && i + 1 < argc) {
+            add_openings(&match, argv[++i]);
+        } else if (strcmp(argv[i], "--movetime") == 0 && i + 1 < argc) {
+            match.limits.movetime_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+            match.limits.depth = atoi(argv[++i]);
+            match.limits.movetime_ms = 0;
+        } else if (strcmp(argv[i], "--maxplies") == 0 && i + 1 < argc) {
+            match.limits.max_plies = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--concurrency") == 0 && i + 1 < argc) {
+            concurrency = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--pgn") == 0 && i + 1 < argc) {
+            pgn_path = argv[++i];
+        } else if (strcmp(argv[i], "--sprt") == 0 && i + 2 < argc) {
+            match.use_sprt = true;
+            match.sprt.elo0 = atof(argv[++i]);
+            match.sprt.elo1 = atof(argv[++i]);
+            if (i + 2 < argc && argv[i + 1][0] != '-') {
+                match.sprt.alpha = atof(argv[++i]);
+                match.sprt.beta = atof(argv[++i]);
+            }
+        } else if (argv[i][0] != '-' && !engine_args[1]) {
+            engine_args[engine_args[0] ? 1 : 0] = argv[i];
+        } else {
+            return usage(argv[0]);
+        }
+    }
+
+    if (!engine_args[1] || match.games < 1 || match.limits.movetime_ms < 0 || match.limits.depth < 0) {
+        return usage(argv[0]);
+    }
+    if (match.use_sprt && (match.sprt.elo1 <= match.sprt.elo0 || match.sprt.alpha <= 0 || match.sprt.alpha >= 1 ||
+                           match.sprt.beta <= 0 || match.sprt.beta >= 1)) {
+        fprintf(stderr, "Error: --sprt needs ELO0 < ELO1 and error rates between 0 and 1\n");
+        return 1;
+    }
+    for (int i = 0; i < 2; i++) {
+        if (!selfplay_parse_engine(engine_args[i], &match.specs[i])) {
+            fprintf(stderr, "Error: Invalid engine '%s'\n", engine_args[i]);
+            return usage(argv[0]);
+        }
+    }
+    if (match.opening_count == 0) {
+        init_board(&openings[0].game);
+        snprintf(openings[0].name, sizeof(openings[0].name), "startpos");
+        match.opening_count = 1;
+    }
+    if (pgn_path && !(match.pgn = fopen(pgn_path, "w"))) {
+        fprintf(stderr, "Error: Cannot write %s\n", pgn_path);
+        return 1;
+    }
+
+    if (concurrency < 1) concurrency = 1;
+    if (concurrency > MATCH_MAX_WORKERS) concurrency = MATCH_MAX_WORKERS;
+    if (concurrency > match.games) concurrency = match.games;
+
+    // Start every engine before any game; each built-in engine has its own hash
+    int started = 0;
+    for (; started < concurrency; started++) {
+        workers[started].match = &match;
+        if (!selfplay_open_engine(&match.specs[0], &workers[started].engines[0])) break;
+        if (!selfplay_open_engine(&match.specs[1], &workers[started].engines[1])) {
+            close_stockfish(&workers[started].engines[0]);
+            break;
+        }
+    }
+    if (started == 0) {
+        fprintf(stderr, "Error: Cannot start the engines (is Stockfish installed?)\n");
+        return 1;
+    }
+
+    printf("%s vs %s: %d games, %d opening%s, %d at a time, ", match.specs[0].name, match.specs[1].name,
+           match.games, match.opening_count, match.opening_count == 1 ? "" : "s", started);
+    if (match.limits.depth > 0) printf("depth %d per move\n", match.limits.depth);
+    else printf("%d ms per move\n", match.limits.movetime_ms);
+
+    pthread_mutex_init(&match.lock, NULL);
+    for (int i = 0; i < started; i++) {
+        pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]);
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i].thread, NULL);
+        close_stockfish(&workers[i].engines[0]);
+        close_stockfish(&workers[i].engines[1]);
+    }
+    pthread_mutex_destroy(&match.lock);
+
+    print_summary(&match);
+    if (match.pgn) {
+        fclose(match.pgn);
+        printf("Games written to %s\n", pgn_path);
+    }
+    return 0;
+}
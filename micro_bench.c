@@ -0,0 +1,522 @@
+/**
+ * MICRO_BENCH.C - Microbenchmarks for the Core Chess Primitives
+ *
+ * Times the rules code the game, the tools and the built-in search call
+ * most, so a change to the move generator can be measured instead of
+ * guessed. micro_test.c checks that the primitives are right; this checks
+ * how fast they are.
+ *
+ * Usage: ./micro_bench [--reps N] [--warmup N] [--filter TEXT]
+ *                      [--json FILE] [--baseline FILE] [--threshold PCT]
+ *                      [--list]
+ *
+ * Example (record a baseline, change the code, compare):
+ *        ./micro_bench --json bench_baseline.json
+ *        make bench BASELINE=bench_baseline.json
+ *
+ * Method:
+ * - Each benchmark repeats one operation in a batch sized so a batch takes
+ *   at least BENCH_BATCH_NS; a sample is the batch time per operation
+ * - Warmup batches run first and are discarded; then --reps samples are
+ *   taken and reported as median, p99 (nearest rank), minimum and mean
+ * - Profiling (profile.h) stays off, so the instrumented primitives pay
+ *   only their disabled-branch cost
+ *
+ * Output:
+ * - A table on stdout; with --json the results as JSON, one benchmark per
+ *   line so a baseline can be read back without a JSON library
+ * - With --baseline, each median is compared with the baseline's; one
+ *   slower by more than --threshold percent (default 10) is a regression
+ *   and the exit status is 2
+ */
+
+#define _GNU_SOURCE        // Required for Linux (mkstemp)
+
+#include "chess.h"
+#include "pgn_utils.h"
+#include "profile.h"
+#include "san.h"
+#include "stockfish.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define BENCH_DEFAULT_REPS 30           // Samples per benchmark
+#define BENCH_DEFAULT_WARMUP 3          // Discarded batches per benchmark
+#define BENCH_DEFAULT_THRESHOLD 10.0    // Regression threshold (percent slower)
+#define BENCH_BATCH_NS 200000ULL        // Shortest batch (ns); keeps clock overhead negligible
+#define BENCH_MAX_REPS 10000
+#define BENCH_MAX_BASELINE 64           // Benchmarks read from a baseline file
+#define BENCH_GAME_PLIES 80             // Length of the game converted to PGN
+
+// Middlegame with every piece type, castling rights and pins ("Kiwipete")
+#define BENCH_MIDDLEGAME_FEN "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"
+// Fool's mate: White is checkmated, so the legal move list is empty
+#define BENCH_CHECKMATE_FEN "rnb1kbnr/pppp1ppp/8/4p3/6Pq/5P2/PPPPP2P/RNBQKBNR w KQkq - 1 3"
+
+typedef struct BenchCase BenchCase;
+
+/**
+ * BenchFunction - Run the benchmarked operation `iterations` times
+ * Returns a value derived from the results so the work cannot be
+ * optimized away.
+ */
+typedef uint64_t (*BenchFunction)(const BenchCase *bench, int iterations);
+
+/**
+ * BenchCase - One benchmark
+ */
+struct BenchCase {
+    const char *name;
+    BenchFunction run;
+    ChessGame *game;              // Position the operation runs in
+    PieceType piece;              // Piece type for get_possible_moves cases
+};
+
+/**
+ * BenchResult - Samples summarized, in nanoseconds per operation
+ */
+typedef struct {
+    char name[64];
+    long batch;
+    double median;
+    double p99;
+    double min;
+    double mean;
+} BenchResult;
+
+// Fixtures, built once by setup_fixtures()
+static ChessGame middlegame;
+static ChessGame checkmate;
+static Position piece_squares[KING + 1][16];    // White pieces of each type in the middlegame
+static int piece_square_count[KING + 1];
+static Move legal_moves[MAX_LEGAL_MOVES];       // Legal moves of the middlegame
+static int legal_move_count;
+static char san_tokens[MAX_LEGAL_MOVES][SAN_BUFFER_SIZE];  // Their SAN
+static char game_log[] = "/tmp/micro_bench_game_XXXXXX";   // FEN log of one game
+
+static volatile uint64_t bench_sink;            // Defeats dead-code elimination
+
+/******************************************************************************
+ *                                 FIXTURES
+ ******************************************************************************/
+
+/**
+ * Write the FEN log of a deterministic game (same moves every run)
+ *
+ * @return false if the log cannot be written
+ */
+static bool write_game_log(void) {
+    int fd = mkstemp(game_log);
+    if (fd < 0) return false;
+    FILE *log = fdopen(fd, "w");
+    if (!log) {
+        close(fd);
+        return false;
+    }
+
+    ChessGame game;
+    Move moves[MAX_LEGAL_MOVES];
+    char fen[FEN_BUFFER_SIZE];
+    init_board(&game);
+    fen_write(&game, fen, sizeof(fen));
+    fprintf(log, "%s\n", fen);
+    for (int ply = 0; ply < BENCH_GAME_PLIES; ply++) {
+        int count = generate_legal_moves(&game, moves);
+        if (count == 0) break;
+        execute_move(&game, moves[(ply * 7 + 3) % count]);
+        fen_write(&game, fen, sizeof(fen));
+        fprintf(log, "%s\n", fen);
+    }
+    return fclose(log) == 0;
+}
+
+/**
+ * Build the positions and inputs shared by the benchmarks
+ *
+ * @return false if a fixture cannot be built
+ */
+static bool setup_fixtures(void) {
+    if (!setup_board_from_fen(&middlegame, BENCH_MIDDLEGAME_FEN) ||
+        !setup_board_from_fen(&checkmate, BENCH_CHECKMATE_FEN)) {
+        return false;
+    }
+
+    memset(piece_square_count, 0, sizeof(piece_square_count));
+    for (int row = 0; row < BOARD_SIZE; row++) {
+        for (int col = 0; col < BOARD_SIZE; col++) {
+            Piece piece = middlegame.board[row][col];
+            if (piece.type == EMPTY || piece.color != WHITE) continue;
+            Position square = {row, col};
+            piece_squares[piece.type][piece_square_count[piece.type]++] = square;
+        }
+    }
+
+    legal_move_count = generate_legal_moves(&middlegame, legal_moves);
+    for (int i = 0; i < legal_move_count; i++) {
+        san_format_move(&middlegame, legal_moves[i], san_tokens[i], sizeof(san_tokens[i]));
+    }
+    return legal_move_count > 0 && write_game_log();
+}
+
+/******************************************************************************
+ *                                BENCHMARKS
+ ******************************************************************************/
+
+static uint64_t bench_possible_moves(const BenchCase *bench, int iterations) {
+    const Position *squares = piece_squares[bench->piece];
+    int count = piece_square_count[bench->piece];
+    Position moves[64];
+    uint64_t sum = 0;
+    for (int i = 0; i < iterations; i++) {
+        sum += get_possible_moves(bench->game, squares[i % count], moves);
+    }
+    return sum;
+}
+
+static uint64_t bench_square_attacked(const BenchCase *bench, int iterations) {
+    uint64_t sum = 0;
+    for (int i = 0; i < iterations; i++) {
+        Position square = {(i >> 3) & 7, i & 7};
+        sum += is_square_attacked(bench->game, square, BLACK);
+    }
+    return sum;
+}
+
+static uint64_t bench_valid_move(const BenchCase *bench, int iterations) {
+    uint64_t sum = 0;
+    for (int i = 0; i < iterations; i++) {
+        // Alternate a legal move with the same piece going to the mirrored square
+        const Move *move = &legal_moves[(i >> 1) % legal_move_count];
+        Position to = move->to;
+        if (i & 1) to.row = BOARD_SIZE - 1 - to.row;
+        sum += is_valid_move(bench->game, move->from, to);
+    }
+    return sum;
+}
+
+static uint64_t bench_legal_moves(const BenchCase *bench, int iterations) {
+    Move moves[MAX_LEGAL_MOVES];
+    uint64_t sum = 0;
+    for (int i = 0; i < iterations; i++) {
+        sum += generate_legal_moves(bench->game, moves);
+    }
+    return sum;
+}
+
+static uint64_t bench_has_legal_moves(const BenchCase *bench, int iterations) {
+    uint64_t sum = 0;
+    for (int i = 0; i < iterations; i++) {
+        sum += has_legal_moves(bench->game, bench->game->current_player);
+    }
+    return sum;
+}
+
+static uint64_t bench_is_checkmate(const BenchCase *bench, int iterations) {
+    uint64_t sum = 0;
+    for (int i = 0; i < iterations; i++) {
+        sum += is_checkmate(bench->game, bench->game->current_player);
+    }
+    return sum;
+}
+
+static uint64_t bench_setup_board(const BenchCase *bench, int iterations) {
+    (void)bench;
+    ChessGame game;
+    uint64_t sum = 0;
+    for (int i = 0; i < iterations; i++) {
+        sum += setup_board_from_fen(&game, BENCH_MIDDLEGAME_FEN);
+    }
+    return sum + game.fullmove_number;
+}
+
+static uint64_t bench_board_to_fen(const BenchCase *bench, int iterations) {
+    uint64_t sum = 0;
+    for (int i = 0; i < iterations; i++) {
+        sum += (uint8_t)board_to_fen(bench->game)[i & 15];
+    }
+    return sum;
+}
+
+static uint64_t bench_fen_to_pgn(const BenchCase *bench, int iterations) {
+    (void)bench;
+    uint64_t sum = 0;
+    for (int i = 0; i < iterations; i++) {
+        char *pgn = convert_fen_to_pgn_string(game_log, "*");
+        if (pgn) sum += strlen(pgn);
+        free(pgn);
+    }
+    return sum;
+}
+
+static uint64_t bench_san_parse(const BenchCase *bench, int iterations) {
+    Move move;
+    uint64_t sum = 0;
+    for (int i = 0; i < iterations; i++) {
+        sum += san_parse(bench->game, san_tokens[i % legal_move_count], &move);
+    }
+    return sum;
+}
+
+// has_legal_moves() stops at the first legal move, so the middlegame is its
+// best case and the mated position (every move tried) its worst
+static const BenchCase bench_cases[] = {
+    {"get_possible_moves/pawn", bench_possible_moves, &middlegame, PAWN},
+    {"get_possible_moves/knight", bench_possible_moves, &middlegame, KNIGHT},
+    {"get_possible_moves/bishop", bench_possible_moves, &middlegame, BISHOP},
+    {"get_possible_moves/rook", bench_possible_moves, &middlegame, ROOK},
+    {"get_possible_moves/queen", bench_possible_moves, &middlegame, QUEEN},
+    {"get_possible_moves/king", bench_possible_moves, &middlegame, KING},
+    {"is_square_attacked", bench_square_attacked, &middlegame, EMPTY},
+    {"is_valid_move", bench_valid_move, &middlegame, EMPTY},
+    {"generate_legal_moves/middlegame", bench_legal_moves, &middlegame, EMPTY},
+    {"generate_legal_moves/checkmate", bench_legal_moves, &checkmate, EMPTY},
+    {"has_legal_moves/middlegame", bench_has_legal_moves, &middlegame, EMPTY},
+    {"has_legal_moves/checkmate", bench_has_legal_moves, &checkmate, EMPTY},
+    {"is_checkmate/checkmate", bench_is_checkmate, &checkmate, EMPTY},
+    {"setup_board_from_fen", bench_setup_board, NULL, EMPTY},
+    {"board_to_fen", bench_board_to_fen, &middlegame, EMPTY},
+    {"convert_fen_to_pgn_string", bench_fen_to_pgn, NULL, EMPTY},
+    {"san_parse", bench_san_parse, &middlegame, EMPTY},
+};
+
+#define BENCH_CASE_COUNT ((int)(sizeof(bench_cases) / sizeof(bench_cases[0])))
+
+/******************************************************************************
+ *                                 HARNESS
+ ******************************************************************************/
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Time one batch
+ *
+ * @return Nanoseconds for `batch` operations
+ */
+static uint64_t time_batch(const BenchCase *bench, long batch) {
+    uint64_t start = profile_now_ns();
+    bench_sink += bench->run(bench, (int)batch);
+    return profile_now_ns() - start;
+}
+
+/**
+ * Calibrate, warm up and sample one benchmark
+ *
+ * @param bench Benchmark to run
+ * @param reps Samples to take
+ * @param warmup Batches to discard first
+ * @param samples Scratch space for reps samples
+ * @param result Output summary
+ */
+static void run_benchmark(const BenchCase *bench, int reps, int warmup, double *samples, BenchResult *result) {
+    long batch = 1;
+    while (batch < (1L << 30) && time_batch(bench, batch) < BENCH_BATCH_NS) {
+        batch *= 2;
+    }
+    for (int i = 0; i < warmup; i++) {
+        time_batch(bench, batch);
+    }
+
+    double total = 0;
+    for (int i = 0; i < reps; i++) {
+        samples[i] = (double)time_batch(bench, batch) / (double)batch;
+        total += samples[i];
+    }
+    qsort(samples, reps, sizeof(double), compare_doubles);
+
+    snprintf(result->name, sizeof(result->name), "%s", bench->name);
+    result->batch = batch;
+    result->median = reps % 2 ? samples[reps / 2] : (samples[reps / 2 - 1] + samples[reps / 2]) / 2;
+    int rank = (int)(0.99 * reps + 0.999999);    // Nearest rank, 1-based
+    result->p99 = samples[(rank < 1 ? 1 : rank) - 1];
+    result->min = samples[0];
+    result->mean = total / reps;
+}
+
+/**
+ * Write results as JSON, one benchmark per line
+ *
+ * @return false if the file cannot be written
+ */
+static bool write_json(const char *path, const BenchResult *results, int count, int reps, int warmup) {
+    FILE *file = fopen(path, "w");
+    if (!file) return false;
+    fprintf(file, "{\n  \"benchmark\": \"micro_bench\",\n  \"unit\": \"ns/op\",\n");
+    fprintf(file, "  \"reps\": %d,\n  \"warmup\": %d,\n  \"results\": [\n", reps, warmup);
+    for (int i = 0; i < count; i++) {
+        const BenchResult *r = &results[i];
+        fprintf(file, "    {\"name\": \"%s\", \"batch\": %ld, \"median_ns\": %.3f, \"p99_ns\": %.3f, "
+                "\"min_ns\": %.3f, \"mean_ns\": %.3f}%s\n",
+                r->name, r->batch, r->median, r->p99, r->min, r->mean, i + 1 < count ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    return fclose(file) == 0;
+}
+
+/**
+ * Read the name and median of each benchmark in a file from write_json()
+ *
+ * @param path Baseline file
+ * @param baseline Output (name and median are set)
+ * @return Benchmarks read, or -1 if the file cannot be opened
+ */
+static int read_baseline(const char *path, BenchResult *baseline) {
+    FILE *file = fopen(path, "r");
+    if (!file) return -1;
+
+    char line[512];
+    int count = 0;
+    while (count < BENCH_MAX_BASELINE && fgets(line, sizeof(line), file)) {
+        const char *name = strstr(line, "\"name\": \"");
+        const char *median = strstr(line, "\"median_ns\": ");
+        if (!name || !median) continue;
+
+        name += strlen("\"name\": \"");
+        size_t length = strcspn(name, "\"");
+        if (length >= sizeof(baseline[count].name)) continue;
+        memcpy(baseline[count].name, name, length);
+        baseline[count].name[length] = '\0';
+        baseline[count].median = strtod(median + strlen("\"median_ns\": "), NULL);
+        if (baseline[count].median > 0) count++;
+    }
+    fclose(file);
+    return count;
+}
+
+/**
+ * Compare medians with a baseline and print the changes
+ *
+ * @return Number of regressions
+ */
+static int compare_baseline(const BenchResult *results, int count, const BenchResult *baseline,
+                            int baseline_count, double threshold) {
+    char before[16], current[16];
+    int regressions = 0;
+    printf("\n%-34s %10s %10s %8s\n", "Benchmark", "Baseline", "Current", "Change");
+    for (int i = 0; i < count; i++) {
+        const BenchResult *old = NULL;
+        for (int j = 0; j < baseline_count && !old; j++) {
+            if (strcmp(baseline[j].name, results[i].name) == 0) old = &baseline[j];
+        }
+        if (!old) {
+            profile_format_ns((uint64_t)(results[i].median + 0.5), current, sizeof(current));
+            printf("%-34s %10s %10s %8s\n", results[i].name, "-", current, "new");
+            continue;
+        }
+
+        double change = (results[i].median - old->median) / old->median * 100.0;
+        const char *verdict = "";
+        if (change > threshold) {
+            verdict = "  REGRESSION";
+            regressions++;
+        } else if (change < -threshold) {
+            verdict = "  faster";
+        }
+        profile_format_ns((uint64_t)(old->median + 0.5), before, sizeof(before));
+        profile_format_ns((uint64_t)(results[i].median + 0.5), current, sizeof(current));
+        printf("%-34s %10s %10s %+7.1f%%%s\n", results[i].name, before, current, change, verdict);
+    }
+
+    if (regressions > 0) {
+        printf("\n%d benchmark%s slower than the baseline by more than %.1f%%\n", regressions,
+               regressions == 1 ? "" : "s", threshold);
+    } else {
+        printf("\nNo regressions (threshold %.1f%%)\n", threshold);
+    }
+    return regressions;
+}
+
+static void print_usage(const char *program) {
+    fprintf(stderr, "Usage: %s [--reps N] [--warmup N] [--filter TEXT] [--json FILE]\n", program);
+    fprintf(stderr, "       %*s [--baseline FILE] [--threshold PCT] [--list]\n", (int)strlen(program), "");
+}
+
+int main(int argc, char* argv[]) {
+    int reps = BENCH_DEFAULT_REPS;
+    int warmup = BENCH_DEFAULT_WARMUP;
+    double threshold = BENCH_DEFAULT_THRESHOLD;
+    const char *filter = NULL;
+    const char *json_path = NULL;
+    const char *baseline_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+            reps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline_path = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--list") == 0) {
+            for (int b = 0; b < BENCH_CASE_COUNT; b++) printf("%s\n", bench_cases[b].name);
+            return 0;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (reps < 1 || reps > BENCH_MAX_REPS || warmup < 0 || threshold <= 0) {
+        fprintf(stderr, "Error: --reps must be 1 to %d, --warmup at least 0, --threshold above 0\n", BENCH_MAX_REPS);
+        return 1;
+    }
+
+    BenchResult baseline[BENCH_MAX_BASELINE];
+    int baseline_count = 0;
+    if (baseline_path) {
+        baseline_count = read_baseline(baseline_path, baseline);
+        if (baseline_count < 0) {
+            fprintf(stderr, "Error: Cannot read baseline %s\n", baseline_path);
+            return 1;
+        }
+    }
+
+    if (!setup_fixtures()) {
+        fprintf(stderr, "Error: Cannot set up benchmark positions\n");
+        return 1;
+    }
+
+    BenchResult results[BENCH_CASE_COUNT];
+    double *samples = malloc(sizeof(double) * reps);
+    int count = 0;
+    if (!samples) {
+        unlink(game_log);
+        return 1;
+    }
+
+    printf("%-34s %10s %10s %10s %10s\n", "Benchmark", "Median", "p99", "Min", "Batch");
+    for (int b = 0; b < BENCH_CASE_COUNT; b++) {
+        if (filter && !strstr(bench_cases[b].name, filter)) continue;
+        BenchResult *result = &results[count++];
+        run_benchmark(&bench_cases[b], reps, warmup, samples, result);
+        char median[16], p99[16], min[16];
+        profile_format_ns((uint64_t)(result->median + 0.5), median, sizeof(median));
+        profile_format_ns((uint64_t)(result->p99 + 0.5), p99, sizeof(p99));
+        profile_format_ns((uint64_t)(result->min + 0.5), min, sizeof(min));
+        printf("%-34s %10s %10s %10s %10ld\n", result->name, median, p99, min, result->batch);
+        fflush(stdout);
+    }
+    free(samples);
+    unlink(game_log);
+
+    if (json_path) {
+        if (!write_json(json_path, results, count, reps, warmup)) {
+            fprintf(stderr, "Error: Cannot write %s\n", json_path);
+            return 1;
+        }
+        printf("\nResults written to %s\n", json_path);
+    }
+
+    if (baseline_path && compare_baseline(results, count, baseline, baseline_count, threshold) > 0) {
+        return 2;
+    }
+    return 0;
+}
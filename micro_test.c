@@ -11,13 +11,31 @@
  * Usage: Compile and run specific test functions as needed
  */
 
+#define _GNU_SOURCE        // Required for Linux (mkdtemp)
+
 #include "chess.h"
 #include "stockfish.h"
 #include "pgn_utils.h"
+#include "game_record.h"
+#include "history.h"
+#include "san.h"
+#include "position_index.h"
+#include "book.h"
+#include "explorer.h"
+#include "tablebase.h"
+#include "search.h"
+#include "tt.h"
+#include "screen.h"
+#include "protocol.h"
+#include "selfplay.h"
+#include "server.h"
+#include "profile.h"
 #include <stdio.h>
 #include <assert.h>
+#include <signal.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/stat.h>
 
 /**
  * Test basic board initialization
@@ -328,6 +346,113 @@ void test_en_passant_fen_parsing() {
     printf("PASSED\n");
 }
 
+/**
+ * Test single-pass FEN decoder error reporting
+ * Tests: fen_decode() error codes, offsets and optional-field defaults
+ */
+void test_fen_decode_errors() {
+    printf("Testing FEN decoder errors... ");
+
+    ChessGame game;
+    FenResult result;
+
+    // Valid FEN consumes the whole string
+    const char* start = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+    result = fen_decode(&game, start);
+    assert(result.code == FEN_OK && result.offset == (int)strlen(start));
+
+    // Trailing fields are optional and default to "- - 0 1"
+    result = fen_decode(&game, "4k3/8/8/8/8/8/8/4K3 b\r\n");
+    assert(result.code == FEN_OK);
+    assert(game.current_player == BLACK && game.white_king_moved == true);
+    assert(game.en_passant_available == false);
+    assert(game.halfmove_clock == 0 && game.fullmove_number == 1);
+
+    // Each malformed field is reported with the offending column
+    result = fen_decode(&game, "rnbqkbnr/ppppxppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    assert(result.code == FEN_ERR_BAD_PIECE && result.offset == 13);
+
+    result = fen_decode(&game, "rnbqkbnr/ppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    assert(result.code == FEN_ERR_RANK_LENGTH && result.offset == 16);
+
+    result = fen_decode(&game, "rnbqkbnr/pppppppp/9/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    assert(result.code == FEN_ERR_BAD_PIECE && result.offset == 18);
+
+    result = fen_decode(&game, "rnbqkbnr/pppppppp/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    assert(result.code == FEN_ERR_RANK_COUNT);
+
+    result = fen_decode(&game, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR");
+    assert(result.code == FEN_ERR_MISSING_FIELD);
+
+    result = fen_decode(&game, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR x KQkq - 0 1");
+    assert(result.code == FEN_ERR_BAD_ACTIVE_COLOR && result.offset == 44);
+
+    result = fen_decode(&game, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KXkq - 0 1");
+    assert(result.code == FEN_ERR_BAD_CASTLING && result.offset == 47);
+
+    result = fen_decode(&game, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq e4 0 1");
+    assert(result.code == FEN_ERR_BAD_EN_PASSANT && result.offset == 52);
+
+    result = fen_decode(&game, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - x 1");
+    assert(result.code == FEN_ERR_BAD_COUNTER && result.offset == 53);
+
+    result = fen_decode(&game, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1 extra");
+    assert(result.code == FEN_ERR_TRAILING_DATA && result.offset == 57);
+
+    result = fen_decode(&game, "");
+    assert(result.code == FEN_ERR_EMPTY);
+
+    // A rejected FEN leaves the game untouched
+    init_board(&game);
+    assert(setup_board_from_fen(&game, "4k3/8/8/8/8/8/8/4K3 w - - zz 1") == false);
+    assert(get_piece_at(&game, 7, 0).type == ROOK);
+
+    printf("PASSED\n");
+}
+
+/**
+ * Test reentrant FEN serialization
+ * Tests: fen_write() round-trips positions and respects buffer capacity
+ */
+void test_fen_write() {
+    printf("Testing FEN serialization... ");
+
+    ChessGame game;
+    char fen[FEN_BUFFER_SIZE];
+
+    // Starting position
+    init_board(&game);
+    size_t length = fen_write(&game, fen, sizeof(fen));
+    assert(strcmp(fen, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1") == 0);
+    assert(length == strlen(fen));
+
+    // Round-trip positions covering castling, en passant and multi-digit counters
+    const char* positions[] = {
+        "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+        "r3k2r/8/8/8/8/8/8/R3K2R b Kq - 12 40",
+        "8/4P3/8/8/8/8/8/K6k w - - 0 1",
+        "rnbqk2r/pppp1ppp/5n2/2b1p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 100 125"
+    };
+    for (size_t i = 0; i < sizeof(positions) / sizeof(positions[0]); i++) {
+        assert(setup_board_from_fen(&game, positions[i]) == true);
+        length = fen_write(&game, fen, sizeof(fen));
+        assert(strcmp(fen, positions[i]) == 0);
+        assert(length == strlen(positions[i]));
+    }
+
+    // Too-small buffer reports failure and leaves an empty string
+    char tiny[16];
+    assert(fen_write(&game, tiny, sizeof(tiny)) == 0);
+    assert(tiny[0] == '\0');
+
+    // Exact-fit small buffer still succeeds
+    char exact[80];
+    assert(fen_write(&game, exact, strlen(positions[3]) + 1) == strlen(positions[3]));
+    assert(strcmp(exact, positions[3]) == 0);
+
+    printf("PASSED\n");
+}
+
 /**
  * Test en passant move generation
  * Tests: get_pawn_moves() includes en passant captures when available
@@ -631,9 +756,1416 @@ void test_pgn_conversion() {
     printf("PASSED\n");
 }
 
+/**
+ * Test compact binary game records
+ * Tests: cgr_pack_move(), cgr_play_move(), game_record_save/load/seek_file(), FEN log conversion
+ */
+void test_game_record() {
+    printf("Testing binary game records... ");
+
+    // Promotion survives packing
+    Move promo = {0};
+    promo.from = (Position){1, 4};
+    promo.to = (Position){0, 4};
+    promo.is_promotion = true;
+    promo.promotion_piece = KNIGHT;
+    Move unpacked = cgr_unpack_move(cgr_pack_move(promo));
+    assert(unpacked.from.row == 1 && unpacked.from.col == 4);
+    assert(unpacked.to.row == 0 && unpacked.to.col == 4);
+    assert(unpacked.is_promotion && unpacked.promotion_piece == KNIGHT);
+
+    // A pawn reaching the last rank without a valid promotion code is rejected, not prompted for
+    ChessGame promotion_game;
+    memset(&promotion_game, 0, sizeof(promotion_game));
+    assert(setup_board_from_fen(&promotion_game, "8/4P3/8/8/8/8/8/k6K w - - 0 1"));
+    promo.is_promotion = false;
+    assert(!cgr_play_move(&promotion_game, cgr_pack_move(promo)));
+    assert(!cgr_play_move(&promotion_game, (uint16_t)(cgr_pack_move(promo) | (6 << 12))));
+    assert(promotion_game.board[1][4].type == PAWN && promotion_game.current_player == WHITE);
+    promo.is_promotion = true;
+    assert(cgr_play_move(&promotion_game, cgr_pack_move(promo)));
+    assert(promotion_game.board[0][4].type == KNIGHT);
+
+    // Build a 40-ply game (knight shuffles) so the index holds a keyframe
+    const char* fen_filename = "test_game_record.fen";
+    const char* cgr_filename = "test_game_record.cgr";
+    Position shuffle[4][2] = {{{7, 6}, {5, 5}}, {{0, 6}, {2, 5}}, {{5, 5}, {7, 6}}, {{2, 5}, {0, 6}}};
+    char fens[41][FEN_BUFFER_SIZE];
+
+    ChessGame game;
+    init_board(&game);
+    FILE* fen_file = fopen(fen_filename, "w");
+    assert(fen_file != NULL);
+    fen_write(&game, fens[0], sizeof(fens[0]));
+    fprintf(fen_file, "%s\n", fens[0]);
+    for (int ply = 1; ply <= 40; ply++) {
+        Position* step = shuffle[(ply - 1) % 4];
+        assert(make_move(&game, step[0], step[1]));
+        fen_write(&game, fens[ply], sizeof(fens[ply]));
+        fprintf(fen_file, "%s\n", fens[ply]);
+    }
+    fclose(fen_file);
+
+    GameRecord record;
+    assert(game_record_from_fen_log(&record, fen_filename));
+    assert(record.ply_count == 40);
+    assert(game_record_save(&record, cgr_filename, true));
+    game_record_free(&record);
+
+    // Seeking before, on and after the keyframe matches the FEN log
+    int plies[] = {0, 31, 32, 33, 40};
+    char fen[FEN_BUFFER_SIZE];
+    for (size_t i = 0; i < sizeof(plies) / sizeof(plies[0]); i++) {
+        ChessGame seeked;
+        memset(&seeked, 0, sizeof(seeked));
+        assert(game_record_seek_file(cgr_filename, plies[i], &seeked));
+        fen_write(&seeked, fen, sizeof(fen));
+        assert(strcmp(fen, fens[plies[i]]) == 0);
+    }
+    ChessGame beyond;
+    assert(game_record_seek_file(cgr_filename, 41, &beyond) == false);
+
+    // Loading and replaying reproduces the final position
+    assert(game_record_load(&record, cgr_filename));
+    ChessGame replayed;
+    memset(&replayed, 0, sizeof(replayed));
+    assert(game_record_position_at(&record, 40, &replayed));
+    fen_write(&replayed, fen, sizeof(fen));
+    assert(strcmp(fen, fens[40]) == 0);
+    game_record_free(&record);
+
+    unlink(fen_filename);
+    unlink(cgr_filename);
+
+    printf("PASSED\n");
+}
+
+/**
+ * Test in-memory undo history and FEN journal truncation
+ * Tests: history_reset(), history_push(), history_undo(), history_load_journal()
+ */
+void test_history_undo() {
+    printf("Testing undo history... ");
+
+    const char* journal = "test_history.fen";
+    GameHistory history;
+    history_init(&history);
+
+    ChessGame game;
+    init_board(&game);
+    assert(history_reset(&history, &game, journal));
+
+    char start_fen[FEN_BUFFER_SIZE];
+    char after_two[FEN_BUFFER_SIZE];
+    fen_write(&game, start_fen, sizeof(start_fen));
+
+    Position moves[4][2] = {{{6, 4}, {4, 4}}, {{1, 4}, {3, 4}}, {{7, 6}, {5, 5}}, {{0, 1}, {2, 2}}};
+    for (int i = 0; i < 4; i++) {
+        Move move = {0};
+        move.from = moves[i][0];
+        move.to = moves[i][1];
+        assert(make_move(&game, move.from, move.to));
+        assert(history_push(&history, &game, move));
+        if (i == 1) fen_write(&game, after_two, sizeof(after_two));
+    }
+    assert(history_ply_count(&history) == 4);
+
+    // Undo two plies: position restored and journal truncated to 3 lines
+    assert(history_undo(&history, 2, &game));
+    assert(history_ply_count(&history) == 2);
+    char fen[FEN_BUFFER_SIZE];
+    fen_write(&game, fen, sizeof(fen));
+    assert(strcmp(fen, after_two) == 0);
+
+    FILE* file = fopen(journal, "r");
+    assert(file != NULL);
+    char line[256];
+    int lines = 0;
+    char last[256] = "";
+    while (fgets(line, sizeof(line), file)) {
+        lines++;
+        strcpy(last, line);
+    }
+    fclose(file);
+    last[strcspn(last, "\n")] = '\0';
+    assert(lines == 3 && strcmp(last, after_two) == 0);
+
+    // Cannot undo past the starting position
+    assert(history_undo(&history, 3, &game) == false);
+    history_close(&history);
+
+    // Reloading the journal continues from where it was truncated
+    assert(history_load_journal(&history, journal));
+    assert(history_ply_count(&history) == 2);
+    assert(history_undo(&history, 2, &game));
+    fen_write(&game, fen, sizeof(fen));
+    assert(strcmp(fen, start_fen) == 0);
+    history_close(&history);
+
+    unlink(journal);
+
+    printf("PASSED\n");
+}
+
+void test_history_tree() {
+    printf("Testing redo and variations... ");
+
+    const char* journal = "test_history_tree.fen";
+    GameHistory history;
+    history_init(&history);
+
+    ChessGame game;
+    init_board(&game);
+    assert(history_reset(&history, &game, journal));
+    uint64_t start_hash = position_hash(&game);
+
+    // 1. e4 e5, undo both, then 1. d4 d5 as a second variation
+    Position line_a[2][2] = {{{6, 4}, {4, 4}}, {{1, 4}, {3, 4}}};
+    Position line_b[2][2] = {{{6, 3}, {4, 3}}, {{1, 3}, {3, 3}}};
+    for (int i = 0; i < 2; i++) {
+        Move move = {0};
+        move.from = line_a[i][0];
+        move.to = line_a[i][1];
+        assert(make_move(&game, move.from, move.to));
+        assert(history_push(&history, &game, move));
+    }
+    char after_e5[FEN_BUFFER_SIZE];
+    fen_write(&game, after_e5, sizeof(after_e5));
+    history_set_eval(&history, 25);
+
+    assert(history_undo(&history, 2, &game));
+    assert(position_hash(&game) == start_hash && history_current(&history)->hash == start_hash);
+    assert(history_redo_count(&history) == 2);
+
+    // Redo returns to the cached position without replaying moves
+    assert(history_redo(&history, 2, &game));
+    char fen[FEN_BUFFER_SIZE];
+    fen_write(&game, fen, sizeof(fen));
+    assert(strcmp(fen, after_e5) == 0);
+    assert(history_current(&history)->has_eval && history_current(&history)->eval == 25);
+    assert(history_redo(&history, 1, &game) == false);
+
+    assert(history_undo(&history, 2, &game));
+    for (int i = 0; i < 2; i++) {
+        Move move = {0};
+        move.from = line_b[i][0];
+        move.to = line_b[i][1];
+        assert(make_move(&game, move.from, move.to));
+        assert(history_push(&history, &game, move));
+    }
+    assert(history_current(&history)->has_eval == false);
+    assert(history_undo(&history, 2, &game));
+    assert(history_variation_count(&history) == 2);
+
+    // Switching back to the first variation rewrites the journal to that line
+    int node = history_variation_node(&history, 0);
+    assert(node != HISTORY_NO_NODE && history_variation_node(&history, 2) == HISTORY_NO_NODE);
+    assert(history_goto(&history, history.nodes[node].redo_child, &game));
+    fen_write(&game, fen, sizeof(fen));
+    assert(strcmp(fen, after_e5) == 0);
+    assert(history_ply_count(&history) == 2);
+
+    // Replaying an explored move reuses its node instead of adding a variation
+    assert(history_undo(&history, 1, &game));
+    Move again = {0};
+    again.from = line_a[1][0];
+    again.to = line_a[1][1];
+    assert(make_move(&game, again.from, again.to));
+    int nodes_before = history.node_count;
+    assert(history_push(&history, &game, again));
+    assert(history.node_count == nodes_before && history_current(&history)->eval == 25);
+
+    // The current line exports as a record for PGN writing
+    GameRecord record;
+    assert(history_to_record(&history, &record));
+    char* pgn = convert_record_to_pgn_string(&record, "*");
+    assert(record.ply_count == 2 && pgn != NULL && strstr(pgn, "\n1. e4 e5 *") != NULL);
+    free(pgn);
+    game_record_free(&record);
+    history_close(&history);
+
+    FILE* file = fopen(journal, "r");
+    assert(file != NULL);
+    char line[256];
+    int lines = 0;
+    char last[256] = "";
+    while (fgets(line, sizeof(line), file)) {
+        lines++;
+        strcpy(last, line);
+    }
+    fclose(file);
+    last[strcspn(last, "\n")] = '\0';
+    assert(lines == 3 && strcmp(last, after_e5) == 0);
+    unlink(journal);
+
+    printf("PASSED\n");
+}
+
+void test_san_parse() {
+    printf("Testing SAN move decoding... ");
+
+    ChessGame game;
+    static SanTable table;
+    Move move;
+
+    // Both knights reach d7: plain "Nd7" is ambiguous, disambiguated forms are not
+    assert(setup_board_from_fen(&game, "rnbqkb1r/pppp1ppp/5n2/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R b KQkq - 3 3"));
+    game.board[1][3] = (Piece){EMPTY, WHITE};
+    san_table_build(&table, &game);
+    assert(san_table_find(&table, "Nd7") < 0);
+    int index = san_table_find(&table, "Nbd7");
+    assert(index >= 0 && table.moves[index].from.row == 0 && table.moves[index].from.col == 1);
+    index = san_table_find(&table, "Nfd7+!?");
+    assert(index >= 0 && table.moves[index].from.row == 2 && table.moves[index].from.col == 5);
+    assert(strcmp(table.san[index], "Nfd7") == 0);
+    assert(san_table_find(&table, "Nf6d7") == index);
+    assert(san_table_find(&table, "Bb4") >= 0 && san_table_find(&table, "Bg7") < 0);
+
+    // Pawn captures are resolved by file, including en passant
+    assert(setup_board_from_fen(&game, "4k3/8/8/2pP4/8/8/8/4K3 w - c6 0 1"));
+    assert(san_parse(&game, "dxc6", &move));
+    assert(move.is_capture && move.captured.type == PAWN && move.to.row == 2 && move.to.col == 2);
+
+    // Promotions: explicit piece, underpromotion, no '=' and default queen
+    assert(setup_board_from_fen(&game, "8/4P3/8/8/8/8/k7/4K3 w - - 0 1"));
+    assert(san_parse(&game, "e8=N+", &move) && move.is_promotion && move.promotion_piece == KNIGHT);
+    assert(san_parse(&game, "e8R", &move) && move.promotion_piece == ROOK);
+    assert(san_parse(&game, "e8", &move) && move.promotion_piece == QUEEN);
+    assert(san_parse(&game, "e8=K", &move) == false);
+
+    // Castling in either spelling
+    assert(setup_board_from_fen(&game, "r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1"));
+    assert(san_parse(&game, "0-0", &move) && move.to.col == 6);
+    assert(san_parse(&game, "O-O-O", &move) && move.to.col == 2);
+
+    printf("PASSED\n");
+}
+
+void test_san_write() {
+    printf("Testing SAN move encoding... ");
+
+    ChessGame game;
+    char san[SAN_BUFFER_SIZE];
+    Move move = {0};
+
+    // Rooks on the same file are told apart by rank, knights by file
+    assert(setup_board_from_fen(&game, "4k3/8/8/8/R7/8/8/R3K1N1 w - - 0 1"));
+    move.from = (Position){7, 0};
+    move.to = (Position){5, 0};
+    assert(san_format_move(&game, move, san, sizeof(san)) > 0 && strcmp(san, "R1a3") == 0);
+    move.from = (Position){7, 6};
+    move.to = (Position){5, 5};
+    assert(san_format_move(&game, move, san, sizeof(san)) > 0 && strcmp(san, "Nf3") == 0);
+
+    // Check and mate marks come from the position after the move
+    assert(setup_board_from_fen(&game, "rnbqkbnr/pppp1ppp/8/4p3/6P1/5P2/PPPPP2P/RNBQKBNR b KQkq - 0 2"));
+    move.from = (Position){0, 3};
+    move.to = (Position){4, 7};
+    assert(san_format_move(&game, move, san, sizeof(san)) > 0 && strcmp(san, "Qh4#") == 0);
+    assert(setup_board_from_fen(&game, "4k3/8/8/8/8/8/8/R3K3 w - - 0 1"));
+    move.from = (Position){7, 0};
+    move.to = (Position){0, 0};
+    assert(san_format_move(&game, move, san, sizeof(san)) > 0 && strcmp(san, "Ra8+") == 0);
+
+    // Illegal moves are not encoded
+    move.to = (Position){0, 4};
+    assert(san_format_move(&game, move, san, sizeof(san)) == 0);
+
+    // Movetext from a record starting with Black to move
+    assert(setup_board_from_fen(&game, "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1"));
+    GameRecord record;
+    game_record_init(&record, &game);
+    Move reply = {0};
+    reply.from = (Position){1, 4};
+    reply.to = (Position){3, 4};
+    assert(game_record_append(&record, reply));
+    char* movetext = pgn_format_movetext(&record, "*");
+    assert(movetext != NULL && strcmp(movetext, "1... e5 *\n") == 0);
+    free(movetext);
+    game_record_free(&record);
+
+    printf("PASSED\n");
+}
+
+/**
+ * Test the position index over a small PGN and FEN library
+ * Tests: pgn_reader_next(), position_index_update(), position_index_find()
+ */
+void test_position_index() {
+    printf("Testing position index... ");
+
+    char directory[] = "/tmp/micro_test_index_XXXXXX";
+    assert(mkdtemp(directory) != NULL);
+    char pgn_path[128], fen_path[128], index_path[128];
+    snprintf(pgn_path, sizeof(pgn_path), "%s/games.pgn", directory);
+    snprintf(fen_path, sizeof(fen_path), "%s/game.fen", directory);
+    snprintf(index_path, sizeof(index_path), "%s/positions.cpx", directory);
+
+    // Two games reaching the same position by transposition, the second with a variation
+    FILE* file = fopen(pgn_path, "w");
+    assert(file != NULL);
+    fprintf(file, "[Event \"A\"]\n[Result \"1-0\"]\n\n1. e4 e5 2. Nf3 Nc6 {main} 3. Bb5 1-0\n\n");
+    fprintf(file, "[Event \"B\"]\n[Result \"*\"]\n\n1. Nf3 Nc6 2. e4 (2. d4 d5) 2... e5 *\n");
+    fclose(file);
+
+    file = fopen(fen_path, "w");
+    assert(file != NULL);
+    fprintf(file, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1\n");
+    fprintf(file, "rnbqkbnr/pppppppp/8/8/3P4/8/PPP1PPPP/RNBQKBNR b KQkq d3 0 1\n");
+    fclose(file);
+
+    IndexRoot root = {directory, false};
+    IndexUpdateStats stats;
+    assert(position_index_update(index_path, &root, 1, NULL, &stats));
+    assert(stats.files_indexed == 2 && stats.files_reused == 0 && stats.games == 3);
+    assert(stats.positions == 6 + 5 + 2);
+
+    ChessGame game;
+    IndexMatch matches[4];
+    int total = 0;
+    assert(setup_board_from_fen(&game, "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3"));
+    assert(position_index_find(index_path, position_hash(&game), matches, 4, &total) == 2 && total == 2);
+    assert(matches[0].game_number == 1 && matches[0].ply == 4 && matches[0].ply_count == 5);
+    assert(matches[1].game_number == 2 && matches[1].ply == 4);
+
+    // The starting position is in every game
+    init_board(&game);
+    assert(position_index_find(index_path, position_hash(&game), matches, 1, &total) == 1 && total == 3);
+
+    // Nothing changed: the index file is not rewritten
+    struct stat before, after;
+    assert(stat(index_path, &before) == 0);
+    assert(position_index_update(index_path, &root, 1, NULL, &stats));
+    assert(stats.files_reused == 2 && stats.files_indexed == 0 && stats.files_removed == 0);
+    assert(stats.games == 3 && stats.positions == 6 + 5 + 2);
+    assert(stat(index_path, &after) == 0 && after.st_ino == before.st_ino);
+
+    // Unchanged files are reused, removed ones dropped
+    unlink(pgn_path);
+    assert(position_index_update(index_path, &root, 1, NULL, &stats));
+    assert(stats.files_reused == 1 && stats.files_indexed == 0 && stats.files_removed == 1);
+    assert(position_index_find(index_path, position_hash(&game), matches, 4, &total) == 1 && total == 1);
+    assert(strcmp(matches[0].path, fen_path) == 0);
+
+    unlink(fen_path);
+    unlink(index_path);
+    rmdir(directory);
+    printf("PASSED\n");
+}
+
+/**
+ * Test building and probing a Polyglot opening book
+ * Tests: book_builder_add_record(), book_builder_write(), book_probe(), book_pick_move(), book_hash()
+ */
+void test_opening_book() {
+    printf("Testing opening book... ");
+
+    const char* white_win[] = {"e4", "e5", "Nf3", "Nc6", "Bc4", "Bc5", "O-O"};
+    const char* draw[] = {"d4", "d5"};
+    ChessGame game, other;
+    GameRecord record;
+    Move move;
+    BookBuilder builder;
+    book_builder_init(&builder, 0);
+
+    init_board(&game);
+    game_record_init(&record, &game);
+    for (int i = 0; i < 7; i++) {
+        assert(san_parse(&game, white_win[i], &move) && execute_move(&game, move));
+        assert(game_record_append(&record, move));
+    }
+    assert(book_builder_add_record(&builder, &record, "1-0"));
+    game_record_free(&record);
+
+    init_board(&game);
+    game_record_init(&record, &game);
+    for (int i = 0; i < 2; i++) {
+        assert(san_parse(&game, draw[i], &move) && execute_move(&game, move));
+        assert(game_record_append(&record, move));
+    }
+    assert(book_builder_add_record(&builder, &record, "1/2-1/2"));
+    game_record_free(&record);
+
+    // Losing side's moves get no weight: 4 white moves + d4 + d5
+    char path[] = "/tmp/micro_test_book_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+    assert(book_builder_write(&builder, path) == 6);
+    book_builder_free(&builder);
+
+    Book book;
+    BookMove moves[4];
+    assert(book_open(&book, path));
+    init_board(&game);
+    assert(book_probe(&book, &game, moves, 4) == 2);
+    assert(moves[0].weight == 2 && moves[0].move.from.row == 6 && moves[0].move.from.col == 4);
+    assert(moves[1].weight == 1 && moves[1].move.from.col == 3);
+
+    assert(san_parse(&game, "e4", &move) && execute_move(&game, move));
+    assert(book_probe(&book, &game, moves, 4) == 0);
+
+    // Castling is stored as king takes rook and played as a king move
+    char move_str[10];
+    assert(setup_board_from_fen(&game, "r1bqk1nr/pppp1ppp/2n5/2b1p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4"));
+    assert(book_pick_move(&book, &game, move_str) && strcmp(move_str, "e1g1") == 0);
+
+    book_close(&book);
+    unlink(path);
+
+    // Keys match the published Polyglot test positions
+    assert(setup_board_from_fen(&game, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"));
+    assert(book_hash(&game) == 0x463B96181691FC9CULL);
+    assert(setup_board_from_fen(&game, "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1"));
+    assert(book_hash(&game) == 0x823C9B50FD114196ULL);
+    assert(setup_board_from_fen(&game, "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3"));
+    assert(book_hash(&game) == 0x22A48B5A8E47FF78ULL);
+    assert(setup_board_from_fen(&game, "rnbq1bnr/ppp1pkpp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR w - - 0 4"));
+    assert(book_hash(&game) == 0x00FDD303C946BDD9ULL);
+    assert(setup_board_from_fen(&game, "rnbqkbnr/p1pppppp/8/8/P6P/R1p5/1P1PPPP1/1NBQKBNR b Kkq - 0 4"));
+    assert(book_hash(&game) == 0x5C3F9B829B279560ULL);
+
+    // Castling keys come from the pieces: a rook gone from its corner drops the right
+    init_board(&game);
+    game.board[7][0].type = EMPTY;
+    assert(setup_board_from_fen(&other, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/1NBQKBNR w Kkq - 0 1"));
+    assert(book_hash(&game) == book_hash(&other));
+    printf("PASSED\n");
+}
+
+/**
+ * Test opening explorer statistics with spilled runs and multi-pass merge
+ * Tests: pgn_reader_next() eval annotations, explorer_builder_*, explorer_lookup()
+ */
+void test_opening_explorer() {
+    printf("Testing opening explorer... ");
+
+    char directory[] = "/tmp/micro_test_explorer_XXXXXX";
+    assert(mkdtemp(directory) != NULL);
+    char pgn_path[128], output_path[128];
+    snprintf(pgn_path, sizeof(pgn_path), "%s/games.pgn", directory);
+    snprintf(output_path, sizeof(output_path), "%s/explorer.cxp", directory);
+
+    // 40 games: 1.e4 e5 won by White (every 4th with evals), 1.e4 c5 drawn, 1.d4 lost
+    FILE* file = fopen(pgn_path, "w");
+    assert(file != NULL);
+    for (int i = 0; i < 40; i++) {
+        if (i % 4 == 0) {
+            fprintf(file, "[Result \"1-0\"]\n\n1. e4 { [%%eval 0.40] } e5 { [%%eval #-2] } 1-0\n\n");
+        } else if (i % 4 == 1) {
+            fprintf(file, "[Result \"1-0\"]\n\n1. e4 e5 1-0\n\n");
+        } else if (i % 4 == 2) {
+            fprintf(file, "[Result \"1/2-1/2\"]\n\n1. e4 c5 1/2-1/2\n\n");
+        } else {
+            fprintf(file, "[Result \"0-1\"]\n\n1. d4 d5 0-1\n\n");
+        }
+    }
+    fclose(file);
+
+    // One observation per run forces 40 runs, more than one merge pass
+    ExplorerBuilder builder;
+    assert(explorer_builder_init(&builder, output_path, 0, 1));
+    builder.capacity = 1;
+    assert(explorer_builder_add_pgn(&builder, pgn_path) == 40);
+    assert(builder.next_run > EXPLORER_MERGE_FANIN);
+    assert(explorer_builder_finish(&builder) == 2);
+    explorer_builder_free(&builder);
+
+    ChessGame game;
+    ExplorerRecord records[4];
+    init_board(&game);
+    assert(explorer_lookup(output_path, position_hash(&game), records, 4) == 2);
+    Move e4 = cgr_unpack_move(records[0].move);
+    assert(e4.from.row == 6 && e4.from.col == 4 && e4.to.row == 4);
+    assert(records[0].games == 30 && records[0].white_wins == 20 && records[0].draws == 10);
+    assert(records[0].eval_count == 10 && records[0].eval_sum == 400);
+    assert(records[1].games == 10 && records[1].black_wins == 10 && records[1].eval_count == 0);
+
+    // A short output still gets the most played move, not the first stored
+    assert(explorer_lookup(output_path, position_hash(&game), records, 1) == 1);
+    assert(records[0].games == 30);
+
+    // Only the first ply of each game was added
+    Move move;
+    assert(san_parse(&game, "e4", &move) && execute_move(&game, move));
+    assert(explorer_lookup(output_path, position_hash(&game), records, 4) == 0);
+
+    // No run files are left behind
+    char run_path[160];
+    snprintf(run_path, sizeof(run_path), "%s.run0", output_path);
+    assert(access(run_path, F_OK) != 0);
+
+    unlink(pgn_path);
+    unlink(output_path);
+    rmdir(directory);
+    printf("PASSED\n");
+}
+
+/**
+ * Test endgame tablebase generation and probing
+ * Tests: tablebase_generate(), tablebase_init(), tablebase_probe(), tablebase_best_move()
+ */
+void test_tablebase() {
+    printf("Testing endgame tablebase... ");
+
+    char directory[] = "/tmp/micro_test_tablebase_XXXXXX";
+    assert(mkdtemp(directory) != NULL);
+    assert(tablebase_max_pieces() == 0);
+    assert(tablebase_generate(QUEEN, directory));
+    assert(tablebase_generate(PAWN, directory));
+    tablebase_free();
+
+    // Reload the written tables (KPvK also needs KRvK) through the memory-mapped path
+    assert(tablebase_init(directory) == 3);
+    assert(tablebase_max_pieces() == 3);
+
+    ChessGame game;
+    TbResult result;
+    Move move;
+    memset(&game, 0, sizeof(game));
+
+    // Mate in one, and the best move delivers it
+    assert(setup_board_from_fen(&game, "7k/5Q2/6K1/8/8/8/8/8 w - - 0 1"));
+    assert(tablebase_probe(&game, &result) && result.wdl == TB_WIN && result.distance == 1);
+    assert(tablebase_best_move(&game, &move, &result));
+    assert(execute_move(&game, move) && is_in_check(&game, BLACK));
+    assert(tablebase_probe(&game, &result) && result.wdl == TB_LOSS && result.distance == 0);
+
+    // Same position with Black to move is stalemate
+    assert(setup_board_from_fen(&game, "7k/5Q2/6K1/8/8/8/8/8 b - - 0 1"));
+    assert(tablebase_probe(&game, &result) && result.wdl == TB_DRAW);
+
+    // Colors flipped: Black queen, White to move is mated in 2 moves at most
+    assert(setup_board_from_fen(&game, "8/8/8/8/8/6k1/5q2/7K w - - 0 1"));
+    assert(tablebase_probe(&game, &result) && result.wdl == TB_DRAW);
+    assert(setup_board_from_fen(&game, "8/8/8/8/8/5k2/3q4/7K w - - 0 1"));
+    assert(tablebase_probe(&game, &result) && result.wdl == TB_LOSS && result.distance == 2);
+
+    // A lone minor piece is a draw without a table; more material is not covered
+    assert(setup_board_from_fen(&game, "8/8/8/4k3/8/8/2N5/4K3 w - - 0 1"));
+    assert(tablebase_probe(&game, &result) && result.wdl == TB_DRAW);
+    assert(setup_board_from_fen(&game, "8/8/8/4k3/8/8/2RN4/4K3 w - - 0 1"));
+    assert(!tablebase_probe(&game, &result));
+
+    // Pawns on the first or last rank are outside the pawn table
+    assert(setup_board_from_fen(&game, "4k3/8/8/8/8/8/P7/4K3 w - - 0 1"));
+    assert(tablebase_probe(&game, &result));
+    assert(setup_board_from_fen(&game, "4k3/8/8/8/8/8/8/P3K3 w - - 0 1"));
+    assert(!tablebase_probe(&game, &result));
+    assert(setup_board_from_fen(&game, "8/8/8/8/8/8/8/K1k4p w - - 0 1"));
+    assert(!tablebase_probe(&game, &result) && !tablebase_best_move(&game, &move, &result));
+    init_board(&game);
+    assert(!tablebase_probe(&game, &result));
+
+    tablebase_free();
+    char path[128];
+    snprintf(path, sizeof(path), "%s/KQvK.ctb", directory);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s/KRvK.ctb", directory);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s/KPvK.ctb", directory);
+    unlink(path);
+    rmdir(directory);
+    printf("PASSED\n");
+}
+
+/**
+ * Test the built-in search engine
+ * Tests: evaluate_position(), search_position() (one and four threads), init_builtin_engine(), get_best_move(), get_position_evaluation()
+ */
+void test_builtin_search() {
+    printf("Testing built-in search... ");
+
+    ChessGame game;
+    SearchLimits limits = {4, 0, 1, NULL, NULL};
+    SearchResult result;
+    memset(&game, 0, sizeof(game));
+
+    // The starting position is symmetric; an extra queen is worth a lot
+    init_board(&game);
+    assert(evaluate_position(&game) == 0);
+    game.current_player = BLACK;
+    assert(evaluate_position(&game) == 0);
+    assert(setup_board_from_fen(&game, "4k3/8/8/8/8/8/8/3QK3 w - - 0 1"));
+    assert(evaluate_position(&game) > 800);
+    game.current_player = BLACK;
+    assert(evaluate_position(&game) < -800);
+
+    // Back-rank mate in one
+    assert(setup_board_from_fen(&game, "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1"));
+    assert(search_position(&game, &limits, &result));
+    assert(result.best_move.from.row == 7 && result.best_move.from.col == 3);
+    assert(result.best_move.to.row == 0 && result.best_move.to.col == 3);
+    assert(result.score == SEARCH_MATE_SCORE - 1);
+
+    // Wins a hanging queen
+    assert(setup_board_from_fen(&game, "4k3/8/8/3q4/8/8/3R4/4K3 w - - 0 1"));
+    assert(search_position(&game, &limits, &result));
+    assert(result.best_move.to.row == 3 && result.best_move.to.col == 3 && result.score > 300);
+
+    // Stalemate and checkmate have no move
+    assert(setup_board_from_fen(&game, "7k/5Q2/6K1/8/8/8/8/8 b - - 0 1"));
+    assert(!search_position(&game, &limits, &result));
+
+    // Lazy SMP: four threads agree on the mate; a time limit stops them all
+    SearchLimits parallel = {5, 0, 4, NULL, NULL};
+    assert(setup_board_from_fen(&game, "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1"));
+    assert(search_position(&game, &parallel, &result) && result.score == SEARCH_MATE_SCORE - 1);
+    init_board(&game);
+    parallel.max_depth = SEARCH_MAX_PLY - 1;
+    parallel.time_ms = 50;
+    assert(search_position(&game, &parallel, &result) && result.depth >= 1 && result.time_ms < 1000);
+    assert(search_default_threads() >= 1);
+
+    // The engine handle answers through the Stockfish interface
+    StockfishEngine engine;
+    char move_str[10];
+    int score;
+    assert(init_builtin_engine(&engine) && engine.builtin);
+    assert(set_skill_level(&engine, 2));
+    init_board(&game);
+    assert(get_best_move(&engine, &game, move_str, false));
+    Move move = parse_move_string(move_str);
+    assert(is_valid_move(&game, move.from, move.to));
+    assert(setup_board_from_fen(&game, "4k3/8/8/8/8/8/8/3QK3 b - - 0 1"));
+    assert(get_position_evaluation(&engine, &game, &score) && score < -800);
+    TTData entry;
+    assert(tt_size_mb(&engine.table) == TT_DEFAULT_MB && tt_probe(&engine.table, position_hash(&game), &entry));
+    assert(set_hash_size(&engine, 2) && tt_size_mb(&engine.table) == 2 && !set_hash_size(&engine, 0));
+
+    // Checkmate scores as lost for the side to move, stalemate as even
+    assert(setup_board_from_fen(&game, "3R2k1/5ppp/8/8/8/8/8/6K1 b - - 0 1"));
+    assert(get_position_evaluation(&engine, &game, &score) && score == -SEARCH_MATE_SCORE);
+    assert(setup_board_from_fen(&game, "7k/5Q2/6K1/8/8/8/8/8 b - - 0 1"));
+    assert(get_position_evaluation(&engine, &game, &score) && score == 0);
+    close_stockfish(&engine);
+    assert(tt_size_mb(&engine.table) == 0);
+
+    printf("PASSED\n");
+}
+
+/**
+ * Test the bucketed transposition table
+ * Tests: tt_init(), tt_store(), tt_probe(), tt_new_search(), tt_hashfull(), separate tables
+ */
+void test_transposition_table() {
+    printf("Testing transposition table... ");
+
+    TranspositionTable table = {0};
+    TTData data;
+    assert(!tt_init(&table, 0));
+    assert(tt_init(&table, 1) && tt_size_mb(&table) == 1);
+    size_t buckets = 1024 * 1024 / 64;
+
+    // Store and read back, negative scores and depths included
+    uint64_t key = 0x123456789ABCDEF0ULL;
+    assert(!tt_probe(&table, key, &data));
+    tt_store(&table, key, 7, -1234, TT_BOUND_LOWER, 0x0ABC);
+    assert(tt_probe(&table, key, &data));
+    assert(data.depth == 7 && data.score == -1234 && data.bound == TT_BOUND_LOWER && data.move == 0x0ABC);
+
+    // A shallower bound does not replace it; an exact result does, keeping the move
+    tt_store(&table, key, 3, 50, TT_BOUND_UPPER, 0);
+    assert(tt_probe(&table, key, &data) && data.depth == 7);
+    tt_store(&table, key, 2, 60, TT_BOUND_EXACT, 0);
+    assert(tt_probe(&table, key, &data) && data.depth == 2 && data.score == 60 && data.move == 0x0ABC);
+
+    // Five positions in one bucket: the shallowest is replaced
+    tt_clear(&table);
+    for (uint64_t i = 1; i <= 4; i++) {
+        tt_store(&table, key + i * buckets, (int)i * 2, 0, TT_BOUND_EXACT, 0);
+    }
+    tt_store(&table, key + 5 * buckets, 5, 0, TT_BOUND_EXACT, 0);
+    assert(!tt_probe(&table, key + 1 * buckets, &data));
+    for (uint64_t i = 2; i <= 5; i++) assert(tt_probe(&table, key + i * buckets, &data));
+
+    // After two new searches, old deep entries lose to a fresh shallow one
+    tt_new_search(&table);
+    tt_new_search(&table);
+    tt_store(&table, key + 6 * buckets, 1, 0, TT_BOUND_EXACT, 0);
+    assert(tt_probe(&table, key + 6 * buckets, &data));
+    assert(!tt_probe(&table, key + 2 * buckets, &data));
+    assert(tt_hashfull(&table) >= 0);
+
+    // Keys of other positions in the same bucket never match
+    assert(!tt_probe(&table, key ^ (1ULL << 63), &data));
+
+    // Tables are independent: another engine's searches do not age this one
+    TranspositionTable other = {0};
+    assert(tt_init(&other, 1));
+    tt_new_search(&other);
+    assert(!tt_probe(&other, key + 6 * buckets, &data));
+    assert(tt_probe(&table, key + 6 * buckets, &data) && table.generation == 2);
+    tt_free(&other);
+
+    tt_free(&table);
+    assert(tt_size_mb(&table) == 0 && !tt_probe(&table, key, &data));
+    printf("PASSED\n");
+}
+
+/**
+ * Test static exchange evaluation and hanging piece detection
+ * Tests: static_exchange_eval(), is_piece_hanging(), set_hanging_overlay()
+ */
+void test_static_exchange() {
+    printf("Testing static exchange evaluation... ");
+
+    ChessGame game;
+    Move capture = {0};
+    capture.is_capture = true;
+
+    // Pawn takes a knight defended by a pawn: wins knight for pawn
+    assert(setup_board_from_fen(&game, "4k3/2p5/3n4/4P3/8/8/8/4K3 w - - 0 1"));
+    capture.from = char_to_position("e5");
+    capture.to = char_to_position("d6");
+    assert(static_exchange_eval(&game, capture) == 320 - 100);
+    assert(is_piece_hanging(&game, char_to_position("d6")));
+    assert(!is_piece_hanging(&game, char_to_position("e5")));
+    assert(!is_piece_hanging(&game, char_to_position("e8")));   // Kings never hang
+
+    // Rook takes a pawn defended by a pawn: loses the exchange
+    assert(setup_board_from_fen(&game, "4k3/8/4p3/3p4/8/8/8/3RK3 w - - 0 1"));
+    capture.from = char_to_position("d1");
+    capture.to = char_to_position("d5");
+    assert(static_exchange_eval(&game, capture) == 100 - 500);
+    assert(!is_piece_hanging(&game, char_to_position("d5")));
+
+    // Doubled rooks: the rook behind joins in once the front rook has captured
+    assert(setup_board_from_fen(&game, "3rk3/8/8/3p4/8/8/3R4/3RK3 w - - 0 1"));
+    capture.from = char_to_position("d2");
+    capture.to = char_to_position("d5");
+    assert(static_exchange_eval(&game, capture) == 100);
+    assert(is_piece_hanging(&game, char_to_position("d5")));
+
+    // En passant wins the pawn beside the destination; non-captures are 0
+    assert(setup_board_from_fen(&game, "4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1"));
+    capture.from = char_to_position("e5");
+    capture.to = char_to_position("d6");
+    assert(static_exchange_eval(&game, capture) == 100);
+    capture.from = char_to_position("e1");
+    capture.to = char_to_position("e2");
+    assert(static_exchange_eval(&game, capture) == 0);
+
+    set_hanging_overlay(true);
+    assert(is_hanging_overlay_enabled());
+    set_hanging_overlay(false);
+    assert(!is_hanging_overlay_enabled());
+
+    printf("PASSED\n");
+}
+
+/**
+ * Test the diff-based terminal renderer
+ * Tests: screen_frame_layout(), screen_frame_diff()
+ */
+void test_screen_renderer() {
+    printf("Testing diff-based screen renderer... ");
+
+    static ScreenFrame before, after;
+    ScreenBuffer out = {NULL, 0, 0};
+    const char *text = "8 | " COLOR_BLACK_PIECE "r" SCREEN_RESET " . |\n\tx\n";
+
+    // Layout: colors become cell styles, tabs expand, cursor ends below
+    screen_frame_layout(&before, text, strlen(text));
+    assert(!before.overflow && before.rows == 3);
+    assert(before.row_length[0] == 9 && before.row_length[1] == 9);
+    assert(before.cells[0][4].text[0] == 'r' && before.cells[0][4].style != 0);
+    assert(before.cells[0][6].text[0] == '.' && before.cells[0][6].style == 0);
+    assert(before.cursor_row == 2 && before.cursor_col == 0);
+
+    // A full paint writes every cell
+    screen_frame_diff(NULL, &before, &out);
+    assert(out.length > strlen("8 | r . |") && memmem(out.data, out.length, "8 | ", 4) != NULL);
+
+    // An identical frame only clears below and parks the cursor
+    out.length = 0;
+    screen_frame_layout(&after, text, strlen(text));
+    screen_frame_diff(&before, &after, &out);
+    assert(memchr(out.data, 'r', out.length) == NULL && memchr(out.data, '8', out.length) == NULL);
+
+    // One changed cell is addressed directly (row 1, column 7)
+    const char *moved = "8 | " COLOR_BLACK_PIECE "r" SCREEN_RESET " * |\n\tx\n";
+    out.length = 0;
+    screen_frame_layout(&after, moved, strlen(moved));
+    screen_frame_diff(&before, &after, &out);
+    assert(memmem(out.data, out.length, "\033[1;7H", 6) != NULL);
+    assert(memchr(out.data, '*', out.length) != NULL && memchr(out.data, 'r', out.length) == NULL);
+    assert(out.length < 40);
+
+    // UTF-8 characters take one cell
+    screen_frame_layout(&after, "← →", strlen("← →"));
+    assert(after.row_length[0] == 3 && after.cells[0][0].length == 3);
+
+    screen_buffer_free(&out);
+    printf("PASSED\n");
+}
+
+/**
+ * Test board highlight masks
+ * Tests: get_board_highlights(), get_move_highlights(), last move tracking
+ */
+void test_board_highlights() {
+    printf("Testing board highlight masks... ");
+
+    ChessGame game;
+    BoardHighlights highlights;
+
+    // En passant: f6 is a move, the f5 pawn it removes is marked separately
+    assert(setup_board_from_fen(&game, "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3"));
+    get_board_highlights(&game, &highlights);
+    assert(highlights.last_move == 0 && highlights.check == 0);
+    assert(get_move_highlights(&game, char_to_position("e5"), &highlights) == 2);
+    assert(highlights.moves == (SQUARE_BIT(2, 4) | SQUARE_BIT(2, 5)));   // e6, f6
+    assert(highlights.captures == 0 && highlights.en_passant == SQUARE_BIT(3, 5));   // f5
+
+    // Knight on b1: two empty destinations, no captures
+    memset(&highlights, 0, sizeof(highlights));
+    assert(get_move_highlights(&game, char_to_position("b1"), &highlights) == 2);
+    assert(highlights.moves == (SQUARE_BIT(5, 0) | SQUARE_BIT(5, 2)));   // a3, c3
+
+    // After a move, its squares are the last move highlight
+    assert(make_move(&game, char_to_position("e5"), char_to_position("f6")));
+    get_board_highlights(&game, &highlights);
+    assert(highlights.last_move == (SQUARE_BIT(3, 4) | SQUARE_BIT(2, 5)));
+    assert(game.last_move.is_capture && game.last_move.captured.type == PAWN);
+
+    // Captures and a king in check
+    assert(setup_board_from_fen(&game, "4k3/8/8/8/8/8/4p3/4R2K w - - 0 1"));
+    memset(&highlights, 0, sizeof(highlights));
+    get_move_highlights(&game, char_to_position("e1"), &highlights);
+    assert(highlights.captures == SQUARE_BIT(6, 4));   // e2
+    assert(setup_board_from_fen(&game, "4k3/8/8/8/8/8/8/4R2K b - - 0 1"));
+    get_board_highlights(&game, &highlights);
+    assert(highlights.check == SQUARE_BIT(0, 4));   // e8
+
+    printf("PASSED\n");
+}
+
+/**
+ * Test the millisecond game clock and in-place clock fields
+ * Tests: stop_move_timer() accounting, format_clock(), screen_frame_update_field()
+ */
+void test_game_clock() {
+    printf("Testing millisecond game clock... ");
+
+    ChessGame game;
+    init_board(&game);
+    TimeControl control;
+    assert(parse_time_control("5/3", &control) && control.enabled);
+    init_game_timer(&game, &control);
+    assert(game.timer.white_time_ms == 300000);
+
+    // 1.5 s spent, 3 s increment: charged to the millisecond
+    start_move_timer(&game);
+    game.timer.move_start_ms -= 1500;
+    int64_t running = get_remaining_time_ms(&game, WHITE);
+    assert(running <= 298500 && running > 298400);
+    stop_move_timer(&game);
+    assert(game.timer.white_time_ms <= 301500 && game.timer.white_time_ms > 301400);
+    assert(get_remaining_time_ms(&game, BLACK) == 300000);
+
+    // Flag-fall as soon as the running clock reaches zero
+    game.current_player = BLACK;
+    start_move_timer(&game);
+    game.timer.move_start_ms -= 300000;
+    assert(check_time_forfeit(&game) && get_remaining_time_ms(&game, BLACK) == 0);
+
+    char text[CLOCK_STRING_SIZE];
+    format_clock(65000, text, sizeof(text));
+    assert(strcmp(text, "1:05") == 0);
+    format_clock(19950, text, sizeof(text));
+    assert(strcmp(text, "0:19.9") == 0);
+    format_clock(-40, text, sizeof(text));
+    assert(strcmp(text, "0:00.0") == 0);
+
+    // A clock field rewrites only its own row and shifts the text after it
+    static ScreenFrame frame;
+    const char *line = "White: 1:05 | Captured: Q\nBlack: 5:00\n";
+    memset(frame.fields, 0, sizeof(frame.fields));
+    frame.fields[0] = (ScreenField){7, 11, true, false, 0, 0, 0, 0};
+    screen_frame_layout(&frame, line, strlen(line));
+    assert(frame.fields[0].placed && frame.fields[0].row == 0 && frame.fields[0].col == 7 && frame.fields[0].width == 4);
+
+    ScreenBuffer out = {NULL, 0, 0};
+    assert(screen_frame_update_field(&frame, 0, "1:05", &out) && out.length == 0);
+    assert(screen_frame_update_field(&frame, 0, "0:19.9", &out));
+    assert(memmem(out.data, out.length, "\033[1;8H", 6) != NULL && memmem(out.data, out.length, "0:19.9 | Captured: Q", 20) != NULL);
+    assert(frame.row_length[0] == 27 && frame.cells[0][26].text[0] == 'Q' && frame.row_length[1] == 11);
+    assert(!screen_frame_update_field(&frame, 1, "0:00", &out));
+
+    screen_buffer_free(&out);
+    printf("PASSED\n");
+}
+
+/**
+ * Play one timed move that took elapsed_ms (test helper)
+ */
+static void play_timed_move(ChessGame *game, Color color, int64_t elapsed_ms) {
+    game->current_player = color;
+    start_move_timer(game);
+    game->timer.move_start_ms -= elapsed_ms;
+    stop_move_timer(game);
+}
+
+/**
+ * Test extended time controls
+ * Tests: parse_time_control() formats, delay and Bronstein accounting,
+ *        multi-period controls, byoyomi, get_clock_budget()
+ */
+void test_extended_time_control() {
+    printf("Testing extended time controls... ");
+
+    ChessGame game;
+    init_board(&game);
+    TimeControl control;
+    char text[TIME_CONTROL_STRING_SIZE];
+
+    // Classic forms still parse; extended text round-trips through describe
+    assert(parse_time_control("30/10/5/0", &control) && control.white.periods[0].minutes == 30);
+    assert(control.black.periods[0].minutes == 5 && control.black.periods[0].bonus_seconds == 0);
+    assert(parse_time_control("0/0", &control) && !control.enabled);
+    assert(parse_time_control("40/90+30,G/30+30,byo5x30 g/5d3", &control) && control.enabled);
+    assert(control.white.period_count == 2 && control.white.periods[0].moves == 40 && control.white.byoyomi_periods == 5);
+    describe_time_control(&control.white, text, sizeof(text));
+    assert(strcmp(text, "40/90+30,G/30+30,byo5x30") == 0);
+    describe_time_control(&control.black, text, sizeof(text));
+    assert(strcmp(text, "G/5d3") == 0);
+    // Bare 40/120 is classic minutes/increment; a bonus makes it one repeating period
+    assert(parse_time_control("40/120", &control) && control.white.periods[0].moves == 0 && control.white.periods[0].minutes == 40);
+    assert(parse_time_control("40/120+0", &control) && control.white.period_count == 1);
+    assert(control.white.periods[0].moves == 40 && control.white.periods[0].minutes == 120);
+    assert(!parse_time_control("G/30,40/90", &control));     // Nothing after sudden death
+    assert(!parse_time_control("90x", &control));
+    assert(!parse_time_control("1/2/3", &control));
+
+    // Simple delay: a 2.5 s move with a 3 s delay costs nothing
+    assert(parse_time_control("G/1d3", &control));
+    init_game_timer(&game, &control);
+    play_timed_move(&game, WHITE, 2500);
+    assert(game.timer.white_time_ms == 60000);
+    play_timed_move(&game, WHITE, 5000);
+    assert(game.timer.white_time_ms > 57900 && game.timer.white_time_ms <= 58000);
+
+    // Bronstein: time used comes back, at most the delay
+    assert(parse_time_control("G/1b3", &control));
+    init_game_timer(&game, &control);
+    play_timed_move(&game, WHITE, 2000);
+    assert(game.timer.white_time_ms > 59900 && game.timer.white_time_ms <= 60000);
+    play_timed_move(&game, WHITE, 10000);
+    assert(game.timer.white_time_ms > 52900 && game.timer.white_time_ms <= 53000);
+
+    // Two moves in 1 minute, then 2 more minutes; moves to go counts down
+    assert(parse_time_control("2/1,G/2", &control));
+    init_game_timer(&game, &control);
+    ClockBudget budget;
+    get_clock_budget(&game, BLACK, &budget);
+    assert(budget.moves_to_go == 2 && budget.time_ms == 60000);
+    play_timed_move(&game, BLACK, 10000);
+    get_clock_budget(&game, BLACK, &budget);
+    assert(budget.moves_to_go == 1);
+    play_timed_move(&game, BLACK, 10000);
+    get_clock_budget(&game, BLACK, &budget);
+    assert(budget.moves_to_go == 0 && budget.time_ms > 159900 && budget.time_ms <= 160000);
+
+    // Byoyomi: an overrun costs a period, running out of periods is a loss
+    assert(parse_time_control("1,byo2x10", &control));
+    init_game_timer(&game, &control);
+    play_timed_move(&game, WHITE, 65000);    // 5 s into the first period: kept
+    assert(game.timer.white_time_ms == 0 && game.timer.byoyomi_left[WHITE] == 2);
+    format_player_clock(&game, WHITE, text, sizeof(text));
+    assert(strcmp(text, "BY2 0:10.0") == 0);
+    play_timed_move(&game, WHITE, 12000);    // Overran one period
+    assert(game.timer.byoyomi_left[WHITE] == 1 && !check_time_forfeit(&game));
+    play_timed_move(&game, WHITE, 10000);    // Overran the last one
+    assert(check_time_forfeit(&game));
+
+    printf("PASSED\n");
+}
+
+/**
+ * Run one protocol command and return what it wrote
+ */
+static const char *protocol_reply(ProtocolSession *session, const char *command) {
+    static char reply[4096];
+    char line[PROTOCOL_LINE_SIZE];
+    snprintf(line, sizeof(line), "%s", command);
+
+    long start = ftell(session->out);
+    protocol_execute(session, line);
+    if (session->searching) {
+        // Wait for bestmove the way a client would: the next command joins the search
+        char fen[] = "fen";
+        protocol_execute(session, fen);
+    }
+    fflush(session->out);
+    long end = ftell(session->out);
+    fseek(session->out, start, SEEK_SET);
+    size_t length = fread(reply, 1, (size_t)(end - start) < sizeof(reply) - 1 ? (size_t)(end - start) : sizeof(reply) - 1, session->out);
+    reply[length] = '\0';
+    fseek(session->out, end, SEEK_SET);
+    return reply;
+}
+
+/**
+ * Test the headless line protocol
+ * Tests: protocol_execute() position/moves/undo/fen/legal/pgn/eval/go/stop,
+ *        UCI and SAN moves, all-or-nothing move lists, JSON replies
+ */
+void test_protocol() {
+    printf("Testing headless protocol... ");
+
+    StockfishEngine engine;
+    ProtocolSession session;
+    FILE *out = tmpfile();
+    assert(out && init_builtin_engine(&engine));
+    assert(protocol_init(&session, &engine, out, PROTOCOL_TEXT));
+
+    // Positions and moves, UCI and SAN mixed
+    assert(strcmp(protocol_reply(&session, "isready"), "readyok\n") == 0);
+    assert(strcmp(protocol_reply(&session, "position startpos moves e2e4 e7e5 Nf3"), "ok\n") == 0);
+    assert(strcmp(protocol_reply(&session, "fen"),
+                  "fen rnbqkbnr/pppp1ppp/8/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R b KQkq - 1 2\n") == 0);
+    assert(strcmp(protocol_reply(&session, "pgn"), "pgn 1. e4 e5 2. Nf3 *\n") == 0);
+
+    // An illegal move rejects the whole list
+    assert(strncmp(protocol_reply(&session, "moves Nc6 e1e3"), "error illegal move e1e3", 23) == 0);
+    assert(strcmp(protocol_reply(&session, "undo"), "ok\n") == 0);
+    assert(strcmp(protocol_reply(&session, "fen"),
+                  "fen rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKBNR w KQkq e6 0 2\n") == 0);
+    assert(strncmp(protocol_reply(&session, "undo 5"), "error", 5) == 0);
+    assert(strncmp(protocol_reply(&session, "frobnicate"), "error unknown command", 21) == 0);
+    assert(strncmp(protocol_reply(&session, "position fen 8/8/8 w - - 0 1"), "error invalid FEN", 17) == 0);
+
+    // Promotions: a bare UCI move promotes to a queen, a suffix picks the piece
+    assert(strcmp(protocol_reply(&session, "position fen 7k/P7/8/8/8/8/8/K7 w - - 0 1 moves a7a8n"), "ok\n") == 0);
+    assert(strcmp(protocol_reply(&session, "fen"), "fen N6k/8/8/8/8/8/8/K7 b - - 0 1\n") == 0);
+    assert(strcmp(protocol_reply(&session, "position fen 7k/P7/8/8/8/8/8/K7 w - - 0 1"), "ok\n") == 0);
+    const char *legal = protocol_reply(&session, "legal");
+    assert(strstr(legal, " a7a8q") && strstr(legal, " a7a8n") && !strstr(legal, " a7a8 "));
+
+    // Engine: finds the back-rank mate; checkmate ends the PGN
+    assert(strcmp(protocol_reply(&session, "position fen 6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1"), "ok\n") == 0);
+    assert(strncmp(protocol_reply(&session, "go depth 2"), "bestmove d1d8\n", 14) == 0);
+    assert(strncmp(protocol_reply(&session, "eval static"), "eval cp ", 8) == 0);
+    assert(strcmp(protocol_reply(&session, "moves Rd8#"), "ok\n") == 0);
+    assert(strcmp(protocol_reply(&session, "legal"), "legal\n") == 0);
+    assert(strcmp(protocol_reply(&session, "pgn"), "pgn 1. Rd8# 1-0\n") == 0);
+
+    // stop ends an infinite search at once, and the move still comes back
+    assert(strcmp(protocol_reply(&session, "position startpos"), "ok\n") == 0);
+    char go[] = "go infinite";
+    protocol_execute(&session, go);
+    usleep(20000);
+    char stop[] = "stop";
+    protocol_execute(&session, stop);
+    assert(strncmp(protocol_reply(&session, "fen"), "bestmove ", 9) == 0);
+    char quit[] = "quit";
+    assert(!protocol_execute(&session, quit));
+    protocol_close(&session);
+
+    // JSON replies
+    rewind(out);
+    assert(protocol_init(&session, &engine, out, PROTOCOL_JSON));
+    assert(strcmp(protocol_reply(&session, "moves e4"), "{\"ok\":true}\n") == 0);
+    assert(strcmp(protocol_reply(&session, "fen"),
+                  "{\"fen\":\"rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1\"}\n") == 0);
+    assert(strncmp(protocol_reply(&session, "legal"), "{\"legal\":[\"", 11) == 0);
+    assert(strncmp(protocol_reply(&session, "pgn"), "{\"pgn\":\"[Event ", 15) == 0);
+    assert(strcmp(protocol_reply(&session, "moves e5 Ke3"), "{\"error\":\"illegal move Ke3\"}\n") == 0);
+    protocol_close(&session);
+
+    fclose(out);
+    close_stockfish(&engine);
+    printf("PASSED\n");
+}
+
+/**
+ * Test engine self-play and match statistics
+ * Tests: selfplay_parse_engine(), selfplay_adjudicate(), selfplay_play_game(),
+ *        match_score_add(), match_elo(), match_los(), match_sprt()
+ */
+void test_selfplay() {
+    printf("Testing self-play and match statistics... ");
+
+    EngineSpec spec;
+    assert(selfplay_parse_engine("builtin:skill=5,threads=2", &spec) && spec.builtin);
+    assert(spec.skill_level == 5 && spec.threads == 2);
+    assert(selfplay_parse_engine("stockfish:nnue=big.nnue,hash=64", &spec) && !spec.builtin);
+    assert(strcmp(spec.eval_file, "big.nnue") == 0 && spec.hash_mb == 64 && spec.skill_level == MAX_SKILL_LEVEL);
+    assert(!selfplay_parse_engine("builtin:nnue=big.nnue", &spec));
+    assert(!selfplay_parse_engine("builtin:skill=21", &spec));
+    assert(!selfplay_parse_engine("crafty", &spec));
+
+    // Adjudication by the rules
+    ChessGame game;
+    char termination[SELFPLAY_TERMINATION_SIZE];
+    uint64_t hashes[9];
+    memset(&game, 0, sizeof(game));
+    assert(setup_board_from_fen(&game, "3R2k1/5ppp/8/8/8/8/5PPP/6K1 b - - 1 1"));
+    assert(strcmp(selfplay_adjudicate(&game, hashes, 0, termination), "1-0") == 0 && strcmp(termination, "checkmate") == 0);
+    assert(is_checkmate(&game, BLACK) && !is_stalemate(&game, BLACK) && has_legal_moves(&game, WHITE));
+    assert(setup_board_from_fen(&game, "7k/5Q2/6K1/8/8/8/8/8 b - - 0 1"));
+    assert(strcmp(selfplay_adjudicate(&game, hashes, 0, termination), "1/2-1/2") == 0 && strcmp(termination, "stalemate") == 0);
+    assert(is_stalemate(&game, BLACK) && !is_checkmate(&game, BLACK));
+    assert(setup_board_from_fen(&game, "4k3/8/8/8/8/8/2B2B2/4K3 w - - 0 1"));     // Bishops on both colors can mate
+    assert(selfplay_adjudicate(&game, hashes, 0, termination) == NULL);
+    assert(setup_board_from_fen(&game, "4k3/8/8/8/8/8/3B1B2/4K3 w - - 0 1"));
+    assert(strcmp(selfplay_adjudicate(&game, hashes, 0, termination), "1/2-1/2") == 0);
+    assert(strcmp(termination, "insufficient material") == 0);
+
+    // Knights shuffle back and forth: the start position recurs at plies 4 and 8
+    init_board(&game);
+    const char *shuffle[] = {"g1f3", "g8f6", "f3g1", "f6g8", "g1f3", "g8f6", "f3g1", "f6g8"};
+    hashes[0] = position_hash(&game);
+    for (int i = 0; i < 8; i++) {
+        assert(execute_move(&game, parse_move_string(shuffle[i])));
+        hashes[i + 1] = position_hash(&game);
+        const char *result = selfplay_adjudicate(&game, hashes, i + 2, termination);
+        assert(i < 7 ? result == NULL : strcmp(termination, "threefold repetition") == 0);
+    }
+
+    // The built-in engine finds the mate and the game ends there
+    StockfishEngine engine;
+    SelfPlayLimits limits = {0, 2, 10};
+    SelfPlayGame played;
+    assert(selfplay_parse_engine("builtin", &spec) && selfplay_open_engine(&spec, &engine));
+    assert(setup_board_from_fen(&game, "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1"));
+    assert(selfplay_play_game(&engine, &engine, &game, &limits, &played));
+    assert(strcmp(played.result, "1-0") == 0 && strcmp(played.termination, "checkmate") == 0);
+    assert(played.record.ply_count == 1);
+    game_record_free(&played.record);
+
+    // The ply limit scores a draw
+    init_board(&game);
+    limits.depth = 1;
+    limits.max_plies = 4;
+    assert(selfplay_play_game(&engine, &engine, &game, &limits, &played));
+    assert(strcmp(played.result, "1/2-1/2") == 0 && played.record.ply_count == 4);
+    game_record_free(&played.record);
+    close_stockfish(&engine);
+
+    // Scores count from the first engine's side
+    MatchScore score = {0, 0, 0};
+    match_score_add(&score, "1-0", true);
+    match_score_add(&score, "1-0", false);
+    match_score_add(&score, "0-1", false);
+    match_score_add(&score, "1/2-1/2", true);
+    assert(score.wins == 2 && score.losses == 1 && score.draws == 1);
+
+    // 75% is about +191 Elo; an even score is 0 with LOS 50%
+    MatchScore strong = {60, 30, 10};
+    double margin;
+    double elo = match_elo(&strong, &margin);
+    assert(elo > 190 && elo < 192 && margin > 40 && margin < 80);
+    MatchScore even = {20, 10, 20};
+    assert(match_elo(&even, NULL) == 0.0 && match_los(&even) == 0.5);
+    assert(match_los(&strong) > 0.99);
+
+    // SPRT: a clear winner accepts H1, a clear loser H0, a short match continues
+    SprtParams sprt = {0.0, 10.0, 0.05, 0.05};
+    double llr, lower, upper;
+    MatchScore winning = {400, 200, 300};
+    assert(match_sprt(&winning, &sprt, &llr, &lower, &upper) == SPRT_ACCEPT_H1 && llr >= upper);
+    assert(lower < -2.9 && lower > -3.0 && upper > 2.9 && upper < 3.0);
+    MatchScore losing = {300, 200, 400};
+    assert(match_sprt(&losing, &sprt, &llr, NULL, NULL) == SPRT_ACCEPT_H0 && llr <= lower);
+    MatchScore early = {3, 2, 2};
+    assert(match_sprt(&early, &sprt, NULL, NULL, NULL) == SPRT_CONTINUE);
+
+    printf("PASSED\n");
+}
+
+/**
+ * Run one server command for an in-process client and return its output
+ */
+static const char *server_reply(GameServer *server, int client, const char *command) {
+    static char reply[1024];
+    char line[SERVER_LINE_SIZE];
+    snprintf(line, sizeof(line), "%s", command);
+    server_execute(server, client, line);
+
+    ServerClient *state = &server->clients[client];
+    snprintf(reply, sizeof(reply), "%.*s", (int)state->out_used, state->out ? state->out : "");
+    state->out_used = 0;
+    return reply;
+}
+
+/**
+ * Test the multi-game server without a socket
+ * Tests: server_execute() create/move/query/resign/pgn/list/close,
+ *        events to watchers, engine pool moves, flag fall, journals
+ */
+void test_game_server() {
+    printf("Testing multi-game server... ");
+
+    static GameServer server;
+    char directory[] = "/tmp/micro_test_server_XXXXXX";
+    assert(mkdtemp(directory) != NULL);
+    assert(server_init(&server, NULL, directory, 1));
+    int alice = server_add_client(&server, -1);
+    int bob = server_add_client(&server, -1);
+    assert(alice >= 0 && bob >= 0 && alice != bob);
+
+    // Two humans; the creator gets the events of its game
+    assert(strcmp(server_reply(&server, alice, "create both"), "created 1\n") == 0);
+    assert(strcmp(server_reply(&server, alice, "move 1 e4"), "moved 1 e2e4 e4\nok\n") == 0);
+    assert(strcmp(server_reply(&server, bob, "watch 1"), "ok\n") == 0);
+    assert(strcmp(server_reply(&server, bob, "move 1 c7c5"), "moved 1 c7c5 c5\nok\n") == 0);
+    assert(strcmp(server_reply(&server, alice, ""), "moved 1 c7c5 c5\n") == 0);
+    assert(strcmp(server_reply(&server, alice, "query 1"),
+                  "state 1 playing * white -1 -1 rnbqkbnr/pp1ppppp/8/2p5/4P3/8/PPPP1PPP/RNBQKBNR w KQkq c6 0 2\n") == 0);
+    assert(strcmp(server_reply(&server, alice, "move 1 e4e6"), "error illegal move e4e6\n") == 0);
+    assert(strcmp(server_reply(&server, alice, "move 9 e4e5"), "error no such session\n") == 0);
+    assert(strcmp(server_reply(&server, alice, "resign 1"), "error usage: resign <id> white|black\n") == 0);
+
+    // The engine pool answers for the engine's side
+    assert(strcmp(server_reply(&server, bob, "create black skill 0"), "created 2\n") == 0);
+    assert(strcmp(server_reply(&server, bob, "move 2 e5"), "error engine to move\n") == 0);
+    for (int i = 0; i < 100 && server_find_session(&server, 2)->game.current_player == WHITE; i++) {
+        server_run_once(&server, 100);
+    }
+    assert(strncmp(server_reply(&server, bob, ""), "moved 2 ", 8) == 0);
+    assert(strncmp(server_reply(&server, bob, "query 2"), "state 2 playing * black -1 -1 ", 30) == 0);
+
+    // Flag fall ends a timed game on the next loop pass
+    assert(strcmp(server_reply(&server, alice, "create both time 1/1"), "created 3\n") == 0);
+    server_find_session(&server, 3)->game.timer.white_time_ms = 0;
+    server_run_once(&server, 0);
+    assert(strcmp(server_reply(&server, alice, ""), "over 3 0-1 time forfeit\n") == 0);
+    assert(strcmp(server_reply(&server, alice, "move 3 e4"), "error game over\n") == 0);
+
+    // Resignation, PGN, listing and closing
+    assert(strcmp(server_reply(&server, alice, "resign 1 black"), "ok\nover 1 1-0 black resigns\n") == 0);
+    assert(strcmp(server_reply(&server, bob, ""), "over 1 1-0 black resigns\n") == 0);
+    assert(strcmp(server_reply(&server, alice, "pgn 1"), "pgn 1 1. e4 c5 1-0\n") == 0);
+    assert(strcmp(server_reply(&server, alice, "list"), "sessions 3 1 2 3\n") == 0);
+    assert(strcmp(server_reply(&server, alice, "close 2"), "ok\n") == 0);
+    assert(strcmp(server_reply(&server, alice, "list"), "sessions 2 1 3\n") == 0);
+    assert(strncmp(server_reply(&server, alice, "fly"), "error unknown command", 21) == 0);
+
+    // Each game has its own journal: one FEN per position
+    char path[128], line[128];
+    snprintf(path, sizeof(path), "%s/session_1.fen", directory);
+    FILE *journal = fopen(path, "r");
+    assert(journal);
+    int lines = 0;
+    while (fgets(line, sizeof(line), journal)) lines++;
+    fclose(journal);
+    assert(lines == 3);
+    server_close(&server);
+
+    // A restarted server keeps the earlier journals and continues the ids
+    assert(server_init(&server, NULL, directory, 1));
+    alice = server_add_client(&server, -1);
+    assert(strcmp(server_reply(&server, alice, "create both"), "created 4\n") == 0);
+    journal = fopen(path, "r");
+    assert(journal);
+    lines = 0;
+    while (fgets(line, sizeof(line), journal)) lines++;
+    fclose(journal);
+    assert(lines == 3);
+
+    server_close(&server);
+    for (int id = 1; id <= 4; id++) {
+        snprintf(path, sizeof(path), "%s/session_%d.fen", directory, id);
+        unlink(path);
+    }
+    rmdir(directory);
+    printf("PASSED\n");
+}
+
+void test_profile() {
+    printf("Testing profiling counters... ");
+
+    ChessGame game;
+    Move moves[MAX_LEGAL_MOVES];
+    char fen[FEN_BUFFER_SIZE];
+    ProfileStats stats;
+
+    // Off by default: instrumented calls record nothing
+    init_board(&game);
+    profile_reset();
+    assert(!profile_enabled());
+    assert(profile_begin() == 0);
+    generate_legal_moves(&game, moves);
+    profile_snapshot(PROFILE_MOVE_GENERATION, &stats);
+    assert(stats.count == 0);
+
+    // Counting, with every call landing in one histogram bucket
+    profile_enable(true);
+    for (int i = 0; i < 10; i++) generate_legal_moves(&game, moves);
+    Position e2 = {6, 4}, e4 = {4, 4}, e5 = {3, 4};
+    assert(is_valid_move(&game, e2, e4));
+    assert(!is_valid_move(&game, e2, e5));
+    fen_write(&game, fen, sizeof(fen));
+    assert(fen_decode(&game, fen).code == FEN_OK);
+    profile_snapshot(PROFILE_MOVE_GENERATION, &stats);
+    assert(stats.count == 10 && stats.total_ns > 0 && stats.max_ns <= stats.total_ns);
+    uint64_t in_buckets = 0;
+    for (int bucket = 0; bucket < PROFILE_BUCKETS; bucket++) in_buckets += stats.buckets[bucket];
+    assert(in_buckets == 10);
+    assert(profile_percentile(&stats, 0.5) <= profile_percentile(&stats, 0.99));
+    assert(profile_percentile(&stats, 0.99) <= stats.max_ns);
+    profile_snapshot(PROFILE_LEGALITY_CHECK, &stats);
+    assert(stats.count == 2);
+    profile_snapshot(PROFILE_FEN_ENCODE, &stats);
+    assert(stats.count == 1);
+    profile_snapshot(PROFILE_FEN_DECODE, &stats);
+    assert(stats.count == 1);
+
+    // Hand-made histogram: 90 fast calls and 10 slow ones
+    memset(&stats, 0, sizeof(stats));
+    stats.count = 100;
+    stats.buckets[10] = 90;
+    stats.buckets[20] = 10;
+    stats.max_ns = 1500000;
+    assert(profile_percentile(&stats, 0.5) == 2047);
+    assert(profile_percentile(&stats, 0.99) == 1500000);
+
+    char text[16];
+    profile_format_ns(850, text, sizeof(text));
+    assert(strcmp(text, "850ns") == 0);
+    profile_format_ns(12345, text, sizeof(text));
+    assert(strcmp(text, "12.3us") == 0);
+    profile_format_ns(4560000, text, sizeof(text));
+    assert(strcmp(text, "4.56ms") == 0);
+    assert(strcmp(profile_counter_name(PROFILE_PGN_REBUILD), "pgn_rebuild") == 0);
+
+    // Trace file: FEN work is traced, move generation only counted
+    char path[] = "/tmp/micro_test_trace_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+    assert(profile_trace_start(path));
+    assert(!profile_trace_start(path));
+    fen_write(&game, fen, sizeof(fen));
+    generate_legal_moves(&game, moves);
+    assert(profile_trace_stop());
+    assert(!profile_trace_stop());
+
+    FILE *trace = fopen(path, "r");
+    assert(trace);
+    char contents[2048];
+    size_t length = fread(contents, 1, sizeof(contents) - 1, trace);
+    contents[length] = '\0';
+    fclose(trace);
+    unlink(path);
+    assert(strncmp(contents, "{\"traceEvents\":[", 16) == 0);
+    assert(strstr(contents, "\"name\":\"fen_encode\",\"cat\":\"chess\",\"ph\":\"X\""));
+    assert(!strstr(contents, "move_generation"));
+    assert(strstr(contents, "\"dropped_events\":0"));
+
+    profile_enable(false);
+    profile_reset();
+    profile_snapshot(PROFILE_FEN_ENCODE, &stats);
+    assert(stats.count == 0);
+    printf("PASSED\n");
+}
+
 int main() {
     printf("=== MICRO-TESTING FRAMEWORK ===\n");
     printf("Running safe, minimal-output tests...\n\n");
+    signal(SIGPIPE, SIG_IGN);   // Engine pipes, as in the programs that start engines
     
     test_board_init();
     test_position_conversion();
@@ -646,6 +2178,8 @@ int main() {
     test_complex_fen_and_check_detection();
     test_fifty_move_rule();
     test_en_passant_fen_parsing();
+    test_fen_write();
+    test_fen_decode_errors();
     test_en_passant_move_generation();
     test_en_passant_capture();
     test_promotion_detection();
@@ -654,6 +2188,26 @@ int main() {
     test_promotion_fen_integration();
     test_uci_promotion_parsing();
     test_pgn_conversion();
+    test_game_record();
+    test_history_undo();
+    test_history_tree();
+    test_san_parse();
+    test_san_write();
+    test_position_index();
+    test_opening_book();
+    test_opening_explorer();
+    test_tablebase();
+    test_builtin_search();
+    test_transposition_table();
+    test_static_exchange();
+    test_screen_renderer();
+    test_board_highlights();
+    test_game_clock();
+    test_extended_time_control();
+    test_protocol();
+    test_selfplay();
+    test_game_server();
+    test_profile();
 
     printf("\n✅ ALL MICRO-TESTS PASSED\n");
     printf("=== TESTING COMPLETE ===\n");
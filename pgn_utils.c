@@ -2,93 +2,153 @@
  * pgn_utils.c - PGN (Portable Game Notation) Utility Functions
  *
  * Purpose:
- *   Provides utilities for converting FEN log files to PGN format.
+ *   Provides utilities for converting game records and FEN log files to
+ *   PGN format, and a streaming reader for multi-game PGN files.
  *   Extracted from chess.c (lines 1052-1333) to create a dedicated PGN module.
  *
  * Architecture:
- *   - Reads FEN positions from log file
- *   - Compares consecutive positions to detect moves
- *   - Converts moves to standard algebraic notation
+ *   - Games are written from a GameRecord (root position + move list)
+ *   - FEN logs are first turned into a record by matching each pair of
+ *     consecutive positions against the legal moves (no board diffing)
+ *   - Every move is written by san_write(), which disambiguates and adds
+ *     "+"/"#" from legal move generation
  *   - Formats output as proper PGN with headers
+ *   - PgnReader reads one game at a time (tags, then movetext up to the
+ *     result), skipping comments, variations and NAGs, and decodes the
+ *     moves with a SanTable rebuilt per ply
  *
  * Dependencies:
- *   - chess.h: Core types (Piece, PieceType, Color, BOARD_SIZE)
- *   - char_to_piece_type() from chess.c for FEN parsing
+ *   - chess.h: Core types, fen_write(), execute_move()
+ *   - game_record.h: GameRecord, game_record_from_fen_log()
+ *   - san.h: san_table_build(), san_write()
  */
 
 #define _GNU_SOURCE        // Required for Linux (strdup, strcasecmp)
 
 #include "pgn_utils.h"
+#include "san.h"
 
-#include <ctype.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
+#include <ctype.h>
 
 /**
- * convert_fen_to_pgn_string() - Convert FEN log file to PGN format string
- *
- * This function reads a FEN log file (containing one FEN position per line)
- * and converts it to PGN (Portable Game Notation) format as a string.
- * Used for real-time PGN display during gameplay.
+ * Growable output string used while formatting PGN
+ */
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+} PgnBuffer;
+
+/**
+ * Append formatted text to a PGN buffer, growing it as needed
+ * Returns false (and leaves the buffer unchanged) on allocation failure
+ */
+static bool pgn_append(PgnBuffer *buffer, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+static bool pgn_append(PgnBuffer *buffer, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int needed = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    if (needed < 0) return false;
+
+    if (buffer->length + (size_t)needed + 1 > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity : 1024;
+        while (buffer->length + (size_t)needed + 1 > capacity) capacity *= 2;
+        char *data = realloc(buffer->data, capacity);
+        if (!data) return false;
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+
+    va_start(args, format);
+    vsnprintf(buffer->data + buffer->length, buffer->capacity - buffer->length, format, args);
+    va_end(args);
+    buffer->length += (size_t)needed;
+    return true;
+}
+
+/**
+ * Append the movetext of a record followed by the result
+ * Moves are numbered from the root position's fullmove number; a game
+ * starting with Black to move begins with "N...". A line break follows
+ * every sixth ply for readability.
+ */
+static bool pgn_append_movetext(PgnBuffer *buffer, const GameRecord *record, const char *result) {
+    SanTable table;
+    ChessGame game;
+    char san[SAN_BUFFER_SIZE];
+
+    memset(&game, 0, sizeof(game));
+    if (!cgr_unpack_position(record->root, &game)) return false;
+
+    for (int i = 0; i < record->ply_count; i++) {
+        if (game.current_player == WHITE) {
+            if (!pgn_append(buffer, "%d. ", game.fullmove_number)) return false;
+        } else if (i == 0) {
+            if (!pgn_append(buffer, "%d... ", game.fullmove_number)) return false;
+        }
+
+        san_table_build(&table, &game);
+        int index = san_table_index_of(&table, cgr_unpack_move(record->moves[i]));
+        if (index < 0 || san_write(&game, &table, index, san, sizeof(san)) == 0) return false;
+        if (!execute_move(&game, table.moves[index])) return false;
+
+        if (!pgn_append(buffer, "%s ", san)) return false;
+        if ((i + 1) % 6 == 0 && !pgn_append(buffer, "\n")) return false;
+    }
+
+    return pgn_append(buffer, "%s\n", result);
+}
+
+/**
+ * pgn_format_movetext() - Format the moves of a game record as PGN movetext
  *
- * @param fen_filename: Path to the FEN log file to convert
- * @param game_result: Game result string ("1-0" for White wins, "0-1" for Black wins,
- *                     "1/2-1/2" for draw, "*" for in-progress/unknown)
- * @return: Dynamically allocated string containing PGN notation, or NULL on error
+ * @param record: Game record to format
+ * @param game_result: Result marker appended after the moves ("*" if NULL or empty)
+ * @return: Dynamically allocated movetext ending in the result and a newline,
+ *          or NULL if a recorded move is illegal or memory runs out.
  *          Caller must free() the returned string
- *
- * Implementation notes:
- * - Reuses core logic from fen_to_pgn.c utility but returns string instead of writing file
- * - Handles all chess moves including castling, en passant, captures, and promotions
- * - Creates properly formatted PGN with headers and algebraic notation
- * - Memory management: Returns malloc'd string that caller must free
- * - Error handling: Returns NULL if file cannot be opened or memory allocation fails
  */
-char* convert_fen_to_pgn_string(const char* fen_filename, const char* game_result) {
-    #define MAX_LINE_LENGTH 256
-    #define MAX_MOVES 1000
-    #define MAX_PGN_SIZE 8192
-
-    typedef struct {
-        int from_row, from_col, to_row, to_col;
-        PieceType piece_type;
-        Color piece_color;
-        PieceType captured_piece;
-        int is_castle;
-        int is_en_passant;
-        PieceType promotion_piece;
-        int is_check;
-        int is_checkmate;
-    } PgnMove;
-
-    typedef struct {
-        int row, col;
-        PieceType type;
-        Color color;
-    } PieceChange;
-
-    FILE* input_file = fopen(fen_filename, "r");
-    if (!input_file) {
-        return NULL;
-    }
+char* pgn_format_movetext(const GameRecord* record, const char* game_result) {
+    const char* result = (game_result && game_result[0] != '\0') ? game_result : "*";
+    PgnBuffer buffer = {NULL, 0, 0};
 
-    char* pgn_string = malloc(MAX_PGN_SIZE);
-    if (!pgn_string) {
-        fclose(input_file);
+    if (!pgn_append_movetext(&buffer, record, result)) {
+        free(buffer.data);
         return NULL;
     }
+    return buffer.data;
+}
+
+/**
+ * convert_record_to_pgn_string() - Convert a game record to PGN format string
+ *
+ * Writes the session headers, SetUp/FEN headers for a non-standard
+ * starting position, and the movetext. Used directly for the live PGN
+ * view, where the session history already holds every move.
+ *
+ * @param record: Game record to convert
+ * @param game_result: Game result string ("1-0", "0-1", "1/2-1/2" or "*")
+ * @return: Dynamically allocated string containing PGN notation, or NULL on error
+ *          Caller must free() the returned string
+ */
+char* convert_record_to_pgn_string(const GameRecord* record, const char* game_result) {
+    // Use provided game_result or default to "*" (in-progress) if NULL
+    const char* result = (game_result && game_result[0] != '\0') ? game_result : "*";
+    PgnBuffer buffer = {NULL, 0, 0};
 
     time_t now = time(NULL);
     struct tm* timeinfo = localtime(&now);
     char date_str[20];
     strftime(date_str, sizeof(date_str), "%Y.%m.%d", timeinfo);
 
-    // Initial headers (FEN headers will be added later if needed)
-    // Use provided game_result or default to "*" (in-progress) if NULL
-    const char* result = (game_result && game_result[0] != '\0') ? game_result : "*";
-    snprintf(pgn_string, MAX_PGN_SIZE,
+    bool ok = pgn_append(&buffer,
         "[Event \"Current Game\"]\n"
         "[Site \"Claude Chess\"]\n"
         "[Date \"%s\"]\n"
@@ -97,250 +157,358 @@ char* convert_fen_to_pgn_string(const char* fen_filename, const char* game_resul
         "[Black \"AI\"]\n"
         "[Result \"%s\"]\n", date_str, result);
 
-    Piece prev_board[BOARD_SIZE][BOARD_SIZE];
-    Piece curr_board[BOARD_SIZE][BOARD_SIZE];
-    PgnMove moves[MAX_MOVES];
-    int move_count = 0;
-
-    char line[MAX_LINE_LENGTH];
-    char first_fen[MAX_LINE_LENGTH] = {0};
-    bool first_position = true;
-
-    while (fgets(line, sizeof(line), input_file) && move_count < MAX_MOVES) {
-        line[strcspn(line, "\n")] = 0;
-        if (strlen(line) == 0) continue;
-
-        memset(curr_board, 0, sizeof(curr_board));
-
-        int row = 0, col = 0;
-        const char* ptr = line;
-
-        while (*ptr && *ptr != ' ') {
-            if (*ptr == '/') {
-                row++;
-                col = 0;
-            } else if (isdigit(*ptr)) {
-                col += (*ptr - '0');
-            } else {
-                curr_board[row][col].type = char_to_piece_type(tolower(*ptr));
-                curr_board[row][col].color = isupper(*ptr) ? WHITE : BLACK;
-                col++;
-            }
-            ptr++;
-        }
-
-        if (first_position) {
-            // Save the first FEN string for PGN headers
-            strncpy(first_fen, line, sizeof(first_fen) - 1);
-            memcpy(prev_board, curr_board, sizeof(curr_board));
-            first_position = false;
-            continue;
-        }
-
-        PgnMove move = {0};
-
-        PieceChange disappeared[64], appeared[64];
-        int disappeared_count = 0, appeared_count = 0;
-
-        for (int i = 0; i < BOARD_SIZE; i++) {
-            for (int j = 0; j < BOARD_SIZE; j++) {
-                if (prev_board[i][j].type != EMPTY &&
-                    (curr_board[i][j].type != prev_board[i][j].type ||
-                     curr_board[i][j].color != prev_board[i][j].color)) {
-                    disappeared[disappeared_count].row = i;
-                    disappeared[disappeared_count].col = j;
-                    disappeared[disappeared_count].type = prev_board[i][j].type;
-                    disappeared[disappeared_count].color = prev_board[i][j].color;
-                    disappeared_count++;
-                }
-            }
-        }
-
-        for (int i = 0; i < BOARD_SIZE; i++) {
-            for (int j = 0; j < BOARD_SIZE; j++) {
-                if (curr_board[i][j].type != EMPTY &&
-                    (prev_board[i][j].type != curr_board[i][j].type ||
-                     prev_board[i][j].color != curr_board[i][j].color)) {
-                    appeared[appeared_count].row = i;
-                    appeared[appeared_count].col = j;
-                    appeared[appeared_count].type = curr_board[i][j].type;
-                    appeared[appeared_count].color = curr_board[i][j].color;
-                    appeared_count++;
-                }
-            }
-        }
-
-        bool move_found = false;
-        for (int i = 0; i < BOARD_SIZE && !move_found; i++) {
-            for (int j = 0; j < BOARD_SIZE && !move_found; j++) {
-                if (prev_board[i][j].type == KING && curr_board[i][j].type != KING) {
-                    for (int ni = 0; ni < BOARD_SIZE; ni++) {
-                        for (int nj = 0; nj < BOARD_SIZE; nj++) {
-                            if (curr_board[ni][nj].type == KING &&
-                                curr_board[ni][nj].color == prev_board[i][j].color &&
-                                prev_board[ni][nj].type != KING &&
-                                ni == i && abs(nj - j) == 2) {
-
-                                move.from_row = i; move.from_col = j;
-                                move.to_row = ni; move.to_col = nj;
-                                move.piece_type = KING;
-                                move.piece_color = prev_board[i][j].color;
-                                move.is_castle = 1;
-                                moves[move_count++] = move;
-                                move_found = true;
-                                break;
-                            }
-                        }
-                    }
-                }
-            }
+    // Add PGN standard FEN headers for a custom starting position
+    ChessGame root;
+    char first_fen[FEN_BUFFER_SIZE];
+    memset(&root, 0, sizeof(root));
+    if (ok && cgr_unpack_position(record->root, &root)) {
+        fen_write(&root, first_fen, sizeof(first_fen));
+        if (!pgn_is_standard_start(first_fen)) {
+            ok = pgn_append(&buffer, "[SetUp \"1\"]\n[FEN \"%s\"]\n", first_fen);
         }
+    }
 
-        if (!move_found) {
-            for (int d = 0; d < disappeared_count && !move_found; d++) {
-                for (int a = 0; a < appeared_count && !move_found; a++) {
-                    if (disappeared[d].type == appeared[a].type &&
-                        disappeared[d].color == appeared[a].color) {
-
-                        move.from_row = disappeared[d].row;
-                        move.from_col = disappeared[d].col;
-                        move.to_row = appeared[a].row;
-                        move.to_col = appeared[a].col;
-                        move.piece_type = disappeared[d].type;
-                        move.piece_color = disappeared[d].color;
-
-                        if (prev_board[appeared[a].row][appeared[a].col].type != EMPTY) {
-                            move.captured_piece = prev_board[appeared[a].row][appeared[a].col].type;
-                        }
-
-                        if (move.piece_type == PAWN &&
-                            move.from_col != move.to_col &&
-                            prev_board[move.to_row][move.to_col].type == EMPTY) {
-                            move.is_en_passant = 1;
-                        }
-
-                        if (move.piece_type == PAWN &&
-                            ((move.piece_color == WHITE && move.to_row == 0) ||
-                             (move.piece_color == BLACK && move.to_row == 7)) &&
-                            curr_board[move.to_row][move.to_col].type != PAWN) {
-                            move.promotion_piece = curr_board[move.to_row][move.to_col].type;
-                        }
-
-                        moves[move_count++] = move;
-                        move_found = true;
-                    }
-                }
-            }
-        }
+    // Blank line before moves
+    ok = ok && pgn_append(&buffer, "\n") && pgn_append_movetext(&buffer, record, result);
 
-        memcpy(prev_board, curr_board, sizeof(curr_board));
+    if (!ok) {
+        free(buffer.data);
+        return NULL;
     }
+    return buffer.data;
+}
 
-    fclose(input_file);
-
-    // Check if starting position is non-standard and add FEN headers if needed
+/**
+ * pgn_is_standard_start() - Check whether a FEN has the standard piece placement
+ *
+ * @param fen: FEN string (only the piece placement field is compared)
+ * @return: true if the pieces are in the standard starting position
+ */
+bool pgn_is_standard_start(const char* fen) {
     // Standard starting position FEN (first component only):
     // rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR
     const char* standard_position = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR";
+    size_t length = strcspn(fen, " ");
 
-    if (first_fen[0] != '\0') {
-        // Extract just the piece placement part (before first space)
-        char fen_pieces[MAX_LINE_LENGTH] = {0};
-        const char* space_pos = strchr(first_fen, ' ');
-        if (space_pos) {
-            size_t len = space_pos - first_fen;
-            if (len < sizeof(fen_pieces)) {
-                strncpy(fen_pieces, first_fen, len);
-                fen_pieces[len] = '\0';
-            }
-        } else {
-            strncpy(fen_pieces, first_fen, sizeof(fen_pieces) - 1);
-        }
+    return length == strlen(standard_position) && strncasecmp(fen, standard_position, length) == 0;
+}
 
-        // Compare with standard position (case-insensitive)
-        bool is_standard = (strcasecmp(fen_pieces, standard_position) == 0);
+/**
+ * convert_fen_to_pgn_string() - Convert FEN log file to PGN format string
+ *
+ * This function reads a FEN log file (containing one FEN position per line)
+ * and converts it to PGN (Portable Game Notation) format as a string.
+ * Used for PGN files saved at game end and for logs loaded from disk.
+ *
+ * @param fen_filename: Path to the FEN log file to convert
+ * @param game_result: Game result string ("1-0" for White wins, "0-1" for Black wins,
+ *                     "1/2-1/2" for draw, "*" for in-progress/unknown)
+ * @return: Dynamically allocated string containing PGN notation, or NULL on error
+ *          Caller must free() the returned string
+ *
+ * Implementation notes:
+ * - Each move is identified by matching the next position against the legal
+ *   moves of the previous one, so castling, en passant and promotions need
+ *   no special cases
+ * - Memory management: Returns malloc'd string that caller must free
+ * - Error handling: Returns NULL if the file cannot be opened, positions are
+ *   not consecutive, or memory allocation fails
+ */
+char* convert_fen_to_pgn_string(const char* fen_filename, const char* game_result) {
+    GameRecord record;
+    if (!game_record_from_fen_log(&record, fen_filename)) {
+        return NULL;
+    }
 
-        if (!is_standard) {
-            // Add PGN standard FEN headers for custom starting position
-            size_t current_len = strlen(pgn_string);
-            snprintf(pgn_string + current_len, MAX_PGN_SIZE - current_len,
-                "[SetUp \"1\"]\n[FEN \"%s\"]\n", first_fen);
-        }
+    char* pgn_string = convert_record_to_pgn_string(&record, game_result);
+    game_record_free(&record);
+    return pgn_string;
+}
+
+/**
+ * pgn_reader_init() - Start reading games from a stream
+ *
+ * @param reader: Reader to initialize
+ * @param file: Open PGN stream; the caller keeps ownership and closes it
+ */
+void pgn_reader_init(PgnReader* reader, FILE* file) {
+    reader->file = file;
+    reader->movetext = NULL;
+    reader->movetext_capacity = 0;
+    reader->has_pending = false;
+    reader->games_read = 0;
+    reader->evals = NULL;
+    reader->eval_capacity = 0;
+}
+
+/**
+ * pgn_reader_free() - Release buffers held by a reader (the stream is not closed)
+ *
+ * @param reader: Reader to release
+ */
+void pgn_reader_free(PgnReader* reader) {
+    free(reader->movetext);
+    reader->movetext = NULL;
+    reader->movetext_capacity = 0;
+    free(reader->evals);
+    reader->evals = NULL;
+    reader->eval_capacity = 0;
+}
+
+/**
+ * Read the next line (or line fragment for very long lines), honoring lookahead
+ */
+static bool pgn_reader_line(PgnReader* reader, char* line, size_t size) {
+    if (reader->has_pending) {
+        strncpy(line, reader->pending, size - 1);
+        line[size - 1] = '\0';
+        reader->has_pending = false;
+        return true;
     }
+    return fgets(line, (int)size, reader->file) != NULL;
+}
 
-    // Add blank line before moves
-    size_t current_len = strlen(pgn_string);
-    if (current_len < MAX_PGN_SIZE - 2) {
-        strcat(pgn_string, "\n");
-        current_len++;
+/**
+ * Copy the value of a tag pair line ([Name "Value"]) if its name matches
+ */
+static bool pgn_tag_value(const char* line, const char* name, char* value, size_t size) {
+    size_t name_length = strlen(name);
+    if (strncmp(line + 1, name, name_length) != 0 || line[1 + name_length] != ' ') return false;
+
+    const char* start = strchr(line, '"');
+    if (!start) return false;
+    start++;
+
+    size_t length = 0;
+    for (const char* c = start; *c && *c != '"' && length + 1 < size; c++) {
+        if (*c == '\\' && c[1]) c++;
+        value[length++] = *c;
     }
+    value[length] = '\0';
+    return true;
+}
 
-    char* pos = pgn_string + current_len;
-    size_t remaining = MAX_PGN_SIZE - current_len;
+/**
+ * Check whether a movetext token is a game termination marker
+ */
+static bool pgn_is_result(const char* token) {
+    return strcmp(token, "1-0") == 0 || strcmp(token, "0-1") == 0 ||
+           strcmp(token, "1/2-1/2") == 0 || strcmp(token, "*") == 0;
+}
 
-    for (int i = 0; i < move_count && remaining > 50; i++) {
-        if (i % 2 == 0) {
-            int written = snprintf(pos, remaining, "%d. ", (i / 2) + 1);
-            pos += written;
-            remaining -= written;
-        }
+/**
+ * Read an "[%eval ...]" annotation from a comment body
+ * Pawn scores ("0.25", "-1.5") become centipawns, mate scores ("#-3")
+ * become +/-PGN_MATE_EVAL.
+ *
+ * @return true if the comment holds an eval annotation
+ */
+static bool pgn_comment_eval(const char* comment, const char* end, int32_t* eval) {
+    const char* tag = strstr(comment, "[%eval ");
+    if (!tag || tag >= end) return false;
+
+    const char* value = tag + 7;
+    if (*value == '#') {
+        *eval = value[1] == '-' ? -PGN_MATE_EVAL : PGN_MATE_EVAL;
+        return true;
+    }
 
-        char algebraic[10] = "";
+    char* number_end;
+    double pawns = strtod(value, &number_end);
+    if (number_end == value) return false;
+    *eval = (int32_t)(pawns * 100.0 + (pawns < 0 ? -0.5 : 0.5));
+    return true;
+}
 
-        if (moves[i].is_castle) {
-            strcpy(algebraic, moves[i].to_col > moves[i].from_col ? "O-O" : "O-O-O");
-        } else if (moves[i].piece_type == PAWN) {
-            char from_file = 'a' + moves[i].from_col;
-            char to_file = 'a' + moves[i].to_col;
-            char to_rank = '8' - moves[i].to_row;
+/**
+ * Store the eval annotation for a ply, growing the reader's buffer
+ */
+static void pgn_store_eval(PgnReader* reader, int ply, int32_t eval) {
+    if (ply >= reader->eval_capacity) {
+        int capacity = reader->eval_capacity ? reader->eval_capacity : 256;
+        while (ply >= capacity) capacity *= 2;
+        int32_t* evals = realloc(reader->evals, (size_t)capacity * sizeof(int32_t));
+        if (!evals) return;
+        for (int i = reader->eval_capacity; i < capacity; i++) evals[i] = PGN_NO_EVAL;
+        reader->evals = evals;
+        reader->eval_capacity = capacity;
+    }
+    reader->evals[ply] = eval;
+}
 
-            if (moves[i].captured_piece != EMPTY || moves[i].is_en_passant) {
-                if (moves[i].promotion_piece != EMPTY) {
-                    char promo_symbols[] = " PRNBQK";
-                    snprintf(algebraic, sizeof(algebraic), "%cx%c%c=%c",
-                            from_file, to_file, to_rank, promo_symbols[moves[i].promotion_piece]);
-                } else {
-                    snprintf(algebraic, sizeof(algebraic), "%cx%c%c",
-                            from_file, to_file, to_rank);
+/**
+ * Decode movetext into the game's record, one legal move per SAN token
+ * Stops at the result marker; an undecodable token ends decoding and
+ * marks the game incomplete. Eval annotations in comments are attached to
+ * the move before them.
+ */
+static void pgn_decode_movetext(PgnReader* reader, PgnGame* game, ChessGame* position, char* marker, size_t marker_size) {
+    SanTable table;
+    bool decoding = true;
+    char* p = reader->movetext;
+
+    san_table_build(&table, position);
+
+    while (*p) {
+        if (isspace((unsigned char)*p)) {
+            p++;
+        } else if (*p == '{') {
+            char* end = strchr(p, '}');
+            if (!end) break;
+            int32_t eval;
+            if (decoding && game->record.ply_count > 0 && pgn_comment_eval(p, end, &eval)) {
+                pgn_store_eval(reader, game->record.ply_count - 1, eval);
+            }
+            p = end + 1;
+        } else if (*p == ';') {
+            while (*p && *p != '\n') p++;
+        } else if (*p == '(') {
+            // Skip the variation, including nested variations and comments inside it
+            int depth = 0;
+            while (*p) {
+                if (*p == '{') {
+                    p = strchr(p, '}');
+                    if (!p) return;
+                } else if (*p == '(') {
+                    depth++;
+                } else if (*p == ')' && --depth == 0) {
+                    p++;
+                    break;
                 }
-            } else {
-                if (moves[i].promotion_piece != EMPTY) {
-                    char promo_symbols[] = " PRNBQK";
-                    snprintf(algebraic, sizeof(algebraic), "%c%c=%c",
-                            to_file, to_rank, promo_symbols[moves[i].promotion_piece]);
+                p++;
+            }
+        } else if (*p == '$' || *p == ')') {
+            p++;
+            while (isdigit((unsigned char)*p)) p++;
+        } else {
+            char* token = p;
+            while (*p && !isspace((unsigned char)*p) && !strchr("{}();", *p)) p++;
+            char saved = *p;
+            *p = '\0';
+
+            if (pgn_is_result(token)) {
+                strncpy(marker, token, marker_size - 1);
+                marker[marker_size - 1] = '\0';
+                *p = saved;
+                return;
+            }
+
+            // Move numbers ("12.", "12...") may be glued to the move ("12.e4")
+            char* dot = strrchr(token, '.');
+            if (dot) token = dot + 1;
+
+            bool is_number = true;
+            for (char* c = token; *c; c++) {
+                if (!isdigit((unsigned char)*c)) is_number = false;
+            }
+
+            if (decoding && !is_number) {
+                int index = san_table_find(&table, token);
+                if (index >= 0 && execute_move(position, table.moves[index]) &&
+                    game_record_append(&game->record, table.moves[index])) {
+                    san_table_build(&table, position);
                 } else {
-                    snprintf(algebraic, sizeof(algebraic), "%c%c", to_file, to_rank);
+                    decoding = false;
+                    game->complete = false;
                 }
             }
-        } else {
-            char piece_symbols[] = " PRNBQK";
-            char piece_symbol = piece_symbols[moves[i].piece_type];
-            char to_file = 'a' + moves[i].to_col;
-            char to_rank = '8' - moves[i].to_row;
-
-            if (moves[i].captured_piece != EMPTY) {
-                snprintf(algebraic, sizeof(algebraic), "%cx%c%c",
-                        piece_symbol, to_file, to_rank);
-            } else {
-                snprintf(algebraic, sizeof(algebraic), "%c%c%c",
-                        piece_symbol, to_file, to_rank);
+            *p = saved;
+        }
+    }
+}
+
+/**
+ * pgn_reader_next() - Read and decode the next game
+ *
+ * @param reader: Reader positioned anywhere in the collection
+ * @param game: Output game; free game->record with game_record_free()
+ * @return: true if a game was read, false at end of input
+ */
+bool pgn_reader_next(PgnReader* reader, PgnGame* game) {
+    char line[sizeof(reader->pending)];
+    char fen[FEN_BUFFER_SIZE] = "";
+    bool line_start = true;
+    bool in_moves = false;
+    bool have_game = false;
+    size_t movetext_length = 0;
+
+    game->white[0] = '\0';
+    game->black[0] = '\0';
+    game->result[0] = '\0';
+    game->complete = true;
+
+    while (pgn_reader_line(reader, line, sizeof(line))) {
+        bool starts_line = line_start;
+        size_t length = strlen(line);
+        line_start = length > 0 && line[length - 1] == '\n';
+
+        if (starts_line && line[0] == '[') {
+            if (in_moves) {
+                // Headers of the next game: keep the line for the next call
+                strcpy(reader->pending, line);
+                reader->has_pending = true;
+                break;
             }
+            have_game = true;
+            pgn_tag_value(line, "White", game->white, sizeof(game->white));
+            pgn_tag_value(line, "Black", game->black, sizeof(game->black));
+            pgn_tag_value(line, "Result", game->result, sizeof(game->result));
+            pgn_tag_value(line, "FEN", fen, sizeof(fen));
+            continue;
         }
 
-        int written = snprintf(pos, remaining, "%s ", algebraic);
-        pos += written;
-        remaining -= written;
+        if (starts_line && line[0] == '%') continue;   // Escape line
 
-        if ((i + 1) % 6 == 0 && remaining > 5) {
-            strcpy(pos, "\n");
-            pos++;
-            remaining--;
+        if (movetext_length + length + 1 > reader->movetext_capacity) {
+            size_t capacity = reader->movetext_capacity ? reader->movetext_capacity * 2 : 4096;
+            while (movetext_length + length + 1 > capacity) capacity *= 2;
+            char* movetext = realloc(reader->movetext, capacity);
+            if (!movetext) break;
+            reader->movetext = movetext;
+            reader->movetext_capacity = capacity;
+        }
+        memcpy(reader->movetext + movetext_length, line, length + 1);
+        movetext_length += length;
+
+        for (size_t i = 0; i < length; i++) {
+            if (!isspace((unsigned char)line[i])) {
+                in_moves = true;
+                have_game = true;
+                break;
+            }
         }
     }
 
-    if (remaining > 10) {
-        snprintf(pos, remaining, "%s\n", result);
+    if (!have_game) return false;
+
+    ChessGame position;
+    memset(&position, 0, sizeof(position));
+    init_board(&position);
+    if (fen[0] != '\0' && !setup_board_from_fen(&position, fen)) {
+        game->complete = false;
     }
+    game_record_init(&game->record, &position);
 
-    return pgn_string;
-}
\ No newline at end of file
+    for (int i = 0; i < reader->eval_capacity; i++) {
+        reader->evals[i] = PGN_NO_EVAL;
+    }
+
+    char marker[16] = "*";
+    if (movetext_length > 0 && game->complete) {
+        pgn_decode_movetext(reader, game, &position, marker, sizeof(marker));
+    }
+
+    // Make sure evals[] covers every ply even when the game had no annotations
+    if (game->record.ply_count > 0) {
+        pgn_store_eval(reader, game->record.ply_count - 1,
+                       game->record.ply_count <= reader->eval_capacity ? reader->evals[game->record.ply_count - 1]
+                                                                       : PGN_NO_EVAL);
+    }
+    game->evals = reader->evals;
+    if (game->result[0] == '\0') {
+        strcpy(game->result, marker);
+    }
+
+    reader->games_read++;
+    return true;
+}
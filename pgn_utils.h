@@ -5,19 +5,24 @@
  * pgn_utils.h - PGN (Portable Game Notation) Utility Functions
  *
  * Purpose:
- *   Provides utilities for converting FEN log files to PGN format.
+ *   Provides utilities for converting game records and FEN log files to
+ *   PGN format.
  *   Extracted from chess.c to create a dedicated PGN handling module.
  *
  * Features:
  *   - FEN-to-PGN string conversion for real-time display
  *   - Proper PGN formatting with headers and algebraic notation
+ *   - Minimal disambiguation and check/mate marks from legal move generation
  *   - Support for all chess moves (castling, en passant, captures, promotions)
  *
  * Dependencies:
  *   - chess.h for core data types (Piece, PieceType, Color, BOARD_SIZE)
+ *   - game_record.h for GameRecord
+ *   - san.h (implementation only) for the shared SAN writer
  */
 
 #include "chess.h"
+#include "game_record.h"
 
 /**
  * convert_fen_to_pgn_string() - Convert FEN log file to PGN format string
@@ -40,4 +45,91 @@
  */
 char* convert_fen_to_pgn_string(const char* fen_filename, const char* game_result);
 
+/**
+ * convert_record_to_pgn_string() - Convert a game record to PGN format string
+ *
+ * @param record: Game record (root position and moves)
+ * @param game_result: Game result string ("1-0", "0-1", "1/2-1/2" or "*")
+ * @return: Dynamically allocated PGN string, or NULL on error; caller must free()
+ */
+char* convert_record_to_pgn_string(const GameRecord* record, const char* game_result);
+
+/**
+ * pgn_format_movetext() - Format the moves of a game record as PGN movetext
+ *
+ * @param record: Game record (root position and moves)
+ * @param game_result: Result marker appended after the moves
+ * @return: Dynamically allocated movetext, or NULL on error; caller must free()
+ */
+char* pgn_format_movetext(const GameRecord* record, const char* game_result);
+
+/**
+ * pgn_is_standard_start() - Check whether a FEN has the standard piece placement
+ *
+ * @param fen: FEN string
+ * @return: true if only the standard starting pieces are on their home squares
+ */
+bool pgn_is_standard_start(const char* fen);
+
+#define PGN_NO_EVAL INT32_MIN     // evals[] value for plies without an [%eval] annotation
+#define PGN_MATE_EVAL 10000       // Centipawn value used for [%eval #N] mate scores
+
+/**
+ * PgnGame - One game read from a PGN collection
+ * The moves are decoded against the legal move list as the game is read,
+ * so record always holds a legal prefix of the game.
+ */
+typedef struct {
+    char white[64];           // [White] tag (empty if missing)
+    char black[64];           // [Black] tag (empty if missing)
+    char result[16];          // [Result] tag, or the movetext result marker ("*" if neither)
+    GameRecord record;        // Root position ([FEN] tag or standard start) and decoded moves
+    bool complete;            // false if decoding stopped at an illegal or unknown move
+    const int32_t* evals;     // Per ply: [%eval] after the move in centipawns (White's view) or
+                              // PGN_NO_EVAL; owned by the reader, valid until the next game
+} PgnGame;
+
+/**
+ * PgnReader - Streaming reader for PGN files holding any number of games
+ * Holds one line of lookahead so the headers of the next game are not lost.
+ */
+typedef struct {
+    FILE* file;               // Input stream (not owned)
+    char* movetext;           // Movetext of the game being read (grows as needed)
+    size_t movetext_capacity; // Allocated bytes in movetext
+    char pending[1024];       // Line read ahead from the next game
+    bool has_pending;         // Whether pending holds a line
+    int games_read;           // Games returned so far
+    int32_t* evals;           // Eval annotations of the game being read (grows as needed)
+    int eval_capacity;        // Allocated entries in evals
+} PgnReader;
+
+/**
+ * pgn_reader_init() - Start reading games from a stream
+ *
+ * @param reader: Reader to initialize
+ * @param file: Open PGN stream; the caller keeps ownership and closes it
+ */
+void pgn_reader_init(PgnReader* reader, FILE* file);
+
+/**
+ * pgn_reader_next() - Read and decode the next game
+ *
+ * Tags, comments ({...} and ;...), variations, NAGs and move numbers are
+ * handled; moves are matched against the legal move list one ply at a time.
+ * "[%eval 0.25]" / "[%eval #-3]" comment annotations are kept in game->evals.
+ *
+ * @param reader: Reader positioned anywhere in the collection
+ * @param game: Output game; free game->record with game_record_free()
+ * @return: true if a game was read, false at end of input
+ */
+bool pgn_reader_next(PgnReader* reader, PgnGame* game);
+
+/**
+ * pgn_reader_free() - Release buffers held by a reader (the stream is not closed)
+ *
+ * @param reader: Reader to release
+ */
+void pgn_reader_free(PgnReader* reader);
+
 #endif // PGN_UTILS_H
\ No newline at end of file
@@ -0,0 +1,772 @@
+/**
+ * position_index.c - On-Disk Position Index over FEN, PGN and CGR Games
+ *
+ * Purpose:
+ *   Builds, incrementally updates and searches the position index described
+ *   in position_index.h.
+ *
+ * Architecture:
+ *   - Scanning collects .fen, .pgn and .cgr files from the configured
+ *     directories and sorts them by path
+ *   - Files are kept in path order in the index, so entries carried over
+ *     from the previous index stay sorted after their games are renumbered;
+ *     only entries of freshly parsed files need sorting before the merge
+ *   - Lookups binary-search the entry table with pread() and never load it
+ *
+ * Dependencies:
+ *   - chess.h: fen_decode(), position_hash(), execute_move()
+ *   - game_record.h: game_record_load(), cgr_unpack_position(), cgr_play_move()
+ *   - pgn_utils.h: PgnReader
+ */
+
+#define _GNU_SOURCE        // Required for Linux (pread, strdup)
+
+#include "position_index.h"
+#include "game_record.h"
+#include "pgn_utils.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#define CPX_HEADER_SIZE 32             // Bytes before the file table
+#define CPX_GAME_SIZE 12               // Bytes per game table record
+#define CPX_ENTRY_SIZE 16              // Bytes per entry
+#define CPX_IO_BATCH 4096              // Entries per read/write batch
+#define CPX_NO_GAME 0xFFFFFFFFu        // Dropped game marker while remapping
+
+/******************************************************************************
+ *                           LITTLE-ENDIAN HELPERS
+ ******************************************************************************/
+
+static void cpx_put_u16(uint8_t *out, uint16_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+}
+
+static void cpx_put_u32(uint8_t *out, uint32_t value) {
+    for (int i = 0; i < 4; i++) out[i] = (uint8_t)(value >> (8 * i));
+}
+
+static void cpx_put_u64(uint8_t *out, uint64_t value) {
+    for (int i = 0; i < 8; i++) out[i] = (uint8_t)(value >> (8 * i));
+}
+
+static uint16_t cpx_get_u16(const uint8_t *in) {
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static uint32_t cpx_get_u32(const uint8_t *in) {
+    uint32_t value = 0;
+    for (int i = 3; i >= 0; i--) value = (value << 8) | in[i];
+    return value;
+}
+
+static uint64_t cpx_get_u64(const uint8_t *in) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) value = (value << 8) | in[i];
+    return value;
+}
+
+static void cpx_pack_entry(uint8_t *out, const IndexEntry *entry) {
+    cpx_put_u64(out, entry->hash);
+    cpx_put_u32(out + 8, entry->game);
+    cpx_put_u32(out + 12, entry->ply);
+}
+
+static void cpx_unpack_entry(const uint8_t *in, IndexEntry *entry) {
+    entry->hash = cpx_get_u64(in);
+    entry->game = cpx_get_u32(in + 8);
+    entry->ply = cpx_get_u32(in + 12);
+}
+
+/******************************************************************************
+ *                             IN-MEMORY INDEX
+ ******************************************************************************/
+
+/**
+ * Initialize an empty index
+ *
+ * @param index Index to initialize
+ */
+void position_index_init(PositionIndex *index) {
+    memset(index, 0, sizeof(*index));
+}
+
+/**
+ * Release all memory held by an index
+ *
+ * @param index Index to free (empty afterwards)
+ */
+void position_index_free(PositionIndex *index) {
+    for (uint32_t i = 0; i < index->file_count; i++) {
+        free(index->files[i].path);
+    }
+    free(index->files);
+    free(index->games);
+    free(index->entries);
+    position_index_init(index);
+}
+
+/**
+ * Append an entry to a growable entry array
+ */
+static bool cpx_push_entry(IndexEntry **entries, uint64_t *count, uint64_t *capacity, IndexEntry entry) {
+    if (*count == *capacity) {
+        uint64_t grown = *capacity ? *capacity * 2 : 4096;
+        IndexEntry *resized = realloc(*entries, grown * sizeof(IndexEntry));
+        if (!resized) return false;
+        *entries = resized;
+        *capacity = grown;
+    }
+    (*entries)[(*count)++] = entry;
+    return true;
+}
+
+/**
+ * Append a game to the game table
+ * Returns the new game index, or CPX_NO_GAME on allocation failure
+ */
+static uint32_t cpx_add_game(PositionIndex *index, uint32_t file, uint32_t number) {
+    if (index->game_count == index->game_capacity) {
+        uint32_t grown = index->game_capacity ? index->game_capacity * 2 : 256;
+        IndexedGame *resized = realloc(index->games, grown * sizeof(IndexedGame));
+        if (!resized) return CPX_NO_GAME;
+        index->games = resized;
+        index->game_capacity = grown;
+    }
+    IndexedGame *game = &index->games[index->game_count];
+    game->file = file;
+    game->number = number;
+    game->ply_count = 0;
+    return index->game_count++;
+}
+
+/**
+ * Entry order: hash, then game, then ply
+ */
+static int cpx_compare_entries(const void *a, const void *b) {
+    const IndexEntry *left = a;
+    const IndexEntry *right = b;
+    if (left->hash != right->hash) return left->hash < right->hash ? -1 : 1;
+    if (left->game != right->game) return left->game < right->game ? -1 : 1;
+    if (left->ply != right->ply) return left->ply < right->ply ? -1 : 1;
+    return 0;
+}
+
+/******************************************************************************
+ *                               FILE I/O
+ ******************************************************************************/
+
+/**
+ * Read the header, file table and game table of an index file
+ * Leaves the stream positioned at the first entry.
+ */
+static bool cpx_read_tables(FILE *file, PositionIndex *index) {
+    uint8_t header[CPX_HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header)) return false;
+    if (memcmp(header, POSITION_INDEX_MAGIC, 4) != 0) return false;
+    if (cpx_get_u32(header + 4) != POSITION_INDEX_VERSION) return false;
+
+    uint32_t file_count = cpx_get_u32(header + 8);
+    uint32_t game_count = cpx_get_u32(header + 12);
+    index->entry_count = cpx_get_u64(header + 16);
+
+    index->files = calloc(file_count ? file_count : 1, sizeof(IndexedFile));
+    index->games = malloc((game_count ? game_count : 1) * sizeof(IndexedGame));
+    if (!index->files || !index->games) return false;
+    index->game_capacity = game_count;
+
+    for (uint32_t i = 0; i < file_count; i++) {
+        uint8_t length_bytes[2];
+        uint8_t record[24];
+        if (fread(length_bytes, 1, 2, file) != 2) return false;
+
+        uint16_t length = cpx_get_u16(length_bytes);
+        char *path = malloc((size_t)length + 1);
+        if (!path) return false;
+        if (fread(path, 1, length, file) != length || fread(record, 1, sizeof(record), file) != sizeof(record)) {
+            free(path);
+            return false;
+        }
+        path[length] = '\0';
+
+        IndexedFile *indexed = &index->files[index->file_count++];
+        indexed->path = path;
+        indexed->mtime = (int64_t)cpx_get_u64(record);
+        indexed->size = (int64_t)cpx_get_u64(record + 8);
+        indexed->first_game = cpx_get_u32(record + 16);
+        indexed->game_count = cpx_get_u32(record + 20);
+    }
+
+    for (uint32_t i = 0; i < game_count; i++) {
+        uint8_t record[CPX_GAME_SIZE];
+        if (fread(record, 1, sizeof(record), file) != sizeof(record)) return false;
+        index->games[i].file = cpx_get_u32(record);
+        index->games[i].number = cpx_get_u32(record + 4);
+        index->games[i].ply_count = cpx_get_u32(record + 8);
+    }
+    index->game_count = game_count;
+    return true;
+}
+
+/**
+ * Read a complete index file into memory
+ *
+ * @param index Output index (initialized by this call)
+ * @param index_path Index file to read
+ * @return true on success, false if the file is missing or malformed
+ */
+bool position_index_load(PositionIndex *index, const char *index_path) {
+    position_index_init(index);
+
+    FILE *file = fopen(index_path, "rb");
+    if (!file) return false;
+
+    bool ok = cpx_read_tables(file, index);
+    if (ok) {
+        index->entry_capacity = index->entry_count;
+        index->entries = malloc((index->entry_count ? index->entry_count : 1) * sizeof(IndexEntry));
+        ok = index->entries != NULL;
+    }
+
+    uint8_t buffer[CPX_IO_BATCH * CPX_ENTRY_SIZE];
+    for (uint64_t done = 0; ok && done < index->entry_count;) {
+        uint64_t batch = index->entry_count - done < CPX_IO_BATCH ? index->entry_count - done : CPX_IO_BATCH;
+        ok = fread(buffer, CPX_ENTRY_SIZE, batch, file) == batch;
+        for (uint64_t i = 0; ok && i < batch; i++) {
+            cpx_unpack_entry(buffer + i * CPX_ENTRY_SIZE, &index->entries[done + i]);
+        }
+        done += batch;
+    }
+
+    fclose(file);
+    if (!ok) position_index_free(index);
+    return ok;
+}
+
+/**
+ * Write an index file atomically (temporary file, then rename)
+ *
+ * @param index Index to write; entries must be sorted
+ * @param index_path Destination path
+ * @return true on success
+ */
+bool position_index_save(const PositionIndex *index, const char *index_path) {
+    char temp_path[1024];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", index_path);
+
+    FILE *file = fopen(temp_path, "wb");
+    if (!file) return false;
+
+    uint8_t header[CPX_HEADER_SIZE] = {0};
+    memcpy(header, POSITION_INDEX_MAGIC, 4);
+    cpx_put_u32(header + 4, POSITION_INDEX_VERSION);
+    cpx_put_u32(header + 8, index->file_count);
+    cpx_put_u32(header + 12, index->game_count);
+    cpx_put_u64(header + 16, index->entry_count);
+    bool ok = fwrite(header, 1, sizeof(header), file) == sizeof(header);
+
+    for (uint32_t i = 0; ok && i < index->file_count; i++) {
+        const IndexedFile *indexed = &index->files[i];
+        size_t length = strlen(indexed->path);
+        uint8_t length_bytes[2];
+        uint8_t record[24];
+
+        if (length > 0xFFFF) {
+            ok = false;
+            break;
+        }
+        cpx_put_u16(length_bytes, (uint16_t)length);
+        cpx_put_u64(record, (uint64_t)indexed->mtime);
+        cpx_put_u64(record + 8, (uint64_t)indexed->size);
+        cpx_put_u32(record + 16, indexed->first_game);
+        cpx_put_u32(record + 20, indexed->game_count);
+
+        ok = fwrite(length_bytes, 1, 2, file) == 2 &&
+             fwrite(indexed->path, 1, length, file) == length &&
+             fwrite(record, 1, sizeof(record), file) == sizeof(record);
+    }
+
+    for (uint32_t i = 0; ok && i < index->game_count; i++) {
+        uint8_t record[CPX_GAME_SIZE];
+        cpx_put_u32(record, index->games[i].file);
+        cpx_put_u32(record + 4, index->games[i].number);
+        cpx_put_u32(record + 8, index->games[i].ply_count);
+        ok = fwrite(record, 1, sizeof(record), file) == sizeof(record);
+    }
+
+    uint8_t buffer[CPX_IO_BATCH * CPX_ENTRY_SIZE];
+    for (uint64_t done = 0; ok && done < index->entry_count;) {
+        uint64_t batch = index->entry_count - done < CPX_IO_BATCH ? index->entry_count - done : CPX_IO_BATCH;
+        for (uint64_t i = 0; i < batch; i++) {
+            cpx_pack_entry(buffer + i * CPX_ENTRY_SIZE, &index->entries[done + i]);
+        }
+        ok = fwrite(buffer, CPX_ENTRY_SIZE, batch, file) == batch;
+        done += batch;
+    }
+
+    if (fclose(file) != 0) ok = false;
+    if (ok) ok = rename(temp_path, index_path) == 0;
+    if (!ok) unlink(temp_path);
+    return ok;
+}
+
+/******************************************************************************
+ *                              GAME PARSING
+ ******************************************************************************/
+
+/**
+ * Add every position of a record (root included) as entries of one game
+ */
+static bool cpx_index_record(PositionIndex *index, uint32_t game, const GameRecord *record,
+                             IndexEntry **entries, uint64_t *count, uint64_t *capacity) {
+    ChessGame position;
+    memset(&position, 0, sizeof(position));
+    if (!cgr_unpack_position(record->root, &position)) return false;
+
+    IndexEntry entry = {position_hash(&position), game, 0};
+    if (!cpx_push_entry(entries, count, capacity, entry)) return false;
+
+    for (int ply = 0; ply < record->ply_count; ply++) {
+        if (!cgr_play_move(&position, record->moves[ply])) break;
+        entry.hash = position_hash(&position);
+        entry.ply = (uint32_t)ply + 1;
+        if (!cpx_push_entry(entries, count, capacity, entry)) return false;
+        index->games[game].ply_count = entry.ply;
+    }
+    return true;
+}
+
+/**
+ * Parse one source file and append its games and entries
+ * FEN logs are one game with one position per line; PGN files may hold any
+ * number of games; .cgr files hold one game.
+ *
+ * @return false only on allocation failure (unreadable files index as empty)
+ */
+static bool cpx_index_file(PositionIndex *index, uint32_t file_number, const char *path,
+                           IndexEntry **entries, uint64_t *count, uint64_t *capacity) {
+    const char *extension = strrchr(path, '.');
+    IndexedFile *indexed = &index->files[file_number];
+    indexed->first_game = index->game_count;
+    indexed->game_count = 0;
+
+    if (extension && strcmp(extension, ".pgn") == 0) {
+        FILE *file = fopen(path, "r");
+        if (!file) return true;
+
+        PgnReader reader;
+        PgnGame game;
+        bool ok = true;
+        pgn_reader_init(&reader, file);
+        while (ok && pgn_reader_next(&reader, &game)) {
+            uint32_t id = cpx_add_game(index, file_number, (uint32_t)reader.games_read);
+            ok = id != CPX_NO_GAME && cpx_index_record(index, id, &game.record, entries, count, capacity);
+            if (ok) indexed->game_count++;
+            game_record_free(&game.record);
+        }
+        pgn_reader_free(&reader);
+        fclose(file);
+        return ok;
+    }
+
+    if (extension && strcmp(extension, ".cgr") == 0) {
+        GameRecord record;
+        if (!game_record_load(&record, path)) return true;
+
+        uint32_t id = cpx_add_game(index, file_number, 1);
+        bool ok = id != CPX_NO_GAME && cpx_index_record(index, id, &record, entries, count, capacity);
+        if (ok) indexed->game_count = 1;
+        game_record_free(&record);
+        return ok;
+    }
+
+    // FEN log: hash each valid line; invalid lines are skipped
+    FILE *file = fopen(path, "r");
+    if (!file) return true;
+
+    char line[256];
+    uint32_t id = CPX_NO_GAME;
+    uint32_t ply = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), file)) {
+        ChessGame position;
+        memset(&position, 0, sizeof(position));
+        if (fen_decode(&position, line).code != FEN_OK) continue;
+
+        if (id == CPX_NO_GAME) {
+            id = cpx_add_game(index, file_number, 1);
+            if (id == CPX_NO_GAME) {
+                ok = false;
+                break;
+            }
+            indexed->game_count = 1;
+        }
+
+        IndexEntry entry = {position_hash(&position), id, ply};
+        ok = cpx_push_entry(entries, count, capacity, entry);
+        index->games[id].ply_count = ply++;
+    }
+    fclose(file);
+    return ok;
+}
+
+/******************************************************************************
+ *                           DIRECTORY SCANNING
+ ******************************************************************************/
+
+/**
+ * List of candidate source files
+ */
+typedef struct {
+    char **paths;
+    int count;
+    int capacity;
+} CpxPathList;
+
+static bool cpx_is_source(const char *name) {
+    const char *extension = strrchr(name, '.');
+    return extension && (strcmp(extension, ".fen") == 0 || strcmp(extension, ".pgn") == 0 ||
+                         strcmp(extension, ".cgr") == 0);
+}
+
+/**
+ * Collect source files under a directory
+ */
+static void cpx_scan_directory(const char *directory, bool recursive, CpxPathList *list) {
+    DIR *dir = opendir(directory);
+    if (!dir) return;
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') continue;   // ".", ".." and hidden entries
+
+        char path[1024];
+        if (strcmp(directory, ".") == 0) {
+            snprintf(path, sizeof(path), "%s", entry->d_name);
+        } else {
+            snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name);
+        }
+
+        struct stat file_stat;
+        if (stat(path, &file_stat) != 0) continue;
+
+        if (S_ISDIR(file_stat.st_mode)) {
+            if (recursive) cpx_scan_directory(path, true, list);
+        } else if (S_ISREG(file_stat.st_mode) && cpx_is_source(entry->d_name)) {
+            if (list->count == list->capacity) {
+                int grown = list->capacity ? list->capacity * 2 : 64;
+                char **resized = realloc(list->paths, (size_t)grown * sizeof(char *));
+                if (!resized) break;
+                list->paths = resized;
+                list->capacity = grown;
+            }
+            char *copy = strdup(path);
+            if (copy) list->paths[list->count++] = copy;
+        }
+    }
+    closedir(dir);
+}
+
+static int cpx_compare_paths(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/**
+ * Find a file in the (path-sorted) file table of an index
+ */
+static int cpx_find_file(const PositionIndex *index, const char *path) {
+    int low = 0, high = (int)index->file_count - 1;
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        int order = strcmp(index->files[middle].path, path);
+        if (order == 0) return middle;
+        if (order < 0) low = middle + 1;
+        else high = middle - 1;
+    }
+    return -1;
+}
+
+/******************************************************************************
+ *                              INCREMENTAL UPDATE
+ ******************************************************************************/
+
+/**
+ * Check whether an index already covers exactly the listed files, unchanged
+ * Reads only the file and game tables, so an up-to-date index costs no
+ * entry I/O and no rewrite.
+ *
+ * @return true if every listed file is indexed with the same size and
+ *         modification time and no indexed file has gone
+ */
+static bool cpx_index_current(const char *index_path, const CpxPathList *list, const char *skip_path,
+                              IndexUpdateStats *stats) {
+    FILE *file = fopen(index_path, "rb");
+    if (!file) return false;
+
+    PositionIndex index;
+    position_index_init(&index);
+    bool current = cpx_read_tables(file, &index);
+
+    // A truncated entry table needs the full rebuild
+    struct stat index_stat;
+    off_t tables_end = ftello(file);
+    current = current && tables_end >= 0 && fstat(fileno(file), &index_stat) == 0 &&
+              (uint64_t)index_stat.st_size >= (uint64_t)tables_end + index.entry_count * CPX_ENTRY_SIZE;
+    fclose(file);
+
+    uint32_t number = 0;
+    for (int i = 0; current && i < list->count; i++) {
+        const char *path = list->paths[i];
+        if (i > 0 && strcmp(path, list->paths[i - 1]) == 0) continue;
+        if (skip_path && strcmp(path, skip_path) == 0) continue;
+
+        struct stat file_stat;
+        if (stat(path, &file_stat) != 0) continue;
+
+        const IndexedFile *indexed = number < index.file_count ? &index.files[number] : NULL;
+        current = indexed && strcmp(indexed->path, path) == 0 &&
+                  indexed->mtime == (int64_t)file_stat.st_mtime && indexed->size == (int64_t)file_stat.st_size;
+        number++;
+    }
+    current = current && number == index.file_count;
+
+    if (current) {
+        stats->files_reused = (int)index.file_count;
+        stats->games = index.game_count;
+        stats->positions = index.entry_count;
+    }
+    position_index_free(&index);
+    return current;
+}
+
+/**
+ * Bring an index file up to date with the source files on disk
+ * Unchanged files (same size and modification time) keep their entries;
+ * new and changed files are parsed; files that disappeared are dropped.
+ * When nothing changed the index file is left as it is.
+ *
+ * @param index_path Index file to update (created if missing or unreadable)
+ * @param roots Directories to scan
+ * @param root_count Number of roots
+ * @param skip_path File to leave out (e.g. the FEN log of the game in progress), or NULL
+ * @param stats Output statistics (may be NULL)
+ * @return true if the index file is up to date (written, or already current)
+ */
+bool position_index_update(const char *index_path, const IndexRoot roots[], int root_count,
+                           const char *skip_path, IndexUpdateStats *stats) {
+    IndexUpdateStats local = {0};
+    if (!stats) stats = &local;
+    memset(stats, 0, sizeof(*stats));
+
+    CpxPathList list = {NULL, 0, 0};
+    for (int i = 0; i < root_count; i++) {
+        cpx_scan_directory(roots[i].path, roots[i].recursive, &list);
+    }
+    if (list.count > 1) qsort(list.paths, (size_t)list.count, sizeof(char *), cpx_compare_paths);
+
+    if (cpx_index_current(index_path, &list, skip_path, stats)) {
+        for (int i = 0; i < list.count; i++) free(list.paths[i]);
+        free(list.paths);
+        return true;
+    }
+
+    PositionIndex old, fresh;
+    position_index_load(&old, index_path);   // Missing or stale index: start empty
+    position_index_init(&fresh);
+
+    uint32_t *remap = malloc((old.game_count ? old.game_count : 1) * sizeof(uint32_t));
+    bool *matched = calloc(old.file_count ? old.file_count : 1, sizeof(bool));
+    fresh.files = calloc(list.count ? (size_t)list.count : 1, sizeof(IndexedFile));
+    bool ok = remap && matched && fresh.files;
+    for (uint32_t i = 0; ok && i < old.game_count; i++) remap[i] = CPX_NO_GAME;
+
+    IndexEntry *parsed = NULL;
+    uint64_t parsed_count = 0, parsed_capacity = 0;
+
+    for (int i = 0; ok && i < list.count; i++) {
+        const char *path = list.paths[i];
+        if (i > 0 && strcmp(path, list.paths[i - 1]) == 0) continue;   // Same directory listed twice
+        if (skip_path && strcmp(path, skip_path) == 0) continue;
+
+        struct stat file_stat;
+        if (stat(path, &file_stat) != 0) continue;
+
+        uint32_t number = fresh.file_count++;
+        IndexedFile *indexed = &fresh.files[number];
+        indexed->path = strdup(path);
+        indexed->mtime = (int64_t)file_stat.st_mtime;
+        indexed->size = (int64_t)file_stat.st_size;
+        if (!indexed->path) {
+            ok = false;
+            break;
+        }
+
+        int previous = cpx_find_file(&old, path);
+        if (previous >= 0) matched[previous] = true;
+
+        if (previous >= 0 && old.files[previous].mtime == indexed->mtime && old.files[previous].size == indexed->size) {
+            // Unchanged: renumber its games, entries are carried over below
+            const IndexedFile *kept = &old.files[previous];
+            indexed->first_game = fresh.game_count;
+            indexed->game_count = 0;
+            for (uint32_t g = kept->first_game; ok && g < kept->first_game + kept->game_count; g++) {
+                uint32_t id = cpx_add_game(&fresh, number, old.games[g].number);
+                ok = id != CPX_NO_GAME;
+                if (ok) {
+                    fresh.games[id].ply_count = old.games[g].ply_count;
+                    remap[g] = id;
+                    indexed->game_count++;
+                }
+            }
+            stats->files_reused++;
+        } else {
+            ok = cpx_index_file(&fresh, number, path, &parsed, &parsed_count, &parsed_capacity);
+            stats->files_indexed++;
+        }
+    }
+
+    for (uint32_t i = 0; i < old.file_count; i++) {
+        if (matched && !matched[i]) stats->files_removed++;
+    }
+
+    // Merge carried-over entries (still sorted) with the sorted fresh ones
+    if (ok && parsed_count > 1) qsort(parsed, parsed_count, sizeof(IndexEntry), cpx_compare_entries);
+
+    uint64_t kept_count = 0;
+    for (uint64_t i = 0; ok && i < old.entry_count; i++) {
+        if (old.entries[i].game < old.game_count && remap[old.entries[i].game] != CPX_NO_GAME) kept_count++;
+    }
+
+    if (ok) {
+        fresh.entry_capacity = kept_count + parsed_count;
+        fresh.entries = malloc((fresh.entry_capacity ? fresh.entry_capacity : 1) * sizeof(IndexEntry));
+        ok = fresh.entries != NULL;
+    }
+
+    uint64_t old_position = 0, parsed_position = 0;
+    while (ok && (old_position < old.entry_count || parsed_position < parsed_count)) {
+        IndexEntry carried;
+        bool have_carried = false;
+        while (old_position < old.entry_count) {
+            carried = old.entries[old_position];
+            if (carried.game < old.game_count && remap[carried.game] != CPX_NO_GAME) {
+                carried.game = remap[carried.game];
+                have_carried = true;
+                break;
+            }
+            old_position++;
+        }
+
+        if (have_carried && (parsed_position >= parsed_count ||
+                             cpx_compare_entries(&carried, &parsed[parsed_position]) <= 0)) {
+            fresh.entries[fresh.entry_count++] = carried;
+            old_position++;
+        } else if (parsed_position < parsed_count) {
+            fresh.entries[fresh.entry_count++] = parsed[parsed_position++];
+        } else {
+            break;
+        }
+    }
+
+    if (ok) {
+        stats->games = fresh.game_count;
+        stats->positions = fresh.entry_count;
+        ok = position_index_save(&fresh, index_path);
+    }
+
+    for (int i = 0; i < list.count; i++) free(list.paths[i]);
+    free(list.paths);
+    free(parsed);
+    free(remap);
+    free(matched);
+    position_index_free(&old);
+    position_index_free(&fresh);
+    return ok;
+}
+
+/******************************************************************************
+ *                                 LOOKUP
+ ******************************************************************************/
+
+/**
+ * Read one entry of the on-disk entry table
+ */
+static bool cpx_read_entry(int fd, off_t base, uint64_t position, IndexEntry *entry) {
+    uint8_t record[CPX_ENTRY_SIZE];
+    off_t offset = base + (off_t)(position * CPX_ENTRY_SIZE);
+    if (pread(fd, record, sizeof(record), offset) != (ssize_t)sizeof(record)) return false;
+    cpx_unpack_entry(record, entry);
+    return true;
+}
+
+/**
+ * Find the games that reach a position
+ * Binary-searches the entry table on disk; only the file and game tables
+ * are loaded. Each game is reported once, at the first ply it reaches the
+ * position.
+ *
+ * @param index_path Index file
+ * @param hash Position hash from position_hash()
+ * @param matches Output array
+ * @param max_matches Capacity of matches
+ * @param total_games Output: number of matching games (may exceed max_matches), or NULL
+ * @return Number of matches written, or -1 if the index cannot be read
+ */
+int position_index_find(const char *index_path, uint64_t hash, IndexMatch matches[], int max_matches,
+                        int *total_games) {
+    FILE *file = fopen(index_path, "rb");
+    if (!file) return -1;
+
+    PositionIndex index;
+    position_index_init(&index);
+    if (!cpx_read_tables(file, &index)) {
+        fclose(file);
+        position_index_free(&index);
+        return -1;
+    }
+    off_t base = ftello(file);
+    int fd = fileno(file);
+
+    // Lower bound of the hash in the sorted entry table
+    uint64_t low = 0, high = index.entry_count;
+    IndexEntry entry;
+    while (low < high) {
+        uint64_t middle = low + (high - low) / 2;
+        if (!cpx_read_entry(fd, base, middle, &entry)) {
+            low = high = index.entry_count;
+            break;
+        }
+        if (entry.hash < hash) low = middle + 1;
+        else high = middle;
+    }
+
+    int written = 0, total = 0;
+    uint32_t last_game = CPX_NO_GAME;
+    for (uint64_t i = low; i < index.entry_count; i++) {
+        if (!cpx_read_entry(fd, base, i, &entry) || entry.hash != hash) break;
+        if (entry.game == last_game || entry.game >= index.game_count) continue;
+        last_game = entry.game;
+        total++;
+
+        if (written < max_matches) {
+            const IndexedGame *game = &index.games[entry.game];
+            IndexMatch *match = &matches[written++];
+            snprintf(match->path, sizeof(match->path), "%s",
+                     game->file < index.file_count ? index.files[game->file].path : "?");
+            match->game_number = game->number;
+            match->ply = entry.ply;
+            match->ply_count = game->ply_count;
+        }
+    }
+
+    if (total_games) *total_games = total;
+    fclose(file);
+    position_index_free(&index);
+    return written;
+}
@@ -0,0 +1,129 @@
+#ifndef POSITION_INDEX_H
+#define POSITION_INDEX_H
+
+/**
+ * position_index.h - On-Disk Position Index over FEN, PGN and CGR Games
+ *
+ * Purpose:
+ *   Answers "which games on disk reach this position?" without opening the
+ *   games. Every position of every indexed game is stored as a
+ *   (Zobrist hash, game, ply) entry sorted by hash, so a lookup is a binary
+ *   search over the index file.
+ *
+ * File layout (all integers little-endian):
+ *   header   magic "CPX1", uint32 version, uint32 file count,
+ *            uint32 game count, uint64 entry count, uint64 reserved
+ *   files    per file: uint16 path length, path bytes, int64 mtime,
+ *            int64 size, uint32 first game, uint32 game count
+ *   games    per game: uint32 file, uint32 game number in file (1-based),
+ *            uint32 ply count
+ *   entries  per position: uint64 hash, uint32 game, uint32 ply
+ *            (sorted by hash, then game, then ply)
+ *
+ * Architecture:
+ *   - Updates are incremental: files whose size and modification time are
+ *     unchanged keep their entries from the previous index, only new or
+ *     changed files are parsed, and vanished files are dropped
+ *   - The updated index is written to a temporary file and renamed over
+ *     the old one, so readers never see a partial index
+ *   - Lookups read only the file and game tables plus log2(entries)
+ *     entries from disk
+ *
+ * Dependencies:
+ *   - chess.h for position_hash() and the FEN decoder
+ *   - game_record.h for .cgr games
+ *   - pgn_utils.h for the streaming PGN reader
+ */
+
+#include "chess.h"
+
+#define POSITION_INDEX_MAGIC "CPX1"
+#define POSITION_INDEX_VERSION 1
+#define POSITION_INDEX_DEFAULT_FILE "positions.cpx"   // Default index file name
+#define POSITION_INDEX_MAX_ROOTS 8                      // Directories scanned by one update
+
+/**
+ * IndexedFile - One source file in the index
+ */
+typedef struct {
+    char *path;             // Path as found while scanning
+    int64_t mtime;          // Modification time when indexed
+    int64_t size;           // Size in bytes when indexed
+    uint32_t first_game;    // Index of its first game in the game table
+    uint32_t game_count;    // Games read from the file
+} IndexedFile;
+
+/**
+ * IndexedGame - One game in the index
+ */
+typedef struct {
+    uint32_t file;          // Index into the file table
+    uint32_t number;        // Game number within the file (1-based)
+    uint32_t ply_count;     // Plies indexed for the game
+} IndexedGame;
+
+/**
+ * IndexEntry - One position occurrence
+ */
+typedef struct {
+    uint64_t hash;          // Zobrist hash from position_hash()
+    uint32_t game;          // Index into the game table
+    uint32_t ply;           // Ply at which the position occurs (0 = start)
+} IndexEntry;
+
+/**
+ * PositionIndex - Complete index held in memory while updating
+ */
+typedef struct {
+    IndexedFile *files;
+    uint32_t file_count;
+    IndexedGame *games;
+    uint32_t game_count;
+    uint32_t game_capacity;
+    IndexEntry *entries;
+    uint64_t entry_count;
+    uint64_t entry_capacity;
+} PositionIndex;
+
+/**
+ * IndexRoot - Directory to scan during an update
+ */
+typedef struct {
+    const char *path;       // Directory path
+    bool recursive;         // Descend into subdirectories
+} IndexRoot;
+
+/**
+ * IndexUpdateStats - What an update did
+ */
+typedef struct {
+    int files_reused;       // Unchanged files whose entries were kept
+    int files_indexed;      // New or changed files parsed
+    int files_removed;      // Files in the old index that no longer exist
+    uint32_t games;         // Games in the updated index
+    uint64_t positions;     // Entries in the updated index
+} IndexUpdateStats;
+
+/**
+ * IndexMatch - One game reaching a position
+ */
+typedef struct {
+    char path[512];         // File holding the game
+    uint32_t game_number;   // Game number within the file (1-based)
+    uint32_t ply;           // First ply at which the position occurs
+    uint32_t ply_count;     // Length of the game in plies
+} IndexMatch;
+
+// Building
+void position_index_init(PositionIndex *index);  // Empty index
+void position_index_free(PositionIndex *index);  // Release all memory
+bool position_index_load(PositionIndex *index, const char *index_path);  // Read whole index file
+bool position_index_save(const PositionIndex *index, const char *index_path);  // Write atomically
+bool position_index_update(const char *index_path, const IndexRoot roots[], int root_count,
+                           const char *skip_path, IndexUpdateStats *stats);  // Incremental rebuild
+
+// Querying
+int position_index_find(const char *index_path, uint64_t hash, IndexMatch matches[], int max_matches,
+                        int *total_games);  // Games reaching a position (-1 if no index)
+
+#endif // POSITION_INDEX_H
@@ -0,0 +1,389 @@
+/**
+ * profile.c - Built-in Profiling Counters and Trace Recording
+ *
+ * Purpose:
+ *   Counter storage, histograms, the stats report and the Chrome trace
+ *   writer described in profile.h.
+ *
+ * Architecture:
+ *   - Counters are static globals updated with relaxed __atomic adds (and
+ *     a compare-and-swap loop for the maximum); a snapshot may mix
+ *     updates from a moment apart, which a report does not notice
+ *   - Trace events go into one array allocated by profile_trace_start();
+ *     each recorder claims a slot with an atomic increment, so events are
+ *     kept in completion order, not start order (trace viewers sort them)
+ *   - Trace thread ids are small numbers handed out on a thread's first
+ *     event, so the viewer shows one row per thread
+ *
+ * Dependencies:
+ *   - profile.h
+ */
+
+#define _GNU_SOURCE        // Required for Linux (clock_gettime)
+
+#include "profile.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PROFILE_HISTOGRAM_SHADES " .:-=+*#%@"   // Histogram cell shades, emptiest first
+
+/**
+ * ProfileInfo - Name and trace policy of one counter
+ */
+typedef struct {
+    const char *name;
+    bool traced;             // Hot primitives are counted but never traced
+} ProfileInfo;
+
+/**
+ * TraceEvent - One completed timed section
+ */
+typedef struct {
+    uint64_t start_ns;       // Relative to the trace start
+    uint64_t duration_ns;
+    int thread;
+    ProfileCounter counter;
+} TraceEvent;
+
+static const ProfileInfo profile_info[PROFILE_COUNTER_COUNT] = {
+    [PROFILE_MOVE_GENERATION] = {"move_generation", false},
+    [PROFILE_LEGALITY_CHECK] = {"legality_check", false},
+    [PROFILE_FEN_ENCODE] = {"fen_encode", true},
+    [PROFILE_FEN_DECODE] = {"fen_decode", true},
+    [PROFILE_PGN_REBUILD] = {"pgn_rebuild", true},
+    [PROFILE_ENGINE_SEND] = {"engine_send", true},
+    [PROFILE_ENGINE_MOVE] = {"engine_move", true},
+    [PROFILE_RENDER] = {"render", true},
+};
+
+static bool profiling = false;
+static ProfileStats profile_stats[PROFILE_COUNTER_COUNT];
+
+static TraceEvent *trace_events = NULL;     // NULL when not tracing
+static size_t trace_used = 0;               // Slots claimed (may pass PROFILE_TRACE_EVENTS)
+static uint64_t trace_origin_ns = 0;
+static char *trace_path = NULL;
+static int trace_threads = 0;
+static __thread int trace_thread_id = 0;    // 0 until the thread's first event
+
+/******************************************************************************
+ *                                 RECORDING
+ ******************************************************************************/
+
+/**
+ * Start or stop recording
+ * Set before starting the threads that record; the flag itself is not
+ * synchronized.
+ *
+ * @param enabled true to record
+ */
+void profile_enable(bool enabled) {
+    profiling = enabled;
+}
+
+/**
+ * Check whether recording is on
+ *
+ * @return true if profile_begin() returns start times
+ */
+bool profile_enabled(void) {
+    return profiling;
+}
+
+/**
+ * Read the monotonic clock
+ *
+ * @return Nanoseconds since an arbitrary fixed point (never 0)
+ */
+uint64_t profile_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec + 1;
+}
+
+/**
+ * Start timing a section
+ *
+ * @return Start time for profile_end(), or 0 when recording is off
+ */
+uint64_t profile_begin(void) {
+    return profiling ? profile_now_ns() : 0;
+}
+
+/**
+ * Histogram bucket of a duration
+ *
+ * @param ns Duration in nanoseconds
+ * @return floor(log2(ns)), capped at the last bucket
+ */
+static int profile_bucket(uint64_t ns) {
+    int bucket = ns ? 63 - __builtin_clzll(ns) : 0;
+    return bucket < PROFILE_BUCKETS ? bucket : PROFILE_BUCKETS - 1;
+}
+
+/**
+ * Keep one event for the trace file
+ */
+static void trace_record(ProfileCounter counter, uint64_t start, uint64_t duration) {
+    TraceEvent *events = __atomic_load_n(&trace_events, __ATOMIC_ACQUIRE);
+    if (!events || !profile_info[counter].traced) return;
+
+    size_t slot = __atomic_fetch_add(&trace_used, 1, __ATOMIC_RELAXED);
+    if (slot >= PROFILE_TRACE_EVENTS) return;
+
+    if (trace_thread_id == 0) {
+        trace_thread_id = __atomic_add_fetch(&trace_threads, 1, __ATOMIC_RELAXED);
+    }
+    TraceEvent *event = &events[slot];
+    event->start_ns = start > trace_origin_ns ? start - trace_origin_ns : 0;
+    event->duration_ns = duration;
+    event->thread = trace_thread_id;
+    event->counter = counter;
+}
+
+/**
+ * Finish timing a section
+ *
+ * @param counter Counter to charge
+ * @param start Value returned by profile_begin() (0 = not timed)
+ */
+void profile_end(ProfileCounter counter, uint64_t start) {
+    if (start == 0 || counter < 0 || counter >= PROFILE_COUNTER_COUNT) return;
+    uint64_t now = profile_now_ns();
+    uint64_t duration = now > start ? now - start : 0;
+
+    ProfileStats *stats = &profile_stats[counter];
+    __atomic_fetch_add(&stats->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->total_ns, duration, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->buckets[profile_bucket(duration)], 1, __ATOMIC_RELAXED);
+
+    uint64_t max = __atomic_load_n(&stats->max_ns, __ATOMIC_RELAXED);
+    while (duration > max &&
+           !__atomic_compare_exchange_n(&stats->max_ns, &max, duration, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+
+    trace_record(counter, start, duration);
+}
+
+/**
+ * Zero every counter (the trace, if any, keeps its events)
+ */
+void profile_reset(void) {
+    for (int counter = 0; counter < PROFILE_COUNTER_COUNT; counter++) {
+        ProfileStats *stats = &profile_stats[counter];
+        __atomic_store_n(&stats->count, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&stats->total_ns, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&stats->max_ns, 0, __ATOMIC_RELAXED);
+        for (int bucket = 0; bucket < PROFILE_BUCKETS; bucket++) {
+            __atomic_store_n(&stats->buckets[bucket], 0, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/******************************************************************************
+ *                                 REPORTING
+ ******************************************************************************/
+
+/**
+ * Get the name of a counter
+ *
+ * @param counter Counter
+ * @return Short snake_case name, "unknown" if out of range
+ */
+const char *profile_counter_name(ProfileCounter counter) {
+    if (counter < 0 || counter >= PROFILE_COUNTER_COUNT) return "unknown";
+    return profile_info[counter].name;
+}
+
+/**
+ * Copy one counter
+ *
+ * @param counter Counter to read
+ * @param stats Output snapshot (zeroed for an unknown counter)
+ */
+void profile_snapshot(ProfileCounter counter, ProfileStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (counter < 0 || counter >= PROFILE_COUNTER_COUNT) return;
+
+    const ProfileStats *source = &profile_stats[counter];
+    stats->count = __atomic_load_n(&source->count, __ATOMIC_RELAXED);
+    stats->total_ns = __atomic_load_n(&source->total_ns, __ATOMIC_RELAXED);
+    stats->max_ns = __atomic_load_n(&source->max_ns, __ATOMIC_RELAXED);
+    for (int bucket = 0; bucket < PROFILE_BUCKETS; bucket++) {
+        stats->buckets[bucket] = __atomic_load_n(&source->buckets[bucket], __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * Estimate a percentile from the histogram
+ * Durations are only known to a power of two, so this is the upper bound
+ * of the bucket the percentile falls in, never more than the maximum.
+ *
+ * @param stats Snapshot
+ * @param fraction Percentile as a fraction (0.5 = median, 0.99 = p99)
+ * @return Duration in nanoseconds (0 if nothing was recorded)
+ */
+uint64_t profile_percentile(const ProfileStats *stats, double fraction) {
+    if (stats->count == 0) return 0;
+    uint64_t target = (uint64_t)(fraction * (double)stats->count + 0.5);
+    if (target < 1) target = 1;
+
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < PROFILE_BUCKETS; bucket++) {
+        seen += stats->buckets[bucket];
+        if (seen >= target) {
+            uint64_t upper = bucket + 1 < 64 ? (1ULL << (bucket + 1)) - 1 : UINT64_MAX;
+            return upper < stats->max_ns ? upper : stats->max_ns;
+        }
+    }
+    return stats->max_ns;
+}
+
+/**
+ * Format a duration with a unit that keeps it short
+ *
+ * @param ns Duration in nanoseconds
+ * @param out Output buffer
+ * @param size Size of out (12 bytes always suffice)
+ */
+void profile_format_ns(uint64_t ns, char *out, size_t size) {
+    if (ns < 1000) {
+        snprintf(out, size, "%uns", (unsigned)ns);
+    } else if (ns < 1000000) {
+        snprintf(out, size, "%.1fus", ns / 1e3);
+    } else if (ns < 1000000000) {
+        snprintf(out, size, "%.2fms", ns / 1e6);
+    } else {
+        snprintf(out, size, "%.2fs", ns / 1e9);
+    }
+}
+
+/**
+ * Print the table and histograms of every counter that ran
+ * Each histogram cell is one doubling of duration, shaded by its share of
+ * the fullest cell; the labels are the lower bounds of the first and last.
+ *
+ * @param out Stream to print on
+ */
+void profile_print(FILE *out) {
+    char mean[16], median[16], p99[16], max[16], total[16];
+    ProfileStats stats[PROFILE_COUNTER_COUNT];
+    bool any = false;
+
+    fprintf(out, "%-16s %10s %9s %9s %9s %9s %9s\n", "Counter", "Count", "Mean", "p50", "p99", "Max", "Total");
+    for (int counter = 0; counter < PROFILE_COUNTER_COUNT; counter++) {
+        profile_snapshot(counter, &stats[counter]);
+        const ProfileStats *s = &stats[counter];
+        if (s->count == 0) continue;
+        any = true;
+
+        profile_format_ns(s->total_ns / s->count, mean, sizeof(mean));
+        profile_format_ns(profile_percentile(s, 0.50), median, sizeof(median));
+        profile_format_ns(profile_percentile(s, 0.99), p99, sizeof(p99));
+        profile_format_ns(s->max_ns, max, sizeof(max));
+        profile_format_ns(s->total_ns, total, sizeof(total));
+        fprintf(out, "%-16s %10llu %9s %9s %9s %9s %9s\n", profile_counter_name(counter),
+                (unsigned long long)s->count, mean, median, p99, max, total);
+    }
+    if (!any) {
+        fprintf(out, "(nothing recorded yet)\n");
+        return;
+    }
+
+    fprintf(out, "\nHistograms (one cell per doubling of duration):\n");
+    const int shades = (int)strlen(PROFILE_HISTOGRAM_SHADES);
+    for (int counter = 0; counter < PROFILE_COUNTER_COUNT; counter++) {
+        const ProfileStats *s = &stats[counter];
+        if (s->count == 0) continue;
+
+        int first = PROFILE_BUCKETS, last = 0;
+        uint64_t fullest = 0;
+        for (int bucket = 0; bucket < PROFILE_BUCKETS; bucket++) {
+            if (s->buckets[bucket] == 0) continue;
+            if (bucket < first) first = bucket;
+            last = bucket;
+            if (s->buckets[bucket] > fullest) fullest = s->buckets[bucket];
+        }
+
+        char cells[PROFILE_BUCKETS + 1];
+        int length = 0;
+        for (int bucket = first; bucket <= last; bucket++) {
+            uint64_t filled = s->buckets[bucket];
+            int shade = filled == 0 ? 0 : 1 + (int)((filled * (uint64_t)(shades - 2)) / fullest);
+            cells[length++] = PROFILE_HISTOGRAM_SHADES[shade];
+        }
+        cells[length] = '\0';
+
+        char low[16], high[16];
+        profile_format_ns(1ULL << first, low, sizeof(low));
+        profile_format_ns(1ULL << last, high, sizeof(high));
+        fprintf(out, "%-16s %8s [%s] %s\n", profile_counter_name(counter), low, cells, high);
+    }
+}
+
+/******************************************************************************
+ *                                  TRACING
+ ******************************************************************************/
+
+/**
+ * Start keeping events for a Chrome trace file
+ * Also turns recording on. Only one trace runs at a time.
+ *
+ * @param path File profile_trace_stop() writes
+ * @return false if a trace is already running or memory runs out
+ */
+bool profile_trace_start(const char *path) {
+    if (trace_events || !path) return false;
+
+    trace_path = strdup(path);
+    TraceEvent *events = calloc(PROFILE_TRACE_EVENTS, sizeof(TraceEvent));
+    if (!trace_path || !events) {
+        free(trace_path);
+        free(events);
+        trace_path = NULL;
+        return false;
+    }
+
+    trace_used = 0;
+    trace_origin_ns = profile_now_ns();
+    __atomic_store_n(&trace_events, events, __ATOMIC_RELEASE);
+    profiling = true;
+    return true;
+}
+
+/**
+ * Write the trace file and stop tracing
+ * Events are complete events ("ph":"X") with microsecond times, one row
+ * per recording thread. Call once the recording threads have finished.
+ *
+ * @return false if no trace was running or the file cannot be written
+ */
+bool profile_trace_stop(void) {
+    TraceEvent *events = __atomic_exchange_n(&trace_events, NULL, __ATOMIC_ACQ_REL);
+    if (!events) return false;
+
+    size_t used = __atomic_load_n(&trace_used, __ATOMIC_RELAXED);
+    size_t count = used < PROFILE_TRACE_EVENTS ? used : PROFILE_TRACE_EVENTS;
+
+    FILE *file = fopen(trace_path, "w");
+    if (file) {
+        fprintf(file, "{\"traceEvents\":[\n");
+        fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"chess\"}}");
+        for (size_t i = 0; i < count; i++) {
+            const TraceEvent *event = &events[i];
+            fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"chess\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+                    profile_counter_name(event->counter), event->start_ns / 1e3, event->duration_ns / 1e3,
+                    event->thread);
+        }
+        fprintf(file, "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_events\":%llu}}\n",
+                (unsigned long long)(used - count));
+    }
+    bool written = file && fclose(file) == 0;
+
+    free(events);
+    free(trace_path);
+    trace_path = NULL;
+    return written;
+}
@@ -0,0 +1,87 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+/**
+ * profile.h - Built-in Profiling Counters and Trace Recording
+ *
+ * Purpose:
+ *   Answers "where did the time go?" from inside a running game: how
+ *   often each subsystem ran and how long it took (move generation,
+ *   legality checks, FEN encode/decode, PGN rebuilds, engine round trips,
+ *   screen rendering). When the AI feels slow this tells whether the time
+ *   is spent in the engine, writing to its pipe, or in our own code.
+ *
+ * Architecture:
+ *   - One ProfileStats per ProfileCounter: call count, total, maximum and
+ *     a histogram of durations in power-of-two nanosecond buckets.
+ *     Updates are relaxed atomic adds, so search threads can record
+ *     without locks
+ *   - Recording is off until profile_enable(true); profile_begin() then
+ *     returns 0 and profile_end() does nothing, so the instrumented
+ *     primitives cost one branch in tools, tests and benchmarks
+ *   - profile_trace_start() also keeps every timed event in memory and
+ *     profile_trace_stop() writes them as Chrome trace-event JSON
+ *     (chrome://tracing, Perfetto). Move generation and legality checks
+ *     run millions of times per search and are counted only, never traced
+ *
+ * Usage:
+ *     uint64_t start = profile_begin();
+ *     ... work ...
+ *     profile_end(PROFILE_PGN_REBUILD, start);
+ *
+ * Dependencies:
+ *   - None (POSIX clock_gettime(CLOCK_MONOTONIC))
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define PROFILE_BUCKETS 40              // Histogram buckets: [2^i, 2^(i+1)) ns, the last open-ended
+#define PROFILE_TRACE_EVENTS 65536      // Events kept for a trace; later ones are dropped
+
+/**
+ * ProfileCounter - Instrumented subsystems
+ */
+typedef enum {
+    PROFILE_MOVE_GENERATION,            // generate_legal_moves()
+    PROFILE_LEGALITY_CHECK,             // is_valid_move()
+    PROFILE_FEN_ENCODE,                 // fen_write()
+    PROFILE_FEN_DECODE,                 // fen_decode()
+    PROFILE_PGN_REBUILD,                // Current game converted to PGN
+    PROFILE_ENGINE_SEND,                // Position and go written to the Stockfish pipe
+    PROFILE_ENGINE_MOVE,                // get_best_move() round trip (search included)
+    PROFILE_RENDER,                     // screen_begin_frame() to screen_end_frame()
+    PROFILE_COUNTER_COUNT
+} ProfileCounter;
+
+/**
+ * ProfileStats - Snapshot of one counter
+ */
+typedef struct {
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint64_t buckets[PROFILE_BUCKETS];
+} ProfileStats;
+
+// Recording
+void profile_enable(bool enabled);  // Start or stop recording (call before starting threads)
+bool profile_enabled(void);  // Recording is on
+uint64_t profile_now_ns(void);  // Monotonic clock in nanoseconds
+uint64_t profile_begin(void);  // Start time for profile_end(), 0 when recording is off
+void profile_end(ProfileCounter counter, uint64_t start);  // Record the time since start (ignored if start is 0)
+void profile_reset(void);  // Zero every counter
+
+// Reporting
+const char *profile_counter_name(ProfileCounter counter);  // Short name ("move_generation", ...)
+void profile_snapshot(ProfileCounter counter, ProfileStats *stats);  // Copy one counter
+uint64_t profile_percentile(const ProfileStats *stats, double fraction);  // Upper bound of the bucket holding that fraction (ns)
+void profile_format_ns(uint64_t ns, char *out, size_t size);  // "850ns", "12.3us", "4.56ms", "1.23s"
+void profile_print(FILE *out);  // Table and histograms of every counter that ran
+
+// Tracing
+bool profile_trace_start(const char *path);  // Record events for a trace file (enables recording)
+bool profile_trace_stop(void);  // Write the trace file and stop tracing; false if it cannot be written
+
+#endif // PROFILE_H
@@ -0,0 +1,472 @@
+/**
+ * protocol.c - Headless Line Protocol (chess --protocol)
+ *
+ * Purpose:
+ *   Command parsing and replies for the protocol described in protocol.h.
+ *
+ * Architecture:
+ *   - Commands are split on whitespace in place; each handler writes
+ *     exactly one reply through reply_*(), which format it as text or JSON
+ *   - The go worker is the only other thread. It searches a private copy
+ *     of the position, so commands that wait for it never race with it
+ *
+ * Dependencies:
+ *   - protocol.h, san.h, pgn_utils.h, search.h (static evaluation)
+ */
+
+#define _GNU_SOURCE        // Required for Linux (strtok_r)
+
+#include "protocol.h"
+#include "pgn_utils.h"
+#include "san.h"
+#include "search.h"
+
+#define PROTOCOL_MAX_TOKENS 1024        // Words per command line
+
+/******************************************************************************
+ *                                  REPLIES
+ ******************************************************************************/
+
+/**
+ * Write a JSON string literal with the required escapes
+ */
+static void write_json_string(FILE *out, const char *text) {
+    fputc('"', out);
+    for (const unsigned char *p = (const unsigned char *)text; *p; p++) {
+        switch (*p) {
+            case '"': fputs("\\\"", out); break;
+            case '\\': fputs("\\\\", out); break;
+            case '\n': fputs("\\n", out); break;
+            case '\r': fputs("\\r", out); break;
+            case '\t': fputs("\\t", out); break;
+            default:
+                if (*p < 0x20) fprintf(out, "\\u%04x", *p);
+                else fputc(*p, out);
+                break;
+        }
+    }
+    fputc('"', out);
+}
+
+/**
+ * Reply with one string value: "<key> <value>" or {"<key>":"<value>"}
+ */
+static void reply_string(ProtocolSession *session, const char *key, const char *value) {
+    pthread_mutex_lock(&session->output_lock);
+    if (session->format == PROTOCOL_JSON) {
+        fprintf(session->out, "{\"%s\":", key);
+        write_json_string(session->out, value);
+        fputs("}\n", session->out);
+    } else {
+        fprintf(session->out, "%s %s\n", key, value);
+    }
+    fflush(session->out);
+    pthread_mutex_unlock(&session->output_lock);
+}
+
+static void reply_ok(ProtocolSession *session) {
+    pthread_mutex_lock(&session->output_lock);
+    fputs(session->format == PROTOCOL_JSON ? "{\"ok\":true}\n" : "ok\n", session->out);
+    fflush(session->out);
+    pthread_mutex_unlock(&session->output_lock);
+}
+
+static void reply_error(ProtocolSession *session, const char *reason) {
+    reply_string(session, "error", reason);
+}
+
+/******************************************************************************
+ *                                  SEARCH
+ ******************************************************************************/
+
+/**
+ * go worker: search the copied position and reply with the move
+ */
+static void *search_worker(void *argument) {
+    ProtocolSession *session = argument;
+    char move[8];
+    if (get_best_move_limited(session->engine, &session->search_game, session->search_movetime_ms,
+                              session->search_depth, move)) {
+        reply_string(session, "bestmove", move);
+    } else {
+        reply_error(session, "no legal move");
+    }
+    return NULL;
+}
+
+/**
+ * Wait for a running go to answer
+ */
+static void finish_search(ProtocolSession *session) {
+    if (!session->searching) return;
+    pthread_join(session->search_thread, NULL);
+    session->searching = false;
+}
+
+/******************************************************************************
+ *                                 POSITIONS
+ ******************************************************************************/
+
+/**
+ * Find a legal move written in UCI (e2e4, e7e8q) or SAN (Nf3, exf8=Q+)
+ *
+ * @param game Position the move is played in
+ * @param token Move text
+ * @param move Output: the legal move with promotion piece filled in
+ * @return false if the text is not a legal move here
+ */
+bool protocol_parse_move(ChessGame *game, const char *token, Move *move) {
+    size_t length = strlen(token);
+    bool uci = (length == 4 || length == 5) &&
+               token[0] >= 'a' && token[0] <= 'h' && token[1] >= '1' && token[1] <= '8' &&
+               token[2] >= 'a' && token[2] <= 'h' && token[3] >= '1' && token[3] <= '8';
+    return uci ? find_legal_uci_move(game, token, move) : san_parse(game, token, move);
+}
+
+/**
+ * Play moves on the current position; all or nothing
+ *
+ * @param session Session
+ * @param tokens Move texts
+ * @param count Number of moves
+ * @return true if every move was legal (reply not yet written)
+ */
+static bool apply_moves(ProtocolSession *session, char **tokens, int count) {
+    ChessGame game = session->game;
+    Move *played = count > 0 ? malloc((size_t)count * sizeof(Move)) : NULL;
+    ChessGame *after = count > 0 ? malloc((size_t)count * sizeof(ChessGame)) : NULL;
+    if (count > 0 && (!played || !after)) {
+        free(played);
+        free(after);
+        reply_error(session, "out of memory");
+        return false;
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (!protocol_parse_move(&game, tokens[i], &played[i]) || !execute_move(&game, played[i])) {
+            char reason[64];
+            snprintf(reason, sizeof(reason), "illegal move %.40s", tokens[i]);
+            reply_error(session, reason);
+            free(played);
+            free(after);
+            return false;
+        }
+        after[i] = game;
+    }
+
+    for (int i = 0; i < count; i++) {
+        history_push(&session->history, &after[i], played[i]);
+    }
+    session->game = game;
+    free(played);
+    free(after);
+    return true;
+}
+
+/**
+ * Result marker for the current position ("*" while the game goes on)
+ */
+static const char *position_result(ChessGame *game) {
+    Move moves[MAX_LEGAL_MOVES];
+    if (generate_legal_moves(game, moves) > 0) {
+        return is_fifty_move_rule_draw(game) ? "1/2-1/2" : "*";
+    }
+    if (!is_in_check(game, game->current_player)) return "1/2-1/2";
+    return game->current_player == WHITE ? "0-1" : "1-0";
+}
+
+/******************************************************************************
+ *                                 COMMANDS
+ ******************************************************************************/
+
+/**
+ * position startpos|fen <FEN fields> [moves ...]
+ */
+static void command_position(ProtocolSession *session, char **tokens, int count) {
+    int moves_at = count;
+    for (int i = 1; i < count; i++) {
+        if (strcmp(tokens[i], "moves") == 0) {
+            moves_at = i;
+            break;
+        }
+    }
+
+    ChessGame game;
+    if (count >= 2 && strcmp(tokens[1], "startpos") == 0 && moves_at == 2) {
+        init_board(&game);
+    } else if (count >= 3 && strcmp(tokens[1], "fen") == 0) {
+        char fen[FEN_BUFFER_SIZE];
+        size_t used = 0;
+        fen[0] = '\0';
+        for (int i = 2; i < moves_at && used < sizeof(fen); i++) {
+            int written = snprintf(fen + used, sizeof(fen) - used, "%s%s", i > 2 ? " " : "", tokens[i]);
+            if (written > 0) used += (size_t)written;
+        }
+        if (used >= sizeof(fen) || !setup_board_from_fen(&game, fen)) {
+            reply_error(session, "invalid FEN");
+            return;
+        }
+    } else {
+        reply_error(session, "usage: position startpos|fen <FEN> [moves ...]");
+        return;
+    }
+
+    ChessGame previous = session->game;
+    session->game = game;
+    history_reset(&session->history, &game, NULL);
+    if (moves_at < count && !apply_moves(session, tokens + moves_at + 1, count - moves_at - 1)) {
+        // Leave the session where it was
+        session->game = previous;
+        history_reset(&session->history, &previous, NULL);
+        return;
+    }
+    reply_ok(session);
+}
+
+/**
+ * go [movetime <ms>] [depth <n>] [infinite]
+ */
+static void command_go(ProtocolSession *session, char **tokens, int count) {
+    int movetime_ms = 0, depth = 0;
+    bool infinite = false;
+    for (int i = 1; i < count; i++) {
+        if (strcmp(tokens[i], "movetime") == 0 && i + 1 < count) {
+            movetime_ms = atoi(tokens[++i]);
+        } else if (strcmp(tokens[i], "depth") == 0 && i + 1 < count) {
+            depth = atoi(tokens[++i]);
+        } else if (strcmp(tokens[i], "infinite") == 0) {
+            infinite = true;
+        } else {
+            reply_error(session, "usage: go [movetime <ms>] [depth <n>] [infinite]");
+            return;
+        }
+    }
+    if (movetime_ms < 0 || depth < 0) {
+        reply_error(session, "limits must be positive");
+        return;
+    }
+    if (!infinite && movetime_ms == 0 && depth == 0) movetime_ms = PROTOCOL_DEFAULT_MOVETIME_MS;
+    if (infinite) movetime_ms = depth = 0;
+
+    session->search_game = session->game;
+    session->search_movetime_ms = movetime_ms;
+    session->search_depth = depth;
+    session->engine->stop_requested = false;   // Before the thread exists, so a quick stop is never lost
+    if (pthread_create(&session->search_thread, NULL, search_worker, session) != 0) {
+        reply_error(session, "cannot start search");
+        return;
+    }
+    session->searching = true;
+}
+
+/**
+ * eval [static]: engine evaluation, or the built-in static evaluation
+ */
+static void command_eval(ProtocolSession *session, char **tokens, int count) {
+    int score;
+    if (count > 1 && strcmp(tokens[1], "static") == 0) {
+        score = evaluate_position(&session->game);
+    } else if (!get_position_evaluation(session->engine, &session->game, &score)) {
+        reply_error(session, "engine not available");
+        return;
+    }
+
+    pthread_mutex_lock(&session->output_lock);
+    if (session->format == PROTOCOL_JSON) {
+        fprintf(session->out, "{\"eval\":%d}\n", score);
+    } else {
+        fprintf(session->out, "eval cp %d\n", score);
+    }
+    fflush(session->out);
+    pthread_mutex_unlock(&session->output_lock);
+}
+
+/**
+ * undo [<n>]: take back n plies (default 1)
+ */
+static void command_undo(ProtocolSession *session, char **tokens, int count) {
+    int plies = count > 1 ? atoi(tokens[1]) : 1;
+    if (!history_undo(&session->history, plies, &session->game)) {
+        reply_error(session, "nothing to undo");
+        return;
+    }
+    reply_ok(session);
+}
+
+/**
+ * pgn: movetext (text) or the complete PGN (JSON)
+ */
+static void command_pgn(ProtocolSession *session) {
+    GameRecord record;
+    if (!history_to_record(&session->history, &record)) {
+        reply_error(session, "no game");
+        return;
+    }
+
+    const char *result = position_result(&session->game);
+    char *pgn = session->format == PROTOCOL_JSON ? convert_record_to_pgn_string(&record, result) :
+                                                   pgn_format_movetext(&record, result);
+    game_record_free(&record);
+    if (!pgn) {
+        reply_error(session, "out of memory");
+        return;
+    }
+
+    // Text replies stay on one line
+    if (session->format == PROTOCOL_TEXT) {
+        for (char *p = pgn; *p; p++) {
+            if (*p == '\n' || *p == '\r') *p = ' ';
+        }
+        size_t length = strlen(pgn);
+        while (length > 0 && pgn[length - 1] == ' ') pgn[--length] = '\0';
+    }
+    reply_string(session, "pgn", pgn);
+    free(pgn);
+}
+
+/**
+ * legal: every legal move in UCI notation
+ */
+static void command_legal(ProtocolSession *session) {
+    Move moves[MAX_LEGAL_MOVES];
+    int count = generate_legal_moves(&session->game, moves);
+
+    pthread_mutex_lock(&session->output_lock);
+    fputs(session->format == PROTOCOL_JSON ? "{\"legal\":[" : "legal", session->out);
+    for (int i = 0; i < count; i++) {
+        char text[6] = {(char)('a' + moves[i].from.col), (char)('8' - moves[i].from.row),
+                        (char)('a' + moves[i].to.col), (char)('8' - moves[i].to.row), '\0', '\0'};
+        if (moves[i].is_promotion) text[4] = " prnbqk"[moves[i].promotion_piece];
+        if (session->format == PROTOCOL_JSON) fprintf(session->out, "%s\"%s\"", i ? "," : "", text);
+        else fprintf(session->out, " %s", text);
+    }
+    fputs(session->format == PROTOCOL_JSON ? "]}\n" : "\n", session->out);
+    fflush(session->out);
+    pthread_mutex_unlock(&session->output_lock);
+}
+
+/******************************************************************************
+ *                                  SESSION
+ ******************************************************************************/
+
+/**
+ * Start a session at the initial position
+ *
+ * @param session Session to initialize
+ * @param engine Ready engine (Stockfish or built-in)
+ * @param out Where replies are written
+ * @param format Text or JSON replies
+ * @return false if the move tree cannot be allocated
+ */
+bool protocol_init(ProtocolSession *session, StockfishEngine *engine, FILE *out, ProtocolFormat format) {
+    memset(session, 0, sizeof(*session));
+    session->engine = engine;
+    session->out = out;
+    session->format = format;
+    pthread_mutex_init(&session->output_lock, NULL);
+    init_board(&session->game);
+    history_init(&session->history);
+    return history_reset(&session->history, &session->game, NULL);
+}
+
+/**
+ * Run one command line
+ *
+ * @param session Session
+ * @param line Command text (split in place)
+ * @return false once quit has been received
+ */
+bool protocol_execute(ProtocolSession *session, char *line) {
+    char *tokens[PROTOCOL_MAX_TOKENS];
+    int count = 0;
+    char *save = NULL;
+    for (char *token = strtok_r(line, " \t\r\n", &save); token && count < PROTOCOL_MAX_TOKENS;
+         token = strtok_r(NULL, " \t\r\n", &save)) {
+        tokens[count++] = token;
+    }
+    if (count == 0) return true;
+
+    const char *command = tokens[0];
+
+    // Answered at once, even during a search
+    if (strcmp(command, "stop") == 0) {
+        if (session->searching) stop_search(session->engine);
+        return true;
+    }
+    if (strcmp(command, "quit") == 0) {
+        if (session->searching) stop_search(session->engine);
+        finish_search(session);
+        return false;
+    }
+    if (strcmp(command, "isready") == 0) {
+        pthread_mutex_lock(&session->output_lock);
+        fputs(session->format == PROTOCOL_JSON ? "{\"ready\":true}\n" : "readyok\n", session->out);
+        fflush(session->out);
+        pthread_mutex_unlock(&session->output_lock);
+        return true;
+    }
+
+    // Everything else follows the reply of a running go
+    finish_search(session);
+
+    if (strcmp(command, "position") == 0) {
+        command_position(session, tokens, count);
+    } else if (strcmp(command, "moves") == 0) {
+        if (apply_moves(session, tokens + 1, count - 1)) reply_ok(session);
+    } else if (strcmp(command, "go") == 0) {
+        command_go(session, tokens, count);
+    } else if (strcmp(command, "eval") == 0) {
+        command_eval(session, tokens, count);
+    } else if (strcmp(command, "undo") == 0) {
+        command_undo(session, tokens, count);
+    } else if (strcmp(command, "fen") == 0) {
+        char fen[FEN_BUFFER_SIZE];
+        fen_write(&session->game, fen, sizeof(fen));
+        reply_string(session, "fen", fen);
+    } else if (strcmp(command, "pgn") == 0) {
+        command_pgn(session);
+    } else if (strcmp(command, "legal") == 0) {
+        command_legal(session);
+    } else {
+        char reason[80];
+        snprintf(reason, sizeof(reason), "unknown command %.40s", command);
+        reply_error(session, reason);
+    }
+    return true;
+}
+
+/**
+ * Stop any search and free the session
+ *
+ * @param session Session to close
+ */
+void protocol_close(ProtocolSession *session) {
+    if (session->searching) stop_search(session->engine);
+    finish_search(session);
+    history_close(&session->history);
+    pthread_mutex_destroy(&session->output_lock);
+}
+
+/**
+ * Serve protocol commands until quit or end of input
+ *
+ * @param engine Ready engine
+ * @param in Command stream
+ * @param out Reply stream
+ * @param format Text or JSON replies
+ * @return Process exit status (0 = normal end)
+ */
+int protocol_run(StockfishEngine *engine, FILE *in, FILE *out, ProtocolFormat format) {
+    static ProtocolSession session;
+    if (!protocol_init(&session, engine, out, format)) {
+        return 1;
+    }
+
+    static char line[PROTOCOL_LINE_SIZE];
+    while (fgets(line, sizeof(line), in)) {
+        if (!protocol_execute(&session, line)) break;
+    }
+
+    protocol_close(&session);
+    return 0;
+}
@@ -0,0 +1,90 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+/**
+ * protocol.h - Headless Line Protocol (chess --protocol)
+ *
+ * Purpose:
+ *   Lets other programs drive the rules and the engine over stdin and
+ *   stdout instead of feeding keystrokes to the interactive game and
+ *   scraping the screen. No ANSI escapes, screen clears or prompts are
+ *   ever written, and no game files are created.
+ *
+ * Commands (one per line) and replies:
+ *     position startpos|fen <FEN> [moves <m>...]   ok
+ *     moves <m>...                                  ok
+ *     go [movetime <ms>] [depth <n>] [infinite]    bestmove <m>
+ *     stop                                          (no reply; ends a running go)
+ *     eval [static]                                 eval cp <n>
+ *     undo [<n>]                                    ok
+ *     fen                                           fen <FEN>
+ *     pgn                                           pgn <movetext>
+ *     legal                                         legal <m>...
+ *     isready                                       readyok
+ *     quit
+ *   Moves are UCI long algebraic (e2e4, e7e8q) or SAN (Nf3). Scores are
+ *   centipawns from the side to move's view, as in UCI. Every command
+ *   except stop and quit answers with exactly one line; failures answer
+ *   "error <reason>". With PROTOCOL_JSON each reply is one JSON object
+ *   instead: {"ok":true}, {"bestmove":"e2e4"}, {"eval":31},
+ *   {"fen":"..."}, {"pgn":"<complete PGN>"}, {"legal":["e2e4",...]},
+ *   {"ready":true}, {"error":"..."}.
+ *
+ * Architecture:
+ *   - A ProtocolSession holds the position and its move tree (history.h,
+ *     without a FEN journal); undo and pgn come from the tree
+ *   - A move list is applied to a copy of the position and committed only
+ *     if every move is legal
+ *   - go searches on a worker thread so stop is read while it runs; the
+ *     next command other than stop, isready or quit waits for its reply.
+ *     Replies are written whole, under a lock, and flushed
+ *
+ * Dependencies:
+ *   - chess.h, history.h, san.h, pgn_utils.h for rules and notation
+ *   - stockfish.h for the engine (Stockfish or the built-in search)
+ */
+
+#include "chess.h"
+#include "history.h"
+#include "stockfish.h"
+
+#include <pthread.h>
+
+#define PROTOCOL_LINE_SIZE 8192         // Longest command line accepted
+#define PROTOCOL_DEFAULT_MOVETIME_MS 1000   // go without limits or "infinite"
+
+/**
+ * ProtocolFormat - Reply encoding
+ */
+typedef enum {
+    PROTOCOL_TEXT = 0,       // UCI-like words
+    PROTOCOL_JSON            // One JSON object per line
+} ProtocolFormat;
+
+/**
+ * ProtocolSession - State of one protocol connection
+ */
+typedef struct {
+    StockfishEngine *engine;
+    ProtocolFormat format;
+    FILE *out;
+    pthread_mutex_t output_lock;        // Held while a reply is written
+    ChessGame game;                     // Current position
+    GameHistory history;                // Moves from the position command on
+    bool searching;                     // search_thread is running a go
+    pthread_t search_thread;
+    ChessGame search_game;              // Position the running go searches
+    int search_movetime_ms;
+    int search_depth;
+} ProtocolSession;
+
+// Session
+bool protocol_init(ProtocolSession *session, StockfishEngine *engine, FILE *out, ProtocolFormat format);  // Start at the initial position
+bool protocol_execute(ProtocolSession *session, char *line);  // Run one command line; false after quit
+void protocol_close(ProtocolSession *session);  // Stop any search and free the session
+int protocol_run(StockfishEngine *engine, FILE *in, FILE *out, ProtocolFormat format);  // Serve commands until quit or end of input
+
+// Notation
+bool protocol_parse_move(ChessGame *game, const char *token, Move *move);  // Legal move from UCI or SAN text
+
+#endif // PROTOCOL_H
@@ -0,0 +1,320 @@
+/**
+ * san.c - Standard Algebraic Notation (SAN) Move Decoding and Encoding
+ *
+ * Purpose:
+ *   Resolves SAN tokens against the legal move list of a position and
+ *   writes legal moves as SAN.
+ *
+ * Architecture:
+ *   - san_table_build() generates the legal moves once, writes the
+ *     canonical SAN of each and inserts it into a linear-probing hash
+ *   - san_table_find() normalizes the token and looks it up; on a miss it
+ *     decodes the token field by field and requires exactly one match
+ *   - san_write() plays the move on a copy of the position to decide
+ *     between no suffix, "+" and "#"
+ *
+ * Dependencies:
+ *   - chess.h: generate_legal_moves(), execute_move(), is_in_check()
+ */
+
+#include "san.h"
+
+static const char SAN_PIECE_LETTERS[] = " PRNBQK";   // Indexed by PieceType
+
+/**
+ * FNV-1a hash of a SAN string reduced to a table slot
+ */
+static unsigned int san_slot(const char *san) {
+    uint32_t hash = 2166136261u;
+    while (*san) {
+        hash ^= (unsigned char)*san++;
+        hash *= 16777619u;
+    }
+    return hash & (SAN_TABLE_SLOTS - 1);
+}
+
+/**
+ * Write the canonical SAN of moves[index] without a check suffix
+ * Disambiguates by file, then rank, then both, only as far as needed to
+ * separate the move from other legal moves of the same piece type to the
+ * same square.
+ */
+static void san_write_base(const ChessGame *game, const Move *moves, int count, int index, char *out) {
+    const Move *move = &moves[index];
+    PieceType type = game->board[move->from.row][move->from.col].type;
+    char *p = out;
+
+    if (type == KING && abs(move->to.col - move->from.col) == 2) {
+        strcpy(out, move->to.col > move->from.col ? "O-O" : "O-O-O");
+        return;
+    }
+
+    if (type == PAWN) {
+        if (move->is_capture) {
+            *p++ = (char)('a' + move->from.col);
+        }
+    } else {
+        *p++ = SAN_PIECE_LETTERS[type];
+
+        bool ambiguous = false, same_file = false, same_rank = false;
+        for (int i = 0; i < count; i++) {
+            const Move *other = &moves[i];
+            if (i == index || other->to.row != move->to.row || other->to.col != move->to.col) continue;
+            if (other->from.row == move->from.row && other->from.col == move->from.col) continue;
+            if (game->board[other->from.row][other->from.col].type != type) continue;
+
+            ambiguous = true;
+            if (other->from.col == move->from.col) same_file = true;
+            if (other->from.row == move->from.row) same_rank = true;
+        }
+
+        if (ambiguous) {
+            if (!same_file) {
+                *p++ = (char)('a' + move->from.col);
+            } else if (!same_rank) {
+                *p++ = (char)('8' - move->from.row);
+            } else {
+                *p++ = (char)('a' + move->from.col);
+                *p++ = (char)('8' - move->from.row);
+            }
+        }
+    }
+
+    if (move->is_capture) *p++ = 'x';
+    *p++ = (char)('a' + move->to.col);
+    *p++ = (char)('8' - move->to.row);
+
+    if (move->is_promotion) {
+        *p++ = '=';
+        *p++ = SAN_PIECE_LETTERS[move->promotion_piece];
+    }
+    *p = '\0';
+}
+
+/**
+ * Generate the legal moves of a position and index them by SAN
+ *
+ * @param table Table to fill (overwritten)
+ * @param game Position to index (temporarily modified during legality tests, then restored)
+ */
+void san_table_build(SanTable *table, ChessGame *game) {
+    table->move_count = generate_legal_moves(game, table->moves);
+
+    for (int i = 0; i < SAN_TABLE_SLOTS; i++) {
+        table->slots[i] = -1;
+    }
+
+    for (int i = 0; i < table->move_count; i++) {
+        san_write_base(game, table->moves, table->move_count, i, table->san[i]);
+
+        unsigned int slot = san_slot(table->san[i]);
+        while (table->slots[slot] >= 0) {
+            slot = (slot + 1) & (SAN_TABLE_SLOTS - 1);
+        }
+        table->slots[slot] = (int16_t)i;
+    }
+}
+
+/**
+ * Normalize a SAN token to canonical spelling
+ * Drops check marks and annotation glyphs, spells castling with the
+ * letter O and writes promotions as "=Q" (accepting "e8Q" and "e8=q").
+ *
+ * @return false if the token does not fit the buffer
+ */
+static bool san_normalize(const char *token, char *out) {
+    size_t length = 0;
+
+    for (const char *c = token; *c && !strchr("+#!?", *c); c++) {
+        if (length + 2 >= SAN_BUFFER_SIZE) return false;
+        char ch = *c;
+        if (ch == '0') ch = 'O';   // "0-0" castling; digit 0 is never a rank
+        out[length++] = ch;
+    }
+    out[length] = '\0';
+
+    // Promotion piece without '=' or in lower case
+    if (length >= 3) {
+        char last = (char)toupper((unsigned char)out[length - 1]);
+        char before = out[length - 2];
+        if (strchr("QRBN", last) && (before == '8' || before == '1')) {
+            out[length - 1] = '=';
+            out[length++] = last;
+            out[length] = '\0';
+        } else if (strchr("QRBN", last) && before == '=') {
+            out[length - 1] = last;
+        }
+    }
+    return true;
+}
+
+/**
+ * Decode a non-canonical SAN token field by field
+ * Handles redundant disambiguation ("Ngf3"), long algebraic ("Ng1f3",
+ * "e2e4", "e2-e4") and promotions written without a piece (queen assumed).
+ *
+ * @return Move index if exactly one legal move matches, -1 otherwise
+ */
+static int san_match_fields(const SanTable *table, const char *san) {
+    size_t length = strlen(san);
+
+    PieceType piece = PAWN;
+    size_t start = 0;
+    const char *letter = strchr(SAN_PIECE_LETTERS + 2, san[0]);
+    if (san[0] != '\0' && letter) {
+        piece = (PieceType)(letter - SAN_PIECE_LETTERS);
+        start = 1;
+    }
+
+    PieceType promotion = EMPTY;
+    const char *equals = strchr(san, '=');
+    if (equals) {
+        const char *promo = strchr(SAN_PIECE_LETTERS + 2, equals[1]);
+        if (!promo || equals[1] == '\0' || equals[1] == 'K') return -1;
+        promotion = (PieceType)(promo - SAN_PIECE_LETTERS);
+        length = (size_t)(equals - san);
+    }
+
+    if (length < start + 2) return -1;
+    char file = san[length - 2];
+    char rank = san[length - 1];
+    if (file < 'a' || file > 'h' || rank < '1' || rank > '8') return -1;
+    Position to = {'8' - rank, file - 'a'};
+
+    int from_col = -1, from_row = -1;
+    for (size_t i = start; i < length - 2; i++) {
+        char c = san[i];
+        if (c >= 'a' && c <= 'h') from_col = c - 'a';
+        else if (c >= '1' && c <= '8') from_row = '8' - c;
+        else if (c != 'x' && c != '-' && c != ':') return -1;
+    }
+
+    int found = -1;
+    for (int i = 0; i < table->move_count; i++) {
+        const Move *move = &table->moves[i];
+        if (move->to.row != to.row || move->to.col != to.col) continue;
+        if (from_col >= 0 && move->from.col != from_col) continue;
+        if (from_row >= 0 && move->from.row != from_row) continue;
+        if (!move->is_promotion && promotion != EMPTY) continue;
+        if (move->is_promotion && move->promotion_piece != (promotion != EMPTY ? promotion : QUEEN)) continue;
+
+        // Piece type is implied by the canonical SAN's first character
+        char first = table->san[i][0];
+        PieceType type = (first >= 'a' && first <= 'h') ? PAWN : (first == 'O') ? KING
+                       : (PieceType)(strchr(SAN_PIECE_LETTERS, first) - SAN_PIECE_LETTERS);
+        if (type != piece) continue;
+
+        if (found >= 0) return -1;   // Ambiguous
+        found = i;
+    }
+    return found;
+}
+
+/**
+ * Find the legal move a SAN token refers to
+ *
+ * @param table Table built for the current position
+ * @param token SAN token, optionally with check marks and annotations
+ * @return Index into table->moves, or -1 if the token is unknown, illegal or ambiguous
+ */
+int san_table_find(const SanTable *table, const char *token) {
+    char san[SAN_BUFFER_SIZE];
+    if (!token || !san_normalize(token, san) || san[0] == '\0') return -1;
+
+    unsigned int slot = san_slot(san);
+    while (table->slots[slot] >= 0) {
+        int index = table->slots[slot];
+        if (strcmp(table->san[index], san) == 0) return index;
+        slot = (slot + 1) & (SAN_TABLE_SLOTS - 1);
+    }
+
+    if (strncmp(san, "O-O", 3) == 0) return -1;   // Castling is always canonical
+    return san_match_fields(table, san);
+}
+
+/**
+ * Decode a single SAN token in the given position
+ * Builds a table for one lookup; callers decoding a whole game should keep
+ * a SanTable and rebuild it once per ply instead.
+ *
+ * @param game Position the move is played from
+ * @param token SAN token
+ * @param move Output move (is_capture, is_promotion and promotion_piece set)
+ * @return true if the token names exactly one legal move
+ */
+bool san_parse(ChessGame *game, const char *token, Move *move) {
+    SanTable table;
+    san_table_build(&table, game);
+
+    int index = san_table_find(&table, token);
+    if (index < 0) return false;
+
+    *move = table.moves[index];
+    return true;
+}
+
+/**
+ * Find a move in the table by its squares and promotion piece
+ * A promotion move without a piece selects the queen promotion.
+ *
+ * @param table Table built for the position
+ * @param move Move to look up (only from, to and promotion fields are used)
+ * @return Index into table->moves, or -1 if the move is not legal
+ */
+int san_table_index_of(const SanTable *table, Move move) {
+    PieceType promotion = (move.is_promotion && move.promotion_piece != EMPTY) ? move.promotion_piece : QUEEN;
+
+    for (int i = 0; i < table->move_count; i++) {
+        const Move *legal = &table->moves[i];
+        if (legal->from.row != move.from.row || legal->from.col != move.from.col) continue;
+        if (legal->to.row != move.to.row || legal->to.col != move.to.col) continue;
+        if (legal->is_promotion && legal->promotion_piece != promotion) continue;
+        return i;
+    }
+    return -1;
+}
+
+/**
+ * Write a legal move as SAN including the check or mate suffix
+ *
+ * @param game Position the move is played from (not modified)
+ * @param table Table built for that position
+ * @param index Move index in the table
+ * @param out Output buffer
+ * @param cap Size of out (SAN_BUFFER_SIZE always fits)
+ * @return Length written, or 0 if index is invalid or the SAN does not fit
+ */
+size_t san_write(const ChessGame *game, const SanTable *table, int index, char *out, size_t cap) {
+    if (index < 0 || index >= table->move_count || cap == 0) return 0;
+
+    ChessGame after = *game;
+    const char *suffix = "";
+    if (execute_move(&after, table->moves[index]) && is_in_check(&after, after.current_player)) {
+        Move replies[MAX_LEGAL_MOVES];
+        suffix = generate_legal_moves(&after, replies) > 0 ? "+" : "#";
+    }
+
+    int length = snprintf(out, cap, "%s%s", table->san[index], suffix);
+    if (length < 0 || (size_t)length >= cap) {
+        out[0] = '\0';
+        return 0;
+    }
+    return (size_t)length;
+}
+
+/**
+ * Encode a single legal move as SAN
+ * Builds a table for one move; callers writing a whole game should keep a
+ * SanTable and rebuild it once per ply instead.
+ *
+ * @param game Position the move is played from
+ * @param move Move to encode
+ * @param out Output buffer
+ * @param cap Size of out
+ * @return Length written, or 0 if the move is not legal in the position
+ */
+size_t san_format_move(ChessGame *game, Move move, char *out, size_t cap) {
+    SanTable table;
+    san_table_build(&table, game);
+    return san_write(game, &table, san_table_index_of(&table, move), out, cap);
+}
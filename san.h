@@ -0,0 +1,61 @@
+#ifndef SAN_H
+#define SAN_H
+
+/**
+ * san.h - Standard Algebraic Notation (SAN) Move Decoding and Encoding
+ *
+ * Purpose:
+ *   Turns SAN tokens from PGN movetext ("Nbd7", "exd6", "e8=Q+", "O-O")
+ *   into legal moves and legal moves back into SAN. The legal move list is
+ *   generated once per position and every token is matched against it, so
+ *   promotions, en passant and ambiguous pieces resolve exactly as the
+ *   rules require. The writer uses the same list for minimal
+ *   disambiguation and the position after the move for "+" and "#".
+ *
+ * Architecture:
+ *   - SanTable holds the legal moves of one position, the canonical SAN
+ *     of each (minimal disambiguation, no check suffix) and a small
+ *     open-addressing hash from SAN string to move index
+ *   - Lookups normalize the token (annotations, "0-0", "e8Q") and hit the
+ *     hash; tokens that are not canonical (over-disambiguated or long
+ *     algebraic like "Ng1f3") fall back to matching piece, destination,
+ *     disambiguator and promotion field by field
+ *   - Ambiguous tokens are rejected rather than guessed
+ *   - san_write() appends the check/mate suffix to the canonical SAN; it is
+ *     the single SAN writer used by fen_to_pgn, pgn_utils and the live PGN
+ *   - Every function works on caller-owned or stack state (the one-shot
+ *     helpers build their SanTable on the stack), so decoding and encoding
+ *     are safe from several threads at once
+ *
+ * Dependencies:
+ *   - chess.h for ChessGame, Move and generate_legal_moves()
+ */
+
+#include "chess.h"
+
+#define SAN_BUFFER_SIZE 12         // Longest SAN ("Qa1xb2=Q#" style) plus terminator, rounded up
+#define SAN_TABLE_SLOTS 512        // Hash slots (power of two, > 2 * MAX_LEGAL_MOVES)
+
+/**
+ * SanTable - Legal moves of one position indexed by their SAN
+ */
+typedef struct {
+    Move moves[MAX_LEGAL_MOVES];               // Legal moves of the position
+    char san[MAX_LEGAL_MOVES][SAN_BUFFER_SIZE]; // Canonical SAN of each move, without +/#
+    int move_count;                            // Number of legal moves
+    int16_t slots[SAN_TABLE_SLOTS];            // Move index per hash slot (-1 if empty)
+} SanTable;
+
+// Table construction and lookup
+void san_table_build(SanTable *table, ChessGame *game);  // Generate legal moves and index their SAN
+int san_table_find(const SanTable *table, const char *token);  // Move index for a SAN token, or -1
+int san_table_index_of(const SanTable *table, Move move);  // Index of a move (from, to, promotion), or -1
+
+// Encoding
+size_t san_write(const ChessGame *game, const SanTable *table, int index, char *out, size_t cap);  // SAN with +/#
+
+// Convenience
+bool san_parse(ChessGame *game, const char *token, Move *move);  // Decode one token in the given position
+size_t san_format_move(ChessGame *game, Move move, char *out, size_t cap);  // Encode one legal move as SAN
+
+#endif // SAN_H
@@ -0,0 +1,569 @@
+/**
+ * screen.c - Buffered, Diff-Based Terminal Renderer
+ *
+ * Purpose:
+ *   Collects a frame of output, works out which character cells changed
+ *   since the last frame and sends only those to the terminal.
+ *
+ * Architecture:
+ *   - Layout understands the output the display functions produce: text
+ *     (UTF-8), newlines, tabs, SGR color escapes (interned into a small
+ *     style table so a cell stores one byte of style) and the clear-screen
+ *     and cursor-movement escapes
+ *   - Two ScreenFrame grids alternate: the one on screen and the one being
+ *     drawn. Cells of the old frame that later output may have overwritten
+ *     (from its final cursor position on) are treated as unknown and
+ *     redrawn
+ *   - Cursor moves are only emitted when the next changed cell is not
+ *     where the cursor already is (short gaps are rewritten instead);
+ *     colors are only emitted on change
+ *
+ * Dependencies:
+ *   - chess.h for the ANSI reset and clear-screen sequences
+ */
+
+#define _GNU_SOURCE        // Required for Linux (va_copy, ioctl, pthread)
+
+#include "screen.h"
+#include "chess.h"
+#include "profile.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#define SCREEN_BRIDGE_CELLS 4           // Unchanged cells rewritten rather than skipped
+
+static ScreenBuffer frame_text = {NULL, 0, 0};   // Output collected for the open frame
+static ScreenBuffer frame_output = {NULL, 0, 0}; // Escapes written for the frame
+static bool frame_open = false;
+static uint64_t frame_profile_start = 0;         // profile_begin() at screen_begin_frame()
+static ScreenFrame frames[2];
+static int shown_frame = -1;                     // Index of the frame on screen (-1 = unknown)
+static ScreenField open_fields[SCREEN_MAX_FIELDS];   // Fields of the frame being collected
+static ScreenBuffer field_output = {NULL, 0, 0}; // Escapes written for a field update
+static pthread_mutex_t screen_lock = PTHREAD_MUTEX_INITIALIZER;  // Guards the shown frame and terminal writes
+
+static char styles[SCREEN_MAX_STYLES][SCREEN_STYLE_LENGTH];
+static int style_count = 1;                      // Style 0 is the default colors
+
+/******************************************************************************
+ *                               OUTPUT BUFFER
+ ******************************************************************************/
+
+static bool buffer_reserve(ScreenBuffer *buffer, size_t extra) {
+    if (buffer->length + extra <= buffer->capacity) return true;
+    size_t capacity = buffer->capacity ? buffer->capacity : 4096;
+    while (capacity < buffer->length + extra) capacity *= 2;
+    char *data = realloc(buffer->data, capacity);
+    if (!data) return false;
+    buffer->data = data;
+    buffer->capacity = capacity;
+    return true;
+}
+
+static void buffer_append(ScreenBuffer *buffer, const char *text, size_t length) {
+    if (!buffer_reserve(buffer, length)) return;
+    memcpy(buffer->data + buffer->length, text, length);
+    buffer->length += length;
+}
+
+static void buffer_append_string(ScreenBuffer *buffer, const char *text) {
+    buffer_append(buffer, text, strlen(text));
+}
+
+/**
+ * Release an output buffer
+ *
+ * @param buffer Buffer to free (reusable afterwards)
+ */
+void screen_buffer_free(ScreenBuffer *buffer) {
+    free(buffer->data);
+    buffer->data = NULL;
+    buffer->length = 0;
+    buffer->capacity = 0;
+}
+
+/******************************************************************************
+ *                                  LAYOUT
+ ******************************************************************************/
+
+/**
+ * Intern the SGR escape sequences active since the last reset
+ *
+ * @return Style index, or -1 if the table is full or the sequence too long
+ */
+static int intern_style(const char *sequence, size_t length) {
+    if (length == 0) return 0;
+    if (length >= SCREEN_STYLE_LENGTH) return -1;
+
+    for (int i = 1; i < style_count; i++) {
+        if (strlen(styles[i]) == length && memcmp(styles[i], sequence, length) == 0) return i;
+    }
+    if (style_count == SCREEN_MAX_STYLES) return -1;
+    memcpy(styles[style_count], sequence, length);
+    styles[style_count][length] = '\0';
+    return style_count++;
+}
+
+static void put_cell(ScreenFrame *frame, int row, int col, const char *text, int length, uint8_t style) {
+    if (row >= SCREEN_MAX_ROWS || col >= SCREEN_MAX_COLS) {
+        frame->overflow = true;
+        return;
+    }
+    ScreenCell *cells = frame->cells[row];
+    while (frame->row_length[row] < col) {
+        ScreenCell *blank = &cells[frame->row_length[row]++];
+        blank->text[0] = ' ';
+        blank->length = 1;
+        blank->style = 0;
+    }
+    memcpy(cells[col].text, text, length);
+    cells[col].length = (uint8_t)length;
+    cells[col].style = style;
+    if (frame->row_length[row] <= col) frame->row_length[row] = col + 1;
+}
+
+/**
+ * Record where fields start and end as layout passes their byte offsets
+ */
+static void place_fields(ScreenFrame *frame, size_t offset, int row, int col, uint8_t style) {
+    for (int f = 0; f < SCREEN_MAX_FIELDS; f++) {
+        ScreenField *field = &frame->fields[f];
+        if (!field->used) continue;
+        if (offset == field->start) {
+            field->row = row;
+            field->col = col;
+            field->style = style;
+        }
+        if (offset == field->end) {
+            field->placed = row == field->row && col >= field->col && row < SCREEN_MAX_ROWS &&
+                            col <= SCREEN_MAX_COLS;
+            field->width = col - field->col;
+        }
+    }
+}
+
+/**
+ * Lay text out into cells as a terminal would display it from the
+ * top-left corner
+ *
+ * @param frame Output: cells, row lengths and final cursor position
+ * @param text Output collected for the frame
+ * @param length Bytes of text
+ */
+void screen_frame_layout(ScreenFrame *frame, const char *text, size_t length) {
+    memset(frame->row_length, 0, sizeof(frame->row_length));
+    frame->overflow = false;
+    int row = 0, col = 0;
+    uint8_t style = 0;
+    char active[SCREEN_STYLE_LENGTH];   // SGR sequences applied since the last reset
+    size_t active_length = 0;
+    ScreenCell *last = NULL;   // Cell receiving UTF-8 continuation bytes
+    for (int f = 0; f < SCREEN_MAX_FIELDS; f++) frame->fields[f].placed = false;
+
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = (unsigned char)text[i];
+        place_fields(frame, i, row, col, style);
+
+        if (c == '\033' && i + 1 < length && text[i + 1] == '[') {
+            size_t end = i + 2;
+            while (end < length && (text[end] < 0x40 || text[end] > 0x7E)) end++;
+            if (end >= length) break;
+
+            int count = atoi(&text[i + 2]);
+            if (count < 1) count = 1;
+            switch (text[end]) {
+                case 'm': {
+                    // "\033[m" and "\033[0m" reset; anything else adds to the active style
+                    size_t sequence_length = end - i + 1;
+                    if (sequence_length == 3 || (sequence_length == 4 && text[i + 2] == '0')) {
+                        active_length = 0;
+                    } else if (active_length + sequence_length < sizeof(active)) {
+                        memcpy(active + active_length, &text[i], sequence_length);
+                        active_length += sequence_length;
+                    } else {
+                        frame->overflow = true;
+                        break;
+                    }
+                    int index = intern_style(active, active_length);
+                    if (index < 0) frame->overflow = true;
+                    else style = (uint8_t)index;
+                    break;
+                }
+                case 'H': row = 0; col = 0; break;
+                case 'A': row = row > count ? row - count : 0; break;
+                case 'B': row += count; break;
+                case 'C': col += count; break;
+                case 'D': col = col > count ? col - count : 0; break;
+                case 'K':
+                    if (row < SCREEN_MAX_ROWS && frame->row_length[row] > col) frame->row_length[row] = col;
+                    break;
+                case 'J':
+                    // 2J erases everything, J / 0J everything after the cursor
+                    for (int r = text[i + 2] == '2' ? 0 : row + 1; r < SCREEN_MAX_ROWS; r++) frame->row_length[r] = 0;
+                    if (row < SCREEN_MAX_ROWS && frame->row_length[row] > col) frame->row_length[row] = col;
+                    break;
+                default:
+                    break;
+            }
+            i = end;
+            last = NULL;
+        } else if (c == '\n') {
+            row++;
+            col = 0;
+            last = NULL;
+        } else if (c == '\r') {
+            col = 0;
+            last = NULL;
+        } else if ((c & 0xC0) == 0x80) {
+            if (last && last->length < sizeof(last->text)) last->text[last->length++] = (char)c;
+        } else if (c == '\t') {
+            int stop = (col / 8 + 1) * 8;
+            while (col < stop) put_cell(frame, row, col++, " ", 1, style);
+            last = NULL;
+        } else if (c >= 0x20 && c != 0x7F) {
+            char byte = (char)c;
+            put_cell(frame, row, col, &byte, 1, style);
+            last = frame->overflow ? NULL : &frame->cells[row][col];
+            col++;
+        }
+    }
+
+    place_fields(frame, length, row, col, style);
+
+    if (row >= SCREEN_MAX_ROWS) {
+        frame->overflow = true;
+        row = SCREEN_MAX_ROWS - 1;
+    }
+    frame->cursor_row = row;
+    frame->cursor_col = col;
+    frame->rows = row + 1;
+    frame->widest = col;
+    for (int r = 0; r < SCREEN_MAX_ROWS; r++) {
+        if (frame->row_length[r] > 0 && r + 1 > frame->rows) frame->rows = r + 1;
+        if (frame->row_length[r] > frame->widest) frame->widest = frame->row_length[r];
+    }
+}
+
+/******************************************************************************
+ *                                   DIFF
+ ******************************************************************************/
+
+/**
+ * DiffCursor - What the terminal is known to show while escapes are emitted
+ */
+typedef struct {
+    ScreenBuffer *out;
+    int row, col;            // Terminal cursor (-1 = unknown)
+    int style;               // Active style (-1 = unknown)
+} DiffCursor;
+
+static void move_cursor(DiffCursor *term, int row, int col) {
+    if (term->row == row && term->col == col) return;
+    char escape[32];
+    snprintf(escape, sizeof(escape), "\033[%d;%dH", row + 1, col + 1);
+    buffer_append_string(term->out, escape);
+    term->row = row;
+    term->col = col;
+}
+
+static void set_style(DiffCursor *term, int style) {
+    if (term->style == style) return;
+    buffer_append_string(term->out, SCREEN_RESET);
+    if (style != 0) buffer_append_string(term->out, styles[style]);
+    term->style = style;
+}
+
+/**
+ * Rewrite a short run of unchanged cells instead of jumping over it when
+ * that is shorter than a cursor-addressing escape and needs no color change
+ */
+static void bridge_gap(DiffCursor *term, const ScreenFrame *next, int row, int col) {
+    if (term->row != row || term->col >= col || col - term->col > SCREEN_BRIDGE_CELLS) return;
+    if (col > next->row_length[row]) return;
+    for (int c = term->col; c < col; c++) {
+        if (next->cells[row][c].style != term->style) return;
+    }
+    for (int c = term->col; c < col; c++) {
+        buffer_append(term->out, next->cells[row][c].text, next->cells[row][c].length);
+    }
+    term->col = col;
+}
+
+static bool same_cell(const ScreenCell *a, const ScreenCell *b) {
+    return a->style == b->style && a->length == b->length && memcmp(a->text, b->text, a->length) == 0;
+}
+
+/**
+ * Produce the escapes that turn the screen showing previous into next
+ *
+ * @param previous Frame currently on screen, or NULL if unknown (full paint)
+ * @param next Frame to show
+ * @param out Escapes are appended here
+ */
+void screen_frame_diff(const ScreenFrame *previous, const ScreenFrame *next, ScreenBuffer *out) {
+    static const ScreenCell blank = {" ", 1, 0};
+    DiffCursor term = {out, -1, -1, -1};
+
+    for (int row = 0; row < next->rows; row++) {
+        // Cells of the old frame from its final cursor on may have been overwritten
+        int known_cols = 0, previous_length = 0;
+        if (previous) {
+            known_cols = row < previous->cursor_row ? SCREEN_MAX_COLS :
+                         row == previous->cursor_row ? previous->cursor_col : 0;
+            if (row < previous->rows) previous_length = previous->row_length[row];
+        }
+
+        int length = next->row_length[row];
+        for (int col = 0; col < length; col++) {
+            const ScreenCell *cell = &next->cells[row][col];
+            if (col < known_cols) {
+                const ScreenCell *old = col < previous_length ? &previous->cells[row][col] : &blank;
+                if (same_cell(cell, old)) continue;
+            }
+            bridge_gap(&term, next, row, col);
+            move_cursor(&term, row, col);
+            set_style(&term, cell->style);
+            buffer_append(out, cell->text, cell->length);
+            term.col++;
+        }
+
+        bool stale_tail = known_cols < SCREEN_MAX_COLS || previous_length > length;
+        if (stale_tail) {
+            move_cursor(&term, row, length);
+            set_style(&term, 0);
+            buffer_append_string(out, "\033[K");
+        }
+    }
+
+    // Erase anything printed below the old frame, then park the cursor
+    int last = next->rows - 1;
+    move_cursor(&term, last, next->row_length[last]);
+    set_style(&term, 0);
+    buffer_append_string(out, "\033[J");
+    move_cursor(&term, next->cursor_row, next->cursor_col);
+}
+
+/**
+ * Replace a field's text in a laid-out frame and produce the escapes that
+ * redraw it: the field and the rest of its row, with the cursor and colors
+ * saved and restored around them so a prompt being typed is undisturbed
+ *
+ * @param frame Frame holding the field (updated to match the screen)
+ * @param field Field index
+ * @param text New contents (single-byte characters, no escapes)
+ * @param out Escapes are appended here (nothing if the text is unchanged)
+ * @return false if the field was not laid out or the row would overflow
+ */
+bool screen_frame_update_field(ScreenFrame *frame, int field, const char *text, ScreenBuffer *out) {
+    if (field < 0 || field >= SCREEN_MAX_FIELDS || !frame->fields[field].placed) return false;
+    ScreenField *target = &frame->fields[field];
+    ScreenCell *cells = frame->cells[target->row];
+    int width = (int)strlen(text);
+    int row_length = frame->row_length[target->row];
+    int old_width = target->width;
+    if (target->col + old_width > row_length) old_width = row_length > target->col ? row_length - target->col : 0;
+
+    bool unchanged = width == old_width;
+    for (int i = 0; unchanged && i < width; i++) {
+        unchanged = cells[target->col + i].length == 1 && cells[target->col + i].text[0] == text[i] &&
+                    cells[target->col + i].style == target->style;
+    }
+    if (unchanged) return true;
+
+    int shift = width - old_width;
+    if (row_length < target->col) {
+        if (target->col + width > SCREEN_MAX_COLS) return false;
+        while (row_length < target->col) {
+            cells[row_length].text[0] = ' ';
+            cells[row_length].length = 1;
+            cells[row_length++].style = 0;
+        }
+    }
+    int new_length = row_length + shift;
+    if (new_length > SCREEN_MAX_COLS) return false;
+
+    // Move the rest of the row, then write the new text
+    if (row_length > target->col + old_width) {
+        memmove(&cells[target->col + width], &cells[target->col + old_width],
+                (size_t)(row_length - target->col - old_width) * sizeof(ScreenCell));
+    }
+    for (int i = 0; i < width; i++) {
+        cells[target->col + i].text[0] = text[i];
+        cells[target->col + i].length = 1;
+        cells[target->col + i].style = target->style;
+    }
+    frame->row_length[target->row] = new_length;
+    if (new_length > frame->widest) frame->widest = new_length;
+    target->width = width;
+    for (int f = 0; f < SCREEN_MAX_FIELDS; f++) {
+        ScreenField *other = &frame->fields[f];
+        if (f != field && other->placed && other->row == target->row && other->col > target->col) other->col += shift;
+    }
+    if (frame->cursor_row == target->row && frame->cursor_col > target->col) frame->cursor_col += shift;
+
+    DiffCursor term = {out, -1, -1, -1};
+    buffer_append_string(out, "7");
+    move_cursor(&term, target->row, target->col);
+    for (int col = target->col; col < new_length; col++) {
+        set_style(&term, cells[col].style);
+        buffer_append(out, cells[col].text, cells[col].length);
+    }
+    set_style(&term, 0);
+    buffer_append_string(out, "[K8");
+    return true;
+}
+
+/******************************************************************************
+ *                                  FRAMES
+ ******************************************************************************/
+
+/**
+ * Start collecting a frame; it is drawn from the top-left corner of the
+ * screen by screen_end_frame()
+ */
+void screen_begin_frame(void) {
+    frame_profile_start = profile_begin();
+    frame_open = true;
+    frame_text.length = 0;
+    memset(open_fields, 0, sizeof(open_fields));
+}
+
+/**
+ * Mark the start of a field in the open frame
+ *
+ * @param field Field index (0 to SCREEN_MAX_FIELDS - 1)
+ */
+void screen_field_begin(int field) {
+    if (!frame_open || field < 0 || field >= SCREEN_MAX_FIELDS) return;
+    open_fields[field].used = true;
+    open_fields[field].start = frame_text.length;
+    open_fields[field].end = frame_text.length;
+}
+
+/**
+ * Mark the end of a field in the open frame
+ *
+ * @param field Field index passed to screen_field_begin()
+ */
+void screen_field_end(int field) {
+    if (!frame_open || field < 0 || field >= SCREEN_MAX_FIELDS || !open_fields[field].used) return;
+    open_fields[field].end = frame_text.length;
+}
+
+/**
+ * printf into the open frame, or straight to stdout when no frame is open
+ *
+ * @param format printf format
+ * @return Characters produced
+ */
+int screen_printf(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+
+    if (!frame_open) {
+        int written = vprintf(format, args);
+        va_end(args);
+        return written;
+    }
+
+    va_list retry;
+    va_copy(retry, args);
+    int needed = -1;
+    if (buffer_reserve(&frame_text, 256)) {
+        size_t room = frame_text.capacity - frame_text.length;
+        needed = vsnprintf(frame_text.data + frame_text.length, room, format, args);
+        if (needed >= 0 && (size_t)needed >= room) {
+            if (buffer_reserve(&frame_text, (size_t)needed + 1)) {
+                vsnprintf(frame_text.data + frame_text.length, (size_t)needed + 1, format, retry);
+            } else {
+                needed = -1;
+            }
+        }
+        if (needed > 0) frame_text.length += (size_t)needed;
+    }
+    va_end(retry);
+    va_end(args);
+    return needed;
+}
+
+static void write_all(const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(STDOUT_FILENO, data, length);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        data += written;
+        length -= (size_t)written;
+    }
+}
+
+/**
+ * Draw the open frame: only the changed cells when the previous frame is
+ * known to be on screen, otherwise a full repaint; one write() either way
+ */
+void screen_end_frame(void) {
+    if (!frame_open) return;
+    frame_open = false;
+    fflush(stdout);   // Anything printed before the frame goes first
+
+    pthread_mutex_lock(&screen_lock);
+    int index = shown_frame == 0 ? 1 : 0;
+    ScreenFrame *next = &frames[index];
+    memcpy(next->fields, open_fields, sizeof(open_fields));
+    screen_frame_layout(next, frame_text.data ? frame_text.data : "", frame_text.length);
+
+    // Cursor addressing only works if the frame fits the window unwrapped
+    // and leaves room for the prompts printed after it without scrolling
+    struct winsize window;
+    bool diff = isatty(STDOUT_FILENO) && ioctl(STDOUT_FILENO, TIOCGWINSZ, &window) == 0 &&
+                !next->overflow && next->rows + SCREEN_DIFF_MARGIN <= window.ws_row &&
+                next->widest < window.ws_col;
+
+    frame_output.length = 0;
+    if (diff) {
+        screen_frame_diff(shown_frame >= 0 ? &frames[shown_frame] : NULL, next, &frame_output);
+        shown_frame = index;
+    } else {
+        buffer_append_string(&frame_output, CLEAR_SCREEN);
+        buffer_append(&frame_output, frame_text.data, frame_text.length);
+        shown_frame = -1;
+    }
+    write_all(frame_output.data, frame_output.length);
+    pthread_mutex_unlock(&screen_lock);
+    profile_end(PROFILE_RENDER, frame_profile_start);
+}
+
+/**
+ * Forget what is on screen; the next frame is painted in full
+ * (call after clearing the screen or printing output that may scroll)
+ */
+void screen_invalidate(void) {
+    pthread_mutex_lock(&screen_lock);
+    shown_frame = -1;
+    pthread_mutex_unlock(&screen_lock);
+}
+
+/**
+ * Rewrite a field of the frame on screen; safe to call from another thread
+ * while the main thread waits for input
+ *
+ * @param field Field index
+ * @param text New contents (single-byte characters, no escapes)
+ * @return false if no diffable frame with that field is on screen
+ */
+bool screen_update_field(int field, const char *text) {
+    pthread_mutex_lock(&screen_lock);
+    bool updated = false;
+    if (shown_frame >= 0) {
+        field_output.length = 0;
+        updated = screen_frame_update_field(&frames[shown_frame], field, text, &field_output);
+        if (updated && field_output.length > 0) write_all(field_output.data, field_output.length);
+    }
+    pthread_mutex_unlock(&screen_lock);
+    return updated;
+}
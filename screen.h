@@ -0,0 +1,112 @@
+#ifndef SCREEN_H
+#define SCREEN_H
+
+/**
+ * screen.h - Buffered, Diff-Based Terminal Renderer
+ *
+ * Purpose:
+ *   Draws full-screen views (the game screen, the possible moves view,
+ *   the game browser) without repainting the whole terminal on every
+ *   action. Over slow links (SSH) a full repaint is visibly slow and
+ *   arrow-key browsing flickers.
+ *
+ * Architecture:
+ *   - Between screen_begin_frame() and screen_end_frame(), screen_printf()
+ *     collects output in one buffer instead of writing it
+ *   - screen_end_frame() lays the text out into a grid of cells (character
+ *     plus ANSI color style), compares it with the frame drawn last time
+ *     and emits only the changed cells using cursor-addressing escapes,
+ *     then clears whatever was printed below the old frame. The whole
+ *     update goes out in a single write()
+ *   - The frame is anchored at the top-left corner of the screen. Anything
+ *     that may have moved or erased it (clear_screen(), long output that
+ *     scrolls) must call screen_invalidate(); the next frame is then
+ *     painted in full
+ *   - When stdout is not a terminal, or the frame does not fit the window,
+ *     the frame is written as before: clear screen plus the plain text
+ *   - Text printed between screen_field_begin() and screen_field_end() is
+ *     a field: screen_update_field() can later rewrite it on the frame
+ *     shown, from any thread, without redrawing the frame (the live game
+ *     clock). The rest of the field's row moves if the width changes
+ *   - Outside a frame, screen_printf() is plain printf(), so the display
+ *     functions still work in tools and tests
+ *
+ * Dependencies:
+ *   - POSIX write(), ioctl(TIOCGWINSZ) and pthread mutexes
+ *   - profile.h (a frame is timed as PROFILE_RENDER)
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SCREEN_MAX_ROWS 64              // Tallest frame laid out as cells
+#define SCREEN_MAX_COLS 160             // Widest frame line laid out as cells
+#define SCREEN_MAX_STYLES 32            // Distinct color escapes remembered
+#define SCREEN_STYLE_LENGTH 32          // Longest combination of color escapes
+#define SCREEN_DIFF_MARGIN 12           // Window rows kept free below a frame for prompts
+#define SCREEN_MAX_FIELDS 4             // Fields per frame (screen_field_begin())
+
+/**
+ * ScreenCell - One character position: UTF-8 text and color style
+ */
+typedef struct {
+    char text[4];            // UTF-8 bytes of the character
+    uint8_t length;          // Bytes used in text
+    uint8_t style;           // Index into the style table (0 = default colors)
+} ScreenCell;
+
+/**
+ * ScreenField - Updatable run of text in a frame
+ * start/end are byte offsets into the frame text, set while collecting;
+ * layout fills in where the text landed.
+ */
+typedef struct {
+    size_t start, end;       // Byte range in the frame text
+    bool used;               // Field printed in this frame
+    bool placed;             // Laid out on a single row (updatable)
+    int row, col, width;     // Cells the field occupies
+    uint8_t style;           // Style at the start of the field
+} ScreenField;
+
+/**
+ * ScreenFrame - Laid-out contents of one frame
+ */
+typedef struct {
+    ScreenCell cells[SCREEN_MAX_ROWS][SCREEN_MAX_COLS];
+    int row_length[SCREEN_MAX_ROWS]; // Cells used per row; the rest are blank
+    int rows;                // Rows used (cursor row included)
+    int cursor_row;          // Where the cursor is left after the frame
+    int cursor_col;
+    int widest;              // Longest row
+    bool overflow;           // Too large or too many styles to lay out
+    ScreenField fields[SCREEN_MAX_FIELDS];
+} ScreenFrame;
+
+/**
+ * ScreenBuffer - Growable output buffer
+ */
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+} ScreenBuffer;
+
+// Frames
+void screen_begin_frame(void);  // Start collecting a frame drawn from the top of the screen
+int screen_printf(const char *format, ...);  // printf into the open frame (stdout if none)
+void screen_end_frame(void);  // Draw the frame's changes with one write()
+void screen_invalidate(void);  // Screen contents unknown: paint the next frame in full
+
+// Fields
+void screen_field_begin(int field);  // Text printed from here on is the field (0 to SCREEN_MAX_FIELDS - 1)
+void screen_field_end(int field);  // End of the field's text
+bool screen_update_field(int field, const char *text);  // Rewrite a field on the shown frame (thread-safe)
+
+// Layout and diff (used by screen_end_frame(), exposed for tests)
+void screen_frame_layout(ScreenFrame *frame, const char *text, size_t length);  // Place text into cells
+void screen_frame_diff(const ScreenFrame *previous, const ScreenFrame *next, ScreenBuffer *out);  // Escapes that turn previous into next (NULL = full paint)
+bool screen_frame_update_field(ScreenFrame *frame, int field, const char *text, ScreenBuffer *out);  // Replace a field's text and append the escapes
+void screen_buffer_free(ScreenBuffer *buffer);  // Release an output buffer
+
+#endif // SCREEN_H
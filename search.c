@@ -0,0 +1,587 @@
+/**
+ * search.c - Built-in Alpha-Beta Search Engine
+ *
+ * Purpose:
+ *   Finds moves and evaluations without an external engine.
+ *
+ * Architecture:
+ *   - Each node copies the ChessGame and plays the move with
+ *     execute_move(), so the search shares every rule with the game itself
+ *   - SearchContext holds the per-thread state (node count, killers, the
+ *     hashes of the current line for repetition checks, its own copy of
+ *     the root position)
+ *   - Lazy SMP: helper threads run the same iterative deepening loop on
+ *     the same root, starting at staggered depths, and meet only through
+ *     the shared transposition table. Every thread publishes each
+ *     completed iteration to SearchShared; the deepest one is the result.
+ *     The main thread watches the clock (and SearchLimits.stop) and
+ *     raises the shared stop flag
+ *   - The transposition table (tt.h) comes from SearchLimits.table and
+ *     is kept between searches by its owner (a built-in engine); without
+ *     one the search allocates a TT_DEFAULT_MB table for itself. Engines
+ *     searching at the same time never share a table
+ *
+ * Dependencies:
+ *   - chess.h: generate_legal_moves(), execute_move(), position_hash()
+ *   - game_record.h: cgr_pack_move() for table moves
+ *   - tt.h: transposition table
+ */
+
+#define _GNU_SOURCE        // Required for Linux (clock_gettime, sysconf)
+
+#include "search.h"
+#include "game_record.h"
+#include "tt.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SEARCH_CHECK_INTERVAL 1023      // Nodes between clock checks (mask)
+
+// Move ordering priorities
+#define ORDER_TT_MOVE 1000000
+#define ORDER_CAPTURE 100000
+#define ORDER_PROMOTION 90000
+#define ORDER_KILLER_1 80000
+#define ORDER_KILLER_2 70000
+#define ORDER_LOSING_CAPTURE -100000    // Below quiet moves (0), plus the SEE loss
+
+/**
+ * SearchShared - State shared by all threads of one search
+ */
+typedef struct {
+    pthread_mutex_t lock;               // Guards best
+    SearchResult best;                  // Deepest completed iteration of any thread
+    bool stop;                          // Raised by the main thread (atomic access)
+    struct timespec start;
+    int time_ms;                        // 0 = no deadline
+    int max_depth;
+    const bool *external_stop;          // SearchLimits.stop (NULL = none)
+    TranspositionTable *table;          // Table of this search
+} SearchShared;
+
+/**
+ * SearchContext - State of one search thread
+ */
+typedef struct {
+    SearchShared *shared;
+    ChessGame root;                     // Private copy (move generation writes to it)
+    int first_depth;                    // Staggered start of the iteration loop
+    bool is_main;                       // Checks the clock and raises the stop flag
+    bool must_finish;                   // Main thread's first iteration: ignore the stop flag
+    uint64_t nodes;
+    bool stopped;                       // Stop seen; unwind without storing
+    Move killers[SEARCH_MAX_PLY][2];    // Quiet moves that caused cutoffs at each ply
+    uint64_t line[SEARCH_MAX_PLY + 1];  // Position hashes along the current line
+    Move root_best;                     // Best root move of the running iteration
+    bool root_has_best;
+} SearchContext;
+
+/******************************************************************************
+ *                                EVALUATION
+ ******************************************************************************/
+
+// Material by PieceType (EMPTY, PAWN, ROOK, KNIGHT, BISHOP, QUEEN, KING)
+static const int MATERIAL_MG[7] = {0, 82, 477, 337, 365, 1025, 0};
+static const int MATERIAL_EG[7] = {0, 94, 512, 281, 297, 936, 0};
+static const int PHASE_WEIGHT[7] = {0, 0, 2, 1, 1, 4, 0};
+#define PHASE_TOTAL 24
+
+// Piece-square tables from White's view, rank 8 first (same layout as board[][])
+static const int PST_PAWN_MG[64] = {
+     0,   0,   0,   0,   0,   0,   0,   0,
+    50,  50,  50,  50,  50,  50,  50,  50,
+    10,  10,  20,  30,  30,  20,  10,  10,
+     5,   5,  10,  25,  25,  10,   5,   5,
+     0,   0,   0,  20,  20,   0,   0,   0,
+     5,  -5, -10,   0,   0, -10,  -5,   5,
+     5,  10,  10, -20, -20,  10,  10,   5,
+     0,   0,   0,   0,   0,   0,   0,   0
+};
+static const int PST_PAWN_EG[64] = {
+     0,   0,   0,   0,   0,   0,   0,   0,
+    80,  80,  80,  80,  80,  80,  80,  80,
+    50,  50,  50,  50,  50,  50,  50,  50,
+    30,  30,  30,  30,  30,  30,  30,  30,
+    20,  20,  20,  20,  20,  20,  20,  20,
+    10,  10,  10,  10,  10,  10,  10,  10,
+     0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0
+};
+static const int PST_KNIGHT[64] = {
+   -50, -40, -30, -30, -30, -30, -40, -50,
+   -40, -20,   0,   0,   0,   0, -20, -40,
+   -30,   0,  10,  15,  15,  10,   0, -30,
+   -30,   5,  15,  20,  20,  15,   5, -30,
+   -30,   0,  15,  20,  20,  15,   0, -30,
+   -30,   5,  10,  15,  15,  10,   5, -30,
+   -40, -20,   0,   5,   5,   0, -20, -40,
+   -50, -40, -30, -30, -30, -30, -40, -50
+};
+static const int PST_BISHOP[64] = {
+   -20, -10, -10, -10, -10, -10, -10, -20,
+   -10,   0,   0,   0,   0,   0,   0, -10,
+   -10,   0,   5,  10,  10,   5,   0, -10,
+   -10,   5,   5,  10,  10,   5,   5, -10,
+   -10,   0,  10,  10,  10,  10,   0, -10,
+   -10,  10,  10,  10,  10,  10,  10, -10,
+   -10,   5,   0,   0,   0,   0,   5, -10,
+   -20, -10, -10, -10, -10, -10, -10, -20
+};
+static const int PST_ROOK[64] = {
+     0,   0,   0,   0,   0,   0,   0,   0,
+     5,  10,  10,  10,  10,  10,  10,   5,
+    -5,   0,   0,   0,   0,   0,   0,  -5,
+    -5,   0,   0,   0,   0,   0,   0,  -5,
+    -5,   0,   0,   0,   0,   0,   0,  -5,
+    -5,   0,   0,   0,   0,   0,   0,  -5,
+    -5,   0,   0,   0,   0,   0,   0,  -5,
+     0,   0,   0,   5,   5,   0,   0,   0
+};
+static const int PST_QUEEN[64] = {
+   -20, -10, -10,  -5,  -5, -10, -10, -20,
+   -10,   0,   0,   0,   0,   0,   0, -10,
+   -10,   0,   5,   5,   5,   5,   0, -10,
+    -5,   0,   5,   5,   5,   5,   0,  -5,
+     0,   0,   5,   5,   5,   5,   0,  -5,
+   -10,   5,   5,   5,   5,   5,   0, -10,
+   -10,   0,   5,   0,   0,   0,   0, -10,
+   -20, -10, -10,  -5,  -5, -10, -10, -20
+};
+static const int PST_KING_MG[64] = {
+   -30, -40, -40, -50, -50, -40, -40, -30,
+   -30, -40, -40, -50, -50, -40, -40, -30,
+   -30, -40, -40, -50, -50, -40, -40, -30,
+   -30, -40, -40, -50, -50, -40, -40, -30,
+   -20, -30, -30, -40, -40, -30, -30, -20,
+   -10, -20, -20, -20, -20, -20, -20, -10,
+    20,  20,   0,   0,   0,   0,  20,  20,
+    20,  30,  10,   0,   0,  10,  30,  20
+};
+static const int PST_KING_EG[64] = {
+   -50, -40, -30, -20, -20, -30, -40, -50,
+   -30, -20, -10,   0,   0, -10, -20, -30,
+   -30, -10,  20,  30,  30,  20, -10, -30,
+   -30, -10,  30,  40,  40,  30, -10, -30,
+   -30, -10,  30,  40,  40,  30, -10, -30,
+   -30, -10,  20,  30,  30,  20, -10, -30,
+   -30, -30,   0,   0,   0,   0, -30, -30,
+   -50, -30, -30, -30, -30, -30, -30, -50
+};
+
+// Middlegame and endgame tables by PieceType
+static const int *const PST_MG[7] = {NULL, PST_PAWN_MG, PST_ROOK, PST_KNIGHT, PST_BISHOP, PST_QUEEN, PST_KING_MG};
+static const int *const PST_EG[7] = {NULL, PST_PAWN_EG, PST_ROOK, PST_KNIGHT, PST_BISHOP, PST_QUEEN, PST_KING_EG};
+
+/**
+ * Static evaluation: material and piece-square values, blended from the
+ * middlegame to the endgame tables as non-pawn material comes off
+ *
+ * @param game Position to evaluate
+ * @return Centipawns from the side to move's view
+ */
+int evaluate_position(const ChessGame *game) {
+    int mg[2] = {0, 0};
+    int eg[2] = {0, 0};
+    int phase = 0;
+
+    for (int row = 0; row < BOARD_SIZE; row++) {
+        for (int col = 0; col < BOARD_SIZE; col++) {
+            Piece piece = game->board[row][col];
+            if (piece.type == EMPTY) continue;
+
+            // Black reads the tables mirrored vertically
+            int square = piece.color == WHITE ? row * 8 + col : (7 - row) * 8 + col;
+            mg[piece.color] += MATERIAL_MG[piece.type] + PST_MG[piece.type][square];
+            eg[piece.color] += MATERIAL_EG[piece.type] + PST_EG[piece.type][square];
+            phase += PHASE_WEIGHT[piece.type];
+        }
+    }
+
+    if (phase > PHASE_TOTAL) phase = PHASE_TOTAL;
+    int score = ((mg[WHITE] - mg[BLACK]) * phase + (eg[WHITE] - eg[BLACK]) * (PHASE_TOTAL - phase)) / PHASE_TOTAL;
+    return game->current_player == WHITE ? score : -score;
+}
+
+/******************************************************************************
+ *                            TRANSPOSITION TABLE
+ ******************************************************************************/
+
+// Mate scores are stored relative to the node so they stay valid at any ply
+static int tt_score_to_table(int score, int ply) {
+    if (score > SEARCH_MATE_BOUND) return score + ply;
+    if (score < -SEARCH_MATE_BOUND) return score - ply;
+    return score;
+}
+
+static int tt_score_from_table(int score, int ply) {
+    if (score > SEARCH_MATE_BOUND) return score - ply;
+    if (score < -SEARCH_MATE_BOUND) return score + ply;
+    return score;
+}
+
+
+/******************************************************************************
+ *                              MOVE ORDERING
+ ******************************************************************************/
+
+static bool same_move(const Move *a, const Move *b) {
+    return a->from.row == b->from.row && a->from.col == b->from.col &&
+           a->to.row == b->to.row && a->to.col == b->to.col &&
+           a->promotion_piece == b->promotion_piece;
+}
+
+/**
+ * Static exchange value of a capture, skipping the exchange when the
+ * victim is worth at least the attacker (such a capture cannot lose)
+ */
+static int capture_exchange(const ChessGame *game, const Move *move) {
+    PieceType attacker = game->board[move->from.row][move->from.col].type;
+    if (MATERIAL_MG[move->captured.type] >= MATERIAL_MG[attacker]) return 0;
+    return static_exchange_eval(game, *move);
+}
+
+/**
+ * Give every move an ordering score: table move, winning and even captures
+ * by MVV-LVA, queen promotions, killers, quiet moves, then captures that
+ * lose material by static exchange evaluation
+ */
+static void score_moves(const ChessGame *game, const Move moves[], int scores[], int count,
+                        uint16_t tt_move, const Move killers[2]) {
+    for (int i = 0; i < count; i++) {
+        const Move *move = &moves[i];
+        int score = 0;
+
+        if (tt_move != 0 && cgr_pack_move(*move) == tt_move) {
+            score = ORDER_TT_MOVE;
+        } else if (move->is_capture) {
+            PieceType attacker = game->board[move->from.row][move->from.col].type;
+            int exchange = capture_exchange(game, move);
+            score = exchange < 0 ? ORDER_LOSING_CAPTURE + exchange
+                                 : ORDER_CAPTURE + MATERIAL_MG[move->captured.type] * 10 - MATERIAL_MG[attacker] / 10;
+        } else if (move->is_promotion && move->promotion_piece == QUEEN) {
+            score = ORDER_PROMOTION;
+        } else if (killers && same_move(move, &killers[0])) {
+            score = ORDER_KILLER_1;
+        } else if (killers && same_move(move, &killers[1])) {
+            score = ORDER_KILLER_2;
+        }
+        scores[i] = score;
+    }
+}
+
+/**
+ * Move the best remaining move to position index (selection sort step)
+ */
+static void pick_move(Move moves[], int scores[], int count, int index) {
+    int best = index;
+    for (int i = index + 1; i < count; i++) {
+        if (scores[i] > scores[best]) best = i;
+    }
+    if (best != index) {
+        Move move = moves[index];
+        moves[index] = moves[best];
+        moves[best] = move;
+        int score = scores[index];
+        scores[index] = scores[best];
+        scores[best] = score;
+    }
+}
+
+/******************************************************************************
+ *                                  SEARCH
+ ******************************************************************************/
+
+static int elapsed_ms(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int)((now.tv_sec - start->tv_sec) * 1000 + (now.tv_nsec - start->tv_nsec) / 1000000);
+}
+
+/**
+ * Count a node; every SEARCH_CHECK_INTERVAL nodes look at the shared stop
+ * flag (the main thread also checks the deadline and raises it)
+ */
+static bool out_of_time(SearchContext *ctx) {
+    ctx->nodes++;
+    if (ctx->must_finish) return false;
+    if ((ctx->nodes & SEARCH_CHECK_INTERVAL) == 0) {
+        SearchShared *shared = ctx->shared;
+        if (ctx->is_main && ((shared->time_ms > 0 && elapsed_ms(&shared->start) >= shared->time_ms) ||
+                             (shared->external_stop && __atomic_load_n(shared->external_stop, __ATOMIC_RELAXED)))) {
+            __atomic_store_n(&shared->stop, true, __ATOMIC_RELAXED);
+        }
+        if (__atomic_load_n(&shared->stop, __ATOMIC_RELAXED)) ctx->stopped = true;
+    }
+    return ctx->stopped;
+}
+
+/**
+ * Check whether the position at ply repeats an earlier one on the line
+ * (only positions since the last capture or pawn move can repeat)
+ */
+static bool is_repetition(const SearchContext *ctx, const ChessGame *game, int ply) {
+    for (int back = 4; back <= ply && back <= game->halfmove_clock; back += 2) {
+        if (ctx->line[ply - back] == ctx->line[ply]) return true;
+    }
+    return false;
+}
+
+/**
+ * Quiescence search: captures and promotions until the position is quiet
+ * (all evasions when in check)
+ */
+static int quiescence(SearchContext *ctx, ChessGame *game, int alpha, int beta, int ply) {
+    if (out_of_time(ctx)) return 0;
+
+    bool in_check = game->in_check[game->current_player];
+    if (ply >= SEARCH_MAX_PLY - 1) return evaluate_position(game);
+
+    int best = -SEARCH_INFINITE;
+    if (!in_check) {
+        best = evaluate_position(game);
+        if (best >= beta) return best;
+        if (best > alpha) alpha = best;
+    }
+
+    Move moves[MAX_LEGAL_MOVES];
+    int scores[MAX_LEGAL_MOVES];
+    int count = generate_legal_moves(game, moves);
+    if (count == 0) return in_check ? -SEARCH_MATE_SCORE + ply : 0;
+
+    // Outside check only tactical moves are searched, and captures that
+    // lose material by static exchange evaluation are pruned
+    if (!in_check) {
+        int tactical = 0;
+        for (int i = 0; i < count; i++) {
+            if (moves[i].is_capture ? capture_exchange(game, &moves[i]) >= 0
+                                    : (moves[i].is_promotion && moves[i].promotion_piece == QUEEN)) {
+                moves[tactical++] = moves[i];
+            }
+        }
+        count = tactical;
+    }
+    score_moves(game, moves, scores, count, 0, NULL);
+
+    for (int i = 0; i < count; i++) {
+        pick_move(moves, scores, count, i);
+        ChessGame child = *game;
+        if (!execute_move(&child, moves[i])) continue;
+
+        int score = -quiescence(ctx, &child, -beta, -alpha, ply + 1);
+        if (ctx->stopped) return 0;
+
+        if (score > best) best = score;
+        if (score > alpha) alpha = score;
+        if (alpha >= beta) break;
+    }
+    return best;
+}
+
+/**
+ * Negamax alpha-beta search
+ *
+ * @return Score from the side to move's view (0 if the search was stopped)
+ */
+static int search_node(SearchContext *ctx, ChessGame *game, int depth, int alpha, int beta, int ply) {
+    uint64_t key = position_hash(game);
+    ctx->line[ply] = key;
+
+    if (ply > 0 && (game->halfmove_clock >= 100 || is_repetition(ctx, game, ply))) return 0;
+
+    bool in_check = game->in_check[game->current_player];
+    if (in_check && ply < SEARCH_MAX_PLY / 2) depth++;   // Check extension
+    if (depth <= 0 || ply >= SEARCH_MAX_PLY - 1) return quiescence(ctx, game, alpha, beta, ply);
+    if (out_of_time(ctx)) return 0;
+
+    // Transposition table: move for ordering, score for a cutoff
+    TTData entry;
+    uint16_t tt_move = 0;
+    if (tt_probe(ctx->shared->table, key, &entry)) {
+        tt_move = entry.move;
+        if (ply > 0 && entry.depth >= depth) {
+            int score = tt_score_from_table(entry.score, ply);
+            if (entry.bound == TT_BOUND_EXACT ||
+                (entry.bound == TT_BOUND_LOWER && score >= beta) ||
+                (entry.bound == TT_BOUND_UPPER && score <= alpha)) {
+                return score;
+            }
+        }
+    }
+
+    Move moves[MAX_LEGAL_MOVES];
+    int scores[MAX_LEGAL_MOVES];
+    int count = generate_legal_moves(game, moves);
+    if (count == 0) return in_check ? -SEARCH_MATE_SCORE + ply : 0;
+    score_moves(game, moves, scores, count, tt_move, ctx->killers[ply]);
+
+    int original_alpha = alpha;
+    int best = -SEARCH_INFINITE;
+    int best_index = -1;
+
+    for (int i = 0; i < count; i++) {
+        pick_move(moves, scores, count, i);
+        ChessGame child = *game;
+        if (!execute_move(&child, moves[i])) continue;
+
+        int score = -search_node(ctx, &child, depth - 1, -beta, -alpha, ply + 1);
+        if (ctx->stopped) return 0;
+
+        if (score > best) {
+            best = score;
+            best_index = i;
+        }
+        if (score > alpha) {
+            alpha = score;
+            if (ply == 0) {
+                ctx->root_best = moves[i];
+                ctx->root_has_best = true;
+            }
+        }
+        if (alpha >= beta) {
+            if (!moves[i].is_capture && !same_move(&moves[i], &ctx->killers[ply][0])) {
+                ctx->killers[ply][1] = ctx->killers[ply][0];
+                ctx->killers[ply][0] = moves[i];
+            }
+            break;
+        }
+    }
+
+    int bound = best >= beta ? TT_BOUND_LOWER : best > original_alpha ? TT_BOUND_EXACT : TT_BOUND_UPPER;
+    tt_store(ctx->shared->table, key, depth, tt_score_to_table(best, ply), bound, best_index >= 0 ? cgr_pack_move(moves[best_index]) : 0);
+    return best;
+}
+
+/**
+ * Iterative deepening loop of one thread
+ * Each completed iteration is offered to the shared result; the main
+ * thread's first iteration ignores the stop flag so a move always exists.
+ */
+static void iterate(SearchContext *ctx) {
+    SearchShared *shared = ctx->shared;
+
+    for (int depth = ctx->first_depth; depth <= shared->max_depth; depth++) {
+        ctx->root_has_best = false;
+        ctx->must_finish = ctx->is_main && depth == ctx->first_depth;
+        int score = search_node(ctx, &ctx->root, depth, -SEARCH_INFINITE, SEARCH_INFINITE, 0);
+        if (ctx->stopped) break;
+
+        pthread_mutex_lock(&shared->lock);
+        if (ctx->root_has_best && depth > shared->best.depth) {
+            shared->best.best_move = ctx->root_best;
+            shared->best.has_move = true;
+            shared->best.score = score;
+            shared->best.depth = depth;
+        }
+        pthread_mutex_unlock(&shared->lock);
+
+        // A forced mate will not change with more depth
+        if (score > SEARCH_MATE_BOUND || score < -SEARCH_MATE_BOUND) break;
+        if (ctx->is_main && shared->time_ms > 0 && elapsed_ms(&shared->start) >= shared->time_ms) break;
+        if (__atomic_load_n(&shared->stop, __ATOMIC_RELAXED)) break;
+    }
+}
+
+static void *helper_thread(void *arg) {
+    iterate(arg);
+    return NULL;
+}
+
+/**
+ * Number of threads used when SearchLimits.threads is 0
+ *
+ * @return Online processors (1 to SEARCH_MAX_THREADS)
+ */
+int search_default_threads(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) return 1;
+    return cpus > SEARCH_MAX_THREADS ? SEARCH_MAX_THREADS : (int)cpus;
+}
+
+/**
+ * Search a position by iterative deepening until the depth or time limit
+ * With several threads (Lazy SMP) helpers search the same root from
+ * staggered depths; the deepest iteration completed by any thread gives
+ * the move and score. The main thread's depth 1 always completes, so a
+ * legal move is returned whenever one exists.
+ *
+ * @param game Position to search (not modified)
+ * @param limits Depth, time, thread limits and the table to use
+ * @param result Output: best move, score, depth, nodes (all threads) and time
+ * @return false if no table can be allocated or there is no legal move
+ */
+bool search_position(ChessGame *game, const SearchLimits *limits, SearchResult *result) {
+    memset(result, 0, sizeof(*result));
+
+    // Without an allocated table of its own the search uses a private one
+    TranspositionTable scratch = {0};
+    TranspositionTable *table = limits->table;
+    if (!table || !table->buckets) {
+        if (!tt_init(&scratch, TT_DEFAULT_MB)) return false;
+        table = &scratch;
+    }
+    tt_new_search(table);
+
+    int threads = limits->threads > 0 ? limits->threads : search_default_threads();
+    if (threads > SEARCH_MAX_THREADS) threads = SEARCH_MAX_THREADS;
+
+    SearchContext *contexts = calloc((size_t)threads, sizeof(SearchContext));
+    pthread_t *handles = calloc((size_t)threads, sizeof(pthread_t));
+    if (!contexts || !handles) {
+        free(contexts);
+        free(handles);
+        tt_free(&scratch);
+        return false;
+    }
+
+    SearchShared shared;
+    memset(&shared, 0, sizeof(shared));
+    pthread_mutex_init(&shared.lock, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &shared.start);
+    shared.time_ms = limits->time_ms;
+    shared.external_stop = limits->stop;
+    shared.table = table;
+    shared.max_depth = limits->max_depth;
+    if (shared.max_depth < 1) shared.max_depth = 1;
+    if (shared.max_depth > SEARCH_MAX_PLY - 1) shared.max_depth = SEARCH_MAX_PLY - 1;
+
+    ChessGame root = *game;
+    root.in_check[WHITE] = is_in_check(&root, WHITE);
+    root.in_check[BLACK] = is_in_check(&root, BLACK);
+
+    // Helpers start one or two plies deeper than the main thread
+    int started = 1;
+    for (int i = 0; i < threads; i++) {
+        contexts[i].shared = &shared;
+        contexts[i].root = root;
+        contexts[i].is_main = i == 0;
+        contexts[i].first_depth = i == 0 ? 1 : (i % 2 == 1 ? 2 : 3);
+        if (contexts[i].first_depth > shared.max_depth) contexts[i].first_depth = shared.max_depth;
+    }
+    for (int i = 1; i < threads; i++) {
+        if (pthread_create(&handles[i], NULL, helper_thread, &contexts[i]) != 0) break;
+        started++;
+    }
+
+    iterate(&contexts[0]);
+    __atomic_store_n(&shared.stop, true, __ATOMIC_RELAXED);
+
+    for (int i = 1; i < started; i++) {
+        pthread_join(handles[i], NULL);
+    }
+
+    *result = shared.best;
+    for (int i = 0; i < threads; i++) {
+        result->nodes += contexts[i].nodes;
+    }
+    result->time_ms = elapsed_ms(&shared.start);
+
+    pthread_mutex_destroy(&shared.lock);
+    free(contexts);
+    free(handles);
+    tt_free(&scratch);
+    return result->has_move;
+}
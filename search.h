@@ -0,0 +1,78 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+/**
+ * search.h - Built-in Alpha-Beta Search Engine
+ *
+ * Purpose:
+ *   A small in-process engine used when the Stockfish binary is not
+ *   available, so the game always has an opponent. It answers through the
+ *   same get_best_move()/get_position_evaluation() calls as Stockfish
+ *   (see init_builtin_engine() in stockfish.h).
+ *
+ * Architecture:
+ *   - Iterative deepening negamax alpha-beta over chess.c's legal move
+ *     generator, with a check extension and a quiescence search over
+ *     captures and promotions
+ *   - Move ordering: transposition table move, captures by MVV-LVA
+ *     (most valuable victim, least valuable attacker), then two killer
+ *     moves per ply; captures that lose material by static exchange
+ *     evaluation (static_exchange_eval()) go last and are pruned from
+ *     the quiescence search
+ *   - Lock-free transposition table (tt.h) keyed by position_hash(),
+ *     owned by the caller and shared by the threads of one search
+ *   - Lazy SMP: with several threads, helpers search the same root from
+ *     staggered depths and share work through the transposition table;
+ *     the deepest iteration completed by any thread is the result
+ *   - Evaluation: material plus piece-square tables, tapered between
+ *     middlegame and endgame values by the remaining non-pawn material
+ *   - Scores are centipawns from the side to move's view, like UCI;
+ *     mates are SEARCH_MATE_SCORE minus the distance in plies
+ *
+ * Dependencies:
+ *   - chess.h for move generation and position_hash()
+ *   - game_record.h for the 16-bit move packing used in the table
+ *   - tt.h for the transposition table
+ */
+
+#include "chess.h"
+#include "tt.h"
+#include <stdint.h>
+
+#define SEARCH_MAX_PLY 64               // Deepest ply searched (quiescence included)
+#define SEARCH_MATE_SCORE 30000         // Score of delivering mate now
+#define SEARCH_MATE_BOUND (SEARCH_MATE_SCORE - SEARCH_MAX_PLY)   // Scores beyond this are mates
+#define SEARCH_INFINITE 32000           // Bound outside every score
+#define SEARCH_DEFAULT_TIME_MS 1000     // Move time when the game has no clock
+#define SEARCH_EVAL_TIME_MS 500         // Time spent on a SCORE evaluation
+#define SEARCH_MAX_THREADS 64           // Most search threads used
+
+/**
+ * SearchLimits - When to stop searching
+ */
+typedef struct {
+    int max_depth;           // Deepest iteration (plies, 1 to SEARCH_MAX_PLY - 1)
+    int time_ms;             // Wall-clock budget (0 = depth limit only)
+    int threads;             // Search threads (0 = one per online processor)
+    const bool *stop;        // Raised by another thread to end the search early (NULL = none)
+    TranspositionTable *table;  // Table kept between searches (NULL = a private one for this search)
+} SearchLimits;
+
+/**
+ * SearchResult - Outcome of the last completed iteration
+ */
+typedef struct {
+    Move best_move;          // Best move found (valid if has_move)
+    bool has_move;           // false if the position has no legal moves
+    int score;               // Centipawns from the side to move's view
+    int depth;               // Deepest completed iteration
+    uint64_t nodes;          // Positions visited (all threads)
+    int time_ms;             // Wall-clock time used
+} SearchResult;
+
+// Search
+bool search_position(ChessGame *game, const SearchLimits *limits, SearchResult *result);  // Iterative deepening search
+int evaluate_position(const ChessGame *game);  // Static evaluation, side to move's view
+int search_default_threads(void);  // Threads used when SearchLimits.threads is 0
+
+#endif // SEARCH_H
@@ -0,0 +1,357 @@
+/**
+ * selfplay.c - Engine-vs-Engine Games and Match Statistics
+ *
+ * Purpose:
+ *   Engine specs, game play with rules-based adjudication, and the Elo,
+ *   LOS and SPRT calculations described in selfplay.h.
+ *
+ * Architecture:
+ *   - selfplay_play_game() asks each engine for a move with
+ *     get_best_move_limited(), checks it against generate_legal_moves()
+ *     and records it; it keeps the Zobrist hash of every position for the
+ *     repetition rule
+ *   - The statistics are plain functions of a MatchScore so the match
+ *     tool can print them (and stop an SPRT) after every game
+ *
+ * Dependencies:
+ *   - selfplay.h
+ */
+
+#define _GNU_SOURCE        // Required for Linux (strtok_r)
+
+#include "selfplay.h"
+
+#include <math.h>
+
+/******************************************************************************
+ *                                  ENGINES
+ ******************************************************************************/
+
+/**
+ * Parse an engine spec such as "builtin:skill=5" or "stockfish:nnue=big.nnue"
+ *
+ * @param text Spec text
+ * @param spec Output configuration (skill defaults to MAX_SKILL_LEVEL)
+ * @return false for an unknown engine or option
+ */
+bool selfplay_parse_engine(const char *text, EngineSpec *spec) {
+    memset(spec, 0, sizeof(*spec));
+    spec->skill_level = MAX_SKILL_LEVEL;
+    snprintf(spec->name, sizeof(spec->name), "%s", text);
+
+    char copy[512];
+    snprintf(copy, sizeof(copy), "%s", text);
+    char *options = strchr(copy, ':');
+    if (options) *options++ = '\0';
+
+    if (strcmp(copy, "builtin") == 0) {
+        spec->builtin = true;
+    } else if (strcmp(copy, "stockfish") != 0) {
+        return false;
+    }
+
+    char *save = NULL;
+    for (char *option = options ? strtok_r(options, ",", &save) : NULL; option; option = strtok_r(NULL, ",", &save)) {
+        char *value = strchr(option, '=');
+        if (!value) return false;
+        *value++ = '\0';
+
+        if (strcmp(option, "skill") == 0) {
+            spec->skill_level = atoi(value);
+            if (spec->skill_level < MIN_SKILL_LEVEL || spec->skill_level > MAX_SKILL_LEVEL) return false;
+        } else if (strcmp(option, "threads") == 0) {
+            spec->threads = atoi(value);
+            if (spec->threads < 1) return false;
+        } else if (strcmp(option, "hash") == 0 && !spec->builtin) {
+            spec->hash_mb = atoi(value);
+            if (spec->hash_mb < 1) return false;
+        } else if (strcmp(option, "nnue") == 0 && !spec->builtin) {
+            snprintf(spec->eval_file, sizeof(spec->eval_file), "%s", value);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Start an engine and apply a spec
+ * Built-in engines search on one thread unless the spec says otherwise,
+ * since the match tool runs games in parallel instead.
+ *
+ * @param spec Configuration
+ * @param engine Engine handle to initialize (close with close_stockfish())
+ * @return false if Stockfish could not be started
+ */
+bool selfplay_open_engine(const EngineSpec *spec, StockfishEngine *engine) {
+    if (spec->builtin) {
+        init_builtin_engine(engine);
+        set_search_threads(engine, spec->threads > 0 ? spec->threads : 1);
+        return set_skill_level(engine, spec->skill_level);
+    }
+
+    memset(engine, 0, sizeof(*engine));
+    if (!init_stockfish(engine)) return false;
+
+    char command[320];
+    if (spec->threads > 0) {
+        snprintf(command, sizeof(command), "setoption name Threads value %d", spec->threads);
+        send_command(engine, command);
+    }
+    if (spec->hash_mb > 0) {
+        snprintf(command, sizeof(command), "setoption name Hash value %d", spec->hash_mb);
+        send_command(engine, command);
+    }
+    if (spec->eval_file[0] != '\0') {
+        snprintf(command, sizeof(command), "setoption name EvalFile value %s", spec->eval_file);
+        send_command(engine, command);
+    }
+    return set_skill_level(engine, spec->skill_level);
+}
+
+/******************************************************************************
+ *                                   GAMES
+ ******************************************************************************/
+
+/**
+ * Neither side can ever mate: bare kings, a single minor piece, or only
+ * bishops that all stand on squares of one color
+ */
+static bool insufficient_material(const ChessGame *game) {
+    int minors = 0, knights = 0, bishop_colors = 0;
+    for (int row = 0; row < BOARD_SIZE; row++) {
+        for (int col = 0; col < BOARD_SIZE; col++) {
+            PieceType type = game->board[row][col].type;
+            if (type == PAWN || type == ROOK || type == QUEEN) return false;
+            if (type == KNIGHT) {
+                knights++;
+                minors++;
+            } else if (type == BISHOP) {
+                bishop_colors |= 1 << ((row + col) & 1);
+                minors++;
+            }
+        }
+    }
+    if (minors <= 1) return true;
+    return knights == 0 && bishop_colors != 3;
+}
+
+/**
+ * Decide whether a game is over
+ *
+ * @param game Current position
+ * @param hashes position_hash() of every position so far, the current one last
+ * @param count Number of hashes
+ * @param termination Output: reason when the game is over (SELFPLAY_TERMINATION_SIZE bytes)
+ * @return "1-0", "0-1" or "1/2-1/2", or NULL if play continues
+ */
+const char *selfplay_adjudicate(ChessGame *game, const uint64_t *hashes, int count, char *termination) {
+    Move moves[MAX_LEGAL_MOVES];
+    if (generate_legal_moves(game, moves) == 0) {
+        if (is_in_check(game, game->current_player)) {
+            snprintf(termination, SELFPLAY_TERMINATION_SIZE, "checkmate");
+            return game->current_player == WHITE ? "0-1" : "1-0";
+        }
+        snprintf(termination, SELFPLAY_TERMINATION_SIZE, "stalemate");
+        return "1/2-1/2";
+    }
+    if (is_fifty_move_rule_draw(game)) {
+        snprintf(termination, SELFPLAY_TERMINATION_SIZE, "fifty-move rule");
+        return "1/2-1/2";
+    }
+    if (insufficient_material(game)) {
+        snprintf(termination, SELFPLAY_TERMINATION_SIZE, "insufficient material");
+        return "1/2-1/2";
+    }
+
+    // Same side to move every second ply, back to the last capture or pawn move
+    int repeats = 1;
+    for (int i = count - 3; i >= 0 && i >= count - 1 - game->halfmove_clock; i -= 2) {
+        if (hashes[i] == hashes[count - 1] && ++repeats == 3) {
+            snprintf(termination, SELFPLAY_TERMINATION_SIZE, "threefold repetition");
+            return "1/2-1/2";
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Play one game between two engines
+ *
+ * @param white Engine playing White
+ * @param black Engine playing Black (may be the same handle as white)
+ * @param start Start position (either side to move)
+ * @param limits Search limits per move and the ply limit
+ * @param result Output game; free result->record with game_record_free()
+ * @return false if memory ran out (result->record is freed)
+ */
+bool selfplay_play_game(StockfishEngine *white, StockfishEngine *black, const ChessGame *start,
+                        const SelfPlayLimits *limits, SelfPlayGame *result) {
+    ChessGame game = *start;
+    game_record_init(&result->record, start);
+    result->result = NULL;
+    result->termination[0] = '\0';
+
+    if (!white->builtin) send_command(white, "ucinewgame");
+    if (black != white && !black->builtin) send_command(black, "ucinewgame");
+
+    int capacity = 256, count = 0;
+    uint64_t *hashes = malloc((size_t)capacity * sizeof(uint64_t));
+    if (!hashes) {
+        game_record_free(&result->record);
+        return false;
+    }
+    hashes[count++] = position_hash(&game);
+
+    while (!(result->result = selfplay_adjudicate(&game, hashes, count, result->termination))) {
+        if (limits->max_plies > 0 && result->record.ply_count >= limits->max_plies) {
+            snprintf(result->termination, sizeof(result->termination), "ply limit");
+            result->result = "1/2-1/2";
+            break;
+        }
+
+        Color mover = game.current_player;
+        StockfishEngine *engine = mover == WHITE ? white : black;
+        char text[8] = "";
+        Move move;
+        if (!get_best_move_limited(engine, &game, limits->movetime_ms, limits->depth, text)) {
+            snprintf(result->termination, sizeof(result->termination), "%s engine returned no move",
+                     mover == WHITE ? "white" : "black");
+        } else if (!find_legal_uci_move(&game, text, &move) || !execute_move(&game, move)) {
+            snprintf(result->termination, sizeof(result->termination), "%s engine played illegal move %.8s",
+                     mover == WHITE ? "white" : "black", text);
+        } else {
+            if (!game_record_append(&result->record, move)) break;
+            if (count == capacity) {
+                uint64_t *grown = realloc(hashes, (size_t)capacity * 2 * sizeof(uint64_t));
+                if (!grown) break;
+                hashes = grown;
+                capacity *= 2;
+            }
+            hashes[count++] = position_hash(&game);
+            continue;
+        }
+        result->result = mover == WHITE ? "0-1" : "1-0";
+        break;
+    }
+
+    free(hashes);
+    if (!result->result) {
+        game_record_free(&result->record);
+        return false;
+    }
+    return true;
+}
+
+/******************************************************************************
+ *                                STATISTICS
+ ******************************************************************************/
+
+/**
+ * Count one game result for the first engine
+ *
+ * @param score Running score
+ * @param result "1-0", "0-1" or "1/2-1/2"
+ * @param first_engine_white The first engine had White in this game
+ */
+void match_score_add(MatchScore *score, const char *result, bool first_engine_white) {
+    if (strcmp(result, "1-0") == 0) {
+        if (first_engine_white) score->wins++;
+        else score->losses++;
+    } else if (strcmp(result, "0-1") == 0) {
+        if (first_engine_white) score->losses++;
+        else score->wins++;
+    } else {
+        score->draws++;
+    }
+}
+
+/**
+ * Mean score and per-game variance of the score (0, 0.5 or 1 per game)
+ */
+static int score_moments(const MatchScore *score, double *mean, double *variance) {
+    int games = score->wins + score->draws + score->losses;
+    if (games == 0) return 0;
+    *mean = (score->wins + 0.5 * score->draws) / games;
+    *variance = (score->wins * (1.0 - *mean) * (1.0 - *mean) + score->draws * (0.5 - *mean) * (0.5 - *mean) +
+                 score->losses * *mean * *mean) / games;
+    return games;
+}
+
+/**
+ * Elo difference for an expected score (clamped short of 0 and 1)
+ */
+static double score_to_elo(double score) {
+    if (score < 0.001) score = 0.001;
+    if (score > 0.999) score = 0.999;
+    return -400.0 * log10(1.0 / score - 1.0);
+}
+
+/**
+ * Expected score for an Elo difference
+ */
+static double elo_to_score(double elo) {
+    return 1.0 / (1.0 + pow(10.0, -elo / 400.0));
+}
+
+/**
+ * Elo difference of the first engine over the second
+ *
+ * @param score Match score
+ * @param margin Output: half-width of the 95% confidence interval (may be NULL)
+ * @return Elo difference (0 before the first game)
+ */
+double match_elo(const MatchScore *score, double *margin) {
+    double mean, variance;
+    int games = score_moments(score, &mean, &variance);
+    if (margin) *margin = 0.0;
+    if (games == 0) return 0.0;
+
+    if (margin) {
+        double deviation = 1.959964 * sqrt(variance / games);
+        *margin = (score_to_elo(mean + deviation) - score_to_elo(mean - deviation)) / 2.0;
+    }
+    return score_to_elo(mean);
+}
+
+/**
+ * Likelihood of superiority: chance that the first engine is the
+ * stronger one, from wins and losses (draws carry no information)
+ *
+ * @param score Match score
+ * @return 0..1 (0.5 when wins equal losses)
+ */
+double match_los(const MatchScore *score) {
+    int decisive = score->wins + score->losses;
+    if (decisive == 0) return 0.5;
+    return 0.5 * (1.0 + erf((score->wins - score->losses) / sqrt(2.0 * decisive)));
+}
+
+/**
+ * Sequential probability ratio test of elo0 against elo1
+ *
+ * @param score Match score so far
+ * @param params Hypotheses and error rates
+ * @param llr Output: log-likelihood ratio (may be NULL)
+ * @param lower Output: bound that accepts H0 (may be NULL)
+ * @param upper Output: bound that accepts H1 (may be NULL)
+ * @return Decision; SPRT_CONTINUE until a bound is crossed
+ */
+SprtStatus match_sprt(const MatchScore *score, const SprtParams *params, double *llr, double *lower, double *upper) {
+    double a = log(params->beta / (1.0 - params->alpha));
+    double b = log((1.0 - params->beta) / params->alpha);
+    if (lower) *lower = a;
+    if (upper) *upper = b;
+
+    double mean, variance, ratio = 0.0;
+    int games = score_moments(score, &mean, &variance);
+    if (games > 0 && variance > 0.0) {
+        double s0 = elo_to_score(params->elo0), s1 = elo_to_score(params->elo1);
+        ratio = games * (s1 - s0) * (2.0 * mean - s0 - s1) / (2.0 * variance);
+    }
+    if (llr) *llr = ratio;
+
+    if (ratio >= b) return SPRT_ACCEPT_H1;
+    if (ratio <= a) return SPRT_ACCEPT_H0;
+    return SPRT_CONTINUE;
+}
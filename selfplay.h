@@ -0,0 +1,115 @@
+#ifndef SELFPLAY_H
+#define SELFPLAY_H
+
+/**
+ * selfplay.h - Engine-vs-Engine Games and Match Statistics
+ *
+ * Purpose:
+ *   Plays games between two engine configurations with no human at the
+ *   keyboard, for tuning the DefaultSkillLevel presets and regression
+ *   testing engine changes (the match tool), and turns the results into
+ *   an Elo estimate and a sequential probability ratio test (SPRT).
+ *
+ * Engine specs (text, as given on the match command line):
+ *     builtin[:skill=N,threads=N]
+ *     stockfish[:skill=N,threads=N,hash=MB,nnue=FILE]
+ *
+ * Architecture:
+ *   - Each game is played on its own pair of StockfishEngine handles, so
+ *     games on different threads never share a Stockfish process or, for
+ *     built-in engines, a transposition table (each handle owns one, tt.h)
+ *   - Adjudication uses the rules code only: checkmate, stalemate, the
+ *     fifty-move rule, threefold repetition (position_hash()), insufficient
+ *     material, and a ply limit scored as a draw. An engine that returns no
+ *     move or an illegal one loses the game
+ *   - Elo is estimated from the score with a 95% interval from the
+ *     per-game score variance; the SPRT uses the normal approximation of
+ *     the log-likelihood ratio over win/draw/loss outcomes (as fishtest)
+ *
+ * Dependencies:
+ *   - chess.h, game_record.h for rules and the game record
+ *   - stockfish.h for the engines (Stockfish or the built-in search)
+ */
+
+#include "chess.h"
+#include "game_record.h"
+#include "stockfish.h"
+
+#define SELFPLAY_DEFAULT_MOVETIME_MS 100   // Search time per move
+#define SELFPLAY_DEFAULT_MAX_PLIES 400     // Ply limit before a game is scored a draw
+#define SELFPLAY_TERMINATION_SIZE 48       // Longest termination text
+
+/**
+ * EngineSpec - One engine configuration in a match
+ */
+typedef struct {
+    char name[64];           // Spec text, used as the PGN player name
+    bool builtin;            // Built-in search instead of Stockfish
+    int skill_level;         // MIN_SKILL_LEVEL..MAX_SKILL_LEVEL
+    int threads;             // Search threads (0 = engine default)
+    int hash_mb;             // Stockfish hash size (0 = engine default)
+    char eval_file[256];     // Stockfish NNUE network ("" = engine default)
+} EngineSpec;
+
+/**
+ * SelfPlayLimits - Search limits for every move of a game
+ */
+typedef struct {
+    int movetime_ms;         // Time per move (0 = none)
+    int depth;               // Depth per move (0 = none)
+    int max_plies;           // Draw after this many plies (0 = no limit)
+} SelfPlayLimits;
+
+/**
+ * SelfPlayGame - Outcome of one game
+ */
+typedef struct {
+    GameRecord record;       // Start position and moves; free with game_record_free()
+    const char *result;      // "1-0", "0-1" or "1/2-1/2"
+    char termination[SELFPLAY_TERMINATION_SIZE];    // Why the game ended
+} SelfPlayGame;
+
+/**
+ * MatchScore - Results from the first engine's point of view
+ */
+typedef struct {
+    int wins;
+    int draws;
+    int losses;
+} MatchScore;
+
+/**
+ * SprtStatus - Decision of a sequential probability ratio test
+ */
+typedef enum {
+    SPRT_CONTINUE = 0,       // Not enough evidence yet
+    SPRT_ACCEPT_H0,          // Difference is elo0 or less
+    SPRT_ACCEPT_H1           // Difference is elo1 or more
+} SprtStatus;
+
+/**
+ * SprtParams - Hypotheses and error rates of an SPRT
+ */
+typedef struct {
+    double elo0;             // H0: elo difference <= elo0
+    double elo1;             // H1: elo difference >= elo1
+    double alpha;            // False positive rate
+    double beta;             // False negative rate
+} SprtParams;
+
+// Engines
+bool selfplay_parse_engine(const char *text, EngineSpec *spec);  // Parse an engine spec
+bool selfplay_open_engine(const EngineSpec *spec, StockfishEngine *engine);  // Start and configure an engine
+
+// Games
+bool selfplay_play_game(StockfishEngine *white, StockfishEngine *black, const ChessGame *start,
+                        const SelfPlayLimits *limits, SelfPlayGame *game);  // Play one game to its end
+const char *selfplay_adjudicate(ChessGame *game, const uint64_t *hashes, int count, char *termination);  // Result if the game is over, else NULL
+
+// Statistics
+void match_score_add(MatchScore *score, const char *result, bool first_engine_white);  // Count one game
+double match_elo(const MatchScore *score, double *margin);  // Elo difference and 95% margin
+double match_los(const MatchScore *score);  // Likelihood of superiority (0..1)
+SprtStatus match_sprt(const MatchScore *score, const SprtParams *params, double *llr, double *lower, double *upper);  // SPRT decision
+
+#endif // SELFPLAY_H
@@ -0,0 +1,835 @@
+/**
+ * server.c - Multi-Game Server (chess_server)
+ *
+ * Purpose:
+ *   Sessions, client connections, the engine pool and the epoll loop
+ *   described in server.h.
+ *
+ * Architecture:
+ *   - Only server_run_once() and the functions it calls touch sessions
+ *     and clients; engine threads see nothing but the job queues
+ *   - epoll user data is the client index, or one of the SERVER_TAG_*
+ *     values for the listening socket and the engine eventfd
+ *   - Output is appended to the client's buffer and flushed at the end of
+ *     every loop pass; EPOLLOUT is only requested while a buffer is left
+ *     over
+ *
+ * Dependencies:
+ *   - server.h, protocol.h (move parsing), pgn_utils.h, san.h
+ */
+
+#define _GNU_SOURCE        // Required for Linux (accept4, eventfd, strtok_r)
+
+#include "server.h"
+#include "pgn_utils.h"
+#include "protocol.h"
+#include "san.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define SERVER_TAG_LISTEN UINT64_MAX          // epoll data of the listening socket
+#define SERVER_TAG_WAKE (UINT64_MAX - 1)      // epoll data of the engine eventfd
+#define SERVER_MAX_EVENTS 64                  // epoll events handled per pass
+#define SERVER_MAX_TOKENS 16                  // Words per command line
+
+/******************************************************************************
+ *                                  OUTPUT
+ ******************************************************************************/
+
+/**
+ * Append formatted text to a client's output buffer
+ */
+static void client_printf(ServerClient *client, const char *format, ...) {
+    if (!client->used || client->closing) return;
+
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    if (length < 0) return;
+
+    size_t needed = client->out_used + (size_t)length + 1;
+    if (needed > client->out_capacity) {
+        size_t capacity = client->out_capacity ? client->out_capacity : 256;
+        while (capacity < needed) capacity *= 2;
+        char *grown = realloc(client->out, capacity);
+        if (!grown) return;
+        client->out = grown;
+        client->out_capacity = capacity;
+    }
+
+    va_start(args, format);
+    vsnprintf(client->out + client->out_used, client->out_capacity - client->out_used, format, args);
+    va_end(args);
+    client->out_used += (size_t)length;
+}
+
+/**
+ * Disconnect a client and free its slot
+ */
+static void client_close(GameServer *server, int index) {
+    ServerClient *client = &server->clients[index];
+    if (client->fd >= 0) {
+        epoll_ctl(server->epoll_fd, EPOLL_CTL_DEL, client->fd, NULL);
+        close(client->fd);
+    }
+    free(client->out);
+    memset(client, 0, sizeof(*client));
+    client->fd = -1;
+}
+
+/**
+ * Write as much queued output as the socket takes
+ * Requests EPOLLOUT while output remains; closes a quitting client once
+ * everything is written.
+ */
+static void client_flush(GameServer *server, int index) {
+    ServerClient *client = &server->clients[index];
+    if (!client->used || client->fd < 0) return;
+
+    size_t sent = 0;
+    while (sent < client->out_used) {
+        ssize_t written = send(client->fd, client->out + sent, client->out_used - sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (written > 0) {
+            sent += (size_t)written;
+        } else if (written < 0 && errno == EINTR) {
+            continue;
+        } else if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            client_close(server, index);
+            return;
+        }
+    }
+    memmove(client->out, client->out + sent, client->out_used - sent);
+    client->out_used -= sent;
+
+    if (client->out_used == 0 && client->closing) {
+        client_close(server, index);
+        return;
+    }
+    struct epoll_event event = {.events = EPOLLIN | (client->out_used > 0 ? EPOLLOUT : 0), .data.u64 = (uint64_t)index};
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, client->fd, &event);
+}
+
+/**
+ * Send an event line to every client watching a session
+ */
+static void broadcast(GameServer *server, int session_id, const char *format, const char *a, const char *b) {
+    for (int i = 0; i < SERVER_MAX_CLIENTS; i++) {
+        ServerClient *client = &server->clients[i];
+        if (!client->used) continue;
+        for (int w = 0; w < client->watch_count; w++) {
+            if (client->watching[w] == session_id) {
+                client_printf(client, format, session_id, a, b);
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * Subscribe a client to a session's events (idempotent)
+ */
+static bool client_watch(ServerClient *client, int session_id) {
+    for (int w = 0; w < client->watch_count; w++) {
+        if (client->watching[w] == session_id) return true;
+    }
+    if (client->watch_count == SERVER_MAX_WATCHED) return false;
+    client->watching[client->watch_count++] = session_id;
+    return true;
+}
+
+/******************************************************************************
+ *                                ENGINE POOL
+ ******************************************************************************/
+
+/**
+ * Engine thread: take jobs, search, hand the answer back to the loop
+ */
+static void *engine_worker(void *argument) {
+    GameServer *server = argument;
+
+    pthread_mutex_lock(&server->lock);
+    int index = 0;
+    while (index < server->engine_count && server->threads[index] != pthread_self()) index++;
+    StockfishEngine *engine = &server->engines[index];
+    EngineJob *job = &server->searching[index];    // Too large for the stack
+
+    for (;;) {
+        while (!server->stopping && server->pending_count == 0) {
+            pthread_cond_wait(&server->work, &server->lock);
+        }
+        if (server->stopping) break;
+        *job = server->pending[server->pending_head];
+        server->pending_head = (server->pending_head + 1) % SERVER_MAX_JOBS;
+        server->pending_count--;
+        pthread_mutex_unlock(&server->lock);
+
+        set_skill_level(engine, job->skill_level);
+        if (!get_best_move(engine, &job->game, job->move, false)) job->move[0] = '\0';
+
+        pthread_mutex_lock(&server->lock);
+        server->finished[server->finished_count++] = *job;
+        uint64_t one = 1;
+        if (write(server->wake_fd, &one, sizeof(one)) < 0) {
+            // Counter saturated: the loop is already due to wake
+        }
+    }
+    pthread_mutex_unlock(&server->lock);
+    return NULL;
+}
+
+/**
+ * Queue an engine move if the engine is to move in a live session
+ */
+static void request_engine_move(GameServer *server, ServerSession *session) {
+    if (session->over || session->engine_thinking || session->human[session->game.current_player]) return;
+
+    pthread_mutex_lock(&server->lock);
+    EngineJob *job = &server->pending[(server->pending_head + server->pending_count) % SERVER_MAX_JOBS];
+    job->session_id = session->id;
+    job->ply = session->hash_count - 1;
+    job->skill_level = session->skill_level;
+    job->game = session->game;
+    job->move[0] = '\0';
+    server->pending_count++;
+    pthread_cond_signal(&server->work);
+    pthread_mutex_unlock(&server->lock);
+    session->engine_thinking = true;
+}
+
+/**
+ * Drop a session's job if no engine has taken it yet
+ * A job already being searched is dropped when its answer arrives.
+ */
+static void cancel_engine_move(GameServer *server, int session_id) {
+    pthread_mutex_lock(&server->lock);
+    for (int i = 0; i < server->pending_count; i++) {
+        if (server->pending[(server->pending_head + i) % SERVER_MAX_JOBS].session_id != session_id) continue;
+        for (int j = i; j + 1 < server->pending_count; j++) {
+            server->pending[(server->pending_head + j) % SERVER_MAX_JOBS] =
+                server->pending[(server->pending_head + j + 1) % SERVER_MAX_JOBS];
+        }
+        server->pending_count--;
+        break;
+    }
+    pthread_mutex_unlock(&server->lock);
+}
+
+/******************************************************************************
+ *                                 SESSIONS
+ ******************************************************************************/
+
+/**
+ * Session by id
+ *
+ * @param server Server
+ * @param id Session id from create
+ * @return Session, or NULL if there is none (never created or closed)
+ */
+ServerSession *server_find_session(GameServer *server, int id) {
+    if (id <= 0) return NULL;
+    for (int i = 0; i < SERVER_MAX_SESSIONS; i++) {
+        if (server->sessions[i].id == id) return &server->sessions[i];
+    }
+    return NULL;
+}
+
+/**
+ * End a game and tell its watchers
+ */
+static void end_session(GameServer *server, ServerSession *session, const char *result, const char *termination) {
+    session->over = true;
+    session->result = result;
+    session->game.timer.timing_active = false;
+    snprintf(session->termination, sizeof(session->termination), "%s", termination);
+    broadcast(server, session->id, "over %d %s %s\n", result, session->termination);
+}
+
+/**
+ * End the game if the side to move has run out of time
+ */
+static bool check_session_flag(GameServer *server, ServerSession *session) {
+    if (session->over || !check_time_forfeit(&session->game)) return false;
+    Color loser = session->game.timer.timing_active ? session->game.timer.timer_player : session->game.current_player;
+    end_session(server, session, loser == WHITE ? "0-1" : "1-0", "time forfeit");
+    return true;
+}
+
+/**
+ * Play a legal move in a session: clock, history, journal, events, end
+ * of game, and the engine's reply
+ */
+static bool play_session_move(GameServer *server, ServerSession *session, Move move) {
+    char san[SAN_BUFFER_SIZE] = "";
+    san_format_move(&session->game, move, san, sizeof(san));
+    char uci[6] = {(char)('a' + move.from.col), (char)('8' - move.from.row),
+                   (char)('a' + move.to.col), (char)('8' - move.to.row), '\0', '\0'};
+    if (move.is_promotion) uci[4] = " prnbqk"[move.promotion_piece];
+
+    if (session->hash_count == session->hash_capacity) {
+        int capacity = session->hash_capacity * 2;
+        uint64_t *grown = realloc(session->hashes, (size_t)capacity * sizeof(uint64_t));
+        if (!grown) return false;
+        session->hashes = grown;
+        session->hash_capacity = capacity;
+    }
+    if (!execute_move(&session->game, move)) return false;
+
+    stop_move_timer(&session->game);
+    history_push(&session->history, &session->game, move);
+    session->hashes[session->hash_count++] = position_hash(&session->game);
+    broadcast(server, session->id, "moved %d %s %s\n", uci, san);
+
+    // A flag can fall on the move itself (delay and byoyomi accounting)
+    if (check_session_flag(server, session)) return true;
+
+    char termination[SELFPLAY_TERMINATION_SIZE];
+    const char *result = selfplay_adjudicate(&session->game, session->hashes, session->hash_count, termination);
+    if (result) {
+        end_session(server, session, result, termination);
+        return true;
+    }
+    start_move_timer(&session->game);
+    request_engine_move(server, session);
+    return true;
+}
+
+/**
+ * Free a session slot
+ */
+static void free_session(GameServer *server, ServerSession *session) {
+    if (session->engine_thinking) cancel_engine_move(server, session->id);
+    history_close(&session->history);
+    free(session->hashes);
+    memset(session, 0, sizeof(*session));
+}
+
+/**
+ * Apply the engine moves the pool has finished
+ * Answers for closed sessions, finished games or an older ply are dropped.
+ */
+static void apply_engine_moves(GameServer *server) {
+    EngineJob *job = &server->applying;
+    for (;;) {
+        pthread_mutex_lock(&server->lock);
+        if (server->finished_count == 0) {
+            pthread_mutex_unlock(&server->lock);
+            return;
+        }
+        *job = server->finished[--server->finished_count];
+        pthread_mutex_unlock(&server->lock);
+
+        ServerSession *session = server_find_session(server, job->session_id);
+        if (!session || session->hash_count - 1 != job->ply) continue;
+        session->engine_thinking = false;
+        if (session->over || check_session_flag(server, session)) continue;
+
+        Color mover = session->game.current_player;
+        Move move;
+        if (job->move[0] == '\0') {
+            end_session(server, session, mover == WHITE ? "0-1" : "1-0", "engine returned no move");
+        } else if (!find_legal_uci_move(&session->game, job->move, &move) || !play_session_move(server, session, move)) {
+            end_session(server, session, mover == WHITE ? "0-1" : "1-0", "engine played an illegal move");
+        }
+    }
+}
+
+/******************************************************************************
+ *                                 COMMANDS
+ ******************************************************************************/
+
+/**
+ * Session named by a command argument, or an error reply
+ */
+static ServerSession *command_session(GameServer *server, ServerClient *client, char **tokens, int count) {
+    ServerSession *session = count > 1 ? server_find_session(server, atoi(tokens[1])) : NULL;
+    if (!session) client_printf(client, "error no such session\n");
+    return session;
+}
+
+/**
+ * create [white|black|both] [skill <n>] [time <control>]
+ */
+static void command_create(GameServer *server, ServerClient *client, char **tokens, int count) {
+    bool human[2] = {true, false};
+    int skill_level = MAX_SKILL_LEVEL;
+    TimeControl control;
+    memset(&control, 0, sizeof(control));
+
+    for (int i = 1; i < count; i++) {
+        if (strcmp(tokens[i], "white") == 0) {
+            human[WHITE] = true;
+            human[BLACK] = false;
+        } else if (strcmp(tokens[i], "black") == 0) {
+            human[WHITE] = false;
+            human[BLACK] = true;
+        } else if (strcmp(tokens[i], "both") == 0) {
+            human[WHITE] = human[BLACK] = true;
+        } else if (strcmp(tokens[i], "skill") == 0 && i + 1 < count) {
+            skill_level = atoi(tokens[++i]);
+            if (skill_level < MIN_SKILL_LEVEL || skill_level > MAX_SKILL_LEVEL) {
+                client_printf(client, "error skill must be %d to %d\n", MIN_SKILL_LEVEL, MAX_SKILL_LEVEL);
+                return;
+            }
+        } else if (strcmp(tokens[i], "time") == 0 && i + 1 < count) {
+            if (!parse_time_control(tokens[++i], &control)) {
+                client_printf(client, "error invalid time control\n");
+                return;
+            }
+        } else {
+            client_printf(client, "error usage: create [white|black|both] [skill <n>] [time <control>]\n");
+            return;
+        }
+    }
+
+    ServerSession *session = NULL;
+    for (int i = 0; i < SERVER_MAX_SESSIONS && !session; i++) {
+        if (server->sessions[i].id == 0) session = &server->sessions[i];
+    }
+    if (!session) {
+        client_printf(client, "error server full\n");
+        return;
+    }
+
+    memset(session, 0, sizeof(*session));
+    init_board(&session->game);
+    if (control.enabled) init_game_timer(&session->game, &control);
+    history_init(&session->history);
+
+    int id = server->next_id;
+    char journal[SERVER_PATH_SIZE + 32];
+    snprintf(journal, sizeof(journal), "%s/session_%d.fen", server->journal_dir, id);
+    session->hash_capacity = 128;
+    session->hashes = malloc((size_t)session->hash_capacity * sizeof(uint64_t));
+    if (!session->hashes || !history_reset(&session->history, &session->game, journal)) {
+        free_session(server, session);
+        client_printf(client, "error cannot create journal %s\n", journal);
+        return;
+    }
+
+    server->next_id++;
+    session->id = id;
+    session->human[WHITE] = human[WHITE];
+    session->human[BLACK] = human[BLACK];
+    session->skill_level = skill_level;
+    session->result = "*";
+    session->hashes[session->hash_count++] = position_hash(&session->game);
+    client_watch(client, id);
+    client_printf(client, "created %d\n", id);
+
+    start_move_timer(&session->game);
+    request_engine_move(server, session);
+}
+
+/**
+ * move <id> <move>
+ */
+static void command_move(GameServer *server, ServerClient *client, char **tokens, int count) {
+    ServerSession *session = command_session(server, client, tokens, count);
+    if (!session) return;
+
+    Move move;
+    if (count < 3) {
+        client_printf(client, "error usage: move <id> <move>\n");
+    } else if (session->over || check_session_flag(server, session)) {
+        client_printf(client, "error game over\n");
+    } else if (!session->human[session->game.current_player]) {
+        client_printf(client, "error engine to move\n");
+    } else if (!protocol_parse_move(&session->game, tokens[2], &move)) {
+        client_printf(client, "error illegal move %.40s\n", tokens[2]);
+    } else if (!play_session_move(server, session, move)) {
+        client_printf(client, "error out of memory\n");
+    } else {
+        client_printf(client, "ok\n");
+    }
+}
+
+/**
+ * resign <id> [white|black]
+ */
+static void command_resign(GameServer *server, ServerClient *client, char **tokens, int count) {
+    ServerSession *session = command_session(server, client, tokens, count);
+    if (!session) return;
+
+    Color loser;
+    if (count > 2 && strcmp(tokens[2], "white") == 0) {
+        loser = WHITE;
+    } else if (count > 2 && strcmp(tokens[2], "black") == 0) {
+        loser = BLACK;
+    } else if (count == 2 && session->human[WHITE] != session->human[BLACK]) {
+        loser = session->human[WHITE] ? WHITE : BLACK;
+    } else {
+        client_printf(client, "error usage: resign <id> white|black\n");
+        return;
+    }
+    if (session->over) {
+        client_printf(client, "error game over\n");
+        return;
+    }
+    client_printf(client, "ok\n");
+    end_session(server, session, loser == WHITE ? "0-1" : "1-0", loser == WHITE ? "white resigns" : "black resigns");
+}
+
+/**
+ * query <id>
+ */
+static void command_query(GameServer *server, ServerClient *client, char **tokens, int count) {
+    ServerSession *session = command_session(server, client, tokens, count);
+    if (!session) return;
+    check_session_flag(server, session);
+
+    char fen[FEN_BUFFER_SIZE];
+    fen_write(&session->game, fen, sizeof(fen));
+    bool timed = is_time_control_enabled(&session->game);
+    client_printf(client, "state %d %s %s %s %lld %lld %s\n", session->id, session->over ? "over" : "playing",
+                  session->result, session->game.current_player == WHITE ? "white" : "black",
+                  timed ? (long long)get_remaining_time_ms(&session->game, WHITE) : -1LL,
+                  timed ? (long long)get_remaining_time_ms(&session->game, BLACK) : -1LL, fen);
+}
+
+/**
+ * pgn <id>: movetext on one line
+ */
+static void command_pgn(GameServer *server, ServerClient *client, char **tokens, int count) {
+    ServerSession *session = command_session(server, client, tokens, count);
+    if (!session) return;
+
+    GameRecord record;
+    char *movetext = NULL;
+    if (history_to_record(&session->history, &record)) {
+        movetext = pgn_format_movetext(&record, session->result);
+        game_record_free(&record);
+    }
+    if (!movetext) {
+        client_printf(client, "error out of memory\n");
+        return;
+    }
+    for (char *p = movetext; *p; p++) {
+        if (*p == '\n' || *p == '\r') *p = ' ';
+    }
+    size_t length = strlen(movetext);
+    while (length > 0 && movetext[length - 1] == ' ') movetext[--length] = '\0';
+    client_printf(client, "pgn %d %s\n", session->id, movetext);
+    free(movetext);
+}
+
+/**
+ * Run one command line for a client
+ *
+ * @param server Server
+ * @param index Client index from server_add_client()
+ * @param line Command text (split in place)
+ */
+void server_execute(GameServer *server, int index, char *line) {
+    ServerClient *client = &server->clients[index];
+    char *tokens[SERVER_MAX_TOKENS];
+    int count = 0;
+    char *save = NULL;
+    for (char *token = strtok_r(line, " \t\r\n", &save); token && count < SERVER_MAX_TOKENS;
+         token = strtok_r(NULL, " \t\r\n", &save)) {
+        tokens[count++] = token;
+    }
+    if (count == 0) return;
+
+    const char *command = tokens[0];
+    if (strcmp(command, "create") == 0) {
+        command_create(server, client, tokens, count);
+    } else if (strcmp(command, "move") == 0) {
+        command_move(server, client, tokens, count);
+    } else if (strcmp(command, "resign") == 0) {
+        command_resign(server, client, tokens, count);
+    } else if (strcmp(command, "query") == 0) {
+        command_query(server, client, tokens, count);
+    } else if (strcmp(command, "pgn") == 0) {
+        command_pgn(server, client, tokens, count);
+    } else if (strcmp(command, "watch") == 0) {
+        ServerSession *session = command_session(server, client, tokens, count);
+        if (session) client_printf(client, client_watch(client, session->id) ? "ok\n" : "error watching too many sessions\n");
+    } else if (strcmp(command, "close") == 0) {
+        ServerSession *session = command_session(server, client, tokens, count);
+        if (session) {
+            free_session(server, session);
+            client_printf(client, "ok\n");
+        }
+    } else if (strcmp(command, "list") == 0) {
+        int sessions = 0;
+        for (int i = 0; i < SERVER_MAX_SESSIONS; i++) sessions += server->sessions[i].id != 0;
+        client_printf(client, "sessions %d", sessions);
+        for (int i = 0; i < SERVER_MAX_SESSIONS; i++) {
+            if (server->sessions[i].id != 0) client_printf(client, " %d", server->sessions[i].id);
+        }
+        client_printf(client, "\n");
+    } else if (strcmp(command, "quit") == 0) {
+        client->closing = true;
+    } else {
+        client_printf(client, "error unknown command %.40s\n", command);
+    }
+}
+
+/******************************************************************************
+ *                                  LOOP
+ ******************************************************************************/
+
+/**
+ * Register a connection
+ *
+ * @param server Server
+ * @param fd Connected socket (non-blocking), or -1 for an in-process client
+ *           whose output stays in its buffer
+ * @return Client index, or -1 if every slot is taken
+ */
+int server_add_client(GameServer *server, int fd) {
+    for (int i = 0; i < SERVER_MAX_CLIENTS; i++) {
+        ServerClient *client = &server->clients[i];
+        if (client->used) continue;
+
+        memset(client, 0, sizeof(*client));
+        client->used = true;
+        client->fd = fd;
+        if (fd >= 0) {
+            struct epoll_event event = {.events = EPOLLIN, .data.u64 = (uint64_t)i};
+            if (epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+                client->used = false;
+                return -1;
+            }
+        }
+        return i;
+    }
+    return -1;
+}
+
+/**
+ * Read from a client and run every complete line
+ */
+static void client_read(GameServer *server, int index) {
+    ServerClient *client = &server->clients[index];
+    for (;;) {
+        ssize_t got = recv(client->fd, client->in + client->in_used, sizeof(client->in) - 1 - client->in_used, 0);
+        if (got < 0 && errno == EINTR) continue;
+        if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        if (got <= 0) {
+            client_close(server, index);
+            return;
+        }
+        client->in_used += (size_t)got;
+        client->in[client->in_used] = '\0';
+
+        char *start = client->in;
+        char *newline;
+        while (client->used && !client->closing && (newline = strchr(start, '\n'))) {
+            *newline = '\0';
+            server_execute(server, index, start);
+            start = newline + 1;
+        }
+        if (!client->used) return;
+        client->in_used -= (size_t)(start - client->in);
+        memmove(client->in, start, client->in_used);
+
+        if (client->in_used == sizeof(client->in) - 1) {
+            client_printf(client, "error line too long\n");
+            client->in_used = 0;
+        }
+    }
+}
+
+/**
+ * Accept every waiting connection
+ */
+static void accept_clients(GameServer *server) {
+    for (;;) {
+        int fd = accept4(server->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;
+        if (server_add_client(server, fd) < 0) {
+            static const char full[] = "error server full\n";
+            if (send(fd, full, sizeof(full) - 1, MSG_NOSIGNAL | MSG_DONTWAIT) < 0) {
+                // Closing anyway
+            }
+            close(fd);
+        }
+    }
+}
+
+/**
+ * Wait for and handle I/O, engine moves and flag falls
+ *
+ * @param server Server
+ * @param timeout_ms Longest wait (SERVER_TICK_MS keeps clocks responsive)
+ * @return Number of events handled, or -1 if epoll failed
+ */
+int server_run_once(GameServer *server, int timeout_ms) {
+    struct epoll_event events[SERVER_MAX_EVENTS];
+    int count = epoll_wait(server->epoll_fd, events, SERVER_MAX_EVENTS, timeout_ms);
+    if (count < 0) {
+        if (errno != EINTR) return -1;
+        count = 0;
+    }
+
+    for (int i = 0; i < count; i++) {
+        uint64_t tag = events[i].data.u64;
+        if (tag == SERVER_TAG_LISTEN) {
+            accept_clients(server);
+        } else if (tag == SERVER_TAG_WAKE) {
+            uint64_t value;
+            if (read(server->wake_fd, &value, sizeof(value)) < 0) {
+                // Already drained
+            }
+        } else if (tag < SERVER_MAX_CLIENTS && server->clients[tag].used) {
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) client_read(server, (int)tag);
+            else if (events[i].events & EPOLLOUT) client_flush(server, (int)tag);
+        }
+    }
+
+    apply_engine_moves(server);
+    for (int i = 0; i < SERVER_MAX_SESSIONS; i++) {
+        if (server->sessions[i].id != 0) check_session_flag(server, &server->sessions[i]);
+    }
+    for (int i = 0; i < SERVER_MAX_CLIENTS; i++) {
+        if (server->clients[i].used && (server->clients[i].out_used > 0 || server->clients[i].closing)) {
+            client_flush(server, i);
+        }
+    }
+    return count;
+}
+
+/******************************************************************************
+ *                                 LIFETIME
+ ******************************************************************************/
+
+/**
+ * Open the listening socket
+ */
+static bool listen_on(GameServer *server, const char *path) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path)) return false;
+    snprintf(address.sun_path, sizeof(address.sun_path), "%s", path);
+
+    server->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (server->listen_fd < 0) return false;
+    unlink(path);    // Left behind by a server that did not shut down cleanly
+    if (bind(server->listen_fd, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+        listen(server->listen_fd, SOMAXCONN) != 0) {
+        return false;
+    }
+    snprintf(server->socket_path, sizeof(server->socket_path), "%s", path);
+
+    struct epoll_event event = {.events = EPOLLIN, .data.u64 = SERVER_TAG_LISTEN};
+    return epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->listen_fd, &event) == 0;
+}
+
+/**
+ * First session id whose journal does not exist yet in a directory
+ * Keeps a restarted server from overwriting the journals of earlier runs.
+ */
+static int first_free_session_id(const char *journal_dir) {
+    int next_id = 1;
+    DIR *dir = opendir(journal_dir);
+    if (!dir) return next_id;
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        int id;
+        char rest[8];
+        if (sscanf(entry->d_name, "session_%d%7s", &id, rest) == 2 &&
+            strcmp(rest, ".fen") == 0 && id >= next_id && id < INT_MAX) {
+            next_id = id + 1;
+        }
+    }
+    closedir(dir);
+    return next_id;
+}
+
+/**
+ * Start the engine pool and listen
+ * Each pool engine is a Stockfish process, or the built-in search (one
+ * thread and its own hash table each) when Stockfish is not installed.
+ * Session ids continue after the highest journal already in journal_dir.
+ *
+ * @param server Server to initialize (large: give it static storage)
+ * @param socket_path Unix socket to listen on (NULL = in-process clients only)
+ * @param journal_dir Directory for session FEN journals
+ * @param engines Engine pool size (1 to SERVER_MAX_ENGINES)
+ * @return false if the socket or the loop could not be set up
+ */
+bool server_init(GameServer *server, const char *socket_path, const char *journal_dir, int engines) {
+    memset(server, 0, sizeof(*server));
+    server->listen_fd = -1;
+    server->wake_fd = -1;
+    for (int i = 0; i < SERVER_MAX_CLIENTS; i++) server->clients[i].fd = -1;
+    snprintf(server->journal_dir, sizeof(server->journal_dir), "%s", journal_dir ? journal_dir : ".");
+    server->next_id = first_free_session_id(server->journal_dir);
+    pthread_mutex_init(&server->lock, NULL);
+    pthread_cond_init(&server->work, NULL);
+
+    server->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    server->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (server->epoll_fd < 0 || server->wake_fd < 0) return false;
+    struct epoll_event event = {.events = EPOLLIN, .data.u64 = SERVER_TAG_WAKE};
+    if (epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->wake_fd, &event) != 0) return false;
+    if (socket_path && !listen_on(server, socket_path)) return false;
+
+    if (engines < 1) engines = 1;
+    if (engines > SERVER_MAX_ENGINES) engines = SERVER_MAX_ENGINES;
+    for (int i = 0; i < engines; i++) {
+        // A built-in engine brings its own hash, so pool threads never share one
+        if (!init_stockfish(&server->engines[i])) {
+            init_builtin_engine(&server->engines[i]);
+            set_search_threads(&server->engines[i], 1);
+        }
+    }
+
+    // Threads find their engine by their own id, so hold the lock until all exist
+    pthread_mutex_lock(&server->lock);
+    for (int i = 0; i < engines; i++) {
+        if (pthread_create(&server->threads[i], NULL, engine_worker, server) != 0) break;
+        server->engine_count++;
+    }
+    pthread_mutex_unlock(&server->lock);
+    return server->engine_count > 0;
+}
+
+/**
+ * Stop the pool, disconnect clients and free every session
+ * Journals are kept.
+ *
+ * @param server Server from server_init()
+ */
+void server_close(GameServer *server) {
+    pthread_mutex_lock(&server->lock);
+    server->stopping = true;
+    pthread_cond_broadcast(&server->work);
+    pthread_mutex_unlock(&server->lock);
+
+    for (int i = 0; i < server->engine_count; i++) {
+        pthread_join(server->threads[i], NULL);
+    }
+    for (int i = 0; i < SERVER_MAX_ENGINES; i++) {
+        close_stockfish(&server->engines[i]);
+    }
+
+    for (int i = 0; i < SERVER_MAX_CLIENTS; i++) {
+        if (server->clients[i].used) client_close(server, i);
+    }
+    for (int i = 0; i < SERVER_MAX_SESSIONS; i++) {
+        if (server->sessions[i].id != 0) free_session(server, &server->sessions[i]);
+    }
+    if (server->listen_fd >= 0) {
+        close(server->listen_fd);
+        unlink(server->socket_path);
+    }
+    if (server->wake_fd >= 0) close(server->wake_fd);
+    if (server->epoll_fd >= 0) close(server->epoll_fd);
+    pthread_cond_destroy(&server->work);
+    pthread_mutex_destroy(&server->lock);
+}
@@ -0,0 +1,159 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+/**
+ * server.h - Multi-Game Server (chess_server)
+ *
+ * Purpose:
+ *   Hosts many games in one process for a classroom or club: every game
+ *   is a session with its own position, clock, move history and FEN
+ *   journal, while all sessions share a small pool of engines and one
+ *   I/O loop. One process per game, each with its own Stockfish child,
+ *   runs out of memory long before 60 students are playing.
+ *
+ * Commands (one per line on the Unix socket) and replies:
+ *     create [white|black|both] [skill <n>] [time <control>]
+ *                                   created <id>   (sides the client plays;
+ *                                                   the engine plays the rest)
+ *     move <id> <move>              ok
+ *     resign <id> [white|black]     ok
+ *     query <id>                    state <id> <playing|over> <result> <side to move>
+ *                                         <white ms> <black ms> <FEN>
+ *     pgn <id>                      pgn <id> <movetext>
+ *     watch <id>                    ok
+ *     list                          sessions <count> <id>...
+ *     close <id>                    ok
+ *     quit                          (connection closed)
+ *   Moves are UCI or SAN. Failures answer "error <reason>". Clients that
+ *   created or watch a session also receive events as they happen:
+ *     moved <id> <uci> <san>        a move was played (by a client or the engine)
+ *     over <id> <result> <reason>   the game ended
+ *   Clock times are -1 for untimed games.
+ *
+ * Architecture:
+ *   - One thread runs the epoll loop: it accepts clients, reads command
+ *     lines, and owns every session, so sessions need no locks
+ *   - Engine moves are jobs for the engine pool (SERVER_DEFAULT_ENGINES
+ *     threads, each owning one engine). A job carries a copy of the
+ *     position; the finished move goes back through a queue and an
+ *     eventfd that wakes the loop, which applies it if the session is
+ *     still at the same ply
+ *   - Clocks are the ChessGame timers (chess.h); the loop wakes at least
+ *     every SERVER_TICK_MS to end games whose flag has fallen
+ *   - Games end by the rules through selfplay_adjudicate(), by
+ *     resignation, or on time. Journals are <journal dir>/session_<id>.fen;
+ *     ids continue after the highest journal left by an earlier run
+ *   - Replies are queued per client and written as the socket accepts
+ *     them, so one slow client never blocks the others
+ *
+ * Dependencies:
+ *   - chess.h, history.h, san.h for the games
+ *   - stockfish.h for the engines; selfplay.h for adjudication;
+ *     protocol.h for move parsing
+ */
+
+#include "chess.h"
+#include "history.h"
+#include "selfplay.h"
+#include "stockfish.h"
+
+#include <pthread.h>
+
+#define SERVER_MAX_SESSIONS 256         // Games hosted at once
+#define SERVER_MAX_CLIENTS 256          // Connections at once
+#define SERVER_MAX_WATCHED 16           // Sessions one client receives events for
+#define SERVER_MAX_ENGINES 16           // Engine pool size limit
+#define SERVER_DEFAULT_ENGINES 2        // Engine pool size
+#define SERVER_LINE_SIZE 1024           // Longest command line
+#define SERVER_TICK_MS 250              // Longest wait between flag checks
+#define SERVER_PATH_SIZE 256            // Socket and journal paths
+#define SERVER_MAX_JOBS (SERVER_MAX_SESSIONS + SERVER_MAX_ENGINES)  // One per session, plus answers for closed ones
+
+/**
+ * ServerSession - One hosted game
+ */
+typedef struct {
+    int id;                             // 0 = free slot
+    ChessGame game;
+    GameHistory history;                // Moves, with the session's FEN journal
+    uint64_t *hashes;                   // position_hash() of every position (repetition rule)
+    int hash_count;
+    int hash_capacity;
+    bool human[2];                      // Side moves through the API (else the engine), by Color
+    int skill_level;                    // Engine skill for this game
+    bool engine_thinking;               // A job for this session is queued or running
+    bool over;
+    const char *result;                 // "*" while playing
+    char termination[SELFPLAY_TERMINATION_SIZE];
+} ServerSession;
+
+/**
+ * ServerClient - One connection (fd -1 for an in-process client)
+ */
+typedef struct {
+    bool used;
+    int fd;
+    char in[SERVER_LINE_SIZE];          // Partial command line
+    size_t in_used;
+    char *out;                          // Replies and events not yet written
+    size_t out_used;
+    size_t out_capacity;
+    int watching[SERVER_MAX_WATCHED];   // Session ids
+    int watch_count;
+    bool closing;                       // Close once out is written
+} ServerClient;
+
+/**
+ * EngineJob - A move request for the engine pool, and its answer
+ */
+typedef struct {
+    int session_id;
+    int ply;                            // Session ply when queued (stale check)
+    int skill_level;
+    ChessGame game;                     // Position to search, clock included
+    char move[8];                       // Answer in UCI ("" = no move)
+} EngineJob;
+
+/**
+ * GameServer - Sessions, clients, engine pool and I/O loop
+ */
+typedef struct {
+    ServerSession sessions[SERVER_MAX_SESSIONS];
+    ServerClient clients[SERVER_MAX_CLIENTS];
+    int next_id;
+    char journal_dir[SERVER_PATH_SIZE];
+
+    // I/O loop
+    int epoll_fd;
+    int listen_fd;                      // -1 without a socket
+    int wake_fd;                        // eventfd raised by engine threads
+    char socket_path[SERVER_PATH_SIZE];
+
+    // Engine pool
+    StockfishEngine engines[SERVER_MAX_ENGINES];
+    pthread_t threads[SERVER_MAX_ENGINES];
+    int engine_count;
+    pthread_mutex_t lock;               // Guards the two queues and stopping
+    pthread_cond_t work;
+    EngineJob pending[SERVER_MAX_JOBS]; // Ring of queued jobs
+    int pending_head, pending_count;
+    EngineJob finished[SERVER_MAX_JOBS];        // Answers for the loop
+    int finished_count;
+    EngineJob searching[SERVER_MAX_ENGINES];    // Job each engine thread is working on
+    EngineJob applying;                 // Answer being applied by the loop
+    bool stopping;
+} GameServer;
+
+// Lifetime
+bool server_init(GameServer *server, const char *socket_path, const char *journal_dir, int engines);  // Start the pool and listen (socket_path NULL = no socket)
+void server_close(GameServer *server);  // Stop the pool, close clients and sessions
+
+// Loop
+int server_run_once(GameServer *server, int timeout_ms);  // Wait for and handle I/O, engine moves and flags; -1 on error
+int server_add_client(GameServer *server, int fd);  // Register a connection (fd -1 = in-process); client index or -1
+void server_execute(GameServer *server, int client, char *line);  // Run one command line for a client
+
+// Sessions
+ServerSession *server_find_session(GameServer *server, int id);  // Session by id, or NULL
+
+#endif // SERVER_H
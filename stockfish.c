@@ -21,10 +21,30 @@
  * - Skill level adjustment for difficulty control
  * - Position evaluation for scoring and analysis
  * - Engine cleanup and termination
+ *
+ * When no Stockfish binary is available, init_builtin_engine() switches the
+ * same StockfishEngine handle to the in-process search from search.c; every
+ * request function below then answers from that search instead of UCI.
  */
 
 #define _GNU_SOURCE  // Enable GNU/Linux extensions like fdopen
 #include "stockfish.h"
+#include "profile.h"
+#include "search.h"
+
+/**
+ * Release the pipes and reap the child after a failed start
+ * No "quit" is sent: the child has already exited (writing would raise SIGPIPE).
+ */
+static void abandon_engine(StockfishEngine *engine) {
+    if (engine->to_engine) fclose(engine->to_engine);
+    if (engine->from_engine) fclose(engine->from_engine);
+    if (engine->pid > 0) waitpid(engine->pid, NULL, 0);
+    engine->to_engine = NULL;
+    engine->from_engine = NULL;
+    engine->pid = 0;
+    engine->is_ready = false;
+}
 
 /**
  * Initialize Stockfish chess engine via UCI protocol
@@ -35,6 +55,22 @@
  * @return true if initialization successful, false on failure
  */
 bool init_stockfish(StockfishEngine *engine) {
+    char *const command[] = {"stockfish", NULL};
+    return init_uci_engine(engine, command);
+}
+
+/**
+ * Start any UCI engine as a child process and complete the handshake
+ * init_stockfish() with the command of one's choice (PATH is searched).
+ * The program must ignore SIGPIPE: a child whose exec failed closes its
+ * pipe, and the handshake write has to fail rather than kill the process.
+ *
+ * @param engine Pointer to StockfishEngine structure to initialize
+ * @param command Program and arguments, NULL-terminated
+ * @return true if the engine answered uciok and readyok
+ */
+bool init_uci_engine(StockfishEngine *engine, char *const command[]) {
+    memset(engine, 0, sizeof(*engine));
     int to_engine_pipe[2];    // Pipe for sending commands to Stockfish
     int from_engine_pipe[2];  // Pipe for receiving responses from Stockfish
     
@@ -60,9 +96,9 @@ bool init_stockfish(StockfishEngine *engine) {
         close(from_engine_pipe[0]);
         close(from_engine_pipe[1]);
         
-        // Execute Stockfish engine
-        execlp("stockfish", "stockfish", NULL);
-        exit(1);  // Exit if Stockfish launch fails
+        // Execute the engine
+        execvp(command[0], command);
+        exit(1);  // Exit if the engine launch fails
     }
     
     // Parent process: close unused pipe ends and set up file streams
@@ -74,12 +110,14 @@ bool init_stockfish(StockfishEngine *engine) {
     engine->from_engine = fdopen(from_engine_pipe[0], "r"); // Stream to read responses
     
     if (!engine->to_engine || !engine->from_engine) {
+        abandon_engine(engine);
         return false;
     }
     
     // Initialize UCI communication with Stockfish
     send_command(engine, "uci");    // Request UCI mode
     if (!wait_for_ready(engine)) {  // Wait for Stockfish to be ready
+        abandon_engine(engine);     // exec failed: no Stockfish on PATH
         return false;
     }
 
@@ -98,6 +136,79 @@ bool init_stockfish(StockfishEngine *engine) {
     return engine->is_ready;
 }
 
+/**
+ * Use the built-in search as the engine
+ * Fallback when init_stockfish() fails; the handle then works with every
+ * request function in this file without a child process.
+ *
+ * Each built-in engine owns a TT_DEFAULT_MB transposition table, so engines
+ * searching at the same time (match, server) never share one. If it cannot
+ * be allocated every search uses a private table instead.
+ *
+ * @param engine Engine handle to set up (any failed Stockfish start released)
+ * @return true (the built-in engine needs no external resources)
+ */
+bool init_builtin_engine(StockfishEngine *engine) {
+    memset(engine, 0, sizeof(*engine));
+    engine->builtin = true;
+    engine->skill_level = MAX_SKILL_LEVEL;
+    engine->is_ready = true;
+    tt_init(&engine->table, TT_DEFAULT_MB);
+    return true;
+}
+
+/**
+ * Move time for the side to move: its main time shared over the moves to
+ * the next time control (MOVE_TIME_DIVISOR in sudden death) plus most of
+ * the per-move bonus, or the overtime period once main time is gone;
+ * within MIN_MOVE_TIME_MS..MAX_MOVE_TIME_MS and never past flag-fall
+ */
+static int allocate_move_time(ChessGame *game) {
+    ClockBudget budget;
+    get_clock_budget(game, game->current_player, &budget);
+
+    int64_t moves = budget.moves_to_go > 0 && budget.moves_to_go < MOVE_TIME_DIVISOR ?
+                    budget.moves_to_go : MOVE_TIME_DIVISOR;
+    int64_t move_time = budget.time_ms / moves + budget.increment_ms * 3 / 4;
+    if (budget.byoyomi_ms > 0 && move_time < budget.byoyomi_ms - MOVE_OVERHEAD_MS) {
+        move_time = budget.byoyomi_ms - MOVE_OVERHEAD_MS;
+    }
+    if (move_time < MIN_MOVE_TIME_MS) move_time = MIN_MOVE_TIME_MS;
+    if (move_time > MAX_MOVE_TIME_MS) move_time = MAX_MOVE_TIME_MS;
+
+    int64_t limit = get_remaining_time_ms(game, game->current_player) - MOVE_OVERHEAD_MS;
+    if (move_time > limit) move_time = limit > 1 ? limit : 1;
+    return (int)move_time;
+}
+
+/**
+ * Search with the built-in engine and write the move in UCI notation
+ * Lower skill levels cap the search depth (skill 0 = 2 plies) unless an
+ * explicit depth is given; stop_search() ends it early.
+ */
+static bool builtin_best_move(StockfishEngine *engine, ChessGame *game, int time_ms, int depth, char *move_str, bool debug) {
+    SearchLimits limits = {2 + engine->skill_level / 2, time_ms, engine->threads, &engine->stop_requested, &engine->table};
+    if (engine->skill_level >= MAX_SKILL_LEVEL) limits.max_depth = SEARCH_MAX_PLY - 1;
+    if (depth > 0) limits.max_depth = depth < SEARCH_MAX_PLY - 1 ? depth : SEARCH_MAX_PLY - 1;
+
+    SearchResult result;
+    if (!search_position(game, &limits, &result)) return false;
+
+    Move move = result.best_move;
+    snprintf(move_str, 6, "%c%c%c%c", 'a' + move.from.col, '8' - move.from.row, 'a' + move.to.col, '8' - move.to.row);
+    if (move.is_promotion) {
+        const char *letters = " prnbqk";
+        move_str[4] = letters[move.promotion_piece];
+        move_str[5] = '\0';
+    }
+
+    if (debug) {
+        printf("\nDEBUG: Built-in search - depth %d, score %+d, %llu nodes in %dms\n", result.depth,
+               result.score, (unsigned long long)result.nodes, result.time_ms);
+    }
+    return true;
+}
+
 void close_stockfish(StockfishEngine *engine) {
     if (engine->to_engine) {
         send_command(engine, "quit");
@@ -109,6 +220,7 @@ void close_stockfish(StockfishEngine *engine) {
     if (engine->pid > 0) {
         waitpid(engine->pid, NULL, 0);
     }
+    tt_free(&engine->table);
 }
 
 bool send_command(StockfishEngine *engine, const char *command) {
@@ -139,125 +251,78 @@ bool wait_for_ready(StockfishEngine *engine) {
     return false;
 }
 
-char piece_to_fen_char(Piece piece) {
-    if (piece.type == EMPTY) return '1';
-    
-    char symbols[] = {' ', 'P', 'R', 'N', 'B', 'Q', 'K'};
-    char c = symbols[piece.type];
-    
-    return piece.color == WHITE ? c : (c + 32);
-}
-
 /**
  * Convert chess board to FEN (Forsyth-Edwards Notation) string
- * FEN is the standard notation for describing chess positions and is
- * required for communicating positions to UCI-compatible chess engines.
+ * Convenience wrapper around fen_write() for single-threaded callers.
+ * Prefer fen_write() with a caller-owned buffer where reentrancy matters.
  * 
  * @param game Current game state to convert
  * @return Static buffer containing FEN string (do NOT free this!)
  */
 char* board_to_fen(ChessGame *game) {
-    static char fen[256];
-    char board_str[128] = "";
-    
-    for (int row = 0; row < BOARD_SIZE; row++) {
-        int empty_count = 0;
-        
-        for (int col = 0; col < BOARD_SIZE; col++) {
-            Piece piece = game->board[row][col];
-            
-            if (piece.type == EMPTY) {
-                empty_count++;
-            } else {
-                if (empty_count > 0) {
-                    char count_str[12];  // Enough for any int representation
-                    snprintf(count_str, sizeof(count_str), "%d", empty_count);
-                    strcat(board_str, count_str);
-                    empty_count = 0;
-                }
-                
-                char piece_char = piece_to_fen_char(piece);
-                strncat(board_str, &piece_char, 1);
-            }
-        }
-        
-        if (empty_count > 0) {
-            char count_str[12];  // Enough for any int representation
-            snprintf(count_str, sizeof(count_str), "%d", empty_count);
-            strcat(board_str, count_str);
-        }
-        
-        if (row < BOARD_SIZE - 1) {
-            strcat(board_str, "/");
-        }
-    }
-    
-    char active_color = game->current_player == WHITE ? 'w' : 'b';
-    
-    char castling[5] = "";
-    if (!game->white_king_moved) {
-        if (!game->white_rook_h_moved) strcat(castling, "K");
-        if (!game->white_rook_a_moved) strcat(castling, "Q");
-    }
-    if (!game->black_king_moved) {
-        if (!game->black_rook_h_moved) strcat(castling, "k");
-        if (!game->black_rook_a_moved) strcat(castling, "q");
-    }
-    if (strlen(castling) == 0) strcpy(castling, "-");
-    
-    // En passant target square
-    char en_passant[4] = "-";
-    if (game->en_passant_available && 
-        game->en_passant_target.row >= 0 && game->en_passant_target.row < 8 &&
-        game->en_passant_target.col >= 0 && game->en_passant_target.col < 8) {
-        char file = 'a' + game->en_passant_target.col;
-        char rank = '8' - game->en_passant_target.row;
-        sprintf(en_passant, "%c%c", file, rank);
-    }
-    
-    sprintf(fen, "%s %c %s %s %d %d", board_str, active_color, castling, en_passant,
-            game->halfmove_clock, game->fullmove_number);
+    static char fen[FEN_BUFFER_SIZE];
+    fen_write(game, fen, sizeof(fen));
     return fen;
 }
 
 /**
- * Request best move from Stockfish for current position
- * Converts game state to FEN notation, sends position to Stockfish,
- * requests analysis, and returns the recommended move.
- * 
+ * Send the current position to the engine as "position fen ..."
+ * The FEN is serialized straight into the command buffer so there is
+ * no intermediate copy or formatting pass.
+ *
  * @param engine Initialized Stockfish engine
- * @param game Current game state to analyze
- * @param move_str Buffer to store the returned move (e.g., "e2e4")
- * @return true if move obtained successfully, false on error
+ * @param game Game state to send
+ * @return true if the command was sent
  */
-bool get_best_move(StockfishEngine *engine, ChessGame *game, char *move_str, bool debug) {
-    if (!engine->is_ready) return false;
-    
-    char *fen = board_to_fen(game);
-    char position_command[512];
-    sprintf(position_command, "position fen %s", fen);
+static bool send_position(StockfishEngine *engine, ChessGame *game) {
+    static const char prefix[] = "position fen ";
+    char position_command[sizeof(prefix) + FEN_BUFFER_SIZE];
+
+    memcpy(position_command, prefix, sizeof(prefix) - 1);
+    fen_write(game, position_command + sizeof(prefix) - 1, FEN_BUFFER_SIZE);
+
+    return send_command(engine, position_command);
+}
+
+/**
+ * Ask the engine for a move under the game clock (body of get_best_move())
+ */
+static bool request_best_move(StockfishEngine *engine, ChessGame *game, char *move_str, bool debug) {
+    if (engine->builtin) {
+        int move_time = is_time_control_enabled(game) ? allocate_move_time(game) : SEARCH_DEFAULT_TIME_MS;
+        return builtin_best_move(engine, game, move_time, 0, move_str, debug);
+    }
     
-    send_command(engine, position_command);
+    uint64_t send_start = profile_begin();
+    send_position(engine, game);
 
     // Use time-based search if time controls are enabled, otherwise use depth-based
     if (is_time_control_enabled(game)) {
-        // Calculate appropriate time allocation for this move
-        int time_remaining = (game->current_player == WHITE) ?
-                           game->timer.white_time_seconds :
-                           game->timer.black_time_seconds;
-
-        // Use a fraction of remaining time with minimum/maximum bounds
-        int move_time = (time_remaining * 1000) / MOVE_TIME_DIVISOR;
-        if (move_time < MIN_MOVE_TIME_MS) move_time = MIN_MOVE_TIME_MS;
-        if (move_time > MAX_MOVE_TIME_MS) move_time = MAX_MOVE_TIME_MS;
-
-        char go_command[64];
-        sprintf(go_command, "go movetime %d", move_time);
+        // Pass both clocks and the moves to the next time control so
+        // Stockfish allocates its own time; in overtime, the period is
+        // all there is
+        ClockBudget white, black;
+        get_clock_budget(game, WHITE, &white);
+        get_clock_budget(game, BLACK, &black);
+        const ClockBudget *own = game->current_player == WHITE ? &white : &black;
+
+        char go_command[160];
+        if (own->time_ms == 0 && own->byoyomi_ms > 0) {
+            snprintf(go_command, sizeof(go_command), "go movetime %lld",
+                     (long long)(own->byoyomi_ms > 2 * MOVE_OVERHEAD_MS ? own->byoyomi_ms - MOVE_OVERHEAD_MS : own->byoyomi_ms / 2));
+        } else {
+            int length = snprintf(go_command, sizeof(go_command), "go wtime %lld btime %lld winc %lld binc %lld",
+                                  (long long)white.time_ms, (long long)black.time_ms,
+                                  (long long)white.increment_ms, (long long)black.increment_ms);
+            if (own->moves_to_go > 0) {
+                snprintf(go_command + length, sizeof(go_command) - length, " movestogo %d", own->moves_to_go);
+            }
+        }
 
         // Debug output for time allocation
         if (debug) {
-            printf("\nDEBUG: Stockfish time allocation - Remaining: %ds, Allocated: %dms\n",
-                   time_remaining, move_time);
+            printf("\nDEBUG: Stockfish time allocation - Remaining: %lldms, Sent: %s\n",
+                   (long long)own->time_ms, go_command);
         }
 
         send_command(engine, go_command);
@@ -267,6 +332,7 @@ bool get_best_move(StockfishEngine *engine, ChessGame *game, char *move_str, boo
         sprintf(depth_command, "go depth %d", DEFAULT_SEARCH_DEPTH);
         send_command(engine, depth_command);
     }
+    profile_end(PROFILE_ENGINE_SEND, send_start);
     
     char buffer[1024];
     while (read_response(engine, buffer, sizeof(buffer))) {
@@ -286,6 +352,94 @@ bool get_best_move(StockfishEngine *engine, ChessGame *game, char *move_str, boo
     return false;
 }
 
+/**
+ * Request best move from Stockfish for current position
+ * Converts game state to FEN notation, sends position to Stockfish,
+ * requests analysis, and returns the recommended move. The round trip is
+ * timed as PROFILE_ENGINE_MOVE when profiling is on.
+ * 
+ * @param engine Initialized Stockfish engine
+ * @param game Current game state to analyze
+ * @param move_str Buffer to store the returned move (e.g., "e2e4")
+ * @return true if move obtained successfully, false on error
+ */
+bool get_best_move(StockfishEngine *engine, ChessGame *game, char *move_str, bool debug) {
+    if (!engine->is_ready) return false;
+    uint64_t profile_start = profile_begin();
+    bool found = request_best_move(engine, game, move_str, debug);
+    profile_end(PROFILE_ENGINE_MOVE, profile_start);
+    return found;
+}
+
+/**
+ * Ask the engine for a move under explicit limits (body of get_best_move_limited())
+ */
+static bool request_best_move_limited(StockfishEngine *engine, ChessGame *game, int movetime_ms, int depth, char *move_str) {
+    if (engine->builtin) return builtin_best_move(engine, game, movetime_ms, depth, move_str, false);
+
+    uint64_t send_start = profile_begin();
+    send_position(engine, game);
+
+    char go_command[64];
+    if (movetime_ms <= 0 && depth <= 0) {
+        snprintf(go_command, sizeof(go_command), "go infinite");
+    } else if (depth <= 0) {
+        snprintf(go_command, sizeof(go_command), "go movetime %d", movetime_ms);
+    } else if (movetime_ms <= 0) {
+        snprintf(go_command, sizeof(go_command), "go depth %d", depth);
+    } else {
+        snprintf(go_command, sizeof(go_command), "go depth %d movetime %d", depth, movetime_ms);
+    }
+    send_command(engine, go_command);
+    profile_end(PROFILE_ENGINE_SEND, send_start);
+
+    char buffer[1024];
+    while (read_response(engine, buffer, sizeof(buffer))) {
+        if (strncmp(buffer, "bestmove", 8) == 0) {
+            char *move_start = buffer + 9;
+            move_start[strcspn(move_start, " \r\n")] = '\0';
+            snprintf(move_str, 6, "%s", move_start);
+            return strcmp(move_str, "(none") != 0;
+        }
+    }
+    return false;
+}
+
+/**
+ * Request best move with explicit limits instead of the game clock
+ * Used by the headless protocol (protocol.h). With neither limit the
+ * search runs until stop_search() is called.
+ *
+ * @param engine Initialized engine
+ * @param game Position to search
+ * @param movetime_ms Time budget in milliseconds (0 = none)
+ * @param depth Depth limit in plies (0 = none; the built-in engine then
+ *              applies its skill level cap)
+ * @param move_str Buffer for the move in UCI notation (at least 6 bytes)
+ * @return true if a move was obtained
+ */
+bool get_best_move_limited(StockfishEngine *engine, ChessGame *game, int movetime_ms, int depth, char *move_str) {
+    if (!engine->is_ready) return false;
+    uint64_t profile_start = profile_begin();
+    bool found = request_best_move_limited(engine, game, movetime_ms, depth, move_str);
+    profile_end(PROFILE_ENGINE_MOVE, profile_start);
+    return found;
+}
+
+/**
+ * End a running get_best_move_limited() early from another thread
+ * The search still answers with the best move found so far.
+ *
+ * @param engine Engine that is searching
+ */
+void stop_search(StockfishEngine *engine) {
+    if (engine->builtin) {
+        __atomic_store_n(&engine->stop_requested, true, __ATOMIC_RELAXED);
+    } else {
+        send_command(engine, "stop");
+    }
+}
+
 /**
  * Get hint move from Stockfish using fast depth-based search
  * Always uses depth-based search regardless of time control settings
@@ -299,12 +453,9 @@ bool get_best_move(StockfishEngine *engine, ChessGame *game, char *move_str, boo
  */
 bool get_hint_move(StockfishEngine *engine, ChessGame *game, char *move_str, bool debug) {
     if (!engine->is_ready) return false;
+    if (engine->builtin) return builtin_best_move(engine, game, SEARCH_DEFAULT_TIME_MS, 0, move_str, debug);
 
-    char *fen = board_to_fen(game);
-    char position_command[512];
-    sprintf(position_command, "position fen %s", fen);
-
-    send_command(engine, position_command);
+    send_position(engine, game);
 
     // Always use fast depth-based search for hints
     char go_command[32];
@@ -368,23 +519,61 @@ Move parse_move_string(const char *move_str) {
     return move;
 }
 
+/**
+ * Find the legal move a UCI move string stands for
+ * Supplies the piece and flags parse_move_string() cannot know; a
+ * promotion without a piece letter ("e7e8") promotes to a queen.
+ *
+ * @param game Position the move is played in
+ * @param move_str Move in UCI notation
+ * @param move Output: the legal move, ready for execute_move()
+ * @return false if the string is not a legal move in this position
+ */
+bool find_legal_uci_move(ChessGame *game, const char *move_str, Move *move) {
+    size_t length = strlen(move_str);
+    if (length < 4 || length > 5) return false;
+    Move wanted = parse_move_string(move_str);
+    if (length == 5 && !wanted.is_promotion) return false;
+
+    Move legal[MAX_LEGAL_MOVES];
+    int count = generate_legal_moves(game, legal);
+    for (int i = 0; i < count; i++) {
+        if (legal[i].from.row != wanted.from.row || legal[i].from.col != wanted.from.col) continue;
+        if (legal[i].to.row != wanted.to.row || legal[i].to.col != wanted.to.col) continue;
+        if (legal[i].is_promotion && legal[i].promotion_piece != (wanted.is_promotion ? wanted.promotion_piece : QUEEN)) continue;
+        *move = legal[i];
+        return true;
+    }
+    return false;
+}
+
 /**
  * Get position evaluation from Stockfish in centipawns
  * Sends position to Stockfish and requests evaluation analysis.
  * 
  * @param engine Pointer to initialized StockfishEngine
  * @param game Current game state to evaluate
- * @param centipawn_score Pointer to store the evaluation result
+ * @param centipawn_score Pointer to store the evaluation result (side to move's view, as UCI reports it)
  * @return true if evaluation successful, false on failure
  */
 bool get_position_evaluation(StockfishEngine *engine, ChessGame *game, int *centipawn_score) {
     if (!engine->is_ready) return false;
+    if (engine->builtin) {
+        SearchLimits limits = {SEARCH_MAX_PLY - 1, SEARCH_EVAL_TIME_MS, engine->threads, NULL, &engine->table};
+        SearchResult result;
+        if (search_position(game, &limits, &result)) {
+            *centipawn_score = result.score;
+            return true;
+        }
+
+        // No move: checkmate is lost for the side to move, stalemate is even
+        Move moves[MAX_LEGAL_MOVES];
+        if (generate_legal_moves(game, moves) > 0) return false;   // Search could not run
+        *centipawn_score = is_in_check(game, game->current_player) ? -SEARCH_MATE_SCORE : 0;
+        return true;
+    }
     
-    char *fen = board_to_fen(game);
-    char position_command[512];
-    sprintf(position_command, "position fen %s", fen);
-    
-    send_command(engine, position_command);
+    send_position(engine, game);
     send_command(engine, "go depth 15");  // Use deeper analysis for evaluation
     
     char buffer[1024];
@@ -436,6 +625,10 @@ bool set_skill_level(StockfishEngine *engine, int skill_level) {
     if (!engine->is_ready || skill_level < MIN_SKILL_LEVEL || skill_level > MAX_SKILL_LEVEL) {
         return false;
     }
+    if (engine->builtin) {
+        engine->skill_level = skill_level;
+        return true;
+    }
     
     char command[64];
     sprintf(command, "setoption name Skill Level value %d", skill_level);
@@ -443,7 +636,39 @@ bool set_skill_level(StockfishEngine *engine, int skill_level) {
     return send_command(engine, command);
 }
 
+/**
+ * Set the number of built-in search threads (Lazy SMP)
+ * Stockfish manages its own threads, so this only affects the built-in engine.
+ *
+ * @param engine Pointer to initialized built-in engine
+ * @param threads 1 to SEARCH_MAX_THREADS, or 0 for one per processor
+ * @return true if applied, false for a Stockfish engine or a bad count
+ */
+bool set_search_threads(StockfishEngine *engine, int threads) {
+    if (!engine->builtin || threads < 0 || threads > SEARCH_MAX_THREADS) return false;
+    engine->threads = threads;
+    return true;
+}
+
+/**
+ * Resize the built-in engine's transposition table (contents are lost)
+ * Stockfish has its own Hash option, so this only affects the built-in engine.
+ *
+ * @param engine Pointer to initialized built-in engine
+ * @param megabytes 1 to TT_MAX_MB
+ * @return false for a Stockfish engine, a bad size or a failed allocation
+ *         (the current table is kept)
+ */
+bool set_hash_size(StockfishEngine *engine, int megabytes) {
+    if (!engine->builtin || megabytes < 1 || megabytes > TT_MAX_MB) return false;
+    return tt_init(&engine->table, (size_t)megabytes);
+}
+
 bool get_stockfish_version(StockfishEngine *engine, char *version_str, size_t buffer_size) {
+    if (engine->builtin) {
+        snprintf(version_str, buffer_size, "Built-in Engine");
+        return true;
+    }
     if (!engine->to_engine || !engine->from_engine) return false;
     
     send_command(engine, "uci");
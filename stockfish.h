@@ -2,6 +2,7 @@
 #define STOCKFISH_H
 
 #include "chess.h"
+#include "tt.h"
 #include <unistd.h>
 #include <sys/wait.h>
 
@@ -10,19 +11,31 @@ typedef struct {
     FILE *from_engine;
     pid_t pid;
     bool is_ready;
+    bool builtin;        // Built-in search (search.h) instead of a Stockfish process
+    int skill_level;     // Skill level applied to the built-in search
+    int threads;         // Built-in search threads (0 = one per processor)
+    bool stop_requested; // Set by stop_search(); clear before starting a search that may be stopped
+    TranspositionTable table;  // Built-in search hash, private to this engine
 } StockfishEngine;
 
 bool init_stockfish(StockfishEngine *engine);
+bool init_uci_engine(StockfishEngine *engine, char *const command[]);
+bool init_builtin_engine(StockfishEngine *engine);
 void close_stockfish(StockfishEngine *engine);
 bool send_command(StockfishEngine *engine, const char *command);
 bool read_response(StockfishEngine *engine, char *buffer, size_t buffer_size);
 bool wait_for_ready(StockfishEngine *engine);
 char* board_to_fen(ChessGame *game);
 bool get_best_move(StockfishEngine *engine, ChessGame *game, char *move_str, bool debug);
+bool get_best_move_limited(StockfishEngine *engine, ChessGame *game, int movetime_ms, int depth, char *move_str);
+void stop_search(StockfishEngine *engine);
 bool get_hint_move(StockfishEngine *engine, ChessGame *game, char *move_str, bool debug);
 bool get_position_evaluation(StockfishEngine *engine, ChessGame *game, int *centipawn_score);
 bool set_skill_level(StockfishEngine *engine, int skill_level);
+bool set_search_threads(StockfishEngine *engine, int threads);
+bool set_hash_size(StockfishEngine *engine, int megabytes);
 Move parse_move_string(const char *move_str);
+bool find_legal_uci_move(ChessGame *game, const char *move_str, Move *move);
 bool get_stockfish_version(StockfishEngine *engine, char *version_str, size_t buffer_size);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,606 @@
+/**
+ * tablebase.c - Endgame Tablebase Generation and Probing
+ *
+ * Purpose:
+ *   Builds three-piece endgame tables by retrograde analysis, maps them
+ *   from disk and answers probes for the score display and the AI.
+ *
+ * Architecture:
+ *   - TbPosition is the normalized form of a position: White is the strong
+ *     side, squares are numbered rank * 8 + file from a1
+ *   - Generation enumerates every index, decodes it into a ChessGame and
+ *     records its successors once (internal indices, or fixed values for
+ *     captures and promotions into other tables); values are then resolved
+ *     in layers of increasing distance: a position wins in N if a successor
+ *     loses in N - 1, and loses in N if every successor wins and the
+ *     longest of those wins is N - 1. What never resolves is a draw
+ *   - Loaded tables are read-only memory maps; freshly generated tables
+ *     stay in memory until tablebase_free()
+ *
+ * Dependencies:
+ *   - chess.h: generate_legal_moves(), execute_move(), is_in_check()
+ */
+
+#define _GNU_SOURCE        // Required for Linux (mmap flags)
+
+#include "tablebase.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Entry encoding
+#define TB_VALUE_DRAW 0
+#define TB_VALUE_LOSS 128            // 128 + N: side to move is mated in N plies
+#define TB_VALUE_UNRESOLVED 254      // Only during generation
+#define TB_VALUE_ILLEGAL 255
+#define TB_MAX_DISTANCE 125          // Longest distance the encoding holds
+
+#define TB_PAWNLESS_ENTRIES (10 * 64 * 64 * 2)
+#define TB_PAWN_ENTRIES (24 * 64 * 64 * 2)
+
+/**
+ * TbPosition - Three-piece position normalized to White as the strong side
+ */
+typedef struct {
+    int white_king;          // Square (rank * 8 + file, a1 = 0)
+    int black_king;
+    int piece;               // Square of the strong side's extra piece
+    PieceType type;          // Extra piece type (EMPTY for bare kings)
+    Color to_move;
+} TbPosition;
+
+/**
+ * TbTable - One table, mapped from disk or generated in memory
+ */
+typedef struct {
+    const uint8_t *entries;  // Entry bytes (NULL if the table is not available)
+    size_t entry_count;
+    void *mapping;           // mmap() base, or NULL for generated tables
+    size_t mapping_size;
+} TbTable;
+
+static TbTable tb_tables[7];   // Indexed by PieceType of the extra piece
+
+static const char *TB_PIECE_LETTERS = " PRNBQK";
+
+// a1-d1-d4 triangle squares used for the white king in pawnless tables
+static const int TB_TRIANGLE[64] = {
+     0,  1,  2,  3, -1, -1, -1, -1,
+    -1,  4,  5,  6, -1, -1, -1, -1,
+    -1, -1,  7,  8, -1, -1, -1, -1,
+    -1, -1, -1,  9, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1
+};
+static const int TB_TRIANGLE_SQUARES[10] = {0, 1, 2, 3, 9, 10, 11, 18, 19, 27};
+
+/******************************************************************************
+ *                          POSITION NORMALIZATION
+ ******************************************************************************/
+
+static int tb_square(int row, int col) {
+    return (7 - row) * 8 + col;
+}
+
+static size_t tb_entry_count(PieceType type) {
+    return type == PAWN ? TB_PAWN_ENTRIES : TB_PAWNLESS_ENTRIES;
+}
+
+/**
+ * Check whether either side could still castle
+ */
+static bool tb_can_castle(const ChessGame *game) {
+    for (int color = WHITE; color <= BLACK; color++) {
+        int row = color == WHITE ? 7 : 0;
+        bool king_moved = color == WHITE ? game->white_king_moved : game->black_king_moved;
+        bool rook_a_moved = color == WHITE ? game->white_rook_a_moved : game->black_rook_a_moved;
+        bool rook_h_moved = color == WHITE ? game->white_rook_h_moved : game->black_rook_h_moved;
+        Piece king = game->board[row][4];
+        if (king_moved || king.type != KING || king.color != (Color)color) continue;
+
+        Piece rook_a = game->board[row][0];
+        Piece rook_h = game->board[row][7];
+        if ((!rook_a_moved && rook_a.type == ROOK && rook_a.color == (Color)color) ||
+            (!rook_h_moved && rook_h.type == ROOK && rook_h.color == (Color)color)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Normalize a game position (at most one piece besides the kings)
+ *
+ * @param flipped Output: true if colors were swapped and the board mirrored
+ * @return false if the position has more material, castling rights or a
+ *         pawn on the first or last rank (outside the pawn table)
+ */
+static bool tb_from_game(const ChessGame *game, TbPosition *pos, bool *flipped) {
+    int kings[2] = {-1, -1};
+    int extra_square = -1;
+    Color extra_color = WHITE;
+    PieceType extra_type = EMPTY;
+
+    for (int row = 0; row < BOARD_SIZE; row++) {
+        for (int col = 0; col < BOARD_SIZE; col++) {
+            Piece piece = game->board[row][col];
+            if (piece.type == EMPTY) continue;
+            if (piece.type == KING) {
+                kings[piece.color] = tb_square(row, col);
+            } else {
+                if (extra_type != EMPTY) return false;
+                if (piece.type == PAWN && (row == 0 || row == BOARD_SIZE - 1)) return false;
+                extra_type = piece.type;
+                extra_color = piece.color;
+                extra_square = tb_square(row, col);
+            }
+        }
+    }
+    if (kings[WHITE] < 0 || kings[BLACK] < 0 || tb_can_castle(game)) return false;
+
+    *flipped = extra_type != EMPTY && extra_color == BLACK;
+    if (*flipped) {
+        pos->white_king = kings[BLACK] ^ 56;
+        pos->black_king = kings[WHITE] ^ 56;
+        pos->piece = extra_square ^ 56;
+        pos->to_move = game->current_player == WHITE ? BLACK : WHITE;
+    } else {
+        pos->white_king = kings[WHITE];
+        pos->black_king = kings[BLACK];
+        pos->piece = extra_square;
+        pos->to_move = game->current_player;
+    }
+    pos->type = extra_type;
+    return true;
+}
+
+/**
+ * Table index of a normalized position (applies the board symmetries)
+ */
+static size_t tb_index(const TbPosition *pos) {
+    int white_king = pos->white_king, black_king = pos->black_king, piece = pos->piece;
+
+    if (pos->type == PAWN) {
+        if ((piece & 7) > 3) {
+            white_king ^= 7;
+            black_king ^= 7;
+            piece ^= 7;
+        }
+        size_t pawn = (size_t)((piece >> 3) - 1) * 4 + (piece & 7);
+        return ((pawn * 64 + (size_t)white_king) * 64 + (size_t)black_king) * 2 + pos->to_move;
+    }
+
+    if ((white_king & 7) > 3) {
+        white_king ^= 7;
+        black_king ^= 7;
+        piece ^= 7;
+    }
+    if ((white_king >> 3) > 3) {
+        white_king ^= 56;
+        black_king ^= 56;
+        piece ^= 56;
+    }
+    if ((white_king >> 3) > (white_king & 7)) {
+        white_king = ((white_king & 7) << 3) | (white_king >> 3);
+        black_king = ((black_king & 7) << 3) | (black_king >> 3);
+        piece = ((piece & 7) << 3) | (piece >> 3);
+    }
+    return (((size_t)TB_TRIANGLE[white_king] * 64 + (size_t)black_king) * 64 + (size_t)piece) * 2 + pos->to_move;
+}
+
+/**
+ * Decode a table index into a normalized position
+ */
+static void tb_decode(PieceType type, size_t index, TbPosition *pos) {
+    pos->type = type;
+    pos->to_move = (Color)(index & 1);
+    index >>= 1;
+
+    if (type == PAWN) {
+        pos->black_king = (int)(index & 63);
+        pos->white_king = (int)((index >> 6) & 63);
+        int pawn = (int)(index >> 12);
+        pos->piece = (pawn / 4 + 1) * 8 + pawn % 4;
+    } else {
+        pos->piece = (int)(index & 63);
+        pos->black_king = (int)((index >> 6) & 63);
+        pos->white_king = TB_TRIANGLE_SQUARES[index >> 12];
+    }
+}
+
+/**
+ * Build the ChessGame for a normalized position (no castling, no en passant)
+ */
+static void tb_to_game(const TbPosition *pos, ChessGame *game) {
+    memset(game, 0, sizeof(*game));
+    game->board[7 - (pos->white_king >> 3)][pos->white_king & 7] = (Piece){KING, WHITE};
+    game->board[7 - (pos->black_king >> 3)][pos->black_king & 7] = (Piece){KING, BLACK};
+    if (pos->type != EMPTY) {
+        game->board[7 - (pos->piece >> 3)][pos->piece & 7] = (Piece){pos->type, WHITE};
+    }
+    game->white_king_pos = (Position){7 - (pos->white_king >> 3), pos->white_king & 7};
+    game->black_king_pos = (Position){7 - (pos->black_king >> 3), pos->black_king & 7};
+    game->white_king_moved = game->black_king_moved = true;
+    game->white_rook_a_moved = game->white_rook_h_moved = true;
+    game->black_rook_a_moved = game->black_rook_h_moved = true;
+    game->en_passant_target = (Position){-1, -1};
+    game->current_player = pos->to_move;
+    game->fullmove_number = 1;
+}
+
+/**
+ * Check that a decoded position can occur: distinct squares, kings apart
+ * and the side not to move not in check
+ */
+static bool tb_is_legal(const TbPosition *pos, ChessGame *game) {
+    if (pos->white_king == pos->black_king || pos->piece == pos->white_king || pos->piece == pos->black_king) {
+        return false;
+    }
+    int rank_gap = abs((pos->white_king >> 3) - (pos->black_king >> 3));
+    int file_gap = abs((pos->white_king & 7) - (pos->black_king & 7));
+    if (rank_gap <= 1 && file_gap <= 1) return false;
+
+    tb_to_game(pos, game);
+    return !is_in_check(game, pos->to_move == WHITE ? BLACK : WHITE);
+}
+
+/**
+ * Stored value of a normalized position, or TB_VALUE_ILLEGAL if unknown
+ * Bare kings and a lone minor piece are draws without a table.
+ */
+static uint8_t tb_lookup(const TbPosition *pos) {
+    if (pos->type == EMPTY || pos->type == KNIGHT || pos->type == BISHOP) return TB_VALUE_DRAW;
+
+    const TbTable *table = &tb_tables[pos->type];
+    if (!table->entries) return TB_VALUE_ILLEGAL;
+    return table->entries[tb_index(pos)];
+}
+
+static bool tb_decode_value(uint8_t value, TbResult *result) {
+    if (value >= TB_VALUE_UNRESOLVED) return false;
+    if (value == TB_VALUE_DRAW) {
+        result->wdl = TB_DRAW;
+        result->distance = 0;
+    } else if (value < TB_VALUE_LOSS) {
+        result->wdl = TB_WIN;
+        result->distance = value;
+    } else {
+        result->wdl = TB_LOSS;
+        result->distance = value - TB_VALUE_LOSS;
+    }
+    return true;
+}
+
+/******************************************************************************
+ *                                 LOADING
+ ******************************************************************************/
+
+static void tb_release(TbTable *table) {
+    if (table->mapping) {
+        munmap(table->mapping, table->mapping_size);
+    } else {
+        free((void *)table->entries);
+    }
+    memset(table, 0, sizeof(*table));
+}
+
+static void tb_file_name(PieceType type, const char *directory, char *path, size_t size) {
+    snprintf(path, size, "%s/K%cvK.ctb", directory, TB_PIECE_LETTERS[type]);
+}
+
+/**
+ * Map one table file, replacing any table of the same type
+ */
+static bool tb_map(PieceType type, const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat file_stat;
+    size_t expected = TABLEBASE_HEADER_SIZE + tb_entry_count(type);
+    if (fstat(fd, &file_stat) != 0 || (size_t)file_stat.st_size != expected) {
+        close(fd);
+        return false;
+    }
+
+    void *mapping = mmap(NULL, expected, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) return false;
+
+    const uint8_t *header = mapping;
+    if (memcmp(header, TABLEBASE_MAGIC, 4) != 0 || header[4] != (uint8_t)type) {
+        munmap(mapping, expected);
+        return false;
+    }
+
+    tb_release(&tb_tables[type]);
+    tb_tables[type].entries = header + TABLEBASE_HEADER_SIZE;
+    tb_tables[type].entry_count = tb_entry_count(type);
+    tb_tables[type].mapping = mapping;
+    tb_tables[type].mapping_size = expected;
+    return true;
+}
+
+/**
+ * Map every table file found in a directory
+ *
+ * @param directory Directory holding KQvK.ctb, KRvK.ctb, KPvK.ctb
+ * @return Number of tables loaded
+ */
+int tablebase_init(const char *directory) {
+    const PieceType types[] = {QUEEN, ROOK, PAWN};
+    int loaded = 0;
+
+    for (int i = 0; i < 3; i++) {
+        char path[1024];
+        tb_file_name(types[i], directory, path, sizeof(path));
+        if (tb_map(types[i], path)) loaded++;
+    }
+    return loaded;
+}
+
+/**
+ * Unmap and free all tables
+ */
+void tablebase_free(void) {
+    for (int type = 0; type < 7; type++) {
+        tb_release(&tb_tables[type]);
+    }
+}
+
+/**
+ * Largest number of pieces (kings included) that can be probed
+ *
+ * @return TABLEBASE_MAX_PIECES if any table is loaded, otherwise 0
+ */
+int tablebase_max_pieces(void) {
+    for (int type = 0; type < 7; type++) {
+        if (tb_tables[type].entries) return TABLEBASE_MAX_PIECES;
+    }
+    return 0;
+}
+
+/******************************************************************************
+ *                                 PROBING
+ ******************************************************************************/
+
+/**
+ * Probe a position
+ *
+ * @param game Position to probe
+ * @param result Output: result and distance for the side to move
+ * @return false if the position is not covered by the loaded tables
+ */
+bool tablebase_probe(const ChessGame *game, TbResult *result) {
+    TbPosition pos;
+    bool flipped;
+    if (!tb_from_game(game, &pos, &flipped)) return false;
+    return tb_decode_value(tb_lookup(&pos), result);
+}
+
+/**
+ * Find the best move in a covered position
+ * Wins take the fastest mate, losses the longest resistance, draws any
+ * move that keeps the draw.
+ *
+ * @param game Position to play from (not modified)
+ * @param move Output: best move (promotion fields set)
+ * @param result Output: result of the position for the side to move
+ * @return false if the position is not covered or has no legal moves
+ */
+bool tablebase_best_move(ChessGame *game, Move *move, TbResult *result) {
+    if (!tablebase_probe(game, result)) return false;
+
+    Move moves[MAX_LEGAL_MOVES];
+    int count = generate_legal_moves(game, moves);
+    int best = -1;
+    int best_score = 0;
+
+    for (int i = 0; i < count; i++) {
+        ChessGame after = *game;
+        TbResult reply;
+        if (!execute_move(&after, moves[i]) || !tablebase_probe(&after, &reply)) continue;
+
+        // Score from the mover's view: the opponent losing fast is best
+        int score;
+        if (reply.wdl == TB_LOSS) score = 1000 - reply.distance;
+        else if (reply.wdl == TB_DRAW) score = 0;
+        else score = -1000 + reply.distance;
+
+        if (best < 0 || score > best_score) {
+            best = i;
+            best_score = score;
+        }
+    }
+
+    if (best < 0) return false;
+    *move = moves[best];
+    return true;
+}
+
+/******************************************************************************
+ *                               GENERATION
+ ******************************************************************************/
+
+/**
+ * Growable successor list in compressed-row form
+ * Non-negative items are indices in the table being generated; negative
+ * items are fixed values, stored as -(1 + value).
+ */
+typedef struct {
+    int32_t *items;
+    size_t count;
+    size_t capacity;
+} TbSuccessors;
+
+static bool tb_push_successor(TbSuccessors *list, int32_t item) {
+    if (list->count == list->capacity) {
+        size_t grown = list->capacity ? list->capacity * 2 : 1 << 20;
+        int32_t *resized = realloc(list->items, grown * sizeof(int32_t));
+        if (!resized) return false;
+        list->items = resized;
+        list->capacity = grown;
+    }
+    list->items[list->count++] = item;
+    return true;
+}
+
+/**
+ * Write a table file
+ */
+static bool tb_write(PieceType type, const uint8_t *entries, size_t count, int longest, const char *directory) {
+    char path[1024];
+    tb_file_name(type, directory, path, sizeof(path));
+    FILE *file = fopen(path, "wb");
+    if (!file) return false;
+
+    uint8_t header[TABLEBASE_HEADER_SIZE] = {0};
+    memcpy(header, TABLEBASE_MAGIC, 4);
+    header[4] = (uint8_t)type;
+    for (int i = 0; i < 4; i++) {
+        header[8 + i] = (uint8_t)(count >> (8 * i));
+        header[12 + i] = (uint8_t)((uint32_t)longest >> (8 * i));
+    }
+
+    bool ok = fwrite(header, 1, sizeof(header), file) == sizeof(header) &&
+              fwrite(entries, 1, count, file) == count;
+    if (fclose(file) != 0) ok = false;
+    return ok;
+}
+
+/**
+ * Generate the KXvK table by retrograde analysis, write it and load it
+ * The pawn table needs the queen and rook tables for promotions and
+ * generates them first if they are not loaded.
+ *
+ * @param piece QUEEN, ROOK or PAWN
+ * @param directory Output directory
+ * @return true if the table was written and is now loaded
+ */
+bool tablebase_generate(PieceType piece, const char *directory) {
+    if (piece != QUEEN && piece != ROOK && piece != PAWN) return false;
+    if (piece == PAWN) {
+        if (!tb_tables[QUEEN].entries && !tablebase_generate(QUEEN, directory)) return false;
+        if (!tb_tables[ROOK].entries && !tablebase_generate(ROOK, directory)) return false;
+    }
+
+    size_t count = tb_entry_count(piece);
+    uint8_t *values = malloc(count);
+    uint32_t *offsets = malloc((count + 1) * sizeof(uint32_t));
+    TbSuccessors successors = {NULL, 0, 0};
+    bool ok = values && offsets;
+    int external_longest = 0;
+
+    // Pass 1: legality, terminal positions and successor lists
+    for (size_t index = 0; ok && index < count; index++) {
+        TbPosition pos;
+        ChessGame game;
+        offsets[index] = (uint32_t)successors.count;
+        tb_decode(piece, index, &pos);
+
+        if (!tb_is_legal(&pos, &game)) {
+            values[index] = TB_VALUE_ILLEGAL;
+            continue;
+        }
+
+        Move moves[MAX_LEGAL_MOVES];
+        int move_count = generate_legal_moves(&game, moves);
+        if (move_count == 0) {
+            values[index] = is_in_check(&game, pos.to_move) ? TB_VALUE_LOSS : TB_VALUE_DRAW;
+            continue;
+        }
+        values[index] = TB_VALUE_UNRESOLVED;
+
+        for (int i = 0; ok && i < move_count; i++) {
+            TbPosition next = pos;
+            int from = tb_square(moves[i].from.row, moves[i].from.col);
+            int to = tb_square(moves[i].to.row, moves[i].to.col);
+            next.to_move = pos.to_move == WHITE ? BLACK : WHITE;
+
+            if (from == pos.white_king) next.white_king = to;
+            else if (from == pos.black_king) next.black_king = to;
+            else next.piece = to;
+            if (from != pos.piece && to == pos.piece) next.type = EMPTY;   // Captured
+            if (moves[i].is_promotion) next.type = moves[i].promotion_piece;
+
+            if (next.type == piece) {
+                ok = tb_push_successor(&successors, (int32_t)tb_index(&next));
+            } else {
+                uint8_t value = tb_lookup(&next);
+                TbResult external;
+                if (tb_decode_value(value, &external) && external.distance > external_longest) {
+                    external_longest = external.distance;
+                }
+                ok = value != TB_VALUE_ILLEGAL && tb_push_successor(&successors, -(1 + (int32_t)value));
+            }
+        }
+    }
+    if (ok) offsets[count] = (uint32_t)successors.count;
+
+    // Pass 2: resolve layer by layer
+    int longest = 0;
+    int empty_layers = 0;
+    for (int distance = 1; ok && distance <= TB_MAX_DISTANCE; distance++) {
+        bool changed = false;
+
+        for (size_t index = 0; index < count; index++) {
+            if (values[index] != TB_VALUE_UNRESOLVED) continue;
+
+            bool all_win = true;
+            bool wins = false;
+            int longest_win = 0;
+            for (uint32_t s = offsets[index]; s < offsets[index + 1]; s++) {
+                int32_t item = successors.items[s];
+                uint8_t value = item >= 0 ? values[item] : (uint8_t)(-item - 1);
+
+                if (value >= TB_VALUE_LOSS && value < TB_VALUE_UNRESOLVED && value - TB_VALUE_LOSS == distance - 1) {
+                    wins = true;
+                    break;
+                }
+                if (value > TB_VALUE_DRAW && value < TB_VALUE_LOSS) {
+                    if (value > longest_win) longest_win = value;
+                } else {
+                    all_win = false;
+                }
+            }
+
+            if (wins) {
+                values[index] = (uint8_t)distance;
+                changed = true;
+            } else if (all_win && longest_win == distance - 1) {
+                values[index] = (uint8_t)(TB_VALUE_LOSS + distance);
+                changed = true;
+            }
+        }
+
+        if (changed) {
+            longest = distance;
+            empty_layers = 0;
+        } else if (++empty_layers >= 2 && distance > external_longest + 1) {
+            break;
+        }
+    }
+
+    for (size_t index = 0; ok && index < count; index++) {
+        if (values[index] == TB_VALUE_UNRESOLVED) values[index] = TB_VALUE_DRAW;
+    }
+
+    free(successors.items);
+    free(offsets);
+    if (ok) ok = tb_write(piece, values, count, longest, directory);
+    if (!ok) {
+        free(values);
+        return false;
+    }
+
+    tb_release(&tb_tables[piece]);
+    tb_tables[piece].entries = values;
+    tb_tables[piece].entry_count = count;
+    return true;
+}
@@ -0,0 +1,71 @@
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+
+/**
+ * tablebase.h - Endgame Tablebase Generation and Probing
+ *
+ * Purpose:
+ *   Answers endgame positions exactly and instantly: win/draw/loss, the
+ *   distance to mate and the best move, without asking the engine. Used by
+ *   the score display and the AI move choice.
+ *
+ * Coverage:
+ *   Three-piece endings KQvK, KRvK and KPvK (either side strong) from
+ *   table files; KvK, KBvK and KNvK are answered as draws without a table.
+ *   Positions with castling rights are never probed.
+ *
+ * File layout ("<material>.ctb", e.g. KQvK.ctb, all integers little-endian):
+ *   header   magic "CTB1", uint8 strong piece type, 3 reserved bytes,
+ *            uint32 entry count, uint32 longest distance (plies)
+ *   entries  one byte per index: 0 draw, 1-127 win in N plies,
+ *            128+N loss in N plies, 255 illegal position
+ *
+ * Architecture:
+ *   - Positions are normalized so White is the strong side; pawnless
+ *     tables also fold the 8 board symmetries onto the a1-d1-d4 triangle
+ *     for the white king, pawn tables fold the a-d/e-h file mirror
+ *   - Tables are built by retrograde analysis over chess.c's legal move
+ *     generator (make_tablebase) and memory-mapped read-only when loaded
+ *   - The stored distance is the exact distance to mate, so it also serves
+ *     as the distance to zeroing for these endings (a capture ends in KvK)
+ *
+ * Dependencies:
+ *   - chess.h for ChessGame, Move and generate_legal_moves()
+ */
+
+#include "chess.h"
+
+#define TABLEBASE_MAGIC "CTB1"
+#define TABLEBASE_HEADER_SIZE 16      // Bytes before the entries
+#define TABLEBASE_MAX_PIECES 3        // Largest endings the tables cover
+
+/**
+ * TbWdl - Game-theoretic result for the side to move
+ */
+typedef enum {
+    TB_LOSS = -1,
+    TB_DRAW = 0,
+    TB_WIN = 1
+} TbWdl;
+
+/**
+ * TbResult - Outcome of a tablebase probe
+ */
+typedef struct {
+    TbWdl wdl;          // Result with best play, from the side to move's view
+    int distance;       // Plies to mate with best play (0 for draws)
+} TbResult;
+
+// Loading
+int tablebase_init(const char *directory);  // Map all tables in a directory; tables loaded
+void tablebase_free(void);  // Unmap all tables
+int tablebase_max_pieces(void);  // Largest piece count that can be probed (0 if none)
+
+// Probing
+bool tablebase_probe(const ChessGame *game, TbResult *result);  // WDL and distance of a position
+bool tablebase_best_move(ChessGame *game, Move *move, TbResult *result);  // Best move and the position's result
+
+// Generation
+bool tablebase_generate(PieceType piece, const char *directory);  // Build and load the KXvK table
+
+#endif // TABLEBASE_H
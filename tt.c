@@ -0,0 +1,249 @@
+/**
+ * tt.c - Shared Transposition Table for the Built-in Search
+ *
+ * Purpose:
+ *   Lock-free bucketed hash table of search results.
+ *
+ * Architecture:
+ *   - Slot data packs into one 64-bit word:
+ *       bits  0-15 move, 16-31 score, 32-39 depth, 40-41 bound,
+ *       42-47 generation
+ *   - Words are read and written with relaxed atomic loads and stores
+ *     (GCC/Clang __atomic builtins), which cannot tear a single word;
+ *     the XOR check catches two words written by different threads
+ *   - The bucket index is the low bits of the key; the full key is
+ *     verified, so only the table size limits accuracy
+ *   - The generation is a plain field of the table: it changes only in
+ *     tt_new_search(), which the owning engine calls before its search
+ *     threads are created
+ *
+ * Dependencies:
+ *   - None
+ */
+
+#define _GNU_SOURCE        // Required for Linux (posix_memalign)
+
+#include "tt.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define TT_GENERATION_MASK 63           // 6-bit search generation
+#define TT_AGE_PENALTY 8                // Depth a slot loses per generation of age
+#define TT_HASHFULL_SAMPLE 1000         // Buckets sampled by tt_hashfull()
+
+/**
+ * TTSlot - One entry as stored: packed data and key ^ data
+ */
+typedef struct {
+    uint64_t data;
+    uint64_t check;
+} TTSlot;
+
+/**
+ * TTBucket - One cache line of slots
+ */
+typedef struct TTBucket {
+    TTSlot slots[TT_BUCKET_SLOTS];
+} TTBucket;
+
+/******************************************************************************
+ *                                 PACKING
+ ******************************************************************************/
+
+static uint64_t tt_pack(int depth, int score, int bound, uint16_t move, uint8_t generation) {
+    return (uint64_t)move |
+           (uint64_t)(uint16_t)(int16_t)score << 16 |
+           (uint64_t)(uint8_t)(int8_t)depth << 32 |
+           (uint64_t)(bound & 3) << 40 |
+           (uint64_t)(generation & TT_GENERATION_MASK) << 42;
+}
+
+static void tt_unpack(uint64_t word, TTData *data) {
+    data->move = (uint16_t)word;
+    data->score = (int16_t)(uint16_t)(word >> 16);
+    data->depth = (int8_t)(uint8_t)(word >> 32);
+    data->bound = (uint8_t)((word >> 40) & 3);
+}
+
+static uint8_t tt_slot_generation(uint64_t word) {
+    return (uint8_t)((word >> 42) & TT_GENERATION_MASK);
+}
+
+static uint64_t tt_load(const uint64_t *word) {
+    return __atomic_load_n(word, __ATOMIC_RELAXED);
+}
+
+static void tt_write(uint64_t *word, uint64_t value) {
+    __atomic_store_n(word, value, __ATOMIC_RELAXED);
+}
+
+/******************************************************************************
+ *                                  SETUP
+ ******************************************************************************/
+
+/**
+ * Allocate the table, replacing any previous one
+ *
+ * @param table Table to set up (zero-initialized or previously allocated)
+ * @param megabytes Size in MB (1 to TT_MAX_MB); the bucket count is rounded
+ *                  down to a power of two
+ * @return false if the size is out of range or allocation failed (the
+ *         previous table is kept in that case)
+ */
+bool tt_init(TranspositionTable *table, size_t megabytes) {
+    if (megabytes < 1 || megabytes > TT_MAX_MB) return false;
+
+    size_t count = 1;
+    while (count * 2 * sizeof(TTBucket) <= megabytes * 1024 * 1024) count *= 2;
+
+    void *memory = NULL;
+    if (posix_memalign(&memory, sizeof(TTBucket), count * sizeof(TTBucket)) != 0) return false;
+    memset(memory, 0, count * sizeof(TTBucket));
+
+    free(table->buckets);
+    table->buckets = memory;
+    table->bucket_count = count;
+    table->generation = 0;
+    return true;
+}
+
+/**
+ * Release the table
+ *
+ * @param table Table to release (left zeroed, safe to free twice)
+ */
+void tt_free(TranspositionTable *table) {
+    free(table->buckets);
+    table->buckets = NULL;
+    table->bucket_count = 0;
+    table->generation = 0;
+}
+
+/**
+ * Empty every slot
+ *
+ * @param table Table to clear
+ */
+void tt_clear(TranspositionTable *table) {
+    if (table->buckets) memset(table->buckets, 0, table->bucket_count * sizeof(TTBucket));
+    table->generation = 0;
+}
+
+/**
+ * Allocated size
+ *
+ * @param table Table to measure
+ * @return Size in MB, 0 if no table is allocated
+ */
+size_t tt_size_mb(const TranspositionTable *table) {
+    return table->bucket_count * sizeof(TTBucket) / (1024 * 1024);
+}
+
+/******************************************************************************
+ *                                   USE
+ ******************************************************************************/
+
+/**
+ * Start a new search generation; results from older searches become the
+ * first candidates for replacement
+ * Called by the table's owner before its search threads start.
+ *
+ * @param table Table of the engine about to search
+ */
+void tt_new_search(TranspositionTable *table) {
+    table->generation = (table->generation + 1) & TT_GENERATION_MASK;
+}
+
+/**
+ * Look up a position
+ *
+ * @param table Table to search
+ * @param key position_hash() of the position
+ * @param data Output: stored result
+ * @return true if a verified slot for the key exists
+ */
+bool tt_probe(const TranspositionTable *table, uint64_t key, TTData *data) {
+    if (!table->buckets) return false;
+    TTBucket *bucket = &table->buckets[key & (table->bucket_count - 1)];
+
+    for (int i = 0; i < TT_BUCKET_SLOTS; i++) {
+        uint64_t word = tt_load(&bucket->slots[i].data);
+        uint64_t check = tt_load(&bucket->slots[i].check);
+        if ((word ^ check) == key && word != 0) {
+            tt_unpack(word, data);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Record a search result
+ *
+ * @param table Table to write
+ * @param key position_hash() of the position
+ * @param depth Remaining depth searched
+ * @param score Score to store (caller adjusts mate scores)
+ * @param bound TT_BOUND_EXACT, TT_BOUND_LOWER or TT_BOUND_UPPER
+ * @param move Best move (cgr_pack_move), 0 if none; an existing move for
+ *             the same position is kept when 0
+ */
+void tt_store(TranspositionTable *table, uint64_t key, int depth, int score, int bound, uint16_t move) {
+    if (!table->buckets) return;
+    TTBucket *bucket = &table->buckets[key & (table->bucket_count - 1)];
+    uint8_t generation = table->generation;
+    TTSlot *victim = NULL;
+    int victim_worth = 0;
+
+    for (int i = 0; i < TT_BUCKET_SLOTS; i++) {
+        TTSlot *slot = &bucket->slots[i];
+        uint64_t word = tt_load(&slot->data);
+        uint64_t check = tt_load(&slot->check);
+
+        if (word != 0 && (word ^ check) == key) {
+            TTData old;
+            tt_unpack(word, &old);
+
+            // Depth-preferred: a shallower bound never overwrites a deeper result
+            if (bound != TT_BOUND_EXACT && old.depth > depth && tt_slot_generation(word) == generation) return;
+            if (move == 0) move = old.move;
+            victim = slot;
+            break;
+        }
+
+        int worth = -1000;   // Empty slots go first
+        if (word != 0) {
+            int age = (generation - tt_slot_generation(word)) & TT_GENERATION_MASK;
+            worth = (int8_t)(uint8_t)(word >> 32) - TT_AGE_PENALTY * age;
+        }
+        if (!victim || worth < victim_worth) {
+            victim = slot;
+            victim_worth = worth;
+        }
+    }
+
+    uint64_t word = tt_pack(depth, score, bound, move, generation);
+    tt_write(&victim->data, word);
+    tt_write(&victim->check, key ^ word);
+}
+
+/**
+ * Estimate how full the table is with results from the current search
+ *
+ * @param table Table to sample
+ * @return Permille of the first slots sampled that belong to this generation
+ */
+int tt_hashfull(const TranspositionTable *table) {
+    if (!table->buckets) return 0;
+    size_t sample = table->bucket_count < TT_HASHFULL_SAMPLE ? table->bucket_count : TT_HASHFULL_SAMPLE;
+    int used = 0;
+
+    for (size_t b = 0; b < sample; b++) {
+        for (int i = 0; i < TT_BUCKET_SLOTS; i++) {
+            uint64_t word = tt_load(&table->buckets[b].slots[i].data);
+            if (word != 0 && tt_slot_generation(word) == table->generation) used++;
+        }
+    }
+    return (int)(used * 1000 / (sample * TT_BUCKET_SLOTS));
+}
@@ -0,0 +1,78 @@
+#ifndef TT_H
+#define TT_H
+
+/**
+ * tt.h - Shared Transposition Table for the Built-in Search
+ *
+ * Purpose:
+ *   Remembers searched positions (score, bound, depth, best move) so the
+ *   search can reuse work across transpositions, iterations and moves.
+ *   Each built-in engine owns one table, shared by the threads of its
+ *   search; engines playing at the same time never share a table.
+ *
+ * Layout:
+ *   - Buckets of TT_BUCKET_SLOTS 16-byte slots, 64 bytes per bucket and
+ *     allocated on 64-byte boundaries, so a probe touches one cache line
+ *   - Each slot is two 64-bit words: the packed data and (key XOR data).
+ *     A probe accepts a slot only if the XOR of both words gives back the
+ *     key, so a slot torn by two threads writing at once reads as a miss
+ *     instead of returning another position's data. No locks are taken
+ *
+ * Replacement:
+ *   Within the key's bucket, the slot holding the same position is
+ *   refreshed (a deeper result from the same search is kept unless the
+ *   new one is exact); otherwise the slot with the lowest depth, less 8
+ *   plies per search generation of age, is replaced. tt_new_search() advances the
+ *   table's generation so entries from earlier moves age out first. Only
+ *   the owner calls it, once per search and before the search threads
+ *   start, so every thread of a search sees the same generation.
+ *
+ * Dependencies:
+ *   - None (keys come from position_hash())
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define TT_BUCKET_SLOTS 4               // Slots per 64-byte bucket
+#define TT_DEFAULT_MB 16                // Table size when none is configured
+#define TT_MAX_MB 4096                  // Largest configurable size
+
+// Bound types (never 0, so an empty slot is never valid data)
+#define TT_BOUND_UPPER 1                // Score is at most the stored value (fail low)
+#define TT_BOUND_LOWER 2                // Score is at least the stored value (fail high)
+#define TT_BOUND_EXACT 3
+
+/**
+ * TTData - Unpacked contents of one slot
+ */
+typedef struct {
+    uint16_t move;           // Best move (cgr_pack_move), 0 if none
+    int16_t score;           // Score as stored (mate scores relative to the node)
+    int8_t depth;            // Remaining depth of the stored search
+    uint8_t bound;           // TT_BOUND_*
+} TTData;
+
+/**
+ * TranspositionTable - One engine's table (zero-initialized = not allocated)
+ */
+typedef struct {
+    struct TTBucket *buckets;           // Allocated by tt_init()
+    size_t bucket_count;                // Power of two
+    uint8_t generation;                 // Current search generation (6 bits)
+} TranspositionTable;
+
+// Setup
+bool tt_init(TranspositionTable *table, size_t megabytes);  // Allocate (rounded down to a power of two buckets); replaces any table
+void tt_free(TranspositionTable *table);  // Release the table
+void tt_clear(TranspositionTable *table);  // Empty every slot (new game)
+size_t tt_size_mb(const TranspositionTable *table);  // Allocated size in MB (0 if none)
+
+// Use
+void tt_new_search(TranspositionTable *table);  // Advance the generation before each search (owner only)
+bool tt_probe(const TranspositionTable *table, uint64_t key, TTData *data);  // Look up a position
+void tt_store(TranspositionTable *table, uint64_t key, int depth, int score, int bound, uint16_t move);  // Record a search result
+int tt_hashfull(const TranspositionTable *table);  // Permille of sampled slots written this generation
+
+#endif // TT_H